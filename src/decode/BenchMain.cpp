@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "decode/bench/SyntheticProject.h"
+#include "decode/core/Diagnostics.h"
+#include "decode/core/Configuration.h"
+#include "decode/core/PathUtils.h"
+#include "decode/core/Tracer.h"
+#include "decode/core/Utils.h"
+#include "decode/parser/Lexer.h"
+#include "decode/parser/Project.h"
+#include "decode/generator/Generator.h"
+
+#include <bmcl/Buffer.h>
+#include <bmcl/Result.h>
+
+#include <tclap/CmdLine.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+
+using namespace decode;
+
+using Samples = std::map<std::string, std::vector<std::uint64_t>>;
+
+static std::uint64_t microsecondsSince(Tracer::Clock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(Tracer::Clock::now() - start).count();
+}
+
+static std::string samplesToJson(const SyntheticProjectConfig& config, unsigned iterations, Samples* samples)
+{
+    std::string dest;
+    dest.append("{\n  \"config\": {\"modules\": ");
+    dest.append(std::to_string(config.moduleCount));
+    dest.append(", \"types_per_module\": ");
+    dest.append(std::to_string(config.typesPerModule));
+    dest.append(", \"components\": ");
+    dest.append(std::to_string(config.componentCount));
+    dest.append(", \"cmds_per_component\": ");
+    dest.append(std::to_string(config.cmdsPerComponent));
+    dest.append(", \"statuses_per_component\": ");
+    dest.append(std::to_string(config.statusesPerComponent));
+    dest.append(", \"events_per_component\": ");
+    dest.append(std::to_string(config.eventsPerComponent));
+    dest.append(", \"generics\": ");
+    dest.append(config.useGenerics ? "true" : "false");
+    dest.append("},\n  \"iterations\": ");
+    dest.append(std::to_string(iterations));
+    dest.append(",\n  \"benchmarks\": [");
+    bool isFirst = true;
+    for (auto& it : *samples) {
+        std::vector<std::uint64_t>& values = it.second;
+        if (values.empty()) {
+            continue;
+        }
+        std::sort(values.begin(), values.end());
+        std::uint64_t sum = 0;
+        for (std::uint64_t value : values) {
+            sum += value;
+        }
+        if (!isFirst) {
+            dest.push_back(',');
+        }
+        isFirst = false;
+        dest.append("\n    {\"name\": \"");
+        dest.append(it.first);
+        dest.append("\", \"min_us\": ");
+        dest.append(std::to_string(values.front()));
+        dest.append(", \"median_us\": ");
+        dest.append(std::to_string(values[values.size() / 2]));
+        dest.append(", \"mean_us\": ");
+        dest.append(std::to_string(sum / values.size()));
+        dest.append(", \"max_us\": ");
+        dest.append(std::to_string(values.back()));
+        dest.push_back('}');
+    }
+    dest.append("\n  ]\n}\n");
+    return dest;
+}
+
+int main(int argc, char* argv[])
+{
+    TCLAP::CmdLine cmdLine("Decode generator benchmark on a synthetic project");
+    TCLAP::ValueArg<std::string> workPathArg("o", "out", "Working directory for synthetic project and generated sources", false, "./decode-bench", "path");
+    TCLAP::ValueArg<std::string> jsonPathArg("r", "results", "Results json file, stdout if not set", false, "", "path");
+    TCLAP::ValueArg<unsigned> iterationsArg("i", "iterations", "Number of measured iterations", false, 5, "count");
+    TCLAP::ValueArg<unsigned> modulesArg("m", "modules", "Number of modules", false, 8, "count");
+    TCLAP::ValueArg<unsigned> typesArg("t", "types", "Number of types per module", false, 16, "count");
+    TCLAP::ValueArg<unsigned> componentsArg("k", "components", "Number of modules with components", false, 4, "count");
+    TCLAP::ValueArg<unsigned> cmdsArg("c", "cmds", "Number of commands per component", false, 8, "count");
+    TCLAP::ValueArg<unsigned> statusesArg("s", "statuses", "Number of statuses per component", false, 4, "count");
+    TCLAP::ValueArg<unsigned> eventsArg("e", "events", "Number of events per component", false, 4, "count");
+    TCLAP::SwitchArg noGenericsArg("g", "no-generics", "Do not use generic types", false);
+
+    cmdLine.add(&workPathArg);
+    cmdLine.add(&jsonPathArg);
+    cmdLine.add(&iterationsArg);
+    cmdLine.add(&modulesArg);
+    cmdLine.add(&typesArg);
+    cmdLine.add(&componentsArg);
+    cmdLine.add(&cmdsArg);
+    cmdLine.add(&statusesArg);
+    cmdLine.add(&eventsArg);
+    cmdLine.add(&noGenericsArg);
+    cmdLine.parse(argc, argv);
+
+    SyntheticProjectConfig config;
+    config.moduleCount = std::max(1u, modulesArg.getValue());
+    config.typesPerModule = typesArg.getValue();
+    config.componentCount = componentsArg.getValue();
+    config.cmdsPerComponent = cmdsArg.getValue();
+    config.statusesPerComponent = statusesArg.getValue();
+    config.eventsPerComponent = eventsArg.getValue();
+    config.useGenerics = !noGenericsArg.getValue();
+
+    Rc<Diagnostics> diag = new Diagnostics;
+    std::string projectDir = joinPath(workPathArg.getValue(), "project");
+    SyntheticProject synthetic(config);
+    if (!synthetic.generate(projectDir, diag.get())) {
+        diag->printReports(&std::cerr);
+        return -1;
+    }
+
+    std::vector<std::string> decodeSources;
+    for (const std::string& path : synthetic.decodeFilePaths()) {
+        std::ifstream stream(path, std::ios::binary);
+        decodeSources.emplace_back(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+    }
+
+    std::string genDir = joinPath(workPathArg.getValue(), "gen");
+    GeneratorConfig genCfg;
+    Samples samples;
+    unsigned iterations = std::max(1u, iterationsArg.getValue());
+    for (unsigned i = 0; i < iterations; i++) {
+        auto start = Tracer::Clock::now();
+        for (const std::string& src : decodeSources) {
+            Lexer lexer(src);
+            Token token;
+            do {
+                lexer.consumeNextToken(&token);
+            } while (token.kind() != TokenKind::Eof);
+        }
+        samples["Lexer"].push_back(microsecondsSince(start));
+
+        Rc<Tracer> tracer = new Tracer;
+        Tracer::setCurrent(tracer.get());
+        Rc<Configuration> cfg = new Configuration;
+        ProjectResult proj = Project::fromFile(cfg.get(), diag.get(), synthetic.projectFilePath().c_str());
+        bool isOk = proj.isOk() && proj.unwrap()->generate(genDir.c_str(), genCfg);
+        Tracer::setCurrent(nullptr);
+        if (!isOk) {
+            diag->printReports(&std::cerr);
+            return -1;
+        }
+        for (const auto& it : tracer->durationsByName()) {
+            samples[it.first].push_back(it.second);
+        }
+
+        start = Tracer::Clock::now();
+        bmcl::Buffer encoded = proj.unwrap()->encode();
+        samples["Project::encode"].push_back(microsecondsSince(start));
+
+        start = Tracer::Clock::now();
+        ProjectResult decoded = Project::decodeFromMemory(diag.get(), encoded.data(), encoded.size());
+        samples["Project::decodeFromMemory"].push_back(microsecondsSince(start));
+        if (decoded.isErr()) {
+            diag->printReports(&std::cerr);
+            return -1;
+        }
+    }
+
+    std::string json = samplesToJson(config, iterations, &samples);
+    if (jsonPathArg.getValue().empty()) {
+        std::cout << json;
+    } else if (!saveOutput(jsonPathArg.getValue(), json, diag.get())) {
+        diag->printReports(&std::cerr);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "decode/core/Diagnostics.h"
+#include "decode/core/ProgressPrinter.h"
+#include "decode/parser/Project.h"
+#include "decode/runtime/LogDecoder.h"
+#include "decode/runtime/TmArchive.h"
+
+#include <bmcl/Result.h>
+
+#include <tclap/CmdLine.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <future>
+#include <memory>
+#include <thread>
+
+using namespace decode;
+
+int main(int argc, char* argv[])
+{
+    TCLAP::CmdLine cmdLine("Decode recorded downlink log");
+    TCLAP::ValueArg<std::string> packagePathArg("k", "package", "Encoded project (Package.bin)", true, "./Package.bin", "path");
+    TCLAP::ValueArg<std::string> inPathArg("i", "in", "Recorded log file", true, "./downlink.log", "path");
+    TCLAP::ValueArg<std::string> outPathArg("o", "out", "Output file, stdout if not set", false, "", "path");
+    TCLAP::ValueArg<unsigned> threadsArg("t", "threads", "Number of decoding threads, 0 to use all cores", false, 0, "number");
+    TCLAP::ValueArg<unsigned> chunkSizeArg("c", "chunk-size", "Approximate size of a decoded chunk", false, 4, "MiB");
+    TCLAP::ValueArg<std::string> archivePathArg("a", "archive", "Also write statuses to columnar archive, frame index is used as time", false, "", "path");
+    TCLAP::SwitchArg verbLevelArg("v", "verbose", "Enable verbose output", false);
+
+    cmdLine.add(&packagePathArg);
+    cmdLine.add(&inPathArg);
+    cmdLine.add(&outPathArg);
+    cmdLine.add(&threadsArg);
+    cmdLine.add(&chunkSizeArg);
+    cmdLine.add(&archivePathArg);
+    cmdLine.add(&verbLevelArg);
+    cmdLine.parse(argc, argv);
+
+    ProgressPrinter printer(verbLevelArg.getValue());
+    Rc<Diagnostics> diag = new Diagnostics;
+
+    MappedFileResult packageFile = MappedFile::open(packagePathArg.getValue().c_str());
+    if (packageFile.isErr()) {
+        std::cerr << "error opening package: " << packageFile.unwrapErr() << std::endl;
+        return -1;
+    }
+    bmcl::Bytes packageData = packageFile.unwrap()->data();
+    ProjectResult proj = Project::decodeFromMemory(diag.get(), packageData.data(), packageData.size());
+    if (proj.isErr()) {
+        diag->printReports(&std::cerr);
+        return -1;
+    }
+
+    MappedFileResult logFile = MappedFile::open(inPathArg.getValue().c_str());
+    if (logFile.isErr()) {
+        std::cerr << "error opening log: " << logFile.unwrapErr() << std::endl;
+        return -1;
+    }
+    bmcl::Bytes log = logFile.unwrap()->data();
+
+    std::FILE* out = stdout;
+    if (!outPathArg.getValue().empty()) {
+        out = std::fopen(outPathArg.getValue().c_str(), "wb");
+        if (!out) {
+            std::cerr << "error opening output file" << std::endl;
+            return -1;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<LogFrame> frames;
+    std::size_t errorOffset = 0;
+    bool isSplit = LogDecoder::splitFrames(log, &frames, &errorOffset);
+    if (!isSplit) {
+        std::cerr << "truncated frame at offset " << errorOffset << ", decoding preceding frames only" << std::endl;
+    }
+
+    std::size_t chunkSize = std::max(1u, chunkSizeArg.getValue()) * 1024 * 1024;
+    std::vector<std::size_t> chunkStarts;
+    std::size_t currentSize = chunkSize;
+    for (std::size_t i = 0; i < frames.size(); i++) {
+        if (currentSize >= chunkSize) {
+            chunkStarts.push_back(i);
+            currentSize = 0;
+        }
+        currentSize += frames[i].size;
+    }
+    chunkStarts.push_back(frames.size());
+
+    unsigned threadNum = threadsArg.getValue();
+    if (threadNum == 0) {
+        threadNum = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    Rc<LogDecoder> decoder = new LogDecoder(proj.unwrap()->package());
+    auto decodeChunk = [&](std::size_t chunk) {
+        std::size_t first = chunkStarts[chunk];
+        std::size_t last = chunkStarts[chunk + 1];
+        std::unique_ptr<LogChunkResult> result(new LogChunkResult);
+        decoder->decodeFrames(log, bmcl::ArrayView<LogFrame>(frames.data() + first, last - first), first, result.get());
+        return result;
+    };
+
+    // chunks are decoded concurrently but written in order, only a bounded window is kept in memory
+    std::size_t chunkNum = chunkStarts.size() - 1;
+    std::size_t nextChunk = 0;
+    std::size_t messageNum = 0;
+    std::size_t errorNum = 0;
+    std::deque<std::future<std::unique_ptr<LogChunkResult>>> pending;
+    while (nextChunk < chunkNum || !pending.empty()) {
+        while (nextChunk < chunkNum && pending.size() < threadNum * 2) {
+            pending.push_back(std::async(std::launch::async, decodeChunk, nextChunk));
+            nextChunk++;
+        }
+        std::unique_ptr<LogChunkResult> result = pending.front().get();
+        pending.pop_front();
+        std::fwrite(result->output.data(), 1, result->output.size(), out);
+        messageNum += result->messages;
+        errorNum += result->errors;
+    }
+
+    if (out != stdout) {
+        std::fclose(out);
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1000000.0;
+    if (seconds == 0) {
+        seconds = 1e-6;
+    }
+    double mbPerSecond = log.size() / seconds / (1024 * 1024);
+    double msgsPerSecond = messageNum / seconds;
+
+    printer.printActionProgress("Decoded", std::to_string(frames.size()) + " frames, "
+                                + std::to_string(messageNum) + " messages, "
+                                + std::to_string(errorNum) + " errors");
+    printer.printActionProgress("Finished", "in " + std::to_string(seconds) + "s ("
+                                + std::to_string(mbPerSecond) + " MiB/s, "
+                                + std::to_string(msgsPerSecond) + " msgs/s, "
+                                + std::to_string(threadNum) + " threads)");
+
+    if (!archivePathArg.getValue().empty()) {
+        Rc<TmArchiveWriter> archive = new TmArchiveWriter(proj.unwrap()->package());
+        if (!archive->open(archivePathArg.getValue().c_str())) {
+            std::cerr << "error opening archive file" << std::endl;
+            return -1;
+        }
+        std::size_t skipped = 0;
+        for (std::size_t i = 0; i < frames.size(); i++) {
+            if (!archive->appendFrame(i, bmcl::Bytes(log.data() + frames[i].offset, frames[i].size))) {
+                skipped++;
+            }
+        }
+        if (!archive->finish()) {
+            std::cerr << "error writing archive file" << std::endl;
+            return -1;
+        }
+        printer.printActionProgress("Archived", std::to_string(frames.size() - skipped) + " frames, "
+                                    + std::to_string(skipped) + " partially skipped");
+    }
+
+    return (isSplit && errorNum == 0) ? 0 : 1;
+}
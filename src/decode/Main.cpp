@@ -9,6 +9,7 @@
 #include "decode/core/Diagnostics.h"
 #include "decode/core/Configuration.h"
 #include "decode/core/ProgressPrinter.h"
+#include "decode/core/Tracer.h"
 #include "decode/parser/Project.h"
 #include "decode/generator/Generator.h"
 
@@ -29,6 +30,20 @@ int main(int argc, char* argv[])
     TCLAP::SwitchArg verbLevelArg("v", "verbose", "Enable verbose output", false);
     TCLAP::ValueArg<unsigned> compLevelArg("c", "compression-level", "Package compression level", false, 4, "0-5");
     TCLAP::SwitchArg absArg("a", "abs-path", "Use absolute paths for bundled src", false);
+    TCLAP::SwitchArg segArg("s", "segmented-writer", "Generate serializers for segmented frame writers", false);
+    TCLAP::SwitchArg eventQueueArg("e", "event-queue", "Queue events through a lock-free ring buffer", false);
+    TCLAP::SwitchArg seqlockArg("l", "seqlock-vars", "Protect component variables with sequence locks", false);
+    TCLAP::SwitchArg journalArg("j", "autosave-journal", "Track changed saved variables for incremental autosave", false);
+    TCLAP::SwitchArg paramTableArg("t", "param-table", "Generate parameter access table", false);
+    std::vector<std::string> embedModes = {"array", "embed", "incbin", "elf"};
+    TCLAP::ValuesConstraint<std::string> embedConstraint(embedModes);
+    TCLAP::ValueArg<std::string> embedArg("b", "package-embed", "Package blob embedding mode", false, "array", &embedConstraint);
+    TCLAP::ValueArg<std::string> objectTargetArg("", "package-target", "Target architecture of elf package object", false, "arm", "arm|aarch64|i386|x86_64|riscv32|riscv64");
+    TCLAP::ValueArg<std::string> traceArg("", "trace", "Write chrome trace event json with generator phase timings", false, "", "path");
+    TCLAP::SwitchArg specializeArg("", "specialize-devices", "Also generate pruned onboard sources for each device", false);
+    TCLAP::ValueArg<unsigned> instrumentationArg("i", "instrumentation", "Generated code instrumentation level, 1 - per message counters, 2 - counters and cycles", false, 0, "0-2");
+    TCLAP::SwitchArg binLogArg("g", "binary-log", "Replace log messages in generated code with numeric ids written to a binary log", false);
+    TCLAP::ValueArg<unsigned> shardsArg("n", "shards", "Split onboard device sources into N translation units", false, 1, "count");
 
     cmdLine.add(&inPathArg);
     cmdLine.add(&outPathArg);
@@ -36,8 +51,26 @@ int main(int argc, char* argv[])
     cmdLine.add(&verbLevelArg);
     cmdLine.add(&compLevelArg);
     cmdLine.add(&absArg);
+    cmdLine.add(&segArg);
+    cmdLine.add(&eventQueueArg);
+    cmdLine.add(&seqlockArg);
+    cmdLine.add(&journalArg);
+    cmdLine.add(&paramTableArg);
+    cmdLine.add(&shardsArg);
+    cmdLine.add(&embedArg);
+    cmdLine.add(&objectTargetArg);
+    cmdLine.add(&specializeArg);
+    cmdLine.add(&traceArg);
+    cmdLine.add(&instrumentationArg);
+    cmdLine.add(&binLogArg);
     cmdLine.parse(argc, argv);
 
+    Rc<Tracer> tracer;
+    if (traceArg.isSet()) {
+        tracer = new Tracer;
+        Tracer::setCurrent(tracer.get());
+    }
+
     auto start = std::chrono::steady_clock::now();
     Rc<Configuration> cfg = new Configuration;
 
@@ -57,8 +90,30 @@ int main(int argc, char* argv[])
 
     GeneratorConfig genCfg;
     genCfg.useAbsolutePathsForBundledSources = absArg.getValue();
+    genCfg.useSegmentedWriter = segArg.getValue();
+    genCfg.useEventQueue = eventQueueArg.getValue();
+    genCfg.useSeqlockVars = seqlockArg.getValue();
+    genCfg.useAutosaveJournal = journalArg.getValue();
+    genCfg.useParamTable = paramTableArg.getValue();
+    genCfg.onboardShardCount = std::max(1u, shardsArg.getValue());
+    if (embedArg.getValue() == "embed") {
+        genCfg.packageEmbedMode = PackageEmbedMode::Embed;
+    } else if (embedArg.getValue() == "incbin") {
+        genCfg.packageEmbedMode = PackageEmbedMode::Incbin;
+    } else if (embedArg.getValue() == "elf") {
+        genCfg.packageEmbedMode = PackageEmbedMode::Elf;
+    }
+    genCfg.packageObjectTarget = objectTargetArg.getValue();
+    genCfg.specializeDevices = specializeArg.getValue();
+    genCfg.instrumentationLevel = std::min(2u, instrumentationArg.getValue());
+    genCfg.useBinaryLog = binLogArg.getValue();
     proj.unwrap()->generate(outPathArg.getValue().c_str(), genCfg);
 
+    if (!tracer.isNull()) {
+        Tracer::setCurrent(nullptr);
+        tracer->saveJson(traceArg.getValue(), diag.get());
+    }
+
     auto end = std::chrono::steady_clock::now();
     auto delta = end - start;
     ProgressPrinter printer(cfg->verboseOutput());
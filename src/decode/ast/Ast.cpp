@@ -15,13 +15,15 @@
 #include "decode/ast/Constant.h"
 #include "decode/ast/Component.h"
 #include "decode/ast/AllBuiltinTypes.h"
+#include "decode/ast/TypeInterner.h"
 
 #include <bmcl/Option.h>
 
 namespace decode {
 
-Ast::Ast(AllBuiltinTypes* builtinTypes)
+Ast::Ast(AllBuiltinTypes* builtinTypes, TypeInterner* typeInterner)
     : _allBuiltins(builtinTypes)
+    , _typeInterner(typeInterner)
 {
 }
 
@@ -211,4 +213,9 @@ AllBuiltinTypes* Ast::builtinTypes()
 {
     return _allBuiltins.get();
 }
+
+TypeInterner* Ast::typeInterner()
+{
+    return _typeInterner.get();
+}
 }
@@ -34,6 +34,7 @@ class TypeDecl;
 class Component;
 class Constant;
 class AllBuiltinTypes;
+class TypeInterner;
 
 class Ast : public RefCountable {
 public:
@@ -46,7 +47,7 @@ public:
     using Imports = RcVec<ImportDecl>;
     using ImplBlocks = RcSecondUnorderedMap<Rc<Type>, ImplBlock>;
 
-    Ast(AllBuiltinTypes* builtinTypes);
+    Ast(AllBuiltinTypes* builtinTypes, TypeInterner* typeInterner);
     ~Ast();
 
     Types::ConstIterator typesBegin() const;
@@ -86,6 +87,7 @@ public:
 
     const AllBuiltinTypes* builtinTypes() const;
     AllBuiltinTypes* builtinTypes();
+    TypeInterner* typeInterner();
 
 private:
     Imports _importDecls;
@@ -98,6 +100,7 @@ private:
     Rc<const ModuleInfo> _moduleInfo;
     Rc<ModuleDecl> _moduleDecl;
     Rc<AllBuiltinTypes> _allBuiltins;
+    Rc<TypeInterner> _typeInterner;
 };
 
 }
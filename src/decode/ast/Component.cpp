@@ -196,6 +196,14 @@ bool VarRegexp::hasAccessors() const
     return !_accessors.empty();
 }
 
+bmcl::OptionPtr<const Field> VarRegexp::rootField() const
+{
+    if (_accessors.empty() || _accessors.front()->accessorKind() != AccessorKind::Field) {
+        return bmcl::None;
+    }
+    return _accessors.front()->asFieldAccessor()->field();
+}
+
 void VarRegexp::addAccessor(Accessor* acc)
 {
     _accessors.emplace_back(acc);
@@ -679,12 +687,17 @@ bmcl::OptionPtr<Field> Component::varWithName(bmcl::StringView name)
 
 bmcl::OptionPtr<const Command> Component::cmdWithName(bmcl::StringView name) const
 {
-    for (const Rc<Command>& value : _cmds) {
-        if (value->name() == name) {
-            return value.get();
-        }
-    }
-    return bmcl::None;
+    return _cmdNameToCmd.findValueWithKey(name);
+}
+
+bmcl::OptionPtr<const StatusMsg> Component::statusWithName(bmcl::StringView name) const
+{
+    return _statuses.findValueWithKey(name);
+}
+
+bmcl::OptionPtr<const EventMsg> Component::eventWithName(bmcl::StringView name) const
+{
+    return _events.findValueWithKey(name);
 }
 
 void Component::addVar(Field* vars)
@@ -695,6 +708,7 @@ void Component::addVar(Field* vars)
 void Component::addCommand(Command* func)
 {
     _cmds.emplace_back(func);
+    _cmdNameToCmd.emplace(std::piecewise_construct, std::forward_as_tuple(func->name()), std::forward_as_tuple(func));
 }
 
 bool Component::addStatus(StatusMsg* msg)
@@ -126,6 +126,7 @@ public:
     Accessors::ConstIterator accessorsEnd() const;
     Accessors::ConstRange accessorsRange() const;
     bool hasAccessors() const;
+    bmcl::OptionPtr<const Field> rootField() const;
 
     void addAccessor(Accessor* acc);
 
@@ -307,6 +308,8 @@ public:
     bmcl::OptionPtr<const Field> varWithName(bmcl::StringView name) const;
     bmcl::OptionPtr<Field> varWithName(bmcl::StringView name);
     bmcl::OptionPtr<const Command> cmdWithName(bmcl::StringView name) const;
+    bmcl::OptionPtr<const StatusMsg> statusWithName(bmcl::StringView name) const;
+    bmcl::OptionPtr<const EventMsg> eventWithName(bmcl::StringView name) const;
 
     void addVar(Field* var); //TODO: check name conflicts
     void addCommand(Command* func); //TODO: check name conflicts
@@ -321,6 +324,7 @@ private:
     std::size_t _number;
     Vars _vars;
     Cmds _cmds;
+    RcSecondUnorderedMap<bmcl::StringView, Command> _cmdNameToCmd;
     Statuses _statuses;
     Events _events;
     Params _params;
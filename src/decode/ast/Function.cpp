@@ -11,6 +11,9 @@
 #include "decode/ast/Field.h"
 #include "decode/ast/Component.h"
 #include "decode/core/EncodedSizes.h"
+#include "decode/core/CfgOption.h"
+
+#include <bmcl/OptionPtr.h>
 
 namespace decode {
 
@@ -131,4 +134,22 @@ EncodedSizes Command::encodedSizes() const
     }
     return sizes;
 }
+
+bmcl::OptionPtr<const CfgOption> Command::cfgOption() const
+{
+    return _cfgOption.get();
+}
+
+void Command::setCfgOption(const CfgOption* opt)
+{
+    _cfgOption.reset(opt);
+}
+
+bool Command::matchesConfiguration(const Configuration* cfg) const
+{
+    if (_cfgOption.isNull()) {
+        return true;
+    }
+    return _cfgOption->matchesConfiguration(cfg);
+}
 }
@@ -25,6 +25,8 @@ class FunctionType;
 class Field;
 class Type;
 class ModuleInfo;
+class CfgOption;
+class Configuration;
 struct EncodedSizes;
 
 class Function : public NamedRc, public DocBlockMixin {
@@ -85,8 +87,13 @@ public:
 
     EncodedSizes encodedSizes() const;
 
+    bmcl::OptionPtr<const CfgOption> cfgOption() const;
+    void setCfgOption(const CfgOption* opt);
+    bool matchesConfiguration(const Configuration* cfg) const;
+
 private:
     ArgVec _args;
+    Rc<const CfgOption> _cfgOption;
     std::uintmax_t _number;
 };
 }
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "decode/ast/TypeInterner.h"
+#include "decode/ast/Type.h"
+#include "decode/ast/Field.h"
+#include "decode/ast/Ast.h"
+
+#include <algorithm>
+#include <functional>
+
+namespace decode {
+
+bool TypeInterner::Key::operator==(const Key& other) const
+{
+    return kind == other.kind && value == other.value && children == other.children;
+}
+
+std::size_t TypeInterner::KeyHash::operator()(const Key& key) const
+{
+    std::size_t hash = std::hash<std::uintmax_t>()(key.value) ^ ((std::size_t)key.kind << 1);
+    for (const Type* child : key.children) {
+        hash ^= std::hash<const Type*>()(child) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    }
+    return hash;
+}
+
+TypeInterner::TypeInterner()
+{
+}
+
+TypeInterner::~TypeInterner()
+{
+}
+
+// child types are interned before their parents, so comparing them by pointer is enough
+bool TypeInterner::makeKey(const Type* type, Key* key)
+{
+    key->kind = type->typeKind();
+    switch (type->typeKind()) {
+    case TypeKind::Reference: {
+        const ReferenceType* ref = type->asReference();
+        key->value = (ref->referenceKind() == ReferenceKind::Pointer ? 2 : 0) | (ref->isMutable() ? 1 : 0);
+        key->children.push_back(ref->pointee());
+        return true;
+    }
+    case TypeKind::Array:
+        key->value = type->asArray()->elementCount();
+        key->children.push_back(type->asArray()->elementType());
+        return true;
+    case TypeKind::DynArray:
+        key->value = type->asDynArray()->maxSize();
+        key->children.push_back(type->asDynArray()->elementType());
+        return true;
+    case TypeKind::Function: {
+        const FunctionType* func = type->asFunction();
+        key->value = func->selfArgument().isSome() ? (std::uintmax_t)func->selfArgument().unwrap() + 1 : 0;
+        key->children.push_back(func->hasReturnValue() ? func->returnValue().unwrap() : nullptr);
+        for (const Field* arg : func->argumentsRange()) {
+            if (!arg->name().isEmpty() || arg->rangeAttribute().isSome()) {
+                return false;
+            }
+            key->children.push_back(arg->type());
+        }
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+Type* TypeInterner::intern(Type* type, Ast* ast)
+{
+    Key key;
+    if (!makeKey(type, &key)) {
+        ast->addType(type);
+        return type;
+    }
+    auto it = _types.emplace(std::move(key), Entry{type, std::vector<const Ast*>()});
+    Entry& entry = it.first->second;
+    if (std::find(entry.modules.begin(), entry.modules.end(), ast) == entry.modules.end()) {
+        ast->addType(entry.type.get());
+        entry.modules.push_back(ast);
+    }
+    return entry.type.get();
+}
+
+std::size_t TypeInterner::size() const
+{
+    return _types.size();
+}
+}
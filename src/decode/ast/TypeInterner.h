@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "decode/Config.h"
+#include "decode/core/Rc.h"
+#include "decode/core/HashMap.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace decode {
+
+class Ast;
+class Type;
+enum class TypeKind;
+
+// keeps a single node for each distinct reference, array, dyn array and function pointer type of a package,
+// structurally equal types are then equal by pointer
+class TypeInterner : public RefCountable {
+public:
+    using Pointer = Rc<TypeInterner>;
+    using ConstPointer = Rc<const TypeInterner>;
+
+    TypeInterner();
+    ~TypeInterner();
+
+    // returns previously interned type equal to the given one or the type itself,
+    // result is added to module types once per module
+    Type* intern(Type* type, Ast* ast);
+
+    std::size_t size() const;
+
+private:
+    struct Key {
+        bool operator==(const Key& other) const;
+
+        TypeKind kind;
+        std::uintmax_t value;
+        std::vector<const Type*> children;
+    };
+
+    struct KeyHash {
+        std::size_t operator()(const Key& key) const;
+    };
+
+    struct Entry {
+        Rc<Type> type;
+        // modules the type was added to, interning order across modules is arbitrary
+        // (var regexps are resolved after all modules are parsed), so the last one is not enough
+        std::vector<const Ast*> modules;
+    };
+
+    static bool makeKey(const Type* type, Key* key);
+
+    HashMap<Key, Entry, KeyHash> _types;
+};
+}
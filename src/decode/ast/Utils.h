@@ -20,13 +20,11 @@ static const decode::Ast* findModule(const decode::Device* dev, bmcl::StringView
     if (!dev) {
         return nullptr;
     }
-    auto it = std::find_if(dev->modules().begin(), dev->modules().end(), [name](const decode::Ast* module) {
-        return module->moduleName() == name;
-    });
-    if (it == dev->modules().end()) {
+    bmcl::OptionPtr<const decode::Ast> module = dev->moduleWithName(name);
+    if (module.isNone()) {
         return nullptr;
     }
-    return *it;
+    return module.unwrap();
 }
 
 static const decode::Component* getComponent(const decode::Ast* ast)
@@ -101,16 +99,14 @@ static const decode::Command* findCmd(const decode::Component* comp, bmcl::Strin
     if (!comp) {
         return nullptr;
     }
-    auto it = std::find_if(comp->cmdsBegin(), comp->cmdsEnd(), [name](const decode::Command* func) {
-        return func->name() == name;
-    });
-    if (it == comp->cmdsEnd()) {
+    bmcl::OptionPtr<const decode::Command> cmd = comp->cmdWithName(name);
+    if (cmd.isNone()) {
         return nullptr;
     }
-    if (it->fieldsRange().size() != argNum) {
+    if (cmd->fieldsRange().size() != argNum) {
         return nullptr;
     }
-    return *it;
+    return cmd.unwrap();
 }
 
 static const decode::StatusMsg* findStatusMsg(const decode::Component* comp, bmcl::StringView name)
@@ -118,13 +114,11 @@ static const decode::StatusMsg* findStatusMsg(const decode::Component* comp, bmc
     if (!comp) {
         return nullptr;
     }
-    auto it = std::find_if(comp->statusesBegin(), comp->statusesEnd(), [name](const decode::StatusMsg* msg) {
-        return msg->name() == name;
-    });
-    if (it == comp->statusesEnd()) {
+    bmcl::OptionPtr<const decode::StatusMsg> msg = comp->statusWithName(name);
+    if (msg.isNone()) {
         return nullptr;
     }
-    return *it;
+    return msg.unwrap();
 }
 
 static const decode::EventMsg* findEventMsg(const decode::Component* comp, bmcl::StringView name)
@@ -132,13 +126,11 @@ static const decode::EventMsg* findEventMsg(const decode::Component* comp, bmcl:
     if (!comp) {
         return nullptr;
     }
-    auto it = std::find_if(comp->eventsBegin(), comp->eventsEnd(), [name](const decode::EventMsg* msg) {
-        return msg->name() == name;
-    });
-    if (it == comp->eventsEnd()) {
+    bmcl::OptionPtr<const decode::EventMsg> msg = comp->eventWithName(name);
+    if (msg.isNone()) {
         return nullptr;
     }
-    return *it;
+    return msg.unwrap();
 }
 
 static void expectCmdArg(Rc<const Command>* cmd, std::size_t i, const Type* type)
@@ -0,0 +1,317 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "decode/bench/SyntheticProject.h"
+#include "decode/core/StringBuilder.h"
+#include "decode/core/PathUtils.h"
+#include "decode/core/Utils.h"
+#include "decode/core/Try.h"
+
+#include <bmcl/StringView.h>
+
+#include <algorithm>
+
+namespace decode {
+
+SyntheticProject::SyntheticProject(const SyntheticProjectConfig& config)
+    : _config(config)
+{
+}
+
+SyntheticProject::~SyntheticProject()
+{
+}
+
+const std::string& SyntheticProject::projectFilePath() const
+{
+    return _projectFilePath;
+}
+
+const std::vector<std::string>& SyntheticProject::decodeFilePaths() const
+{
+    return _decodeFilePaths;
+}
+
+static void appendName(const char* prefix, std::size_t index, StringBuilder* dest)
+{
+    dest->append(bmcl::StringView(prefix));
+    dest->appendNumericValue(index);
+}
+
+static void appendTypeName(const char* prefix, std::size_t index, std::size_t typeIndex, StringBuilder* dest)
+{
+    appendName(prefix, index, dest);
+    dest->append('_');
+    dest->appendNumericValue(typeIndex);
+}
+
+static const char* typePrefix(std::size_t typeIndex)
+{
+    switch (typeIndex % 4) {
+    case 0:
+        return "S";
+    case 1:
+        return "E";
+    case 2:
+        return "V";
+    }
+    return "G";
+}
+
+void SyntheticProject::appendProjectFile(StringBuilder* dest) const
+{
+    dest->append("[project]\n"
+                 "name = \"synthetic\"\n"
+                 "master = \"master\"\n"
+                 "mcc_id = 0\n"
+                 "module_dirs = [");
+    std::string modules;
+    for (std::size_t i = 0; i < _config.moduleCount; i++) {
+        if (i != 0) {
+            modules.append(", ");
+        }
+        modules.append("\"mod" + std::to_string(i) + "\"");
+    }
+    dest->append(modules);
+    dest->append("]\n\n"
+                 "[[devices]]\n"
+                 "name = \"master\"\n"
+                 "id = 1\n"
+                 "modules = [");
+    dest->append(modules);
+    dest->append("]\n"
+                 "tm_sources = [\"slave\"]\n"
+                 "cmd_targets = [\"slave\"]\n\n"
+                 "[[devices]]\n"
+                 "name = \"slave\"\n"
+                 "id = 2\n"
+                 "modules = [");
+    dest->append(modules);
+    dest->append("]\n"
+                 "tm_sources = [\"master\"]\n"
+                 "cmd_targets = [\"master\"]\n");
+}
+
+void SyntheticProject::appendModuleFile(std::size_t index, StringBuilder* dest) const
+{
+    dest->append("id = ");
+    dest->appendNumericValue(index);
+    dest->append("\nname = \"");
+    appendName("mod", index, dest);
+    dest->append("\"\ndest = \"");
+    appendName("mod", index, dest);
+    dest->append("\"\ndecode = \"");
+    appendName("mod", index, dest);
+    dest->append(".decode\"\n");
+}
+
+void SyntheticProject::appendType(std::size_t index, std::size_t typeIndex, StringBuilder* dest) const
+{
+    dest->append("/// Synthetic type ");
+    dest->appendNumericValue(typeIndex);
+    dest->appendEol();
+    switch (typeIndex % 4) {
+    case 0:
+        dest->append("struct ");
+        appendTypeName("S", index, typeIndex, dest);
+        dest->append(" {\n"
+                     "    /// Byte field\n"
+                     "    a: u8,\n"
+                     "    b: u16,\n"
+                     "    c: i32,\n"
+                     "    d: f32,\n"
+                     "    e: [u8; 4],\n"
+                     "    f: &[u16; 8],\n");
+        if (typeIndex >= 4) {
+            dest->append("    g: ");
+            appendTypeName("S", index, typeIndex - 4, dest);
+            dest->append(",\n    h: ");
+            appendTypeName("E", index, typeIndex - 3, dest);
+            dest->append(",\n    i: ");
+            appendTypeName("V", index, typeIndex - 2, dest);
+            dest->append(",\n");
+        }
+        if (typeIndex == 0 && index != 0) {
+            dest->append("    imported: ");
+            appendTypeName("S", index - 1, 0, dest);
+            dest->append(",\n");
+        }
+        dest->append("}\n\n");
+        return;
+    case 1:
+        dest->append("enum ");
+        appendTypeName("E", index, typeIndex, dest);
+        dest->append(" {\n"
+                     "    A,\n"
+                     "    B = 5,\n"
+                     "    C,\n"
+                     "    D = 100,\n"
+                     "}\n\n");
+        return;
+    case 2:
+        dest->append("variant ");
+        appendTypeName("V", index, typeIndex, dest);
+        dest->append(" {\n"
+                     "    None,\n"
+                     "    Byte(u8),\n"
+                     "    Pair(u16, i64),\n"
+                     "    Point { x: f64, y: f64 },\n"
+                     "}\n\n");
+        return;
+    }
+    dest->append("struct ");
+    appendTypeName("G", index, typeIndex, dest);
+    dest->append(" {\n");
+    if (_config.useGenerics) {
+        dest->append("    p: ");
+        appendName("Pair", index, dest);
+        dest->append("<u8, u32>,\n    q: ");
+        appendName("Pair", index, dest);
+        dest->append("<u16, ");
+        appendTypeName("S", index, typeIndex - 3, dest);
+        dest->append(">,\n");
+    } else {
+        dest->append("    p: [u32; 2],\n    q: ");
+        appendTypeName("S", index, typeIndex - 3, dest);
+        dest->append(",\n");
+    }
+    dest->append("    r: &[i8; 16],\n"
+                 "}\n\n");
+}
+
+void SyntheticProject::appendComponent(std::size_t index, StringBuilder* dest) const
+{
+    bool hasStruct = _config.typesPerModule != 0;
+    std::size_t varCount = std::max<std::size_t>(4, _config.statusesPerComponent);
+
+    dest->append("component {\n"
+                 "    variables {\n");
+    for (std::size_t i = 0; i < varCount; i++) {
+        dest->append("        /// Variable ");
+        dest->appendNumericValue(i);
+        dest->append("\n        var");
+        dest->appendNumericValue(i);
+        dest->append(": ");
+        switch (i % 3) {
+        case 0:
+            dest->append("u32");
+            break;
+        case 1:
+            if (hasStruct) {
+                appendTypeName("S", index, 0, dest);
+            } else {
+                dest->append("u16");
+            }
+            break;
+        default:
+            dest->append("[i16; 4]");
+        }
+        dest->append(",\n");
+    }
+    dest->append("    }\n\n"
+                 "    commands {\n");
+    for (std::size_t i = 0; i < _config.cmdsPerComponent; i++) {
+        dest->append("        /// Command ");
+        dest->appendNumericValue(i);
+        dest->append("\n        fn cmd");
+        dest->appendNumericValue(i);
+        dest->append("(a: u8, b: u16");
+        if (hasStruct && (i % 2) == 1) {
+            dest->append(", s: ");
+            appendTypeName("S", index, 0, dest);
+        }
+        dest->append(")\n");
+    }
+    dest->append("    }\n\n"
+                 "    statuses {\n");
+    for (std::size_t i = 0; i < _config.statusesPerComponent; i++) {
+        dest->append("        [status");
+        dest->appendNumericValue(i);
+        dest->append(", ");
+        dest->appendNumericValue(i);
+        dest->append(", true]: {var0, ");
+        if (hasStruct) {
+            dest->append("var1.b, ");
+        }
+        dest->append("var2[1]},\n");
+    }
+    dest->append("    }\n\n"
+                 "    events {\n");
+    for (std::size_t i = 0; i < _config.eventsPerComponent; i++) {
+        dest->append("        [event");
+        dest->appendNumericValue(i);
+        dest->append(", true]: {code: u16, value: i32},\n");
+    }
+    dest->append("    }\n"
+                 "}\n");
+}
+
+void SyntheticProject::appendModule(std::size_t index, StringBuilder* dest) const
+{
+    dest->append("/// Synthetic module ");
+    dest->appendNumericValue(index);
+    dest->append("\nmodule ");
+    appendName("mod", index, dest);
+    dest->append("\n\n");
+
+    if (index != 0 && _config.typesPerModule != 0) {
+        dest->append("import ");
+        appendName("mod", index - 1, dest);
+        dest->append("::");
+        appendTypeName("S", index - 1, 0, dest);
+        dest->append("\n\n");
+    }
+
+    if (_config.useGenerics) {
+        dest->append("struct ");
+        appendName("Pair", index, dest);
+        dest->append("<A, B> {\n"
+                     "    first: A,\n"
+                     "    second: B,\n"
+                     "}\n\n");
+    }
+
+    for (std::size_t i = 0; i < _config.typesPerModule; i++) {
+        appendType(index, i, dest);
+    }
+
+    if (index < _config.componentCount) {
+        appendComponent(index, dest);
+    }
+}
+
+bool SyntheticProject::generate(const std::string& destDir, Diagnostics* diag)
+{
+    _decodeFilePaths.clear();
+    TRY(makeDirectoryRecursive(destDir, diag));
+
+    StringBuilder output;
+    output.reserve(64 * 1024);
+    for (std::size_t i = 0; i < _config.moduleCount; i++) {
+        std::string modName = "mod" + std::to_string(i);
+        std::string modDir = joinPath(destDir, modName);
+        TRY(makeDirectory(modDir, diag));
+
+        output.clear();
+        appendModuleFile(i, &output);
+        TRY(saveOutput(joinPath(modDir, "mod.toml"), output.view(), diag));
+
+        output.clear();
+        appendModule(i, &output);
+        std::string decodePath = joinPath(modDir, modName + ".decode");
+        TRY(saveOutput(decodePath, output.view(), diag));
+        _decodeFilePaths.push_back(std::move(decodePath));
+    }
+
+    output.clear();
+    appendProjectFile(&output);
+    _projectFilePath = joinPath(destDir, "project.toml");
+    TRY(saveOutput(_projectFilePath, output.view(), diag));
+    return true;
+}
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "decode/Config.h"
+
+#include <string>
+#include <vector>
+
+namespace decode {
+
+class Diagnostics;
+class StringBuilder;
+
+struct SyntheticProjectConfig {
+    SyntheticProjectConfig()
+        : moduleCount(8)
+        , typesPerModule(16)
+        , componentCount(4)
+        , cmdsPerComponent(8)
+        , statusesPerComponent(4)
+        , eventsPerComponent(4)
+        , useGenerics(true)
+    {
+    }
+
+    std::size_t moduleCount;
+    std::size_t typesPerModule;
+    std::size_t componentCount;
+    std::size_t cmdsPerComponent;
+    std::size_t statusesPerComponent;
+    std::size_t eventsPerComponent;
+    bool useGenerics;
+};
+
+// writes project.toml and one module directory with mod.toml and .decode file per module
+class SyntheticProject {
+public:
+    SyntheticProject(const SyntheticProjectConfig& config);
+    ~SyntheticProject();
+
+    bool generate(const std::string& destDir, Diagnostics* diag);
+
+    const std::string& projectFilePath() const;
+    const std::vector<std::string>& decodeFilePaths() const;
+
+private:
+    void appendProjectFile(StringBuilder* dest) const;
+    void appendModuleFile(std::size_t index, StringBuilder* dest) const;
+    void appendModule(std::size_t index, StringBuilder* dest) const;
+    void appendType(std::size_t index, std::size_t typeIndex, StringBuilder* dest) const;
+    void appendComponent(std::size_t index, StringBuilder* dest) const;
+
+    SyntheticProjectConfig _config;
+    std::string _projectFilePath;
+    std::vector<std::string> _decodeFilePaths;
+};
+}
@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "OnboardBench.h"
+
+#include "decode/core/Diagnostics.h"
+#include "decode/core/Utils.h"
+#include "decode/parser/Project.h"
+#include "decode/runtime/DecodePlan.h"
+
+#include "photongen/groundcontrol/Validator.hpp"
+#include "photongen/groundcontrol/TmRouter.hpp"
+
+#include <photon/model/CoderState.h>
+
+#include <bmcl/MemReader.h>
+#include <bmcl/Result.h>
+
+#include <tclap/CmdLine.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+using namespace decode;
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchResult {
+    std::string name;
+    std::size_t bytes;
+    std::vector<std::uint64_t> samples;
+};
+
+template <typename F>
+static bool runBench(const char* name, unsigned iterations, std::vector<BenchResult>* results, F&& func)
+{
+    BenchResult result;
+    result.name = name;
+    result.bytes = 0;
+    result.samples.reserve(iterations);
+    for (unsigned i = 0; i < iterations; i++) {
+        auto start = Clock::now();
+        if (!func(&result.bytes)) {
+            std::cerr << name << " failed at iteration " << i << std::endl;
+            return false;
+        }
+        result.samples.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+    }
+    results->push_back(std::move(result));
+    return true;
+}
+
+static std::string resultsToJson(std::vector<BenchResult>* results)
+{
+    std::string dest = "{\n  \"benchmarks\": [";
+    for (std::size_t i = 0; i < results->size(); i++) {
+        BenchResult& result = (*results)[i];
+        std::vector<std::uint64_t>& samples = result.samples;
+        std::sort(samples.begin(), samples.end());
+        std::uint64_t sum = 0;
+        for (std::uint64_t sample : samples) {
+            sum += sample;
+        }
+        std::uint64_t mean = sum / samples.size();
+        double throughput = mean ? double(result.bytes) * 1000.0 / double(mean) : 0;
+        if (i != 0) {
+            dest.push_back(',');
+        }
+        dest.append("\n    {\"name\": \"");
+        dest.append(result.name);
+        dest.append("\", \"bytes\": ");
+        dest.append(std::to_string(result.bytes));
+        dest.append(", \"min_ns\": ");
+        dest.append(std::to_string(samples.front()));
+        dest.append(", \"median_ns\": ");
+        dest.append(std::to_string(samples[samples.size() / 2]));
+        dest.append(", \"p99_ns\": ");
+        dest.append(std::to_string(samples[samples.size() * 99 / 100]));
+        dest.append(", \"max_ns\": ");
+        dest.append(std::to_string(samples.back()));
+        dest.append(", \"mean_ns\": ");
+        dest.append(std::to_string(mean));
+        dest.append(", \"mb_per_s\": ");
+        dest.append(std::to_string(throughput));
+        dest.push_back('}');
+    }
+    dest.append("\n  ]\n}\n");
+    return dest;
+}
+
+static std::vector<std::uint8_t> readFile(const std::string& path)
+{
+    std::ifstream stream(path, std::ios::binary);
+    return std::vector<std::uint8_t>(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+}
+
+int main(int argc, char* argv[])
+{
+    TCLAP::CmdLine cmdLine("Loopback benchmark of generated onboard and ground control sources");
+    TCLAP::ValueArg<std::string> packagePathArg("k", "package", "Encoded project (Package.bin)", true, "./Package.bin", "path");
+    TCLAP::ValueArg<std::string> deviceArg("d", "device", "Device name, master if not set", false, "", "name");
+    TCLAP::ValueArg<std::string> scriptPathArg("s", "script", "Encoded command script for exec benchmark", false, "", "path");
+    TCLAP::ValueArg<std::string> jsonPathArg("r", "results", "Results json file, stdout if not set", false, "", "path");
+    TCLAP::ValueArg<unsigned> iterationsArg("i", "iterations", "Number of measured iterations", false, 10000, "count");
+    TCLAP::ValueArg<unsigned> bufferSizeArg("b", "buffer-size", "Size of loopback buffers", false, 64, "KiB");
+
+    cmdLine.add(&packagePathArg);
+    cmdLine.add(&deviceArg);
+    cmdLine.add(&scriptPathArg);
+    cmdLine.add(&jsonPathArg);
+    cmdLine.add(&iterationsArg);
+    cmdLine.add(&bufferSizeArg);
+    cmdLine.parse(argc, argv);
+
+    Rc<Diagnostics> diag = new Diagnostics;
+    std::vector<std::uint8_t> package = readFile(packagePathArg.getValue());
+    ProjectResult proj = Project::decodeFromMemory(diag.get(), package.data(), package.size());
+    if (proj.isErr()) {
+        diag->printReports(&std::cerr);
+        return -1;
+    }
+    const Project* project = proj.unwrap().get();
+    const Device* device = project->master();
+    if (!deviceArg.getValue().empty()) {
+        bmcl::OptionPtr<const Device> dev = project->deviceWithName(deviceArg.getValue());
+        if (dev.isNone()) {
+            std::cerr << "unknown device " << deviceArg.getValue() << std::endl;
+            return -1;
+        }
+        device = dev.unwrap();
+    }
+
+    photongen::Validator validator(project, device);
+    photongen::TmRouter router;
+    validator.fillTmRouter(&router);
+
+    unsigned iterations = std::max(1u, iterationsArg.getValue());
+    std::vector<std::uint8_t> tm(std::max(1u, bufferSizeArg.getValue()) * 1024);
+    std::vector<std::uint8_t> response(tm.size());
+    std::size_t tmSize = 0;
+    std::vector<BenchResult> results;
+
+    bool isOk = runBench("status_encode", iterations, &results, [&](std::size_t* bytes) {
+        bool isOk = PhotonBench_EncodeStatuses(tm.data(), tm.size(), &tmSize) == 0;
+        *bytes = tmSize;
+        return isOk;
+    });
+    isOk = isOk && runBench("status_decode", iterations, &results, [&](std::size_t* bytes) {
+        std::size_t decoded;
+        *bytes = tmSize;
+        return PhotonBench_DecodeStatuses(tm.data(), tmSize, &decoded) == 0 && decoded == PhotonBench_StatusCount();
+    });
+    isOk = isOk && runBench("gc_status_decode", iterations, &results, [&](std::size_t* bytes) {
+        bmcl::MemReader reader(tm.data(), tmSize);
+        photon::CoderState state;
+        *bytes = tmSize;
+        return router.route(&reader, &state);
+    });
+    Rc<PackageDecoder> planDecoder = new PackageDecoder(project->package());
+    std::vector<ValueNode> nodes;
+    isOk = isOk && runBench("plan_status_decode", iterations, &results, [&](std::size_t* bytes) {
+        bmcl::MemReader reader(tm.data(), tmSize);
+        std::size_t decoded = 0;
+        *bytes = tmSize;
+        while (reader.sizeLeft() >= 2) {
+            uint8_t compNum = reader.readUint8();
+            uint8_t msgNum = reader.readUint8();
+            bmcl::OptionPtr<const DecodePlan> plan = planDecoder->statusPlan(compNum, msgNum);
+            nodes.clear();
+            if (plan.isNone() || !plan->decode(&reader, &nodes)) {
+                return false;
+            }
+            decoded++;
+        }
+        return reader.sizeLeft() == 0 && decoded == PhotonBench_StatusCount();
+    });
+
+    if (isOk && !scriptPathArg.getValue().empty()) {
+        std::vector<std::uint8_t> script = readFile(scriptPathArg.getValue());
+        isOk = runBench("cmd_exec", iterations, &results, [&](std::size_t* bytes) {
+            std::size_t written;
+            *bytes = script.size();
+            return PhotonBench_ExecScript(script.data(), script.size(), response.data(), response.size(), &written) == 0;
+        });
+    }
+    if (!isOk) {
+        return -1;
+    }
+
+    std::string json = resultsToJson(&results);
+    if (jsonPathArg.getValue().empty()) {
+        std::cout << json;
+    } else if (!saveOutput(jsonPathArg.getValue(), json, diag.get())) {
+        diag->printReports(&std::cerr);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "OnboardBench.h"
+
+#include "Photon.h"
+#include "photongen/onboard/core/Writer.h"
+#include "photongen/onboard/core/Reader.h"
+#include "photongen/onboard/core/Error.h"
+#include "photongen/onboard/CmdDecoder.h"
+#include "photongen/onboard/StatusDecoder.h"
+#include "photongen/onboard/TmMessageDesc.h"
+
+#include <stdbool.h>
+
+#include "photongen/onboard/StatusTable.inc.c"
+
+size_t PhotonBench_StatusCount(void)
+{
+    return _PHOTON_TM_MSG_COUNT;
+}
+
+int PhotonBench_EncodeStatuses(uint8_t* dest, size_t size, size_t* written)
+{
+    PhotonWriter writer;
+    PhotonWriter_Init(&writer, dest, size);
+    for (size_t i = 0; i < _PHOTON_TM_MSG_COUNT; i++) {
+        if (_messageDesc[i].func(&writer) != PhotonError_Ok) {
+            return -1;
+        }
+    }
+    *written = size - PhotonWriter_WritableSize(&writer);
+    return 0;
+}
+
+static void countMessage(uint8_t compNum, uint8_t msgNum, const void* msg, void* userData)
+{
+    (void)compNum;
+    (void)msgNum;
+    (void)msg;
+    (*(size_t*)userData)++;
+}
+
+int PhotonBench_DecodeStatuses(const uint8_t* src, size_t size, size_t* decoded)
+{
+    PhotonReader reader;
+    PhotonReader_Init(&reader, src, size);
+    *decoded = 0;
+    if (Photon_DeserializeTelemetry(&reader, countMessage, decoded) != PhotonError_Ok) {
+        return -1;
+    }
+    return 0;
+}
+
+int PhotonBench_ExecScript(const uint8_t* src, size_t size, uint8_t* dest, size_t destSize, size_t* written)
+{
+    PhotonReader reader;
+    PhotonWriter writer;
+    PhotonReader_Init(&reader, src, size);
+    PhotonWriter_Init(&writer, dest, destSize);
+    if (Photon_ExecScript(&reader, &writer) != PhotonError_Ok) {
+        return -1;
+    }
+    *written = destSize - PhotonWriter_WritableSize(&writer);
+    return 0;
+}
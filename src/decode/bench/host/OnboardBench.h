@@ -0,0 +1,27 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* thin C wrappers around generated onboard sources, all functions return 0 on success */
+
+size_t PhotonBench_StatusCount(void);
+int PhotonBench_EncodeStatuses(uint8_t* dest, size_t size, size_t* written);
+int PhotonBench_DecodeStatuses(const uint8_t* src, size_t size, size_t* decoded);
+int PhotonBench_ExecScript(const uint8_t* src, size_t size, uint8_t* dest, size_t destSize, size_t* written);
+
+#ifdef __cplusplus
+}
+#endif
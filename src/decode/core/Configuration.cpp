@@ -47,7 +47,10 @@ bool Configuration::isCfgOptionSet(bmcl::StringView key, bmcl::Option<bmcl::Stri
     if (it == _values.end()) {
         return false;
     }
-    if (it->second.isSome() && value.isSome()) {
+    if (value.isNone()) {
+        return true;
+    }
+    if (it->second.isSome()) {
         return it->second.unwrap() == value.unwrap();
     }
     return false;
@@ -43,6 +43,7 @@ void StringBuilder::append(const std::string& str)
 
 void StringBuilder::assign(char c)
 {
+    updatePeakSize();
     _output.resize(1);
     _output[0] = c;
 }
@@ -54,16 +55,19 @@ void StringBuilder::assign(bmcl::StringView view)
 
 void StringBuilder::assign(const char* begin, const char* end)
 {
+    updatePeakSize();
     _output.assign(begin, end);
 }
 
 void StringBuilder::assign(const char* begin, std::size_t size)
 {
+    updatePeakSize();
     _output.assign(begin, size);
 }
 
 void StringBuilder::assign(const std::string& str)
 {
+    updatePeakSize();
     _output.assign(str);
 }
 
@@ -89,6 +93,7 @@ void StringBuilder::insert(std::size_t i, char c)
 
 void StringBuilder::resize(std::size_t size)
 {
+    updatePeakSize();
     _output.resize(size);
 }
 
@@ -102,6 +107,17 @@ std::size_t StringBuilder::size() const
     return _output.size();
 }
 
+std::size_t StringBuilder::peakSize() const
+{
+    return std::max(_peakSize, _output.size());
+}
+
+// only called before the contents can shrink, appends are not tracked
+void StringBuilder::updatePeakSize()
+{
+    _peakSize = std::max(_peakSize, _output.size());
+}
+
 const char* StringBuilder::data() const
 {
     return _output.data();
@@ -134,6 +150,7 @@ char StringBuilder::back() const
 
 void StringBuilder::clear()
 {
+    updatePeakSize();
     _output.clear();
 }
 
@@ -194,6 +211,7 @@ void StringBuilder::appendWithFirstLower(bmcl::StringView view)
 void StringBuilder::removeFromBack(std::size_t size)
 {
     assert(_output.size() >= size);
+    updatePeakSize();
     _output.erase(_output.end() - size, _output.end());
 }
 
@@ -326,4 +344,9 @@ void StringBuilder::appendNumericValue(long long int value)
 {
     appendNumericValueFormat(value, "%lld");
 }
+
+void StringBuilder::appendNumericValue(double value)
+{
+    appendNumericValueFormat(value, "%.17g");
+}
 }
@@ -56,6 +56,7 @@ public:
 
     bmcl::StringView view() const;
     std::size_t size() const;
+    std::size_t peakSize() const;
     const char* data() const;
     const char* c_str() const;
     bool isEmpty() const;
@@ -84,6 +85,7 @@ public:
     void appendNumericValue(int value);
     void appendNumericValue(long int value);
     void appendNumericValue(long long int value);
+    void appendNumericValue(double value);
 
     void appendBoolValue(bool value);
     void appendHexValue(uint8_t value);
@@ -103,12 +105,16 @@ private:
 
     template <typename F>
     void appendWithFirstModified(bmcl::StringView view, F&& func);
+    void updatePeakSize();
+
     std::string _output;
+    std::size_t _peakSize;
 };
 
 template <typename... A>
 StringBuilder::StringBuilder(A&&... args)
     : _output(std::forward<A>(args)...)
+    , _peakSize(0)
 {
 }
 
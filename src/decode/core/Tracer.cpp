@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "decode/core/Tracer.h"
+#include "decode/core/Utils.h"
+
+namespace decode {
+
+std::atomic<Tracer*> Tracer::_current(nullptr);
+
+Tracer::Tracer()
+    : _origin(Clock::now())
+{
+}
+
+Tracer::~Tracer()
+{
+}
+
+void Tracer::setCurrent(Tracer* tracer)
+{
+    _current.store(tracer, std::memory_order_relaxed);
+}
+
+void Tracer::addEvent(const char* category, bmcl::StringView name, bmcl::StringView detail,
+                      Clock::time_point start, Clock::time_point end)
+{
+    Event event;
+    event.category = category;
+    event.name = name.toStdString();
+    event.detail = detail.toStdString();
+    event.start = std::chrono::duration_cast<std::chrono::microseconds>(start - _origin).count();
+    event.duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+
+    std::lock_guard<std::mutex> lock(_lock);
+    auto it = _threadIndices.emplace(std::this_thread::get_id(), unsigned(_threadIndices.size()));
+    event.threadIndex = it.first->second;
+    _events.push_back(std::move(event));
+}
+
+HashMap<std::string, std::uint64_t> Tracer::durationsByName() const
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    HashMap<std::string, std::uint64_t> durations;
+    for (const Event& event : _events) {
+        durations[event.name] += event.duration;
+    }
+    return durations;
+}
+
+std::string Tracer::toJson() const
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    std::string dest;
+    dest.reserve(_events.size() * 128 + 32);
+    dest.append("{\"traceEvents\":[\n");
+    for (std::size_t i = 0; i < _events.size(); i++) {
+        const Event& event = _events[i];
+        dest.append("{\"name\":");
+        appendJsonString(event.name, &dest);
+        dest.append(",\"cat\":");
+        appendJsonString(event.category, &dest);
+        dest.append(",\"ph\":\"X\",\"pid\":1,\"tid\":");
+        dest.append(std::to_string(event.threadIndex));
+        dest.append(",\"ts\":");
+        dest.append(std::to_string(event.start));
+        dest.append(",\"dur\":");
+        dest.append(std::to_string(event.duration));
+        if (!event.detail.empty()) {
+            dest.append(",\"args\":{\"detail\":");
+            appendJsonString(event.detail, &dest);
+            dest.push_back('}');
+        }
+        dest.push_back('}');
+        if (i + 1 != _events.size()) {
+            dest.push_back(',');
+        }
+        dest.push_back('\n');
+    }
+    dest.append("],\"displayTimeUnit\":\"ms\"}\n");
+    return dest;
+}
+
+bool Tracer::saveJson(const std::string& path, Diagnostics* diag) const
+{
+    return saveOutput(path, toJson(), diag);
+}
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "decode/Config.h"
+#include "decode/core/Rc.h"
+#include "decode/core/HashMap.h"
+
+#include <bmcl/StringView.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace decode {
+
+class Diagnostics;
+
+// collects complete events in chrome trace event format
+class Tracer : public RefCountable {
+public:
+    using Pointer = Rc<Tracer>;
+    using ConstPointer = Rc<const Tracer>;
+    using Clock = std::chrono::steady_clock;
+
+    Tracer();
+    ~Tracer();
+
+    // null when tracing is disabled
+    static Tracer* current()
+    {
+        return _current.load(std::memory_order_relaxed);
+    }
+
+    static void setCurrent(Tracer* tracer);
+
+    void addEvent(const char* category, bmcl::StringView name, bmcl::StringView detail,
+                  Clock::time_point start, Clock::time_point end);
+
+    // summed durations in microseconds of events with the same name
+    HashMap<std::string, std::uint64_t> durationsByName() const;
+
+    std::string toJson() const;
+    bool saveJson(const std::string& path, Diagnostics* diag) const;
+
+private:
+    struct Event {
+        const char* category;
+        std::string name;
+        std::string detail;
+        std::uint64_t start;
+        std::uint64_t duration;
+        unsigned threadIndex;
+    };
+
+    static std::atomic<Tracer*> _current;
+
+    mutable std::mutex _lock;
+    Clock::time_point _origin;
+    std::vector<Event> _events;
+    HashMap<std::thread::id, unsigned> _threadIndices;
+};
+
+class TraceScope {
+public:
+    TraceScope(const char* category, bmcl::StringView name, bmcl::StringView detail = bmcl::StringView::empty())
+        : _tracer(Tracer::current())
+    {
+        if (_tracer) {
+            _category = category;
+            _name = name;
+            _detail = detail;
+            _start = Tracer::Clock::now();
+        }
+    }
+
+    ~TraceScope()
+    {
+        if (_tracer) {
+            _tracer->addEvent(_category, _name, _detail, _start, Tracer::Clock::now());
+        }
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    Tracer* _tracer;
+    const char* _category;
+    bmcl::StringView _name;
+    bmcl::StringView _detail;
+    Tracer::Clock::time_point _start;
+};
+}
@@ -14,6 +14,8 @@
 #include <bmcl/Result.h>
 #include <bmcl/StringView.h>
 
+#include <cstdio>
+
 #if defined(__linux__)
 # include <sys/stat.h>
 # include <fcntl.h>
@@ -68,6 +70,36 @@ bool doubleEq(double a, double b, unsigned int maxUlps)
     return false;
 }
 
+void appendJsonString(bmcl::StringView str, std::string* dest)
+{
+    dest->push_back('"');
+    for (char c : str) {
+        switch (c) {
+        case '"':
+            dest->append("\\\"");
+            break;
+        case '\\':
+            dest->append("\\\\");
+            break;
+        case '\n':
+            dest->append("\\n");
+            break;
+        case '\t':
+            dest->append("\\t");
+            break;
+        default:
+            if (uint8_t(c) < 0x20) {
+                char buf[8];
+                std::snprintf(buf, sizeof(buf), "\\u%04x", unsigned(c));
+                dest->append(buf);
+            } else {
+                dest->push_back(c);
+            }
+        }
+    }
+    dest->push_back('"');
+}
+
 bool makeDirectory(const std::string& path, Diagnostics* diag)
 {
     return makeDirectory(path.c_str(), diag);
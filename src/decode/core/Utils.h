@@ -23,6 +23,9 @@ bmcl::Result<bmcl::StringView, std::string> deserializeString(bmcl::MemReader* s
 
 bool doubleEq(double a, double b, unsigned int maxUlps = 4);
 
+// appends str as a quoted json string
+void appendJsonString(bmcl::StringView str, std::string* dest);
+
 bool makeDirectory(const char* path, Diagnostics* diag);
 bool makeDirectory(const std::string& path, Diagnostics* diag);
 bool makeDirectoryRecursive(const char* path, Diagnostics* diag);
@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "decode/generator/BinLogGen.h"
+#include "decode/generator/BinLogRewriter.h"
+#include "decode/generator/SrcBuilder.h"
+
+#include <algorithm>
+
+namespace decode {
+
+BinLogGen::BinLogGen(SrcBuilder* output)
+    : _output(output)
+{
+}
+
+BinLogGen::~BinLogGen()
+{
+}
+
+void BinLogGen::generateHeader()
+{
+    _output->startIncludeGuard("PRIVATE", "BIN_LOG");
+
+    _output->appendOnboardIncludePath("core/Error");
+    _output->append("\n#include <stddef.h>\n"
+                    "#include <stdint.h>\n\n");
+
+    // all levels are kept unless the build lowers the level, 1 - critical only, 4 - everything
+    _output->append("#ifndef PHOTON_BINLOG_LEVEL\n"
+                    "# define PHOTON_BINLOG_LEVEL 4\n"
+                    "#endif\n\n"
+                    "#ifndef PHOTON_BINLOG_BUFFER_SIZE\n"
+                    "# define PHOTON_BINLOG_BUFFER_SIZE 1024\n"
+                    "#endif\n\n");
+
+    const char* levels[] = {"CRITICAL", "WARNING", "INFO", "DEBUG"};
+    for (std::size_t i = 0; i < 4; i++) {
+        _output->append("#if PHOTON_BINLOG_LEVEL >= ");
+        _output->appendNumericValue(i + 1);
+        _output->append("\n# define PHOTON_BINLOG_");
+        _output->append(bmcl::StringView(levels[i]));
+        _output->append("(...) PhotonBinLog_Write(__VA_ARGS__)\n#else\n# define PHOTON_BINLOG_");
+        _output->append(bmcl::StringView(levels[i]));
+        _output->append("(...) ((void)0)\n#endif\n\n");
+    }
+
+    _output->append("#define PHOTON_BINLOG_TRY(expr, id)                \\\n"
+                    "    do {                                           \\\n"
+                    "        PhotonError _photonBinLogRv = (expr);      \\\n"
+                    "        if (_photonBinLogRv != PhotonError_Ok) {   \\\n"
+                    "            PHOTON_BINLOG_DEBUG(id, 0);            \\\n"
+                    "            return _photonBinLogRv;                \\\n"
+                    "        }                                          \\\n"
+                    "    } while(0)\n\n");
+
+    _output->startCppGuard();
+
+    _output->append("/* the ring buffer is not synchronized: it supports a single producer, PhotonBinLog_Write\n"
+                    " * must not be called from several contexts (threads, interrupts) at once, and PhotonBinLog_Read\n"
+                    " * must run in the same context as the producer */\n\n"
+                    "/* record is u16 id, u8 argument count and u32 arguments, all little endian */\n"
+                    "void PhotonBinLog_Write(uint16_t id, unsigned argc, ...);\n"
+                    "/* moves whole records into dest, returns number of written bytes */\n"
+                    "size_t PhotonBinLog_Read(uint8_t* dest, size_t size);\n"
+                    "uint32_t PhotonBinLog_DroppedCount(void);\n\n");
+
+    _output->endCppGuard();
+
+    _output->endIncludeGuard();
+}
+
+void BinLogGen::generateSource()
+{
+    _output->append("#include \"photongen/onboard/BinLog.h\"\n\n"
+                    "#include <stdarg.h>\n\n");
+
+    _output->append("/* single producer and single consumer running in the same context */\n"
+                    "static uint8_t _photonBinLog[PHOTON_BINLOG_BUFFER_SIZE];\n"
+                    "static size_t _photonBinLogHead = 0;\n"
+                    "static size_t _photonBinLogTail = 0;\n"
+                    "static size_t _photonBinLogSize = 0;\n"
+                    "static uint32_t _photonBinLogDropped = 0;\n\n");
+
+    _output->append("static void pushByte(uint8_t value)\n"
+                    "{\n"
+                    "    _photonBinLog[_photonBinLogHead] = value;\n"
+                    "    _photonBinLogHead = (_photonBinLogHead + 1) % PHOTON_BINLOG_BUFFER_SIZE;\n"
+                    "    _photonBinLogSize++;\n"
+                    "}\n\n");
+
+    _output->append("void PhotonBinLog_Write(uint16_t id, unsigned argc, ...)\n"
+                    "{\n"
+                    "    va_list args;\n"
+                    "    unsigned i;\n"
+                    "    if (PHOTON_BINLOG_BUFFER_SIZE - _photonBinLogSize < 3 + 4 * (size_t)argc) {\n"
+                    "        _photonBinLogDropped++;\n"
+                    "        return;\n"
+                    "    }\n"
+                    "    pushByte((uint8_t)id);\n"
+                    "    pushByte((uint8_t)(id >> 8));\n"
+                    "    pushByte((uint8_t)argc);\n"
+                    "    va_start(args, argc);\n"
+                    "    for (i = 0; i < argc; i++) {\n"
+                    "        uint32_t value = va_arg(args, uint32_t);\n"
+                    "        pushByte((uint8_t)value);\n"
+                    "        pushByte((uint8_t)(value >> 8));\n"
+                    "        pushByte((uint8_t)(value >> 16));\n"
+                    "        pushByte((uint8_t)(value >> 24));\n"
+                    "    }\n"
+                    "    va_end(args);\n"
+                    "}\n\n");
+
+    _output->append("size_t PhotonBinLog_Read(uint8_t* dest, size_t size)\n"
+                    "{\n"
+                    "    size_t written = 0;\n"
+                    "    while (_photonBinLogSize != 0) {\n"
+                    "        size_t argc = _photonBinLog[(_photonBinLogTail + 2) % PHOTON_BINLOG_BUFFER_SIZE];\n"
+                    "        size_t recordSize = 3 + 4 * argc;\n"
+                    "        size_t i;\n"
+                    "        if (size - written < recordSize) {\n"
+                    "            break;\n"
+                    "        }\n"
+                    "        for (i = 0; i < recordSize; i++) {\n"
+                    "            dest[written++] = _photonBinLog[_photonBinLogTail];\n"
+                    "            _photonBinLogTail = (_photonBinLogTail + 1) % PHOTON_BINLOG_BUFFER_SIZE;\n"
+                    "        }\n"
+                    "        _photonBinLogSize -= recordSize;\n"
+                    "    }\n"
+                    "    return written;\n"
+                    "}\n\n");
+
+    _output->append("uint32_t PhotonBinLog_DroppedCount(void)\n"
+                    "{\n"
+                    "    return _photonBinLogDropped;\n"
+                    "}\n");
+}
+
+void BinLogGen::generateGcHeader(const BinLogRewriter* rewriter)
+{
+    const std::vector<BinLogRewriter::Site>& sites = rewriter->sites();
+
+    _output->appendPragmaOnce();
+    _output->appendEol();
+    _output->append("#include <bmcl/MemReader.h>\n\n"
+                    "#include <string>\n"
+                    "#include <cstdint>\n"
+                    "#include <cstddef>\n"
+                    "#include <cstdio>\n\n");
+
+    _output->append("namespace photongen {\nnamespace binlog {\n\n");
+
+    _output->append("struct Site {\n"
+                    "    const char* level;\n"
+                    "    const char* format;\n"
+                    "};\n\n"
+                    "constexpr std::size_t siteCount = ");
+    _output->appendNumericValue(sites.size());
+    _output->append(";\nconstexpr std::size_t maxArgs = ");
+    _output->appendNumericValue(BinLogRewriter::maxArgs);
+    _output->append(";\n\n");
+
+    _output->append("inline const Site* sites()\n"
+                    "{\n"
+                    "    static const Site table[");
+    _output->appendNumericValue(std::max<std::size_t>(sites.size(), 1));
+    _output->append("] = {\n");
+    if (sites.empty()) {
+        _output->append("        {nullptr, nullptr},\n");
+    }
+    for (const BinLogRewriter::Site& site : sites) {
+        _output->append("        {\"");
+        _output->append(bmcl::StringView(site.level));
+        _output->append("\", \"");
+        _output->append(site.format);
+        _output->append("\"},\n");
+    }
+    _output->append("    };\n"
+                    "    return table;\n"
+                    "}\n\n");
+
+    _output->append("// renders a single record, returns false on malformed data\n"
+                    "inline bool render(bmcl::MemReader* src, std::string* dest)\n"
+                    "{\n"
+                    "    if (src->sizeLeft() < 3) {\n"
+                    "        return false;\n"
+                    "    }\n"
+                    "    std::size_t id = src->readUint16Le();\n"
+                    "    std::size_t argc = src->readUint8();\n"
+                    "    if (id >= siteCount || argc > maxArgs || src->sizeLeft() < argc * 4) {\n"
+                    "        return false;\n"
+                    "    }\n"
+                    "    unsigned args[maxArgs] = {0};\n"
+                    "    for (std::size_t i = 0; i < argc; i++) {\n"
+                    "        args[i] = src->readUint32Le();\n"
+                    "    }\n"
+                    "    char buf[256];\n"
+                    "    std::snprintf(buf, sizeof(buf), sites()[id].format, args[0], args[1], args[2], args[3]);\n"
+                    "    dest->append(sites()[id].level);\n"
+                    "    dest->append(\": \");\n"
+                    "    dest->append(buf);\n"
+                    "    return true;\n"
+                    "}\n\n");
+
+    _output->append("}\n}\n");
+}
+}
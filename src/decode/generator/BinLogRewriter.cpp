@@ -0,0 +1,341 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "decode/generator/BinLogRewriter.h"
+#include "decode/generator/SrcBuilder.h"
+#include "decode/core/Utils.h"
+
+#include <algorithm>
+#include <cctype>
+
+namespace decode {
+
+struct LogMacro {
+    const char* name;
+    const char* level;
+    bool isTry;
+};
+
+static const LogMacro logMacros[] = {
+    {"PHOTON_CRITICAL", "critical", false},
+    {"PHOTON_WARNING",  "warning",  false},
+    {"PHOTON_INFO",     "info",     false},
+    {"PHOTON_DEBUG",    "debug",    false},
+    {"PHOTON_TRY_MSG",  "debug",    true},
+};
+
+static const LogMacro* findLogMacro(bmcl::StringView name)
+{
+    for (const LogMacro& macro : logMacros) {
+        if (name == macro.name) {
+            return &macro;
+        }
+    }
+    return nullptr;
+}
+
+static bool isIdentChar(char c)
+{
+    return std::isalnum((unsigned char)c) || c == '_';
+}
+
+static bmcl::StringView trimSpaces(const char* begin, const char* end)
+{
+    while (begin < end && std::isspace((unsigned char)*begin)) {
+        begin++;
+    }
+    while (end > begin && std::isspace((unsigned char)end[-1])) {
+        end--;
+    }
+    return bmcl::StringView(begin, end - begin);
+}
+
+// splits top level arguments of a call, it points past the opening paren, returns end of the call or nullptr
+static const char* parseArgs(const char* it, const char* end, std::vector<bmcl::StringView>* args)
+{
+    std::size_t depth = 0;
+    const char* argBegin = it;
+    while (it < end) {
+        char c = *it;
+        if (c == '"' || c == '\'') {
+            it++;
+            while (it < end && *it != c) {
+                if (*it == '\\') {
+                    it++;
+                }
+                it++;
+            }
+            if (it >= end) {
+                return nullptr;
+            }
+        } else if (c == '(' || c == '[' || c == '{') {
+            depth++;
+        } else if (c == ')' || c == ']' || c == '}') {
+            if (depth == 0) {
+                if (c != ')') {
+                    return nullptr;
+                }
+                args->push_back(trimSpaces(argBegin, it));
+                return it + 1;
+            }
+            depth--;
+        } else if (c == ',' && depth == 0) {
+            args->push_back(trimSpaces(argBegin, it));
+            argBegin = it + 1;
+        }
+        it++;
+    }
+    return nullptr;
+}
+
+// accepts a single string literal without concatenation, returns its escaped contents
+static bool parseStringLiteral(bmcl::StringView arg, bmcl::StringView* contents)
+{
+    if (arg.size() < 2 || arg[0] != '"' || arg[arg.size() - 1] != '"') {
+        return false;
+    }
+    for (std::size_t i = 1; i < arg.size() - 1; i++) {
+        if (arg[i] == '\\') {
+            i++;
+        } else if (arg[i] == '"') {
+            return false;
+        }
+    }
+    *contents = bmcl::StringView(arg.data() + 1, arg.size() - 2);
+    return true;
+}
+
+static int hexDigitValue(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+// decodes escapes of a C string literal contents, unknown escapes are kept as the escaped char
+static std::string unescapeStringLiteral(bmcl::StringView src)
+{
+    std::string dest;
+    dest.reserve(src.size());
+    for (std::size_t i = 0; i < src.size(); i++) {
+        char c = src[i];
+        if (c != '\\' || i + 1 == src.size()) {
+            dest.push_back(c);
+            continue;
+        }
+        c = src[++i];
+        switch (c) {
+        case 'a':
+            dest.push_back('\a');
+            break;
+        case 'b':
+            dest.push_back('\b');
+            break;
+        case 'f':
+            dest.push_back('\f');
+            break;
+        case 'n':
+            dest.push_back('\n');
+            break;
+        case 'r':
+            dest.push_back('\r');
+            break;
+        case 't':
+            dest.push_back('\t');
+            break;
+        case 'v':
+            dest.push_back('\v');
+            break;
+        case 'x': {
+            unsigned value = 0;
+            while (i + 1 < src.size() && hexDigitValue(src[i + 1]) >= 0) {
+                value = (value << 4) | unsigned(hexDigitValue(src[++i]));
+            }
+            dest.push_back(char(value & 0xff));
+            break;
+        }
+        default:
+            if (c >= '0' && c <= '7') {
+                unsigned value = unsigned(c - '0');
+                for (std::size_t n = 1; n < 3 && i + 1 < src.size() && src[i + 1] >= '0' && src[i + 1] <= '7'; n++) {
+                    value = (value << 3) | unsigned(src[++i] - '0');
+                }
+                dest.push_back(char(value & 0xff));
+            } else {
+                dest.push_back(c);
+            }
+        }
+    }
+    return dest;
+}
+
+BinLogRewriter::BinLogRewriter()
+{
+}
+
+BinLogRewriter::~BinLogRewriter()
+{
+}
+
+void BinLogRewriter::clear()
+{
+    _ids.clear();
+    _sites.clear();
+}
+
+const std::vector<BinLogRewriter::Site>& BinLogRewriter::sites() const
+{
+    return _sites;
+}
+
+std::size_t BinLogRewriter::siteId(const char* level, bmcl::StringView format)
+{
+    std::string key = level;
+    key.push_back(':');
+    key.append(format.begin(), format.end());
+    auto it = _ids.emplace(std::move(key), _sites.size());
+    if (it.second) {
+        _sites.push_back(Site{level, format.toStdString(), 0});
+    }
+    Site& site = _sites[it.first->second];
+    site.count++;
+    return it.first->second;
+}
+
+bool BinLogRewriter::rewriteCall(bmcl::StringView name, const std::vector<bmcl::StringView>& args, SrcBuilder* dest)
+{
+    const LogMacro* macro = findLogMacro(name);
+    if (!macro) {
+        return false;
+    }
+    bmcl::StringView format;
+    if (macro->isTry) {
+        if (args.size() != 2 || !parseStringLiteral(args[1], &format)) {
+            return false;
+        }
+        dest->append("PHOTON_BINLOG_TRY(");
+        dest->append(args[0]);
+        dest->append(", ");
+        dest->appendNumericValue(siteId(macro->level, format));
+        dest->append(')');
+        return true;
+    }
+
+    if (args.empty() || args.size() - 1 > maxArgs || !parseStringLiteral(args[0], &format)) {
+        return false;
+    }
+    dest->append("PHOTON_BINLOG_");
+    dest->appendUpper(macro->level);
+    dest->append('(');
+    dest->appendNumericValue(siteId(macro->level, format));
+    dest->append(", ");
+    dest->appendNumericValue(args.size() - 1);
+    for (std::size_t i = 1; i < args.size(); i++) {
+        dest->append(", (uint32_t)(");
+        dest->append(args[i]);
+        dest->append(')');
+    }
+    dest->append(')');
+    return true;
+}
+
+void BinLogRewriter::rewrite(bmcl::StringView src, SrcBuilder* dest)
+{
+    static const char prefix[] = "PHOTON_";
+    static const char fnameDefine[] = "#define _PHOTON_FNAME";
+
+    std::size_t destStart = dest->size();
+    const char* begin = src.data();
+    const char* end = begin + src.size();
+    const char* it = begin;
+    const char* copied = begin;
+    const char* firstRewrite = nullptr;
+    std::vector<bmcl::StringView> args;
+    SrcBuilder call;
+
+    while (true) {
+        const char* found = std::search(it, end, prefix, prefix + sizeof(prefix) - 1);
+        if (found == end) {
+            break;
+        }
+        it = found + sizeof(prefix) - 1;
+        if (found != begin && isIdentChar(found[-1])) {
+            continue;
+        }
+        const char* nameEnd = it;
+        while (nameEnd < end && isIdentChar(*nameEnd)) {
+            nameEnd++;
+        }
+        if (nameEnd == end || *nameEnd != '(') {
+            continue;
+        }
+        args.clear();
+        const char* callEnd = parseArgs(nameEnd + 1, end, &args);
+        if (!callEnd) {
+            continue;
+        }
+        call.clear();
+        if (!rewriteCall(bmcl::StringView(found, nameEnd - found), args, &call)) {
+            continue;
+        }
+        if (!firstRewrite) {
+            firstRewrite = found;
+        }
+        dest->append(bmcl::StringView(copied, found - copied));
+        dest->append(call.view());
+        copied = callEnd;
+        it = callEnd;
+    }
+    dest->append(bmcl::StringView(copied, end - copied));
+
+    if (!firstRewrite) {
+        return;
+    }
+    // log calls in sources follow the file name define, include binary log macros right before it
+    std::size_t includePos = destStart;
+    const char* define = std::search(begin, end, fnameDefine, fnameDefine + sizeof(fnameDefine) - 1);
+    if (define < firstRewrite) {
+        includePos += define - begin;
+    }
+    dest->insert(includePos, "#include \"photongen/onboard/BinLog.h\"\n");
+}
+
+std::string BinLogRewriter::toJson() const
+{
+    std::string dest = "{\n  \"sites\": [";
+    for (std::size_t i = 0; i < _sites.size(); i++) {
+        const Site& site = _sites[i];
+        if (i != 0) {
+            dest.push_back(',');
+        }
+        dest.append("\n    {\"id\": ");
+        dest.append(std::to_string(i));
+        dest.append(", \"level\": \"");
+        dest.append(site.level);
+        dest.append("\", \"count\": ");
+        dest.append(std::to_string(site.count));
+        dest.append(", \"format\": ");
+        appendJsonString(unescapeStringLiteral(site.format), &dest);
+        dest.push_back('}');
+    }
+    dest.append("\n  ]\n}\n");
+    return dest;
+}
+
+bool BinLogRewriter::saveJson(const std::string& path, Diagnostics* diag) const
+{
+    return saveOutput(path, toJson(), diag);
+}
+}
@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "decode/Config.h"
+#include "decode/core/HashMap.h"
+
+#include <bmcl/StringView.h>
+
+#include <string>
+#include <vector>
+
+namespace decode {
+
+class SrcBuilder;
+class Diagnostics;
+
+// replaces PHOTON_DEBUG/INFO/WARNING/CRITICAL/TRY_MSG calls with string literal messages in generated sources
+// by binary log calls with numeric ids, identical messages share an id
+class BinLogRewriter {
+public:
+    struct Site {
+        const char* level;
+        std::string format;
+        std::size_t count;
+    };
+
+    static constexpr std::size_t maxArgs = 4;
+
+    BinLogRewriter();
+    ~BinLogRewriter();
+
+    void clear();
+    void rewrite(bmcl::StringView src, SrcBuilder* dest);
+
+    const std::vector<Site>& sites() const;
+
+    std::string toJson() const;
+    bool saveJson(const std::string& path, Diagnostics* diag) const;
+
+private:
+    std::size_t siteId(const char* level, bmcl::StringView format);
+    bool rewriteCall(bmcl::StringView name, const std::vector<bmcl::StringView>& args, SrcBuilder* dest);
+
+    HashMap<std::string, std::size_t> _ids;
+    std::vector<Site> _sites;
+};
+}
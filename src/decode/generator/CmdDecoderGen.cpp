@@ -11,6 +11,7 @@
 #include "decode/ast/Component.h"
 #include "decode/generator/TypeReprGen.h"
 #include "decode/generator/FuncPrototypeGen.h"
+#include "decode/generator/MsgStatsGen.h"
 
 namespace decode {
 
@@ -18,6 +19,8 @@ CmdDecoderGen::CmdDecoderGen(SrcBuilder* output)
     : _output(output)
     , _inlineInspector(_output)
     , _paramInspector(_output)
+    , _cfg(nullptr)
+    , _useMsgStats(false)
 {
 }
 
@@ -25,6 +28,26 @@ CmdDecoderGen::~CmdDecoderGen()
 {
 }
 
+void CmdDecoderGen::setSegmentedWriter(bool isSegmented)
+{
+    _inlineInspector.setSegmentedWriter(isSegmented);
+}
+
+void CmdDecoderGen::setMsgStats(bool useMsgStats)
+{
+    _useMsgStats = useMsgStats;
+}
+
+void CmdDecoderGen::setConfiguration(const Configuration* cfg)
+{
+    _cfg = cfg;
+}
+
+bool CmdDecoderGen::hasCmd(const Command* cmd) const
+{
+    return _cfg == nullptr || cmd->matchesConfiguration(_cfg);
+}
+
 void CmdDecoderGen::generateHeader(ComponentMap::ConstRange comps)
 {
     (void)comps;
@@ -34,6 +57,9 @@ void CmdDecoderGen::generateHeader(ComponentMap::ConstRange comps)
     _output->appendOnboardIncludePath("core/Error");
     _output->appendOnboardIncludePath("core/Reader");
     _output->appendOnboardIncludePath("core/Writer");
+    if (_inlineInspector.isSegmentedWriter()) {
+        _output->appendOnboardIncludePath("SegWriter");
+    }
     _output->appendImplIncludePath("core/Try");
     _output->appendEol();
 
@@ -52,6 +78,9 @@ void CmdDecoderGen::generateHeader(ComponentMap::ConstRange comps)
 void CmdDecoderGen::generateSource(ComponentMap::ConstRange comps)
 {
     _output->appendOnboardIncludePath("CmdDecoder");
+    if (_useMsgStats) {
+        _output->appendOnboardIncludePath("MsgStats");
+    }
     _output->appendImplIncludePath("core/Logging");
     _output->appendEol();
     _output->append("#define _PHOTON_FNAME \"CmdDecoder.c\"\n\n");
@@ -69,6 +98,9 @@ void CmdDecoderGen::generateSource(ComponentMap::ConstRange comps)
         _output->appendModIfdef(comp->moduleName());
         _output->appendEol();
         for (const Command* cmd : comp->cmdsRange()) {
+            if (!hasCmd(cmd)) {
+                continue;
+            }
             generateDecoder(comp, cmd);
             _output->appendEol();
             _output->appendEol();
@@ -82,14 +114,30 @@ void CmdDecoderGen::generateSource(ComponentMap::ConstRange comps)
     _output->append("\n#undef _PHOTON_FNAME\n");
 }
 
+bmcl::StringView CmdDecoderGen::writerArgName() const
+{
+    if (_inlineInspector.isSegmentedWriter()) {
+        return "seg";
+    }
+    return "dest";
+}
+
 void CmdDecoderGen::appendCmdFunctionPrototype()
 {
-    _output->append("PhotonError Photon_DeserializeAndExecCmd(uint8_t compNum, uint8_t cmdNum, PhotonReader* src, PhotonWriter* dest)");
+    FuncPrototypeGen prototypeGen(_output);
+    prototypeGen.setSegmentedWriter(_inlineInspector.isSegmentedWriter());
+    _output->append("PhotonError Photon_DeserializeAndExecCmd(uint8_t compNum, uint8_t cmdNum, PhotonReader* src, ");
+    prototypeGen.appendWriterArg();
+    _output->append(")");
 }
 
 void CmdDecoderGen::appendScriptFunctionPrototype()
 {
-    _output->append("PhotonError Photon_ExecScript(PhotonReader* src, PhotonWriter* dest)");
+    FuncPrototypeGen prototypeGen(_output);
+    prototypeGen.setSegmentedWriter(_inlineInspector.isSegmentedWriter());
+    _output->append("PhotonError Photon_ExecScript(PhotonReader* src, ");
+    prototypeGen.appendWriterArg();
+    _output->append(")");
 }
 
 void CmdDecoderGen::generateScriptFunc()
@@ -99,7 +147,9 @@ void CmdDecoderGen::generateScriptFunc()
                     "    uint8_t compNum;\n"
                     "    uint8_t cmdNum;\n\n"
                     "    (void)src;\n"
-                    "    (void)dest;\n\n"
+                    "    (void)");
+    _output->append(writerArgName());
+    _output->append(";\n\n"
                     "    while (PhotonReader_ReadableSize(src) != 0) {\n"
                     "        if (PhotonReader_ReadableSize(src) < 2) {\n"
                     "            PHOTON_CRITICAL(\"Not enough data to deserialize cmd header\");\n"
@@ -107,8 +157,9 @@ void CmdDecoderGen::generateScriptFunc()
                     "        }\n"
                     "        compNum = PhotonReader_ReadU8(src);\n"
                     "        cmdNum = PhotonReader_ReadU8(src);\n"
-                    "        PHOTON_TRY(Photon_DeserializeAndExecCmd(compNum, cmdNum, src, dest));\n"
-                   );
+                    "        PHOTON_TRY(Photon_DeserializeAndExecCmd(compNum, cmdNum, src, ");
+    _output->append(writerArgName());
+    _output->append("));\n");
 
     _output->append("    }\n    return PhotonError_Ok;\n}\n\n");
 }
@@ -116,12 +167,15 @@ void CmdDecoderGen::generateScriptFunc()
 void CmdDecoderGen::generateCmdFunc(ComponentMap::ConstRange comps)
 {
     FuncPrototypeGen prototypeGen(_output);
+    prototypeGen.setSegmentedWriter(_inlineInspector.isSegmentedWriter());
     appendCmdFunctionPrototype();
     _output->append("\n{\n"
                     "    (void)compNum;\n"
                     "    (void)cmdNum;\n"
                     "    (void)src;\n"
-                    "    (void)dest;\n\n"
+                    "    (void)");
+    _output->append(writerArgName());
+    _output->append(";\n\n"
                     "    switch (compNum) {\n");
     for (const Component* comp : comps) {
         if (!comp->hasCmds()) {
@@ -136,13 +190,34 @@ void CmdDecoderGen::generateCmdFunc(ComponentMap::ConstRange comps)
         _output->append("        switch (cmdNum) {\n");
 
         for (const Command* cmd : comp->cmdsRange()) {
-            (void)cmd;
+            // commands disabled by a cfg attribute keep their number and fall to the default case
+            if (!hasCmd(cmd)) {
+                continue;
+            }
             _output->append("        case ");
             _output->appendNumericValue(cmd->number());
+            if (_useMsgStats) {
+                _output->append(": {\n"
+                                "            size_t size = PhotonReader_ReadableSize(src);\n"
+                                "            uint64_t start = PHOTON_MSG_STATS_NOW();\n"
+                                "            PhotonError rv = ");
+                prototypeGen.appendCmdDecoderFunctionName(comp, cmd);
+                _output->append("(src, ");
+                _output->append(writerArgName());
+                _output->append(");\n"
+                                "            PhotonMsgStats_RecordDecode(");
+                MsgStatsGen::appendIndexName(comp, cmd, _output);
+                _output->append(", rv, size - PhotonReader_ReadableSize(src), start);\n"
+                                "            return rv;\n"
+                                "        }\n");
+                continue;
+            }
             _output->append(":\n");
             _output->append("            return ");
             prototypeGen.appendCmdDecoderFunctionName(comp, cmd);
-            _output->append("(src, dest);\n");
+            _output->append("(src, ");
+            _output->append(writerArgName());
+            _output->append(");\n");
         }
         _output->append("        default:\n");
         _output->append("            PHOTON_CRITICAL(\"Recieved invalid cmd id\");\n");
@@ -235,6 +310,7 @@ void CmdDecoderGen::writeReturnOp(const Type* type)
 void CmdDecoderGen::generateDecoder(const Component* comp, const Command* cmd)
 {
     FuncPrototypeGen prototypeGen(_output);
+    prototypeGen.setSegmentedWriter(_inlineInspector.isSegmentedWriter());
     const FunctionType* ftype = cmd->type();
     prototypeGen.appendCmdDecoderFunctionPrototype(comp, cmd);
     _output->append("\n{\n");
@@ -268,7 +344,9 @@ void CmdDecoderGen::generateDecoder(const Component* comp, const Command* cmd)
     _output->appendEol();
 
     _output->append("    (void)src;\n");
-    _output->append("    (void)dest;\n\n");
+    _output->append("    (void)");
+    _output->append(writerArgName());
+    _output->append(";\n\n");
 
     _paramInspector.reset();
     _paramInspector.inspect<true, false>(cmd->argumentsRange(), &_inlineInspector);
@@ -304,6 +382,10 @@ void CmdDecoderGen::generateDecoder(const Component* comp, const Command* cmd)
 
     InlineSerContext ctx;
     if (rv.isSome()) {
+        // return value is written into the chain of the caller, which finishes it after the whole script
+        if (_inlineInspector.isSegmentedWriter()) {
+            _output->appendSegWriterDest();
+        }
         _inlineInspector.inspect<true, true>(rv.unwrap(), ctx, "_rv");
     }
 
@@ -28,6 +28,7 @@ class Command;
 class SrcBuilder;
 class Type;
 class CmdArgument;
+class Configuration;
 
 class InlineCmdParamInspector : public InlineFieldInspector<InlineCmdParamInspector> {
 public:
@@ -84,7 +85,14 @@ public:
     void generateHeader(ComponentMap::ConstRange comps); //TODO: make generic
     void generateSource(ComponentMap::ConstRange comps);
 
+    void setSegmentedWriter(bool isSegmented);
+    void setMsgStats(bool useMsgStats);
+    void setConfiguration(const Configuration* cfg);
+
 private:
+    bool hasCmd(const Command* cmd) const;
+    bmcl::StringView writerArgName() const;
+
     void appendCmdFunctionPrototype();
     void appendScriptFunctionPrototype();
 
@@ -101,5 +109,7 @@ private:
     SrcBuilder* _output;
     InlineTypeInspector _inlineInspector;
     InlineCmdParamInspector _paramInspector;
+    const Configuration* _cfg;
+    bool _useMsgStats;
 };
 }
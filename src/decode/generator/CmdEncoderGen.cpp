@@ -22,6 +22,11 @@ CmdEncoderGen::~CmdEncoderGen()
 {
 }
 
+void CmdEncoderGen::setSegmentedWriter(bool isSegmented)
+{
+    _inlineSer.setSegmentedWriter(isSegmented);
+}
+
 void CmdEncoderGen::generateSource(ComponentMap::ConstRange comps)
 {
     _output->appendImplIncludePath("core/Logging");
@@ -32,6 +37,7 @@ void CmdEncoderGen::generateSource(ComponentMap::ConstRange comps)
     TypeReprGen reprGen(_output);
     WrappingInlineStructInspector inspector(_output);
     FuncPrototypeGen prototypeGen(_output);
+    prototypeGen.setSegmentedWriter(_inlineSer.isSegmentedWriter());
     for (const Component* comp : comps) {
         if (!comp->hasCmds()) {
             continue;
@@ -41,13 +47,20 @@ void CmdEncoderGen::generateSource(ComponentMap::ConstRange comps)
         _output->appendEol();
         for (const Command* cmd : comp->cmdsRange()) {
             prototypeGen.appendCmdEncoderFunctionPrototype(comp, cmd, &reprGen);
-            _output->append("\n{\n"
-                            "    (void)dest;\n"
-                            "    if (PhotonWriter_WritableSize(dest) < 2) {\n"
-                            "        PHOTON_DEBUG(\"Not enough space to serialize cmd header\");\n"
-                            "        return PhotonError_NotEnoughSpace;\n"
-                            "    }\n"
-                            "    PhotonWriter_WriteU8(dest, ");
+            _output->append("\n{\n");
+            if (_inlineSer.isSegmentedWriter()) {
+                _output->appendSegWriterDest();
+            }
+            _output->append("    (void)dest;\n");
+            if (_inlineSer.isSegmentedWriter()) {
+                _output->appendSegmentedWritableSizeCheck(InlineSerContext(), 2);
+            } else {
+                _output->append("    if (PhotonWriter_WritableSize(dest) < 2) {\n"
+                                "        PHOTON_DEBUG(\"Not enough space to serialize cmd header\");\n"
+                                "        return PhotonError_NotEnoughSpace;\n"
+                                "    }\n");
+            }
+            _output->append("    PhotonWriter_WriteU8(dest, ");
             _output->appendNumericValue(comp->number());
             _output->append(");\n"
                             "    PhotonWriter_WriteU8(dest, ");
@@ -25,6 +25,8 @@ public:
     CmdEncoderGen(SrcBuilder* output);
     ~CmdEncoderGen();
 
+    void setSegmentedWriter(bool isSegmented);
+
     void generateSource(ComponentMap::ConstRange comps);
 
 private:
@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "decode/generator/DeviceGuardResolver.h"
+#include "decode/generator/SrcBuilder.h"
+
+#include <vector>
+
+namespace decode {
+
+struct GuardFrame {
+    bool isResolved;
+    bool isTaken;
+    bool wasTaken;
+};
+
+DeviceGuardResolver::DeviceGuardResolver()
+{
+}
+
+DeviceGuardResolver::~DeviceGuardResolver()
+{
+}
+
+void DeviceGuardResolver::declare(bmcl::StringView macro, bool isDefined)
+{
+    _macros[macro.toStdString()] = isDefined;
+}
+
+void DeviceGuardResolver::clear()
+{
+    _macros.clear();
+}
+
+static bmcl::StringView trimSpaces(bmcl::StringView str)
+{
+    const char* begin = str.data();
+    const char* end = begin + str.size();
+    while (begin < end && (*begin == ' ' || *begin == '\t')) {
+        begin++;
+    }
+    while (end > begin && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r')) {
+        end--;
+    }
+    return bmcl::StringView(begin, end - begin);
+}
+
+static bool startsWithDirective(bmcl::StringView line, bmcl::StringView directive, bmcl::StringView* arg)
+{
+    if (line.size() < directive.size() || line.sliceTo(directive.size()) != directive) {
+        return false;
+    }
+    bmcl::StringView rest = line.sliceFrom(directive.size());
+    if (!rest.isEmpty() && rest[0] != ' ' && rest[0] != '\t') {
+        return false;
+    }
+    *arg = trimSpaces(rest);
+    return true;
+}
+
+void DeviceGuardResolver::resolve(bmcl::StringView src, SrcBuilder* dest) const
+{
+    std::vector<GuardFrame> frames;
+    std::size_t hiddenDepth = 0; // number of resolved frames with inactive branch
+
+    auto isEmitting = [&]() {
+        return hiddenDepth == 0;
+    };
+
+    const char* it = src.data();
+    const char* end = it + src.size();
+    while (it < end) {
+        const char* lineEnd = it;
+        while (lineEnd < end && *lineEnd != '\n') {
+            lineEnd++;
+        }
+        bmcl::StringView line(it, lineEnd - it);
+        if (lineEnd < end) {
+            lineEnd++;
+        }
+        bmcl::StringView fullLine(it, lineEnd - it);
+        it = lineEnd;
+
+        bmcl::StringView trimmed = trimSpaces(line);
+        bmcl::StringView arg;
+        bool keepLine = true;
+        if (!trimmed.isEmpty() && trimmed[0] == '#') {
+            bmcl::StringView directive = trimSpaces(trimmed.sliceFrom(1));
+            bool isIfdef = startsWithDirective(directive, "ifdef", &arg);
+            bool isIfndef = !isIfdef && startsWithDirective(directive, "ifndef", &arg);
+            if (isIfdef || isIfndef) {
+                auto macro = _macros.find(arg.toStdString());
+                if (macro == _macros.end()) {
+                    frames.push_back(GuardFrame{false, true, true});
+                } else {
+                    bool isTaken = macro->second == isIfdef;
+                    frames.push_back(GuardFrame{true, isTaken, isTaken});
+                    keepLine = false;
+                    if (!isTaken) {
+                        hiddenDepth++;
+                    }
+                }
+            } else if (startsWithDirective(directive, "if", &arg)) {
+                frames.push_back(GuardFrame{false, true, true});
+            } else if (!frames.empty() && frames.back().isResolved && startsWithDirective(directive, "else", &arg)) {
+                GuardFrame& frame = frames.back();
+                bool isTaken = !frame.wasTaken;
+                if (frame.isTaken && !isTaken) {
+                    hiddenDepth++;
+                } else if (!frame.isTaken && isTaken) {
+                    hiddenDepth--;
+                }
+                frame.isTaken = isTaken;
+                frame.wasTaken = true;
+                keepLine = false;
+            } else if (!frames.empty() && frames.back().isResolved && startsWithDirective(directive, "elif", &arg)) {
+                GuardFrame& frame = frames.back();
+                if (frame.wasTaken) {
+                    // one of previous branches was selected, drop the rest of the chain
+                    if (frame.isTaken) {
+                        hiddenDepth++;
+                    }
+                    frame.isTaken = false;
+                } else {
+                    // nothing selected so far, the rest of the chain becomes a regular #if
+                    hiddenDepth--;
+                    frame.isResolved = false;
+                    frame.isTaken = true;
+                    frame.wasTaken = true;
+                    if (isEmitting()) {
+                        dest->append("#if ");
+                        dest->append(arg);
+                        dest->append('\n');
+                    }
+                }
+                keepLine = false;
+            } else if (!frames.empty() && startsWithDirective(directive, "endif", &arg)) {
+                GuardFrame frame = frames.back();
+                frames.pop_back();
+                if (frame.isResolved) {
+                    if (!frame.isTaken) {
+                        hiddenDepth--;
+                    }
+                    keepLine = false;
+                }
+            }
+        }
+
+        if (keepLine && isEmitting()) {
+            dest->append(fullLine);
+        }
+    }
+}
+}
@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "decode/Config.h"
+#include "decode/core/HashMap.h"
+
+#include <bmcl/StringView.h>
+
+#include <string>
+
+namespace decode {
+
+class SrcBuilder;
+
+// evaluates #ifdef/#ifndef blocks on a known set of macros, everything else is kept as is
+class DeviceGuardResolver {
+public:
+    DeviceGuardResolver();
+    ~DeviceGuardResolver();
+
+    void declare(bmcl::StringView macro, bool isDefined);
+    void clear();
+
+    void resolve(bmcl::StringView src, SrcBuilder* dest) const;
+
+private:
+    HashMap<std::string, bool> _macros;
+};
+}
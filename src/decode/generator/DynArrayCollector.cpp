@@ -27,6 +27,10 @@ void DynArrayCollector::collectUniqueDynArrays(const Type* type, NameToDynArrayM
 
 bool DynArrayCollector::visitDynArrayType(const DynArrayType* dynArray)
 {
+    // structural types are interned, each distinct dyn array is named once
+    if (!_visited.insert(dynArray).second) {
+        return false;
+    }
     _dynArrayName.clear();
     TypeNameGen gen(&_dynArrayName);
     gen.genTypeName(dynArray);
@@ -11,6 +11,7 @@
 #include "decode/Config.h"
 #include "decode/ast/AstVisitor.h"
 #include "decode/parser/Containers.h"
+#include "decode/core/HashSet.h"
 #include "decode/generator/SrcBuilder.h"
 
 #include <string>
@@ -37,5 +38,6 @@ public:
 private:
     SrcBuilder _dynArrayName;
     NameToDynArrayMap* _dest;
+    HashSet<const DynArrayType*> _visited;
 };
 }
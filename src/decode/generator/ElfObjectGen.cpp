@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "decode/generator/ElfObjectGen.h"
+
+#include <bmcl/ArrayView.h>
+#include <bmcl/OptionPtr.h>
+#include <bmcl/StringView.h>
+
+#include <cstring>
+
+namespace decode {
+
+static const ElfTarget targets[] = {
+    {"arm",     40,  0x05000000, false}, // EABI5
+    {"aarch64", 183, 0,          true},
+    {"i386",    3,   0,          false},
+    {"x86_64",  62,  0,          true},
+    {"riscv32", 243, 0,          false},
+    {"riscv64", 243, 0,          true},
+};
+
+static constexpr std::size_t dataAlignment = 8;
+
+// section indices
+static constexpr std::uint16_t rodataIndex = 1;
+// 2 - .note.GNU-stack, 3 - .symtab
+static constexpr std::uint16_t strtabIndex = 4;
+static constexpr std::uint16_t shstrtabIndex = 5;
+static constexpr std::uint16_t sectionCount = 6;
+
+static constexpr std::uint32_t shtProgbits = 1;
+static constexpr std::uint32_t shtSymtab = 2;
+static constexpr std::uint32_t shtStrtab = 3;
+static constexpr std::uint32_t shfAlloc = 0x2;
+
+static const char shstrtab[] = "\0.rodata\0.note.GNU-stack\0.symtab\0.strtab\0.shstrtab";
+static constexpr std::uint32_t rodataName = 1;
+static constexpr std::uint32_t noteName = 9;
+static constexpr std::uint32_t symtabName = 25;
+static constexpr std::uint32_t strtabName = 33;
+static constexpr std::uint32_t shstrtabName = 41;
+
+static void alignBuffer(bmcl::Buffer* dest, std::size_t alignment)
+{
+    while ((dest->size() % alignment) != 0) {
+        dest->writeUint8(0);
+    }
+}
+
+static void writeWord(const ElfTarget* target, bmcl::Buffer* dest, std::uint64_t value)
+{
+    if (target->is64Bit) {
+        dest->writeUint64Le(value);
+    } else {
+        dest->writeUint32Le(std::uint32_t(value));
+    }
+}
+
+static void writeSectionHeader(const ElfTarget* target, bmcl::Buffer* dest, std::uint32_t name, std::uint32_t type,
+                               std::uint64_t flags, std::uint64_t offset, std::uint64_t size, std::uint32_t link,
+                               std::uint32_t info, std::uint64_t alignment, std::uint64_t entrySize)
+{
+    dest->writeUint32Le(name);
+    dest->writeUint32Le(type);
+    writeWord(target, dest, flags);
+    writeWord(target, dest, 0);
+    writeWord(target, dest, offset);
+    writeWord(target, dest, size);
+    dest->writeUint32Le(link);
+    dest->writeUint32Le(info);
+    writeWord(target, dest, alignment);
+    writeWord(target, dest, entrySize);
+}
+
+ElfObjectGen::ElfObjectGen()
+{
+}
+
+ElfObjectGen::~ElfObjectGen()
+{
+}
+
+bmcl::OptionPtr<const ElfTarget> ElfObjectGen::findTarget(bmcl::StringView name)
+{
+    for (const ElfTarget& target : targets) {
+        if (name == target.name) {
+            return &target;
+        }
+    }
+    return bmcl::None;
+}
+
+void ElfObjectGen::addSymbol(bmcl::StringView name, bmcl::Bytes data)
+{
+    alignBuffer(&_rodata, dataAlignment);
+    Symbol symbol;
+    symbol.name = name.toStdString();
+    symbol.offset = _rodata.size();
+    symbol.size = data.size();
+    _symbols.push_back(std::move(symbol));
+    _rodata.write(data);
+}
+
+void ElfObjectGen::generate(const ElfTarget* target, bmcl::Buffer* dest) const
+{
+    std::size_t headerSize = target->is64Bit ? 64 : 52;
+    std::size_t symbolSize = target->is64Bit ? 24 : 16;
+    std::size_t sectionHeaderSize = target->is64Bit ? 64 : 40;
+    std::size_t wordSize = target->is64Bit ? 8 : 4;
+
+    std::string strtab(1, '\0');
+    std::vector<std::uint32_t> symbolNames;
+    symbolNames.reserve(_symbols.size());
+    for (const Symbol& symbol : _symbols) {
+        symbolNames.push_back(std::uint32_t(strtab.size()));
+        strtab.append(symbol.name);
+        strtab.push_back('\0');
+    }
+
+    std::size_t rodataOffset = headerSize;
+    rodataOffset += (dataAlignment - rodataOffset % dataAlignment) % dataAlignment;
+    std::size_t symtabOffset = rodataOffset + _rodata.size();
+    symtabOffset += (wordSize - symtabOffset % wordSize) % wordSize;
+    std::size_t symtabSize = (_symbols.size() + 1) * symbolSize;
+    std::size_t strtabOffset = symtabOffset + symtabSize;
+    std::size_t shstrtabOffset = strtabOffset + strtab.size();
+    std::size_t sectionsOffset = shstrtabOffset + sizeof(shstrtab);
+    sectionsOffset += (wordSize - sectionsOffset % wordSize) % wordSize;
+
+    dest->reserve(sectionsOffset + sectionCount * sectionHeaderSize);
+
+    const uint8_t ident[16] = {0x7f, 'E', 'L', 'F', uint8_t(target->is64Bit ? 2 : 1), 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+    dest->write(ident, sizeof(ident));
+    dest->writeUint16Le(1); // ET_REL
+    dest->writeUint16Le(target->machine);
+    dest->writeUint32Le(1);
+    writeWord(target, dest, 0);
+    writeWord(target, dest, 0);
+    writeWord(target, dest, sectionsOffset);
+    dest->writeUint32Le(target->flags);
+    dest->writeUint16Le(std::uint16_t(headerSize));
+    dest->writeUint16Le(0);
+    dest->writeUint16Le(0);
+    dest->writeUint16Le(std::uint16_t(sectionHeaderSize));
+    dest->writeUint16Le(sectionCount);
+    dest->writeUint16Le(shstrtabIndex);
+
+    alignBuffer(dest, dataAlignment);
+    dest->write(_rodata.data(), _rodata.size());
+
+    alignBuffer(dest, wordSize);
+    for (std::size_t i = 0; i < symbolSize; i++) {
+        dest->writeUint8(0);
+    }
+    for (std::size_t i = 0; i < _symbols.size(); i++) {
+        const Symbol& symbol = _symbols[i];
+        const std::uint8_t info = 0x11; // STB_GLOBAL, STT_OBJECT
+        dest->writeUint32Le(symbolNames[i]);
+        if (target->is64Bit) {
+            dest->writeUint8(info);
+            dest->writeUint8(0);
+            dest->writeUint16Le(rodataIndex);
+            dest->writeUint64Le(symbol.offset);
+            dest->writeUint64Le(symbol.size);
+        } else {
+            dest->writeUint32Le(std::uint32_t(symbol.offset));
+            dest->writeUint32Le(std::uint32_t(symbol.size));
+            dest->writeUint8(info);
+            dest->writeUint8(0);
+            dest->writeUint16Le(rodataIndex);
+        }
+    }
+
+    dest->write(strtab.data(), strtab.size());
+    dest->write(shstrtab, sizeof(shstrtab));
+    alignBuffer(dest, wordSize);
+
+    for (std::size_t i = 0; i < sectionHeaderSize; i++) {
+        dest->writeUint8(0);
+    }
+    writeSectionHeader(target, dest, rodataName, shtProgbits, shfAlloc, rodataOffset, _rodata.size(), 0, 0, dataAlignment, 0);
+    writeSectionHeader(target, dest, noteName, shtProgbits, 0, rodataOffset, 0, 0, 0, 1, 0);
+    writeSectionHeader(target, dest, symtabName, shtSymtab, 0, symtabOffset, symtabSize, strtabIndex, 1, wordSize, symbolSize);
+    writeSectionHeader(target, dest, strtabName, shtStrtab, 0, strtabOffset, strtab.size(), 0, 0, 1, 0);
+    writeSectionHeader(target, dest, shstrtabName, shtStrtab, 0, shstrtabOffset, sizeof(shstrtab), 0, 0, 1, 0);
+}
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "decode/Config.h"
+
+#include <bmcl/Fwd.h>
+#include <bmcl/Buffer.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace decode {
+
+struct ElfTarget {
+    const char* name;
+    std::uint16_t machine;
+    std::uint32_t flags;
+    bool is64Bit;
+};
+
+// generates little-endian relocatable object with global read-only data symbols
+class ElfObjectGen {
+public:
+    ElfObjectGen();
+    ~ElfObjectGen();
+
+    static bmcl::OptionPtr<const ElfTarget> findTarget(bmcl::StringView name);
+
+    void addSymbol(bmcl::StringView name, bmcl::Bytes data);
+    void generate(const ElfTarget* target, bmcl::Buffer* dest) const;
+
+private:
+    struct Symbol {
+        std::string name;
+        std::size_t offset;
+        std::size_t size;
+    };
+
+    std::vector<Symbol> _symbols;
+    bmcl::Buffer _rodata;
+};
+}
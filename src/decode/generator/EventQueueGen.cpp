@@ -0,0 +1,238 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "decode/generator/EventQueueGen.h"
+#include "decode/generator/SrcBuilder.h"
+#include "decode/core/EncodedSizes.h"
+#include "decode/parser/Project.h"
+#include "decode/parser/Package.h"
+#include "decode/ast/Component.h"
+
+#include <bmcl/StringView.h>
+
+#include <algorithm>
+
+namespace decode {
+
+EventQueueGen::EventQueueGen(SrcBuilder* output)
+    : _output(output)
+    , _isSegmented(false)
+{
+}
+
+EventQueueGen::~EventQueueGen()
+{
+}
+
+void EventQueueGen::setSegmentedWriter(bool isSegmented)
+{
+    _isSegmented = isSegmented;
+}
+
+void EventQueueGen::generateHeader(const Project* project)
+{
+    std::size_t maxSize = 2;
+    for (const Component* comp : project->package()->components()) {
+        for (const EventMsg* msg : comp->eventsRange()) {
+            maxSize = std::max(maxSize, msg->encodedSizes().max);
+        }
+    }
+
+    _output->startIncludeGuard("PRIVATE", "EVENT_QUEUE");
+
+    _output->appendOnboardIncludePath("core/Error");
+    _output->appendOnboardIncludePath("core/Writer");
+    _output->appendEol();
+    if (_isSegmented) {
+        _output->append("#include \"photongen/onboard/SegWriter.h\"\n\n");
+    }
+    _output->append("#include <stdatomic.h>\n#include <stddef.h>\n\n");
+
+    _output->appendNumericValueDefine(maxSize, "PHOTON_EVENT_QUEUE_SLOT_SIZE");
+    _output->appendEol();
+    _output->append("#ifndef PHOTON_EVENT_QUEUE_SLOT_COUNT\n"
+                    "# define PHOTON_EVENT_QUEUE_SLOT_COUNT 16\n"
+                    "#endif\n\n"
+                    "#if (PHOTON_EVENT_QUEUE_SLOT_COUNT & (PHOTON_EVENT_QUEUE_SLOT_COUNT - 1)) != 0\n"
+                    "# error \"PHOTON_EVENT_QUEUE_SLOT_COUNT must be a power of 2\"\n"
+                    "#endif\n\n"
+                    "/* largest event payload (without compNum and msgNum) that fits into an empty telemetry frame,\n"
+                    " * must be set when frames are smaller than the largest event */\n"
+                    "#ifndef PHOTON_EVENT_QUEUE_MAX_FRAME_SIZE\n"
+                    "# define PHOTON_EVENT_QUEUE_MAX_FRAME_SIZE PHOTON_EVENT_QUEUE_SLOT_SIZE\n"
+                    "#endif\n\n");
+
+    _output->startCppGuard();
+
+    _output->append("typedef struct {\n"
+                    "    atomic_size_t seq;\n"
+                    "    size_t size;\n"
+                    "    uint8_t data[PHOTON_EVENT_QUEUE_SLOT_SIZE];\n"
+                    "} PhotonEventQueueSlot;\n\n");
+
+    _output->append("/* Photon*_QueueEvent_* may be called from any thread or interrupt. Queued events reach\n"
+                    " * telemetry only when a single consumer (usually the telemetry task) periodically calls\n"
+                    " * PhotonEventQueue_Flush(), which passes them to PhotonTm_BeginEventMsg/PhotonTm_EndEventMsg,\n"
+                    " * or PhotonEventQueue_Drain(), which copies raw (compNum, msgNum, payload) records.\n"
+                    " * Flush drops events larger than PHOTON_EVENT_QUEUE_MAX_FRAME_SIZE and counts them in\n"
+                    " * PhotonEventQueue_DroppedCount(), other events are kept until they fit into a frame.\n"
+                    " * A zero-initialized queue is empty, PhotonEventQueue_Init() only resets it. */\n\n");
+
+    _output->append("void PhotonEventQueue_Init(void);\n");
+    _output->append("PhotonEventQueueSlot* PhotonEventQueue_Reserve(void);\n");
+    _output->append("void PhotonEventQueue_Commit(PhotonEventQueueSlot* slot, size_t size);\n");
+    _output->append("PhotonError PhotonEventQueue_Drain(PhotonWriter* dest);\n");
+    _output->append("size_t PhotonEventQueue_DroppedCount(void);\n");
+    _output->appendModIfdef("tm");
+    _output->append("PhotonError PhotonEventQueue_Flush(void);\n");
+    _output->appendEndif();
+    _output->appendEol();
+
+    _output->endCppGuard();
+
+    _output->endIncludeGuard();
+}
+
+void EventQueueGen::generateSource()
+{
+    _output->append("#include \"photongen/onboard/EventQueue.h\"\n");
+    _output->appendModIfdef("tm");
+    _output->appendOnboardComponentInclude("tm", ".h");
+    _output->appendEndif();
+    _output->appendEol();
+    _output->appendImplIncludePath("core/Logging");
+    _output->appendEol();
+
+    _output->append("#define _PHOTON_FNAME \"photongen/onboard/EventQueue.c\"\n\n");
+
+    //slot sequence numbers are stored relative to the slot index, zero-initialized queue is valid
+    _output->append("typedef struct {\n"
+                    "    atomic_size_t head;\n"
+                    "    size_t tail;\n"
+                    "    atomic_size_t dropped;\n"
+                    "    PhotonEventQueueSlot slots[PHOTON_EVENT_QUEUE_SLOT_COUNT];\n"
+                    "} PhotonEventQueue;\n\n"
+                    "static PhotonEventQueue _photonEventQueue;\n\n");
+
+    _output->append("void PhotonEventQueue_Init(void)\n"
+                    "{\n"
+                    "    size_t i;\n"
+                    "    for (i = 0; i < PHOTON_EVENT_QUEUE_SLOT_COUNT; i++) {\n"
+                    "        atomic_init(&_photonEventQueue.slots[i].seq, 0);\n"
+                    "        _photonEventQueue.slots[i].size = 0;\n"
+                    "    }\n"
+                    "    atomic_init(&_photonEventQueue.head, 0);\n"
+                    "    _photonEventQueue.tail = 0;\n"
+                    "    atomic_init(&_photonEventQueue.dropped, 0);\n"
+                    "}\n\n");
+
+    _output->append("PhotonEventQueueSlot* PhotonEventQueue_Reserve(void)\n"
+                    "{\n"
+                    "    size_t pos = atomic_load_explicit(&_photonEventQueue.head, memory_order_relaxed);\n"
+                    "    while (1) {\n"
+                    "        size_t index = pos & (PHOTON_EVENT_QUEUE_SLOT_COUNT - 1);\n"
+                    "        PhotonEventQueueSlot* slot = &_photonEventQueue.slots[index];\n"
+                    "        size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire) + index;\n"
+                    "        if (seq == pos) {\n"
+                    "            if (atomic_compare_exchange_weak_explicit(&_photonEventQueue.head, &pos, pos + 1,\n"
+                    "                                                      memory_order_relaxed, memory_order_relaxed)) {\n"
+                    "                return slot;\n"
+                    "            }\n"
+                    "        } else if ((ptrdiff_t)(seq - pos) < 0) {\n"
+                    "            return 0;\n"
+                    "        } else {\n"
+                    "            pos = atomic_load_explicit(&_photonEventQueue.head, memory_order_relaxed);\n"
+                    "        }\n"
+                    "    }\n"
+                    "}\n\n");
+
+    _output->append("void PhotonEventQueue_Commit(PhotonEventQueueSlot* slot, size_t size)\n"
+                    "{\n"
+                    "    size_t pos = atomic_load_explicit(&slot->seq, memory_order_relaxed);\n"
+                    "    slot->size = size;\n"
+                    "    atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);\n"
+                    "}\n\n");
+
+    _output->append("static PhotonEventQueueSlot* peekSlot(void)\n"
+                    "{\n"
+                    "    size_t pos = _photonEventQueue.tail;\n"
+                    "    size_t index = pos & (PHOTON_EVENT_QUEUE_SLOT_COUNT - 1);\n"
+                    "    PhotonEventQueueSlot* slot = &_photonEventQueue.slots[index];\n"
+                    "    if (atomic_load_explicit(&slot->seq, memory_order_acquire) + index != pos + 1) {\n"
+                    "        return 0;\n"
+                    "    }\n"
+                    "    return slot;\n"
+                    "}\n\n");
+
+    _output->append("static void releaseSlot(PhotonEventQueueSlot* slot)\n"
+                    "{\n"
+                    "    size_t pos = _photonEventQueue.tail;\n"
+                    "    size_t index = pos & (PHOTON_EVENT_QUEUE_SLOT_COUNT - 1);\n"
+                    "    atomic_store_explicit(&slot->seq, pos + PHOTON_EVENT_QUEUE_SLOT_COUNT - index, memory_order_release);\n"
+                    "    _photonEventQueue.tail = pos + 1;\n"
+                    "}\n\n");
+
+    _output->append("PhotonError PhotonEventQueue_Drain(PhotonWriter* dest)\n"
+                    "{\n"
+                    "    PhotonEventQueueSlot* slot;\n"
+                    "    while ((slot = peekSlot()) != 0) {\n"
+                    "        if (PhotonWriter_WritableSize(dest) < slot->size) {\n"
+                    "            PHOTON_DEBUG(\"Not enough space to drain event\");\n"
+                    "            return PhotonError_NotEnoughSpace;\n"
+                    "        }\n"
+                    "        PhotonWriter_Write(dest, slot->data, slot->size);\n"
+                    "        releaseSlot(slot);\n"
+                    "    }\n"
+                    "    return PhotonError_Ok;\n"
+                    "}\n\n");
+
+    _output->append("size_t PhotonEventQueue_DroppedCount(void)\n"
+                    "{\n"
+                    "    return atomic_load_explicit(&_photonEventQueue.dropped, memory_order_relaxed);\n"
+                    "}\n\n");
+
+    //an event that does not fit into an empty frame would never be flushed and would block the queue,
+    //such events are dropped, other events stay in the queue until the next flush
+    _output->appendModIfdef("tm");
+    _output->append("PhotonError PhotonEventQueue_Flush(void)\n"
+                    "{\n"
+                    "    PhotonEventQueueSlot* slot;\n"
+                    "    while ((slot = peekSlot()) != 0) {\n"
+                    "        if (slot->size >= 2 && slot->size - 2 > PHOTON_EVENT_QUEUE_MAX_FRAME_SIZE) {\n"
+                    "            PHOTON_DEBUG(\"Event does not fit into a frame, dropped\");\n"
+                    "            atomic_fetch_add_explicit(&_photonEventQueue.dropped, 1, memory_order_relaxed);\n"
+                    "        } else if (slot->size >= 2) {\n");
+    if (_isSegmented) {
+        _output->append("            PhotonSegWriter* seg = PhotonTm_BeginEventSegMsg(slot->data[0], slot->data[1]);\n"
+                        "            if (PhotonSegWriter_Write(seg, slot->data + 2, slot->size - 2) != PhotonError_Ok) {\n"
+                        "                /* fits into an empty frame, stays queued until the next flush */\n"
+                        "                PHOTON_DEBUG(\"Not enough space to flush event\");\n"
+                        "                return PhotonError_NotEnoughSpace;\n"
+                        "            }\n"
+                        "            PhotonTm_EndEventSegMsg();\n");
+    } else {
+        _output->append("            PhotonWriter* dest = PhotonTm_BeginEventMsg(slot->data[0], slot->data[1]);\n"
+                        "            if (PhotonWriter_WritableSize(dest) < slot->size - 2) {\n"
+                        "                /* fits into an empty frame, stays queued until the next flush */\n"
+                        "                PHOTON_DEBUG(\"Not enough space to flush event\");\n"
+                        "                return PhotonError_NotEnoughSpace;\n"
+                        "            }\n"
+                        "            PhotonWriter_Write(dest, slot->data + 2, slot->size - 2);\n"
+                        "            PhotonTm_EndEventMsg();\n");
+    }
+    _output->append("        }\n"
+                    "        releaseSlot(slot);\n"
+                    "    }\n"
+                    "    return PhotonError_Ok;\n"
+                    "}\n");
+    _output->appendEndif();
+    _output->appendEol();
+
+    _output->append("#undef _PHOTON_FNAME\n");
+}
+}
@@ -20,6 +20,7 @@ namespace decode {
 
 FuncPrototypeGen::FuncPrototypeGen(SrcBuilder* output)
     : _output(output)
+    , _isSegmentedWriter(false)
 {
 }
 
@@ -27,11 +28,27 @@ FuncPrototypeGen::~FuncPrototypeGen()
 {
 }
 
+void FuncPrototypeGen::setSegmentedWriter(bool isSegmented)
+{
+    _isSegmentedWriter = isSegmented;
+}
+
+void FuncPrototypeGen::appendWriterArg()
+{
+    if (_isSegmentedWriter) {
+        _output->append("PhotonSegWriter* seg");
+    } else {
+        _output->append("PhotonWriter* dest");
+    }
+}
+
 void FuncPrototypeGen::appendCmdDecoderFunctionPrototype(const Component* comp, const Command* cmd)
 {
     _output->append("PhotonError ");
     appendCmdDecoderFunctionName(comp, cmd);
-    _output->append("(PhotonReader* src, PhotonWriter* dest)");
+    _output->append("(PhotonReader* src, ");
+    appendWriterArg();
+    _output->append(")");
 }
 
 void FuncPrototypeGen::appendCmdDecoderFunctionName(const Component* comp, const Command* cmd)
@@ -83,13 +100,13 @@ void FuncPrototypeGen::appendCmdEncoderFunctionPrototype(const Component* comp,
     _output->appendWithFirstUpper(comp->name());
     _output->append("_SerializeCmd_");
     _output->appendWithFirstUpper(cmd->name());
-    if (cmd->type()->argumentsRange().isEmpty()) {
-        _output->append("(PhotonWriter* dest)");
-    } else {
-        _output->append("(");
+    _output->append("(");
+    if (!cmd->type()->argumentsRange().isEmpty()) {
         appendWrappedFuncArgs(cmd->type()->argumentsRange(), reprGen);
-        _output->append(", PhotonWriter* dest)");
+        _output->append(", ");
     }
+    appendWriterArg();
+    _output->append(")");
 }
 
 void FuncPrototypeGen::appendEventEncoderFunctionPrototype(const Component* comp, const EventMsg* msg, TypeReprGen* reprGen)
@@ -103,6 +120,27 @@ void FuncPrototypeGen::appendEventEncoderFunctionPrototype(const Component* comp
     _output->append(")");
 }
 
+void FuncPrototypeGen::appendEventSerializerFunctionName(const Component* comp, const EventMsg* msg)
+{
+    _output->append("Photon");
+    _output->appendWithFirstUpper(comp->moduleName());
+    _output->append("_SerializeEvent_");
+    _output->appendWithFirstUpper(msg->name());
+}
+
+void FuncPrototypeGen::appendEventSerializerFunctionPrototype(const Component* comp, const EventMsg* msg, TypeReprGen* reprGen)
+{
+    _output->append("PhotonError ");
+    appendEventSerializerFunctionName(comp, msg);
+    _output->append("(");
+    if (msg->partsRange().size() != 0) {
+        appendWrappedFuncArgs(msg->partsRange(), reprGen);
+        _output->append(", ");
+    }
+    appendWriterArg();
+    _output->append(")");
+}
+
 
 void FuncPrototypeGen::appendEventDecoderFunctionName(const Component* comp, const EventMsg* msg)
 {
@@ -185,7 +223,9 @@ void FuncPrototypeGen::appendTypeSerializerFunctionPrototype(const Type* type)
     if (type->typeKind() != TypeKind::Enum) {
         _output->append('*');
     }
-    _output->append(" self, PhotonWriter* dest)");
+    _output->append(" self, ");
+    appendWriterArg();
+    _output->append(")");
 }
 
 void FuncPrototypeGen::appendTypeDeserializerFunctionPrototype(const Type* type)
@@ -210,7 +250,9 @@ void FuncPrototypeGen::appendStatusEncoderFunctionPrototype(const Component* com
 {
     _output->append("PhotonError ");
     appendStatusEncoderFunctionName(comp, msg);
-    _output->append("(PhotonWriter* dest)");
+    _output->append("(");
+    appendWriterArg();
+    _output->append(")");
 }
 
 void FuncPrototypeGen::appendStatusDecoderFunctionPrototype(const Component* comp, const StatusMsg* msg)
@@ -29,10 +29,17 @@ public:
     FuncPrototypeGen(SrcBuilder* output);
     ~FuncPrototypeGen();
 
+    void setSegmentedWriter(bool isSegmented);
+
+    // "PhotonSegWriter* seg" with segmented writers, "PhotonWriter* dest" otherwise
+    void appendWriterArg();
+
     void appendCmdDecoderFunctionPrototype(const Component* comp, const Command* cmd);
     void appendCmdDecoderFunctionName(const Component* comp, const Command* cmd);
     void appendCmdEncoderFunctionPrototype(const Component* comp, const Command* cmd, TypeReprGen* reprGen);
     void appendEventEncoderFunctionPrototype(const Component* comp, const EventMsg* msg, TypeReprGen* reprGen);
+    void appendEventSerializerFunctionPrototype(const Component* comp, const EventMsg* msg, TypeReprGen* reprGen);
+    void appendEventSerializerFunctionName(const Component* comp, const EventMsg* msg);
     void appendEventDecoderFunctionPrototype(const Component* comp, const EventMsg* msg);
     void appendEventDecoderFunctionName(const Component* comp, const EventMsg* msg);
     void appendCmdHandlerFunctionProrotype(const Component* comp, const Command* cmd, TypeReprGen* reprGen);
@@ -54,6 +61,7 @@ private:
     void appendWrappedCmdArgs(T range, TypeReprGen* reprGen);
 
     SrcBuilder* _output;
+    bool _isSegmentedWriter;
 };
 
 }
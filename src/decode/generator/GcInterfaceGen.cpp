@@ -2,6 +2,7 @@
 #include "decode/generator/TypeNameGen.h"
 #include "decode/generator/IncludeGen.h"
 #include "decode/generator/TypeDependsCollector.h"
+#include "decode/generator/TypeDependsIndex.h"
 #include "decode/generator/TypeReprGen.h"
 #include "decode/generator/InlineTypeInspector.h"
 #include "decode/generator/GcMsgGen.h"
@@ -17,8 +18,18 @@
 
 namespace decode {
 
+static constexpr std::size_t noSchemaType = std::size_t(-1);
+
 GcInterfaceGen::GcInterfaceGen(SrcBuilder* dest)
     : _output(dest)
+    , _schemaTypeCount(0)
+    , _schemaFieldCount(0)
+    , _schemaRefCount(0)
+    , _schemaCmdCount(0)
+    , _schemaMsgCount(0)
+    , _useMsgStats(false)
+    , _dependsIndex(nullptr)
+    , _cfg(nullptr)
 {
 }
 
@@ -26,6 +37,26 @@ GcInterfaceGen::~GcInterfaceGen()
 {
 }
 
+void GcInterfaceGen::setMsgStats(bool useMsgStats)
+{
+    _useMsgStats = useMsgStats;
+}
+
+void GcInterfaceGen::setDependsIndex(const TypeDependsIndex* index)
+{
+    _dependsIndex = index;
+}
+
+void GcInterfaceGen::setConfiguration(const Configuration* cfg)
+{
+    _cfg = cfg;
+}
+
+bool GcInterfaceGen::hasCmd(const Command* cmd) const
+{
+    return _cfg == nullptr || cmd->matchesConfiguration(_cfg);
+}
+
 //static std::size_t getHolderSize(std::size_t maxValueSize)
 //{
 //    return std::ceil(std::log2(maxValueSize));
@@ -41,95 +72,110 @@ void GcInterfaceGen::generateSource(const Package* package)
                     "#include <decode/ast/Type.h>\n"
                     "#include <decode/ast/AllBuiltinTypes.h>\n"
                     "#include <decode/ast/Field.h>\n"
-                    "#include <decode/parser/Project.h>\n\n"
+                    "#include <decode/parser/Project.h>\n"
+                    "#include <decode/runtime/SchemaValidator.h>\n\n"
                     "#include <photon/groundcontrol/NumberedSub.h>\n\n"
+                    "#include <algorithm>\n\n"
     );
 
     _output->appendEol();
-    _output->append("namespace photongen {\n\n"
-                    "Validator::Validator(const decode::Project* project, const decode::Device* device)\n"
-                    "{\n");
+    _output->append("namespace photongen {\n\n");
 
-    for (const Ast* ast : package->modules()) {
-        _output->append("    decode::Rc<const decode::Ast> _");
-        _output->append(ast->moduleName());
-        _output->append("Ast = decode::findModule(device, \"");
-        _output->append(ast->moduleName());
-        _output->append("\");\n");
-    }
-    _output->appendEol();
-    for (const Component* comp : package->components()) {
-        _output->append("    decode::Rc<const decode::Component> _");
-        _output->append(comp->moduleName());
-        _output->append("Component = decode::getComponent(_");
-        _output->append(comp->moduleName());
-        _output->append("Ast.get());\n");
-        _output->append("    ___hasComponent_");
-        _output->append(comp->name());
-        _output->append(" = !_");
-        _output->append(comp->moduleName());
-        _output->append("Component.isNull();\n");
-        _output->append("    if (!_");
-        _output->append(comp->moduleName());
-        _output->append("Component.isNull()) {\n");
-        _output->append("        ___componentNum_");
-        _output->append(comp->name());
-        _output->append(" = _");
-        _output->append(comp->moduleName());
-        _output->append("Component->number();\n    }\n");
-    }
-    _output->appendEol();
-
-    _output->append("    if (_coreAst.isNull()) {\n        return;\n    }\n"
-                    "    decode::Rc<const decode::BuiltinType> _builtinUsize = _coreAst->builtinTypes()->usizeType();\n"
-                    "    decode::Rc<const decode::BuiltinType> _builtinIsize = _coreAst->builtinTypes()->isizeType();\n"
-                    "    decode::Rc<const decode::BuiltinType> _builtinU8 = _coreAst->builtinTypes()->u8Type();\n"
-                    "    decode::Rc<const decode::BuiltinType> _builtinU16 = _coreAst->builtinTypes()->u16Type();\n"
-                    "    decode::Rc<const decode::BuiltinType> _builtinU32 = _coreAst->builtinTypes()->u32Type();\n"
-                    "    decode::Rc<const decode::BuiltinType> _builtinU64 = _coreAst->builtinTypes()->u64Type();\n"
-                    "    decode::Rc<const decode::BuiltinType> _builtinI8 = _coreAst->builtinTypes()->i8Type();\n"
-                    "    decode::Rc<const decode::BuiltinType> _builtinI16 = _coreAst->builtinTypes()->i16Type();\n"
-                    "    decode::Rc<const decode::BuiltinType> _builtinI32 = _coreAst->builtinTypes()->i32Type();\n"
-                    "    decode::Rc<const decode::BuiltinType> _builtinI64 = _coreAst->builtinTypes()->i64Type();\n"
-                    "    decode::Rc<const decode::BuiltinType> _builtinF32 = _coreAst->builtinTypes()->f32Type();\n"
-                    "    decode::Rc<const decode::BuiltinType> _builtinF64 = _coreAst->builtinTypes()->f64Type();\n"
-                    "    decode::Rc<const decode::BuiltinType> _builtinVaruint = _coreAst->builtinTypes()->varuintType();\n"
-                    "    decode::Rc<const decode::BuiltinType> _builtinVarint = _coreAst->builtinTypes()->varintType();\n"
-                    "    decode::Rc<const decode::BuiltinType> _builtinBool = _coreAst->builtinTypes()->boolType();\n"
-                    "    decode::Rc<const decode::BuiltinType> _builtinVoid = _coreAst->builtinTypes()->voidType();\n"
-                    "    decode::Rc<const decode::BuiltinType> _builtinChar = _coreAst->builtinTypes()->charType();\n\n");
+    appendSchema(package);
 
+    _output->append("Validator::Validator(const decode::Project* project, const decode::Device* device)\n"
+                    "{\n"
+                    "    (void)project;\n"
+                    "    decode::Schema schema;\n");
+    auto appendSchemaArray = [this](bmcl::StringView name, std::size_t size) {
+        if (size == 0) {
+            return;
+        }
+        _output->append("    schema.");
+        _output->append(name);
+        _output->append(" = _schema");
+        _output->appendWithFirstUpper(name);
+        _output->append(";\n");
+    };
+    appendSchemaArray("modules", _schemaModuleIndices.size());
+    appendSchemaArray("types", _schemaTypeCount);
+    appendSchemaArray("fields", _schemaFieldCount);
+    appendSchemaArray("typeRefs", _schemaRefCount);
+    appendSchemaArray("cmds", _schemaCmdCount);
+    appendSchemaArray("msgs", _schemaMsgCount);
+    _output->append("\n    decode::SchemaValidationResult result;\n"
+                    "    decode::validateSchema(schema, device, &result);\n\n");
+
+    std::size_t moduleIndex = 0;
     for (const Ast* ast : package->modules()) {
-        for (const Type* type : ast->typesRange()) {
-            appendTypeValidator(type);
+        if (ast->component().isSome()) {
+            const Component* comp = ast->component().unwrap();
+            _output->append("    ___hasComponent_");
+            _output->append(comp->name());
+            _output->append(" = result.components[");
+            _output->appendNumericValue(moduleIndex);
+            _output->append("].isSome();\n    ___componentNum_");
+            _output->append(comp->name());
+            _output->append(" = result.components[");
+            _output->appendNumericValue(moduleIndex);
+            _output->append("].unwrapOr(0);\n");
         }
+        moduleIndex++;
     }
 
+    std::size_t cmdIndex = 0;
+    std::size_t msgIndex = 0;
+    auto appendResult = [this](const Component* comp, bmcl::StringView kind, bmcl::StringView name, bmcl::StringView array, std::size_t index) {
+        _output->append("    ");
+        appendTypeCheckBitInlineGetter(comp, kind, name);
+        _output->append(" = result.");
+        _output->append(array);
+        _output->append("[");
+        _output->appendNumericValue(index);
+        _output->append("].isSome();\n    ");
+        appendTypeNumDeclInlineGetter(comp, kind, name);
+        _output->append(" = result.");
+        _output->append(array);
+        _output->append("[");
+        _output->appendNumericValue(index);
+        _output->append("].unwrapOr(0);\n");
+    };
     for (const Ast* ast : package->modules()) {
         if (ast->component().isNone()) {
             continue;
         }
         const Component* comp = ast->component().unwrap();
         for (const Command* cmd : comp->cmdsRange()) {
-            appendCmdValidator(comp, cmd);
+            if (!hasCmd(cmd)) {
+                continue;
+            }
+            appendResult(comp, "cmd", cmd->name(), "cmds", cmdIndex);
+            cmdIndex++;
         }
         for (const StatusMsg* msg : comp->statusesRange()) {
-            appendStatusValidator(comp, msg);
+            appendResult(comp, "status", msg->name(), "msgs", msgIndex);
+            msgIndex++;
         }
         for (const EventMsg* msg : comp->eventsRange()) {
-            appendEventValidator(comp, msg);
+            appendResult(comp, "event", msg->name(), "msgs", msgIndex);
+            msgIndex++;
         }
     }
     _output->append("}\n\n");
 
     _output->append("Validator::~Validator()\n{\n}\n\n");
 
+    appendTmRouterFill(package);
+
     for (const Ast* ast : package->modules()) {
         if (ast->component().isNone()) {
             continue;
         }
         const Component* comp = ast->component().unwrap();
         for (const Command* cmd : comp->cmdsRange()) {
+            if (!hasCmd(cmd)) {
+                continue;
+            }
             appendCmdMethods(comp, cmd);
         }
         for (const StatusMsg* msg : comp->statusesRange()) {
@@ -141,7 +187,17 @@ void GcInterfaceGen::generateSource(const Package* package)
     }
 
 
-    _output->append("}\n");
+    _output->append("}\n\n");
+
+    GcMsgGen msgGen(_output);
+    for (const Component* comp : package->components()) {
+        for (const StatusMsg* msg : comp->statusesRange()) {
+            msgGen.appendStatusDeserializer(comp, msg);
+        }
+        for (const EventMsg* msg : comp->eventsRange()) {
+            msgGen.appendEventDeserializer(comp, msg);
+        }
+    }
     _validatedTypes.clear();
 }
 
@@ -149,37 +205,79 @@ void GcInterfaceGen::generateHeader(const Package* package)
 {
     _output->appendPragmaOnce();
     _output->appendEol();
-    TypeDependsCollector coll;
+    _output->append("// umbrella header, contains only includes and can be used as a precompiled header\n\n");
     TypeDependsCollector::Depends depends;
-    for (const Ast* ast : package->modules()) {
-        coll.collect(ast, &depends);
+    if (_dependsIndex) {
+        TypeDependsIndex::Bits bits;
+        for (const Ast* ast : package->modules()) {
+            TypeDependsIndex::unite(&bits, _dependsIndex->moduleDepends(ast).unwrap()->types);
+        }
+        _dependsIndex->toDepends(bits, &depends);
+    } else {
+        TypeDependsCollector coll;
+        for (const Ast* ast : package->modules()) {
+            coll.collect(ast, &depends);
+        }
     }
     IncludeGen includeGen(_output);
     includeGen.genGcIncludePaths(&depends);
     _output->appendEol();
 
     for (const Component* comp : package->components()) {
-        for (const EventMsg* msg : comp->eventsRange()) {
-            _output->append("#include \"photongen/groundcontrol/_events_/");
-            _output->appendWithFirstUpper(comp->name());
-            _output->append("_");
-            _output->appendWithFirstUpper(msg->name());
-            _output->append(".hpp\"\n");
-        }
-        for (const StatusMsg* msg : comp->statusesRange()) {
-            _output->append("#include \"photongen/groundcontrol/_statuses_/");
-            _output->appendWithFirstUpper(comp->name());
-            _output->append("_");
-            _output->appendWithFirstUpper(msg->name());
-            _output->append(".hpp\"\n");
-        }
+        _output->append("#include \"photongen/groundcontrol/_components_/");
+        _output->appendWithFirstUpper(comp->name());
+        _output->append(".hpp\"\n");
     }
     _output->appendEol();
 
-    _output->append("#include \"photongen/groundcontrol/Validator.hpp\"\n\n");
+    _output->append("#include \"photongen/groundcontrol/Validator.hpp\"\n");
+    _output->append("#include \"photongen/groundcontrol/TmRouter.hpp\"\n\n");
     _validatedTypes.clear();
 }
 
+void GcInterfaceGen::generateComponentHeader(const Component* comp)
+{
+    _output->appendPragmaOnce();
+    _output->appendEol();
+    TypeDependsCollector::Depends depends;
+    bmcl::OptionPtr<const TypeDependsIndex::ModuleDepends> indexed;
+    if (_dependsIndex) {
+        indexed = _dependsIndex->componentDepends(comp);
+    }
+    if (indexed.isSome()) {
+        TypeDependsIndex::Bits bits = indexed->cmds;
+        TypeDependsIndex::unite(&bits, indexed->statuses);
+        TypeDependsIndex::unite(&bits, indexed->events);
+        _dependsIndex->toDepends(bits, &depends);
+    } else {
+        TypeDependsCollector coll;
+        coll.collectCmds(comp->cmdsRange(), &depends);
+        coll.collectStatuses(comp->statusesRange(), &depends);
+        coll.collectEvents(comp->eventsRange(), &depends);
+    }
+    IncludeGen includeGen(_output);
+    includeGen.genGcIncludePaths(&depends);
+    _output->appendEol();
+
+    for (const StatusMsg* msg : comp->statusesRange()) {
+        _output->append("#include \"photongen/groundcontrol/_statuses_/");
+        _output->appendWithFirstUpper(comp->name());
+        _output->append("_");
+        _output->appendWithFirstUpper(msg->name());
+        _output->append(".hpp\"\n");
+    }
+    for (const EventMsg* msg : comp->eventsRange()) {
+        _output->append("#include \"photongen/groundcontrol/_events_/");
+        _output->appendWithFirstUpper(comp->name());
+        _output->append("_");
+        _output->appendWithFirstUpper(msg->name());
+        _output->append(".hpp\"\n");
+    }
+    _output->appendEol();
+
+    _output->append("#include \"photongen/groundcontrol/Validator.hpp\"\n");
+}
+
 void GcInterfaceGen::appendTypeCheckBitInlineGetter(const Component* comp, bmcl::StringView kind, bmcl::StringView name)
 {
     _output->append("__has__");
@@ -242,7 +340,8 @@ void GcInterfaceGen::generateValidatorHeader(const Package* package)
                     "}\n\n"
                     "#include <photon/core/Rc.h>\n\n"
 
-                    "namespace photongen {\n\n");
+                    "namespace photongen {\n\n"
+                    "class TmRouter;\n\n");
 
     for (const Component* comp : package->components()) {
         bool hasStatuses = !comp->statusesRange().empty();
@@ -273,6 +372,9 @@ void GcInterfaceGen::generateValidatorHeader(const Package* package)
         }
 
         for (const Command* cmd : comp->cmdsRange()) {
+            if (!hasCmd(cmd)) {
+                continue;
+            }
             for (const Field* field : cmd->fieldsRange()) {
                 appendFwd(field->type(), bmcl::None);
             }
@@ -288,6 +390,7 @@ void GcInterfaceGen::generateValidatorHeader(const Package* package)
     _output->append("class Validator : public photon::RefCountable {\npublic:\n"
                     "    Validator(const decode::Project* project, const decode::Device* device);\n"
                     "    ~Validator();\n\n"
+                    "    void fillTmRouter(TmRouter* router) const;\n\n"
     );
 
 
@@ -297,6 +400,9 @@ void GcInterfaceGen::generateValidatorHeader(const Package* package)
         }
         const Component* comp = ast->component().unwrap();
         for (const Command* cmd : comp->cmdsRange()) {
+            if (!hasCmd(cmd)) {
+                continue;
+            }
             appendCmdDecls(comp, cmd);
         }
         for (const StatusMsg* msg : comp->statusesRange()) {
@@ -317,6 +423,9 @@ void GcInterfaceGen::generateValidatorHeader(const Package* package)
 
     for (const Component* comp : package->components()) {
         for (const Command* cmd : comp->cmdsRange()) {
+            if (!hasCmd(cmd)) {
+                continue;
+            }
             appendTypeCheckBitDecl(comp, "cmd", cmd->name());
         }
         for (const StatusMsg* msg : comp->statusesRange()) {
@@ -335,6 +444,9 @@ void GcInterfaceGen::generateValidatorHeader(const Package* package)
 
     for (const Component* comp : package->components()) {
         for (const Command* cmd : comp->cmdsRange()) {
+            if (!hasCmd(cmd)) {
+                continue;
+            }
             appendTypeNumDecl(comp, "cmd", cmd->name());
         }
         for (const StatusMsg* msg : comp->statusesRange()) {
@@ -349,22 +461,6 @@ void GcInterfaceGen::generateValidatorHeader(const Package* package)
     _validatedTypes.clear();
 }
 
-void GcInterfaceGen::appendCmdFieldName(const Component* comp, const Command* cmd)
-{
-    _output->append("_cmd");
-    _output->appendWithFirstUpper(comp->moduleName());
-    _output->appendWithFirstUpper(cmd->name());
-}
-
-void GcInterfaceGen::appendMsgFieldName(const Component* comp, const TmMsg* msg, bmcl::StringView msgTypeName)
-{
-    _output->append("_");
-    _output->append(msgTypeName);
-    _output->append("Msg");
-    _output->appendWithFirstUpper(comp->moduleName());
-    _output->appendWithFirstUpper(msg->name());
-}
-
 static void appendHasTmMsgDecl(const Component* comp, const TmMsg* msg, bmcl::StringView msgTypeName, SrcBuilder* _output, bool isInside)
 {
     if (isInside) {
@@ -421,6 +517,259 @@ void GcInterfaceGen::appendTmDecls(const Component* comp, const TmMsg* msg, bmcl
     _output->appendEol();
 }
 
+void GcInterfaceGen::appendTmRouterName(const Component* comp, const TmMsg* msg, bmcl::StringView msgTypeName)
+{
+    _output->appendWithFirstUpper(msgTypeName);
+    _output->append("Msg");
+    _output->appendWithFirstUpper(comp->moduleName());
+    _output->appendWithFirstUpper(msg->name());
+}
+
+void GcInterfaceGen::appendTmRouterSlot(const Component* comp, const TmMsg* msg, bmcl::StringView msgTypeName, bmcl::StringView namespaceName)
+{
+    _output->append("    void set");
+    appendTmRouterName(comp, msg, msgTypeName);
+    _output->append("Handler(void (*handler)(const ");
+    GcMsgGen::genTmMsgType(comp, msg, namespaceName, _output);
+    _output->append("& msg, void* userData), void* userData)\n    {\n        _handler");
+    appendTmRouterName(comp, msg, msgTypeName);
+    _output->append(" = handler;\n        _userData");
+    appendTmRouterName(comp, msg, msgTypeName);
+    _output->append(" = userData;\n    }\n\n");
+}
+
+void GcInterfaceGen::generateTmRouterHeader(const Package* package)
+{
+    _output->appendPragmaOnce();
+    _output->appendEol();
+
+    for (const Component* comp : package->components()) {
+        _output->append("#include \"photongen/groundcontrol/_components_/");
+        _output->appendWithFirstUpper(comp->name());
+        _output->append(".hpp\"\n");
+    }
+    if (_useMsgStats) {
+        _output->append("#include \"photongen/groundcontrol/MsgStats.hpp\"\n");
+    }
+    _output->appendEol();
+
+    _output->append("#include <photon/core/Rc.h>\n\n"
+                    "#include <bmcl/MemReader.h>\n\n"
+                    "#include <vector>\n"
+                    "#include <cstdint>\n"
+                    "#include <cstddef>\n\n"
+                    "namespace photon {\n"
+                    "class CoderState;\n"
+                    "}\n\n"
+                    "namespace photongen {\n\n"
+                    "class Validator;\n\n");
+
+    _output->append("class TmRouter : public photon::RefCountable {\n"
+                    "public:\n"
+                    "    TmRouter()\n"
+                    "        : _compCount(0)\n"
+                    "        , _msgCount(0)\n");
+    if (_useMsgStats) {
+        _output->append("        , _handlerMsgStats(nullptr)\n"
+                        "        , _userDataMsgStats(nullptr)\n");
+    }
+    auto appendInit = [this](const Component* comp, const TmMsg* msg, bmcl::StringView msgTypeName) {
+        _output->append("        , _handler");
+        appendTmRouterName(comp, msg, msgTypeName);
+        _output->append("(nullptr)\n        , _userData");
+        appendTmRouterName(comp, msg, msgTypeName);
+        _output->append("(nullptr)\n");
+    };
+    for (const Component* comp : package->components()) {
+        for (const StatusMsg* msg : comp->statusesRange()) {
+            appendInit(comp, msg, "status");
+        }
+        for (const EventMsg* msg : comp->eventsRange()) {
+            appendInit(comp, msg, "event");
+        }
+    }
+    _output->append("    {\n    }\n\n");
+
+    for (const Component* comp : package->components()) {
+        for (const StatusMsg* msg : comp->statusesRange()) {
+            appendTmRouterSlot(comp, msg, "status", "statuses");
+        }
+        for (const EventMsg* msg : comp->eventsRange()) {
+            appendTmRouterSlot(comp, msg, "event", "events");
+        }
+    }
+
+    if (_useMsgStats) {
+        _output->append("    void setMsgStatsHandler(void (*handler)(const MsgStats& stats, void* userData), void* userData)\n"
+                        "    {\n"
+                        "        _handlerMsgStats = handler;\n"
+                        "        _userDataMsgStats = userData;\n"
+                        "    }\n\n"
+                        "    const MsgStats& msgStats() const\n"
+                        "    {\n"
+                        "        return _msgStats;\n"
+                        "    }\n\n");
+    }
+
+    _output->append("    bool route(bmcl::MemReader* src, photon::CoderState* state)\n"
+                    "    {\n"
+                    "        while (!src->isEmpty()) {\n"
+                    "            if (src->sizeLeft() < 2) {\n"
+                    "                return false;\n"
+                    "            }\n"
+                    "            std::size_t compNum = src->readUint8();\n"
+                    "            std::size_t msgNum = src->readUint8();\n");
+    if (_useMsgStats) {
+        _output->append("            if (compNum == MsgStats::compNum && msgNum == MsgStats::msgNum) {\n"
+                        "                if (!_msgStats.deserialize(src)) {\n"
+                        "                    return false;\n"
+                        "                }\n"
+                        "                if (_handlerMsgStats) {\n"
+                        "                    _handlerMsgStats(_msgStats, _userDataMsgStats);\n"
+                        "                }\n"
+                        "                continue;\n"
+                        "            }\n");
+    }
+    _output->append("            if (compNum >= _compCount || msgNum >= _msgCount) {\n"
+                    "                return false;\n"
+                    "            }\n"
+                    "            RouteFunc func = _routes[compNum * _msgCount + msgNum];\n"
+                    "            if (!func) {\n"
+                    "                return false;\n"
+                    "            }\n"
+                    "            if (!func(this, src, state)) {\n"
+                    "                return false;\n"
+                    "            }\n"
+                    "        }\n"
+                    "        return true;\n"
+                    "    }\n\n"
+                    "private:\n"
+                    "    friend class Validator;\n\n"
+                    "    using RouteFunc = bool (*)(TmRouter* self, bmcl::MemReader* src, photon::CoderState* state);\n\n"
+                    "    void resetRoutes(std::size_t compCount, std::size_t msgCount)\n"
+                    "    {\n"
+                    "        _compCount = compCount;\n"
+                    "        _msgCount = msgCount;\n"
+                    "        _routes.assign(compCount * msgCount, nullptr);\n"
+                    "    }\n\n"
+                    "    void setRoute(std::size_t compNum, std::size_t msgNum, RouteFunc func)\n"
+                    "    {\n"
+                    "        _routes[compNum * _msgCount + msgNum] = func;\n"
+                    "    }\n\n");
+
+    auto appendRoute = [this](const Component* comp, const TmMsg* msg, bmcl::StringView msgTypeName) {
+        _output->append("    static bool route");
+        appendTmRouterName(comp, msg, msgTypeName);
+        _output->append("(TmRouter* self, bmcl::MemReader* src, photon::CoderState* state)\n"
+                        "    {\n"
+                        "        if (!photongenDeserialize(&self->_msg");
+        appendTmRouterName(comp, msg, msgTypeName);
+        _output->append(", src, state)) {\n"
+                        "            return false;\n"
+                        "        }\n"
+                        "        if (self->_handler");
+        appendTmRouterName(comp, msg, msgTypeName);
+        _output->append(") {\n            self->_handler");
+        appendTmRouterName(comp, msg, msgTypeName);
+        _output->append("(self->_msg");
+        appendTmRouterName(comp, msg, msgTypeName);
+        _output->append(", self->_userData");
+        appendTmRouterName(comp, msg, msgTypeName);
+        _output->append(");\n        }\n        return true;\n    }\n\n");
+    };
+    for (const Component* comp : package->components()) {
+        for (const StatusMsg* msg : comp->statusesRange()) {
+            appendRoute(comp, msg, "status");
+        }
+        for (const EventMsg* msg : comp->eventsRange()) {
+            appendRoute(comp, msg, "event");
+        }
+    }
+
+    _output->append("    std::vector<RouteFunc> _routes;\n"
+                    "    std::size_t _compCount;\n"
+                    "    std::size_t _msgCount;\n");
+    if (_useMsgStats) {
+        _output->append("    MsgStats _msgStats;\n"
+                        "    void (*_handlerMsgStats)(const MsgStats& stats, void* userData);\n"
+                        "    void* _userDataMsgStats;\n");
+    }
+    auto appendMembers = [this](const Component* comp, const TmMsg* msg, bmcl::StringView msgTypeName, bmcl::StringView namespaceName) {
+        _output->append("    ");
+        GcMsgGen::genTmMsgType(comp, msg, namespaceName, _output);
+        _output->append(" _msg");
+        appendTmRouterName(comp, msg, msgTypeName);
+        _output->append(";\n    void (*_handler");
+        appendTmRouterName(comp, msg, msgTypeName);
+        _output->append(")(const ");
+        GcMsgGen::genTmMsgType(comp, msg, namespaceName, _output);
+        _output->append("& msg, void* userData);\n    void* _userData");
+        appendTmRouterName(comp, msg, msgTypeName);
+        _output->append(";\n");
+    };
+    for (const Component* comp : package->components()) {
+        for (const StatusMsg* msg : comp->statusesRange()) {
+            appendMembers(comp, msg, "status", "statuses");
+        }
+        for (const EventMsg* msg : comp->eventsRange()) {
+            appendMembers(comp, msg, "event", "events");
+        }
+    }
+    _output->append("};\n}\n");
+}
+
+void GcInterfaceGen::appendTmRouterMsgCheck(const Component* comp, const TmMsg* msg, bmcl::StringView msgTypeName)
+{
+    _output->append("    if (___hasComponent_");
+    _output->append(comp->name());
+    _output->append(" && ");
+    appendTypeCheckBitInlineGetter(comp, msgTypeName, msg->name());
+    _output->append(") {\n");
+}
+
+void GcInterfaceGen::appendTmRouterFill(const Package* package)
+{
+    _output->append("void Validator::fillTmRouter(TmRouter* router) const\n{\n"
+                    "    std::size_t compCount = 0;\n"
+                    "    std::size_t msgCount = 0;\n");
+    auto appendCount = [this](const Component* comp, const TmMsg* msg, bmcl::StringView msgTypeName) {
+        appendTmRouterMsgCheck(comp, msg, msgTypeName);
+        _output->append("        compCount = std::max<std::size_t>(compCount, ");
+        appendComponentNumberInlineGetter(comp);
+        _output->append(" + 1);\n        msgCount = std::max<std::size_t>(msgCount, ");
+        appendTypeNumDeclInlineGetter(comp, msgTypeName, msg->name());
+        _output->append(" + 1);\n    }\n");
+    };
+    auto appendSet = [this](const Component* comp, const TmMsg* msg, bmcl::StringView msgTypeName) {
+        appendTmRouterMsgCheck(comp, msg, msgTypeName);
+        _output->append("        router->setRoute(");
+        appendComponentNumberInlineGetter(comp);
+        _output->append(", ");
+        appendTypeNumDeclInlineGetter(comp, msgTypeName, msg->name());
+        _output->append(", &TmRouter::route");
+        appendTmRouterName(comp, msg, msgTypeName);
+        _output->append(");\n    }\n");
+    };
+    for (const Component* comp : package->components()) {
+        for (const StatusMsg* msg : comp->statusesRange()) {
+            appendCount(comp, msg, "status");
+        }
+        for (const EventMsg* msg : comp->eventsRange()) {
+            appendCount(comp, msg, "event");
+        }
+    }
+    _output->append("    router->resetRoutes(compCount, msgCount);\n");
+    for (const Component* comp : package->components()) {
+        for (const StatusMsg* msg : comp->statusesRange()) {
+            appendSet(comp, msg, "status");
+        }
+        for (const EventMsg* msg : comp->eventsRange()) {
+            appendSet(comp, msg, "event");
+        }
+    }
+    _output->append("}\n\n");
+}
+
 void GcInterfaceGen::appendComponentCheck(const Component* comp, bmcl::StringView returnValue)
 {
     _output->append("    if(!___hasComponent_");
@@ -597,111 +946,6 @@ void GcInterfaceGen::appendCmdMethods(const Component* comp, const Command* cmd)
     }
 }
 
-void GcInterfaceGen::appendComponentFieldName(const Component* comp)
-{
-    _output->append("_");
-    _output->append(comp->moduleName());
-    _output->append("Component");
-}
-
-void GcInterfaceGen::appendCmdValidator(const Component* comp, const Command* cmd)
-{
-    _output->append("    decode::Rc<const decode::Command> ");
-    appendCmdFieldName(comp, cmd);
-    _output->append(" = decode::findCmd(");
-    appendComponentFieldName(comp);
-    _output->append(".get(), \"");
-    _output->append(cmd->name());
-    _output->append("\", ");
-    _output->appendNumericValue(cmd->fieldsRange().size());
-    _output->append(");\n");
-
-    std::size_t i = 0;
-    for (const Field* field : cmd->fieldsRange()) {
-        appendTypeValidator(field->type());
-        _output->append("    decode::expectCmdArg(&");
-        appendCmdFieldName(comp, cmd);
-        _output->append(", ");
-        _output->appendNumericValue(i);
-        _output->append(", ");
-        appendTestedType(field->type());
-        _output->append(".get());\n");
-        i++;
-    }
-    auto rv = cmd->type()->returnValue();
-    if (rv.isSome()) {
-        appendTypeValidator(rv.unwrap());
-        _output->append("    decode::expectCmdRv(&");
-        appendCmdFieldName(comp, cmd);
-        _output->append(", ");
-        appendTestedType(rv.unwrap());
-        _output->append(".get());\n");
-    } else {
-        _output->append("    decode::expectCmdNoRv(&");
-        appendCmdFieldName(comp, cmd);
-        _output->append(");\n");
-    }
-
-    _output->append("    ");
-    appendTypeCheckBitInlineGetter(comp, "cmd", cmd->name());
-    _output->append(" = !");
-    appendCmdFieldName(comp, cmd);
-    _output->append(".isNull();\n");
-
-    _output->append("    if (!");
-    appendCmdFieldName(comp, cmd);
-    _output->append(".isNull()) {\n        ");
-    appendTypeNumDeclInlineGetter(comp, "cmd", cmd->name());
-    _output->append(" = ");
-    appendCmdFieldName(comp, cmd);
-    _output->append("->number();\n    }\n");
-
-    _output->appendEol();
-}
-
-void GcInterfaceGen::appendTmMsgValidator(const Component* comp, const TmMsg* msg, bmcl::StringView typeName)
-{
-    _output->append("    decode::Rc<const decode::");
-    _output->appendWithFirstUpper(typeName);
-    _output->append("Msg> ");
-    appendMsgFieldName(comp, msg, typeName);
-    _output->append(" = decode::find");
-    _output->appendWithFirstUpper(typeName);
-    _output->append("Msg(");
-    appendComponentFieldName(comp);
-    _output->append(".get(), \"");
-    _output->append(msg->name());
-    _output->append("\");\n");
-
-    //REFACT
-    //move after full validation
-    _output->append("    ");
-    appendTypeCheckBitInlineGetter(comp, typeName, msg->name());
-    _output->append(" = !");
-    appendMsgFieldName(comp, msg, typeName);
-    _output->append(".isNull();\n");
-
-    _output->append("    if (!");
-    appendMsgFieldName(comp, msg, typeName);
-    _output->append(".isNull()) {\n        ");
-    appendTypeNumDeclInlineGetter(comp, typeName, msg->name());
-    _output->append(" = ");
-    appendMsgFieldName(comp, msg, typeName);
-    _output->append("->number();\n    }\n");
-}
-
-void GcInterfaceGen::appendStatusValidator(const Component* comp, const StatusMsg* msg)
-{
-    appendTmMsgValidator(comp, msg, "status");
-    //TODO: validate status parts
-}
-
-void GcInterfaceGen::appendEventValidator(const Component* comp, const EventMsg* msg)
-{
-    appendTmMsgValidator(comp, msg, "event");
-    //TODO: validate event fields
-}
-
 bool GcInterfaceGen::appendFwd(const Type* type, bmcl::OptionPtr<const GenericType> parent)
 {
     auto beginType = [this, parent](const NamedType* type) {
@@ -837,279 +1081,305 @@ bool GcInterfaceGen::insertForwardedType(const Type* type)
     return pair.second;
 }
 
-bool GcInterfaceGen::insertValidatedType(const Type* type)
+void GcInterfaceGen::appendTestedType(const Type* type, SrcBuilder* dest)
 {
-    if (type->isImported()) {
-        return true;
+    auto appendNamed = [dest](const NamedType* type) {
+        dest->append('_');
+        dest->append(type->moduleName());
+        dest->appendWithFirstUpper(type->name());
+    };
+    switch (type->typeKind()) {
+    case TypeKind::Builtin:
+        dest->append("_builtin");
+        dest->appendWithFirstUpper(type->asBuiltin()->renderedTypeName(type->asBuiltin()->builtinTypeKind()));
+        break;
+    case TypeKind::Reference:
+    case TypeKind::Array:
+    case TypeKind::Function:
+    case TypeKind::GenericParameter:
+    case TypeKind::DynArray:
+    case TypeKind::GenericInstantiation: {
+        TypeNameGen gen(dest);
+        dest->append("_");
+        gen.genTypeName(type);
+        break;
+    }
+    case TypeKind::Enum:
+        appendNamed(type->asEnum());
+        break;
+    case TypeKind::Struct:
+        appendNamed(type->asStruct());
+        break;
+    case TypeKind::Variant:
+        appendNamed(type->asVariant());
+        break;
+    case TypeKind::Imported:
+        appendTestedType(type->asImported()->link(), dest);
+        break;
+    case TypeKind::Alias:
+        appendTestedType(type->asAlias()->alias(), dest);
+        break;
+    case TypeKind::Generic:
+        appendNamed(type->asGeneric());
+        break;
     }
-    appendTestedType(type, &_nameBuilder);
-    auto pair = _validatedTypes.emplace(_nameBuilder.view().toStdString(), type);
-    _nameBuilder.clear();
-    return pair.second;
 }
 
-void GcInterfaceGen::appendStructValidator(const StructType* type)
+std::size_t GcInterfaceGen::schemaModuleIndex(bmcl::StringView name) const
 {
-    for (const Field* field : type->fieldsRange()) {
-        appendTypeValidator(field->type());
-    }
-    appendNamedTypeInit(type, "Struct");
-    _output->append("    decode::expectFieldNum(&_");
-    _output->append(type->moduleName());
-    _output->appendWithFirstUpper(type->name());
-    _output->append(", ");
-    _output->appendNumericValue(type->fieldsRange().size());
-    _output->append(");\n");
+    auto it = _schemaModuleIndices.find(name);
+    assert(it != _schemaModuleIndices.end());
+    return it->second;
+}
 
-    std::size_t i = 0;
-    for (const Field* field : type->fieldsRange()) {
-        _output->append("    decode::expectField(&_");
-        _output->append(type->moduleName());
-        _output->appendWithFirstUpper(type->name());
-        _output->append(", ");
-        _output->appendNumericValue(i);
-        _output->append(", \"");
-        _output->append(field->name());
-        _output->append("\", ");
-        appendTestedType(field->type());
-        _output->append(".get()");
-        _output->append(");\n");
-        i++;
+void GcInterfaceGen::appendSchemaTypeEntry(bmcl::StringView kind, std::size_t flags, std::size_t module, bmcl::StringView name,
+                                           std::uint64_t size, std::size_t inner, std::size_t first, std::size_t count)
+{
+    _schemaTypes.append("    {decode::SchemaTypeKind::");
+    _schemaTypes.append(kind);
+    _schemaTypes.append(", ");
+    _schemaTypes.appendNumericValue(flags);
+    _schemaTypes.append(", ");
+    _schemaTypes.appendNumericValue(module);
+    if (name.isEmpty()) {
+        _schemaTypes.append(", nullptr, ");
+    } else {
+        _schemaTypes.append(", \"");
+        _schemaTypes.appendWithFirstUpper(name);
+        _schemaTypes.append("\", ");
     }
-    _output->appendEol();
+    _schemaTypes.appendNumericValue(size);
+    _schemaTypes.append(", ");
+    appendSchemaTypeIndex(inner, &_schemaTypes);
+    _schemaTypes.append(", ");
+    _schemaTypes.appendNumericValue(first);
+    _schemaTypes.append(", ");
+    _schemaTypes.appendNumericValue(count);
+    _schemaTypes.append("},\n");
 }
 
-void GcInterfaceGen::appendEnumValidator(const EnumType* type)
+void GcInterfaceGen::appendSchemaTypeIndex(std::size_t index, SrcBuilder* dest)
 {
-    appendNamedTypeInit(type, "Enum");
-    _output->appendEol();
+    if (index == noSchemaType) {
+        dest->append("decode::schemaNoType");
+    } else {
+        dest->appendNumericValue(index);
+    }
 }
 
-void GcInterfaceGen::appendVariantValidator(const VariantType* type)
+std::size_t GcInterfaceGen::appendSchemaTypeRefs(const std::vector<std::size_t>& types)
 {
-    const VariantType* v = type;
-    for (const VariantField* field : v->fieldsRange()) {
-        switch (field->variantFieldKind()) {
-        case VariantFieldKind::Constant:
-            break;
-        case VariantFieldKind::Tuple:
-            for (const Type* t : field->asTupleField()->typesRange()) {
-                appendTypeValidator(t);
-            }
-            break;
-        case VariantFieldKind::Struct:
-            for (const Field* f : field->asStructField()->fieldsRange()) {
-                appendTypeValidator(f->type());
-            }
-            break;
-        }
+    std::size_t first = _schemaRefCount;
+    for (std::size_t index : types) {
+        _schemaRefs.append("    ");
+        appendSchemaTypeIndex(index, &_schemaRefs);
+        _schemaRefs.append(",\n");
     }
-    appendNamedTypeInit(type->asVariant(), "Variant");
-    _output->appendEol();
+    _schemaRefCount += types.size();
+    return first;
 }
 
-bool GcInterfaceGen::appendTypeValidator(const Type* type)
+std::size_t GcInterfaceGen::appendSchemaType(const Type* type)
 {
-    if (!insertValidatedType(type)) {
-        return false;
+    switch (type->typeKind()) {
+    case TypeKind::Imported:
+        return appendSchemaType(type->asImported()->link());
+    case TypeKind::Alias:
+        return appendSchemaType(type->asAlias()->alias());
+    case TypeKind::GenericParameter:
+        return noSchemaType;
+    default:
+        break;
     }
+
+    appendTestedType(type, &_nameBuilder);
+    std::string key = _nameBuilder.view().toStdString();
+    _nameBuilder.clear();
+    auto it = _schemaTypeIndices.find(key);
+    if (it != _schemaTypeIndices.end()) {
+        return it->second;
+    }
+    // recursive types can't be described by this table, mark them as missing
+    _schemaTypeIndices.emplace(key, noSchemaType);
+
     switch (type->typeKind()) {
     case TypeKind::Builtin:
+        appendSchemaTypeEntry("Builtin", (std::size_t)type->asBuiltin()->builtinTypeKind(), 0, bmcl::StringView::empty(), 0, noSchemaType, 0, 0);
         break;
     case TypeKind::Reference: {
-        appendTypeValidator(type->asReference()->pointee());
-        _output->append("    decode::Rc<decode::ReferenceType> ");
-        appendTestedType(type);
-        _output->append(" = decode::tryMakeReference(");
-        switch (type->asReference()->referenceKind()) {
-        case ReferenceKind::Pointer:
-            _output->append("decode::ReferenceKind::Pointer, ");
-            break;
-        case ReferenceKind::Reference:
-            _output->append("decode::ReferenceKind::Reference, ");
-            break;
-        }
-        if (type->asReference()->isMutable()) {
-            _output->append("true, (decode::Type*)");
-        } else {
-            _output->append("false, (decode::Type*)");
-        }
-        appendTestedType(type->asReference()->pointee());
-        _output->append(".get());\n\n");
+        const ReferenceType* ref = type->asReference();
+        std::size_t pointee = appendSchemaType(ref->pointee());
+        std::size_t flags = ((std::size_t)ref->referenceKind() << 1) | (ref->isMutable() ? 1 : 0);
+        appendSchemaTypeEntry("Reference", flags, 0, bmcl::StringView::empty(), 0, pointee, 0, 0);
         break;
     }
-    case TypeKind::Array:
-        appendTypeValidator(type->asArray()->elementType());
-        _output->append("    decode::Rc<decode::ArrayType> ");
-        appendTestedType(type);
-        _output->append(" = tryMakeArray(");
-        _output->appendNumericValue(type->asArray()->elementCount());
-        _output->append(", (decode::Type*)");
-        appendTestedType(type->asArray()->elementType());
-        _output->append(".get());\n\n");
+    case TypeKind::Array: {
+        std::size_t element = appendSchemaType(type->asArray()->elementType());
+        appendSchemaTypeEntry("Array", 0, 0, bmcl::StringView::empty(), type->asArray()->elementCount(), element, 0, 0);
+        break;
+    }
+    case TypeKind::DynArray: {
+        std::size_t element = appendSchemaType(type->asDynArray()->elementType());
+        appendSchemaTypeEntry("DynArray", 0, 0, bmcl::StringView::empty(), type->asDynArray()->maxSize(), element, 0, 0);
         break;
+    }
     case TypeKind::Function: {
         const FunctionType* f = type->asFunction();
+        std::size_t rv = noSchemaType;
         if (f->hasReturnValue()) {
-            appendTypeValidator(f->returnValue().unwrap());
+            rv = appendSchemaType(f->returnValue().unwrap());
         }
+        std::vector<std::size_t> args;
         for (const Field* field : f->argumentsRange()) {
-            appendTypeValidator(field->type());
-        }
-        _output->append("    decode::Rc<decode::FunctionType> ");
-        appendTestedType(type);
-        _output->append(" = tryMakeFunction(");
-        if (f->hasReturnValue()) {
-            _output->append("(decode::Type*)");
-            appendTestedType(f->returnValue().unwrap());
-            _output->append(".get(), ");
-        } else {
-            _output->append("bmcl::None, ");
+            args.push_back(appendSchemaType(field->type()));
         }
+        std::size_t flags = 0;
         if (f->selfArgument().isSome()) {
-            _output->append("decode::SelfArgument::");
-            switch (f->selfArgument().unwrap()) {
-                case SelfArgument::Reference:
-                    _output->append("Reference, ");
-                    break;
-                case SelfArgument::MutReference:
-                    _output->append("MutReference, ");
-                    break;
-                case SelfArgument::Value:
-                    _output->append("Value, ");
-                    break;
-            }
-        } else {
-            _output->append("bmcl::None, ");
+            flags = (std::size_t)f->selfArgument().unwrap() + 1;
         }
-        _output->append("bmcl::ArrayView<decode::Type*>{");
-        foreachList(f->argumentsRange(), [this](const Field* field) {
-            _output->append("(decode::Type*)");
-            appendTestedType(field->type());
-            _output->append(".get()");
-        }, [this](const Field* field) {
-            _output->append(", ");
-        });
-        _output->append("});\n\n");
+        std::size_t first = appendSchemaTypeRefs(args);
+        appendSchemaTypeEntry("Function", flags, 0, bmcl::StringView::empty(), 0, rv, first, args.size());
         break;
     }
-    case TypeKind::GenericParameter:
-        break;
-    case TypeKind::DynArray:
-        appendTypeValidator(type->asDynArray()->elementType());
-        _output->append("    decode::Rc<decode::DynArrayType> ");
-        appendTestedType(type);
-        _output->append(" = tryMakeDynArray(");
-        _output->appendNumericValue(type->asDynArray()->maxSize());
-        _output->append(", (decode::Type*)");
-        appendTestedType(type->asDynArray()->elementType());
-        _output->append(".get());\n\n");
-        break;
-    case TypeKind::Enum: {
-        appendEnumValidator(type->asEnum());
+    case TypeKind::Enum:
+        appendSchemaTypeEntry("Enum", 0, schemaModuleIndex(type->asEnum()->moduleName()), type->asEnum()->name(), 0, noSchemaType, 0, 0);
         break;
-    }
     case TypeKind::Struct: {
-        appendStructValidator(type->asStruct());
-        break;
-    }
-    case TypeKind::Variant: {
-        appendVariantValidator(type->asVariant());
+        const StructType* s = type->asStruct();
+        std::vector<std::size_t> fieldTypes;
+        for (const Field* field : s->fieldsRange()) {
+            fieldTypes.push_back(appendSchemaType(field->type()));
+        }
+        std::size_t first = _schemaFieldCount;
+        std::size_t i = 0;
+        for (const Field* field : s->fieldsRange()) {
+            _schemaFields.append("    {\"");
+            _schemaFields.append(field->name());
+            _schemaFields.append("\", ");
+            appendSchemaTypeIndex(fieldTypes[i], &_schemaFields);
+            _schemaFields.append("},\n");
+            i++;
+        }
+        _schemaFieldCount += fieldTypes.size();
+        appendSchemaTypeEntry("Struct", 0, schemaModuleIndex(s->moduleName()), s->name(), 0, noSchemaType, first, fieldTypes.size());
         break;
     }
-    case TypeKind::Imported:
-        appendTypeValidator(type->asImported()->link());
-        break;
-    case TypeKind::Alias:
-        appendTypeValidator(type->asAlias()->alias());
+    case TypeKind::Variant:
+        appendSchemaTypeEntry("Variant", 0, schemaModuleIndex(type->asVariant()->moduleName()), type->asVariant()->name(), 0, noSchemaType, 0, 0);
         break;
     case TypeKind::Generic:
-        appendNamedTypeInit(type->asGeneric(), "Generic");
+        appendSchemaTypeEntry("Generic", 0, schemaModuleIndex(type->asGeneric()->moduleName()), type->asGeneric()->name(), 0, noSchemaType, 0, 0);
         break;
     case TypeKind::GenericInstantiation: {
         const GenericInstantiationType* g = type->asGenericInstantiation();
-        appendTypeValidator(g->genericType());
-        _output->append("    decode::Rc<decode::GenericInstantiationType> ");
-        appendTestedType(g);
-        _output->append(" = decode::instantiateGeneric(&");
-        appendTestedType(g->genericType());
-        _output->append(", {");
-        foreachList(g->substitutedTypesRange(), [this](const Type* type) {
-            _output->append("decode::Rc<decode::Type>((decode::Type*)(");
-            appendTestedType(type);
-            _output->append(".get()))");
-        }, [this](const Type* type) {
-            _output->append(", ");
-        });
-        _output->append("});\n");
+        std::size_t generic = appendSchemaType(g->genericType());
+        std::vector<std::size_t> params;
+        for (const Type* t : g->substitutedTypesRange()) {
+            params.push_back(appendSchemaType(t));
+        }
+        std::size_t first = appendSchemaTypeRefs(params);
+        appendSchemaTypeEntry("GenericInstantiation", 0, 0, bmcl::StringView::empty(), 0, generic, first, params.size());
         break;
     }
+    default:
+        assert(false);
     }
-    return true;
-}
 
-void GcInterfaceGen::appendTestedType(const Type* type)
-{
-    appendTestedType(type, _output);
+    std::size_t index = _schemaTypeCount;
+    _schemaTypeIndices[key] = index;
+    _schemaTypeCount++;
+    return index;
 }
 
-void GcInterfaceGen::appendTestedType(const Type* type, SrcBuilder* dest)
+void GcInterfaceGen::appendSchema(const Package* package)
 {
-    auto appendNamed = [dest](const NamedType* type) {
-        dest->append('_');
-        dest->append(type->moduleName());
-        dest->appendWithFirstUpper(type->name());
-    };
-    switch (type->typeKind()) {
-    case TypeKind::Builtin:
-        dest->append("_builtin");
-        dest->appendWithFirstUpper(type->asBuiltin()->renderedTypeName(type->asBuiltin()->builtinTypeKind()));
-        break;
-    case TypeKind::Reference:
-    case TypeKind::Array:
-    case TypeKind::Function:
-    case TypeKind::GenericParameter:
-    case TypeKind::DynArray:
-    case TypeKind::GenericInstantiation: {
-        TypeNameGen gen(dest);
-        dest->append("_");
-        gen.genTypeName(type);
-        break;
+    _schemaModuleIndices.clear();
+    _schemaTypeIndices.clear();
+    _schemaTypes.clear();
+    _schemaFields.clear();
+    _schemaRefs.clear();
+    _schemaCmds.clear();
+    _schemaMsgs.clear();
+    _schemaTypeCount = 0;
+    _schemaFieldCount = 0;
+    _schemaRefCount = 0;
+    _schemaCmdCount = 0;
+    _schemaMsgCount = 0;
+
+    SrcBuilder modules;
+    for (const Ast* ast : package->modules()) {
+        _schemaModuleIndices.emplace(ast->moduleName(), _schemaModuleIndices.size());
+        modules.append("    \"");
+        modules.append(ast->moduleName());
+        modules.append("\",\n");
     }
-    case TypeKind::Enum:
-        appendNamed(type->asEnum());
-        break;
-    case TypeKind::Struct:
-        appendNamed(type->asStruct());
-        break;
-    case TypeKind::Variant:
-        appendNamed(type->asVariant());
-        break;
-    case TypeKind::Imported:
-        appendTestedType(type->asImported()->link(), dest);
-        break;
-    case TypeKind::Alias:
-        appendTestedType(type->asAlias()->alias(), dest);
-        break;
-    case TypeKind::Generic:
-        appendNamed(type->asGeneric());
-        break;
+
+    auto appendMsg = [this](const Component* comp, const TmMsg* msg, bool isEvent) {
+        _schemaMsgs.append("    {");
+        _schemaMsgs.appendNumericValue(schemaModuleIndex(comp->moduleName()));
+        _schemaMsgs.append(", \"");
+        _schemaMsgs.append(msg->name());
+        _schemaMsgs.append(bmcl::StringView(isEvent ? "\", true},\n" : "\", false},\n"));
+        _schemaMsgCount++;
+    };
+    for (const Ast* ast : package->modules()) {
+        if (ast->component().isNone()) {
+            continue;
+        }
+        const Component* comp = ast->component().unwrap();
+        for (const Command* cmd : comp->cmdsRange()) {
+            if (!hasCmd(cmd)) {
+                continue;
+            }
+            std::vector<std::size_t> args;
+            for (const Field* field : cmd->fieldsRange()) {
+                args.push_back(appendSchemaType(field->type()));
+            }
+            std::size_t rv = noSchemaType;
+            auto rvType = cmd->type()->returnValue();
+            if (rvType.isSome()) {
+                rv = appendSchemaType(rvType.unwrap());
+            }
+            std::size_t first = appendSchemaTypeRefs(args);
+
+            _schemaCmds.append("    {");
+            _schemaCmds.appendNumericValue(schemaModuleIndex(comp->moduleName()));
+            _schemaCmds.append(", \"");
+            _schemaCmds.append(cmd->name());
+            _schemaCmds.append("\", ");
+            _schemaCmds.appendNumericValue(first);
+            _schemaCmds.append(", ");
+            _schemaCmds.appendNumericValue(args.size());
+            _schemaCmds.append(", ");
+            appendSchemaTypeIndex(rv, &_schemaCmds);
+            _schemaCmds.append("},\n");
+            _schemaCmdCount++;
+        }
+        for (const StatusMsg* msg : comp->statusesRange()) {
+            appendMsg(comp, msg, false);
+        }
+        for (const EventMsg* msg : comp->eventsRange()) {
+            appendMsg(comp, msg, true);
+        }
     }
-}
 
-void GcInterfaceGen::appendNamedTypeInit(const NamedType* type, bmcl::StringView name)
-{
-    _output->append("    decode::Rc<const decode::");
-    _output->append(name);
-    _output->append("Type> _");
-    _output->append(type->moduleName());
-    _output->appendWithFirstUpper(type->name());
-    _output->append(" = decode::findType<decode::");
-    _output->append(name);
-    _output->append("Type>(_");
-    _output->append(type->moduleName());
-    _output->append("Ast.get(), \"");
-    _output->appendWithFirstUpper(type->name());
-    _output->append("\");\n");
+    auto appendArray = [this](bmcl::StringView type, bmcl::StringView name, const SrcBuilder& contents) {
+        if (contents.size() == 0) {
+            return;
+        }
+        _output->append("static const ");
+        _output->append(type);
+        _output->append(" _schema");
+        _output->append(name);
+        _output->append("[] = {\n");
+        _output->append(contents.view());
+        _output->append("};\n\n");
+    };
+    appendArray("char*", "Modules", modules);
+    appendArray("decode::SchemaType", "Types", _schemaTypes);
+    appendArray("decode::SchemaField", "Fields", _schemaFields);
+    appendArray("std::uint32_t", "TypeRefs", _schemaRefs);
+    appendArray("decode::SchemaCmd", "Cmds", _schemaCmds);
+    appendArray("decode::SchemaMsg", "Msgs", _schemaMsgs);
 }
 }
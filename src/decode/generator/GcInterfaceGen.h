@@ -6,8 +6,10 @@
 #include "decode/generator/SrcBuilder.h"
 
 #include "bmcl/Fwd.h"
+#include <bmcl/StringViewHash.h>
 
 #include <string>
+#include <vector>
 
 namespace decode {
 
@@ -26,35 +28,43 @@ class TmMsg;
 class StatusMsg;
 class EventMsg;
 class GenericType;
+class TypeDependsIndex;
+class Configuration;
 
 class GcInterfaceGen {
 public:
     GcInterfaceGen(SrcBuilder* dest);
     ~GcInterfaceGen();
 
+    void setMsgStats(bool useMsgStats);
+    void setDependsIndex(const TypeDependsIndex* index);
+    // commands with cfg attributes that do not match are left out, same as in onboard code
+    void setConfiguration(const Configuration* cfg);
+
     void generateHeader(const Package* package);
     void generateValidatorHeader(const Package* package);
     void generateSource(const Package* package);
+    void generateTmRouterHeader(const Package* package);
+    void generateComponentHeader(const Component* comp);
 
 private:
-    bool appendTypeValidator(const Type* type);
-    void appendStructValidator(const StructType* type);
-    void appendEnumValidator(const EnumType* type);
-    void appendVariantValidator(const VariantType* type);
-    void appendCmdValidator(const Component* comp, const Command* cmd);
-    void appendTmMsgValidator(const Component* comp, const TmMsg* msg, bmcl::StringView typeName);
-    void appendStatusValidator(const Component* comp, const StatusMsg* msg);
-    void appendEventValidator(const Component* comp, const EventMsg* msg);
-    void appendComponentFieldName(const Component* comp);
-    void appendCmdFieldName(const Component* comp, const Command* cmd);
-    void appendMsgFieldName(const Component* comp, const TmMsg* msg, bmcl::StringView msgTypeName);
+    bool hasCmd(const Command* cmd) const;
     void appendCmdMethods(const Component* comp, const Command* cmd);
     void appendTmMethods(const Component* comp, const TmMsg* msg, bmcl::StringView msgTypeName, bmcl::StringView namespaceName);
     void appendCmdDecls(const Component* comp, const Command* cmd);
     void appendTmDecls(const Component* comp, const TmMsg* msg, bmcl::StringView msgTypeName, bmcl::StringView namespaceName);
-    void appendNamedTypeInit(const NamedType* type, bmcl::StringView name);
-    void appendTestedType(const Type* type);
+    void appendTmRouterName(const Component* comp, const TmMsg* msg, bmcl::StringView msgTypeName);
+    void appendTmRouterSlot(const Component* comp, const TmMsg* msg, bmcl::StringView msgTypeName, bmcl::StringView namespaceName);
+    void appendTmRouterMsgCheck(const Component* comp, const TmMsg* msg, bmcl::StringView msgTypeName);
+    void appendTmRouterFill(const Package* package);
     bool appendFwd(const Type* type, bmcl::OptionPtr<const GenericType> parent);
+    void appendSchema(const Package* package);
+    std::size_t appendSchemaType(const Type* type);
+    std::size_t appendSchemaTypeRefs(const std::vector<std::size_t>& types);
+    void appendSchemaTypeEntry(bmcl::StringView kind, std::size_t flags, std::size_t module, bmcl::StringView name,
+                               std::uint64_t size, std::size_t inner, std::size_t first, std::size_t count);
+    static void appendSchemaTypeIndex(std::size_t index, SrcBuilder* dest);
+    std::size_t schemaModuleIndex(bmcl::StringView name) const;
     static void appendTestedType(const Type* type, SrcBuilder* dest);
 
     void appendComponentCheck(const Component* comp, bmcl::StringView returnValue);
@@ -67,11 +77,26 @@ private:
     void appendTypeNumDecl(const Component* comp, bmcl::StringView kind, bmcl::StringView name);
     void appendTypeNumDeclInlineGetter(const Component* comp, bmcl::StringView kind, bmcl::StringView name);
 
-    bool insertValidatedType(const Type* type);
     bool insertForwardedType(const Type* type);
 
     SrcBuilder* _output;
     SrcBuilder _nameBuilder;
     HashMap<std::string, Rc<const Type>> _validatedTypes;
+
+    HashMap<bmcl::StringView, std::size_t> _schemaModuleIndices;
+    HashMap<std::string, std::size_t> _schemaTypeIndices;
+    SrcBuilder _schemaTypes;
+    SrcBuilder _schemaFields;
+    SrcBuilder _schemaRefs;
+    SrcBuilder _schemaCmds;
+    SrcBuilder _schemaMsgs;
+    std::size_t _schemaTypeCount;
+    std::size_t _schemaFieldCount;
+    std::size_t _schemaRefCount;
+    std::size_t _schemaCmdCount;
+    std::size_t _schemaMsgCount;
+    bool _useMsgStats;
+    const TypeDependsIndex* _dependsIndex;
+    const Configuration* _cfg;
 };
 }
@@ -63,13 +63,25 @@ void GcMsgGen::generateStatusHeader(const Component* comp, const StatusMsg* msg)
 
     _output->append("};\n\n""}\n}\n}\n\n");
 
-    _output->append("inline bool photongenDeserialize(");
-    genTmMsgType(comp, msg, "statuses", _output);
-    _output->append("* msg, bmcl::MemReader* src, photon::CoderState* state)\n{\n");
+    appendDeserializerPrototype(comp, msg, "statuses");
+    _output->append(";\n");
+}
+
+void GcMsgGen::appendDeserializerPrototype(const Component* comp, const TmMsg* msg, bmcl::StringView namespaceName)
+{
+    _output->append("bool photongenDeserialize(");
+    genTmMsgType(comp, msg, namespaceName, _output);
+    _output->append("* msg, bmcl::MemReader* src, photon::CoderState* state)");
+}
+
+void GcMsgGen::appendStatusDeserializer(const Component* comp, const StatusMsg* msg)
+{
+    appendDeserializerPrototype(comp, msg, "statuses");
+    _output->append("\n{\n");
 
     InlineTypeInspector inspector(_output);
     InlineSerContext ctx;
-    fieldName.assign("msg->");
+    StringBuilder fieldName("msg->");
     for (const VarRegexp* regexp : msg->partsRange()) {
         regexp->buildFieldName(&fieldName);
         inspector.inspect<false, false>(regexp->type(), ctx, fieldName.view());
@@ -91,12 +103,14 @@ void GcMsgGen::generateEventHeader(const Component* comp, const EventMsg* msg)
     }
     _output->append("};\n\n""}\n}\n}\n\n");
 
-    _output->append("inline bool photongenDeserialize(");
-    _output->append("photongen::");
-    _output->append(comp->name());
-    _output->append("::events::");
-    _output->appendWithFirstUpper(msg->name());
-    _output->append("* msg, bmcl::MemReader* src, photon::CoderState* state)\n{\n");
+    appendDeserializerPrototype(comp, msg, "events");
+    _output->append(";\n");
+}
+
+void GcMsgGen::appendEventDeserializer(const Component* comp, const EventMsg* msg)
+{
+    appendDeserializerPrototype(comp, msg, "events");
+    _output->append("\n{\n");
 
     InlineTypeInspector inspector(_output);
     InlineSerContext ctx;
@@ -19,12 +19,15 @@ public:
 
     void generateStatusHeader(const Component* comp, const StatusMsg* msg);
     void generateEventHeader(const Component* comp, const EventMsg* msg);
+    void appendStatusDeserializer(const Component* comp, const StatusMsg* msg);
+    void appendEventDeserializer(const Component* comp, const EventMsg* msg);
 
     static void genTmMsgType(const Component* comp, const TmMsg* msg, bmcl::StringView namespaceName, SrcBuilder* dest);
 
 private:
     template <typename T>
     void appendPrelude(const Component* comp, const T* msg, bmcl::StringView namespaceName);
+    void appendDeserializerPrototype(const Component* comp, const TmMsg* msg, bmcl::StringView namespaceName);
 
     SrcBuilder* _output;
 };
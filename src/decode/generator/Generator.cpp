@@ -19,6 +19,14 @@
 #include "decode/generator/GcInterfaceGen.h"
 #include "decode/generator/GcMsgGen.h"
 #include "decode/generator/ReportGen.h"
+#include "decode/generator/MemoryStats.h"
+#include "decode/generator/SegWriterGen.h"
+#include "decode/generator/EventQueueGen.h"
+#include "decode/generator/ParamTableGen.h"
+#include "decode/generator/MsgStatsGen.h"
+#include "decode/generator/BinLogGen.h"
+#include "decode/generator/ElfObjectGen.h"
+#include "decode/generator/TypeDependsCollector.h"
 #include "decode/ast/Ast.h"
 #include "decode/ast/Function.h"
 #include "decode/ast/ModuleInfo.h"
@@ -27,12 +35,14 @@
 #include "decode/ast/Decl.h"
 #include "decode/ast/Component.h"
 #include "decode/ast/Constant.h"
+#include "decode/core/Configuration.h"
 #include "decode/core/Diagnostics.h"
 #include "decode/core/Try.h"
 #include "decode/core/PathUtils.h"
 #include "decode/core/Utils.h"
 #include "decode/core/HashMap.h"
 #include "decode/core/HashSet.h"
+#include "decode/core/Tracer.h"
 
 #include <bmcl/Logging.h>
 #include <bmcl/Buffer.h>
@@ -40,9 +50,12 @@
 #include <bmcl/FixedArrayView.h>
 
 #include <iostream>
+#include <fstream>
+#include <sstream>
 #include <deque>
 #include <memory>
 #include <future>
+#include <algorithm>
 
 //TODO: use joinPath
 
@@ -66,6 +79,34 @@ bool Generator::generateTmPrivate(const Package* package)
 {
     _output.clear();
 
+    _output.startIncludeGuard("PRIVATE", "TM_MESSAGE_DESC");
+    _output.appendOnboardIncludePath("core/Error");
+    _output.appendOnboardIncludePath("core/Writer");
+    _output.appendEol();
+    if (_config.useSegmentedWriter) {
+        _output.append("#include \"photongen/onboard/SegWriter.h\"\n\n");
+    }
+    _output.append("#include <stdbool.h>\n"
+                   "#include <stddef.h>\n\n");
+    _output.append("typedef struct {\n"
+                   "    PhotonError (*func)(");
+    FuncPrototypeGen descGen(&_output);
+    descGen.setSegmentedWriter(_config.useSegmentedWriter);
+    descGen.appendWriterArg();
+    _output.append(");\n"
+                   "    size_t compNum;\n"
+                   "    size_t msgNum;\n"
+                   "    size_t interest;\n"
+                   "    size_t priority;\n"
+                   "    bool isEnabled;\n"
+                   "} PhotonTmMessageDesc;\n\n");
+    _output.endIncludeGuard();
+    TRY(dump("TmMessageDesc", ".h", &_onboardPath));
+
+    _output.append("#include \"photongen/onboard/TmMessageDesc.h\"\n\n");
+    if (_config.instrumentationLevel > 0) {
+        _output.append("#include \"photongen/onboard/MsgStats.h\"\n\n");
+    }
     _output.append("static PhotonTmMessageDesc _messageDesc[] = {\n");
     FuncPrototypeGen prototypeGen(&_output);
     for (const ComponentAndMsg& msg : package->statusMsgs()) {
@@ -87,35 +128,78 @@ bool Generator::generateTmPrivate(const Package* package)
         _output.append("},\n");
         _output.appendEndif();
     }
+    if (_config.instrumentationLevel > 0) {
+        _output.append("    {.func = PhotonMsgStats_Serialize, .compNum = PHOTON_MSG_STATS_COMP_NUM, "
+                       ".msgNum = PHOTON_MSG_STATS_MSG_NUM, .interest = 0, .priority = 0, .isEnabled = true},\n");
+    }
     _output.append("};\n\n");
 
     _output.append("#define _PHOTON_TM_MSG_COUNT sizeof(_messageDesc) / sizeof(_messageDesc[0])\n\n");
 
     std::string tmDetailPath = joinPath(_onboardPath.toStdString(), "StatusTable.inc.c");
-    TRY(saveOutput(tmDetailPath, _output.view(), _diag.get()));
+    TRY(saveCurrentOutput(tmDetailPath));
     _output.clear();
 
     return true;
 }
 
-void Generator::generateSerializedPackage(const Project* project, bmcl::Buffer* serialized, SrcBuilder* sourceCode)
+void Generator::generateSerializedPackage(const Project* project, const GeneratorConfig* cfg, const std::string* blobPath,
+                                          bmcl::Buffer* serialized, std::size_t* uncompressedSize,
+                                          SrcBuilder* sourceCode, bmcl::Buffer* object)
 {
+    TraceScope trace("generator", "generateSerializedPackage");
     sourceCode->clear();
 
-    *serialized = project->encode();
-
-    sourceCode->appendNumericValueDefine(serialized->size(), "_PHOTON_PACKAGE_SIZE");
-    sourceCode->appendEol();
-    sourceCode->appendByteArrayDefinition("static const", "_package", *serialized);
-    sourceCode->appendEol();
+    *serialized = project->encode(uncompressedSize);
 
     Project::HashType ctx;
     ctx.update(*serialized);
     auto hash = ctx.finalize();
 
+    sourceCode->appendNumericValueDefine(serialized->size(), "_PHOTON_PACKAGE_SIZE");
+    sourceCode->appendEol();
+    switch (cfg->packageEmbedMode) {
+    case PackageEmbedMode::Array:
+        sourceCode->appendByteArrayDefinition("static const", "_package", *serialized);
+        break;
+    case PackageEmbedMode::Embed:
+        sourceCode->append("static const uint8_t _package[_PHOTON_PACKAGE_SIZE] = {\n"
+                           "#embed \"Package.bin\"\n"
+                           "};\n");
+        break;
+    case PackageEmbedMode::Incbin:
+        sourceCode->append("__asm__(\".section .rodata\\n\"\n"
+                           "        \".global _package\\n\"\n"
+                           "        \".type _package, %object\\n\"\n"
+                           "        \".balign 8\\n\"\n"
+                           "        \"_package:\\n\"\n"
+                           "        \".incbin \\\"");
+        for (char c : *blobPath) {
+            sourceCode->append(c == '\\' ? '/' : c);
+        }
+        sourceCode->append("\\\"\\n\"\n"
+                           "        \".size _package, .-_package\\n\"\n"
+                           "        \".previous\\n\");\n"
+                           "extern const uint8_t _package[_PHOTON_PACKAGE_SIZE];\n");
+        break;
+    case PackageEmbedMode::Elf:
+        sourceCode->append("extern const uint8_t _package[_PHOTON_PACKAGE_SIZE];\n");
+        break;
+    }
+    sourceCode->appendEol();
+
     sourceCode->appendNumericValueDefine(hash.size(), "_PHOTON_PACKAGE_HASH_SIZE");
     sourceCode->appendEol();
-    sourceCode->appendByteArrayDefinition("static const", "_packageHash", hash);
+    if (cfg->packageEmbedMode == PackageEmbedMode::Elf) {
+        sourceCode->append("extern const uint8_t _packageHash[_PHOTON_PACKAGE_HASH_SIZE];\n");
+
+        ElfObjectGen objectGen;
+        objectGen.addSymbol("_package", *serialized);
+        objectGen.addSymbol("_packageHash", hash);
+        objectGen.generate(ElfObjectGen::findTarget(cfg->packageObjectTarget).unwrap(), object);
+    } else {
+        sourceCode->appendByteArrayDefinition("static const", "_packageHash", hash);
+    }
     sourceCode->appendEol();
 
     for (const Device* dev : project->devices()) {
@@ -136,6 +220,26 @@ void Generator::appendBuiltinHeaders()
 {
     std::initializer_list<bmcl::StringView> builtin = {"CmdDecoder", "StatusDecoder"};
     appendBuiltins(builtin, ".h");
+    if (_config.useSegmentedWriter) {
+        std::initializer_list<bmcl::StringView> segWriter = {"SegWriter"};
+        appendBuiltins(segWriter, ".h");
+    }
+    if (_config.useEventQueue) {
+        std::initializer_list<bmcl::StringView> eventQueue = {"EventQueue"};
+        appendBuiltins(eventQueue, ".h");
+    }
+    if (_config.useParamTable) {
+        std::initializer_list<bmcl::StringView> paramTable = {"ParamTable"};
+        appendBuiltins(paramTable, ".h");
+    }
+    if (_config.instrumentationLevel > 0) {
+        std::initializer_list<bmcl::StringView> msgStats = {"MsgStats"};
+        appendBuiltins(msgStats, ".h");
+    }
+    if (_config.useBinaryLog) {
+        std::initializer_list<bmcl::StringView> binLog = {"BinLog"};
+        appendBuiltins(binLog, ".h");
+    }
 }
 
 void Generator::appendBuiltinSources()
@@ -143,6 +247,26 @@ void Generator::appendBuiltinSources()
     std::initializer_list<bmcl::StringView> builtin = {"CmdDecoder", "CmdEncoder",
                                                        "StatusEncoder", "StatusDecoder", "EventEncoder"};
     appendBuiltins(builtin, ".c");
+    if (_config.useSegmentedWriter) {
+        std::initializer_list<bmcl::StringView> segWriter = {"SegWriter"};
+        appendBuiltins(segWriter, ".c");
+    }
+    if (_config.useEventQueue) {
+        std::initializer_list<bmcl::StringView> eventQueue = {"EventQueue"};
+        appendBuiltins(eventQueue, ".c");
+    }
+    if (_config.useParamTable) {
+        std::initializer_list<bmcl::StringView> paramTable = {"ParamTable"};
+        appendBuiltins(paramTable, ".c");
+    }
+    if (_config.instrumentationLevel > 0) {
+        std::initializer_list<bmcl::StringView> msgStats = {"MsgStats"};
+        appendBuiltins(msgStats, ".c");
+    }
+    if (_config.useBinaryLog) {
+        std::initializer_list<bmcl::StringView> binLog = {"BinLog"};
+        appendBuiltins(binLog, ".c");
+    }
 }
 
 void Generator::appendBuiltins(bmcl::ArrayView<bmcl::StringView> names, bmcl::StringView ext)
@@ -160,6 +284,9 @@ bool Generator::generateDeviceFiles(const Project* project)
 {
     HashMap<Rc<const Ast>, std::vector<std::string>> srcsPaths;
     for (const Ast* mod : project->package()->modules()) {
+        if (!hasModule(mod)) {
+            continue;
+        }
         auto src = project->sourcesForModule(mod);
         if (src.isNone()) {
             continue;
@@ -188,7 +315,7 @@ bool Generator::generateDeviceFiles(const Project* project)
         }
     }
 
-    auto appendBundledSources = [this, &srcsPaths](const Device* dev, bmcl::StringView ext) {
+    auto appendBundledSources = [&srcsPaths](const Device* dev, bmcl::StringView ext, SrcBuilder* dest) {
         for (const Ast* module : dev->modules()) {
             auto it = srcsPaths.find(module);
             if (it == srcsPaths.end()) {
@@ -198,23 +325,25 @@ bool Generator::generateDeviceFiles(const Project* project)
                 if (!bmcl::StringView(path).endsWith(ext)) {
                     continue;
                 }
-                _output.append("#include \"");
-                _output.append(path);
-                _output.append("\"\n");
+                dest->append("#include \"");
+                dest->append(path);
+                dest->append("\"\n");
             }
         }
     };
 
-    TypeDependsCollector coll;
     for (const DeviceConnection* conn : project->deviceConnections()) {
+        if (_device.isSome() && _device.unwrap() != conn) {
+            continue;
+        }
         const Device* dev = conn->device();
-        TypeDependsCollector::Depends types;
+        TypeDependsIndex::Bits typeBits;
 //         types.insert("core/Reader");
 //         types.insert("core/Writer");
 //         types.insert("core/Error");
 
         for (const Ast* module : dev->modules()) {
-            coll.collect(module, &types);
+            TypeDependsIndex::unite(&typeBits, _dependsIndex.moduleDepends(module)->types);
         }
         HashSet<Rc<const Ast>> targetMods;
         HashSet<Rc<const Ast>> sourceMods;
@@ -222,10 +351,7 @@ bool Generator::generateDeviceFiles(const Project* project)
         auto appendTargetMods = [&](const Device* dep) {
             for (const Ast* module : dep->modules()) {
                 targetMods.emplace(module);
-                if (module->component().isNone()) {
-                    continue;
-                }
-                coll.collectCmds(module->component()->cmdsRange(), &types);
+                TypeDependsIndex::unite(&typeBits, _dependsIndex.moduleDepends(module)->cmds);
             }
         };
         for (const Device* dep : conn->cmdTargets()) {
@@ -235,16 +361,15 @@ bool Generator::generateDeviceFiles(const Project* project)
         auto appendSourceMods = [&](const Device* dep) {
             for (const Ast* module : dep->modules()) {
                 sourceMods.emplace(module);
-                if (module->component().isNone()) {
-                    continue;
-                }
-                coll.collectEvents(module->component()->eventsRange(), &types);
-                coll.collectStatuses(module->component()->statusesRange(), &types);
+                TypeDependsIndex::unite(&typeBits, _dependsIndex.moduleDepends(module)->events);
+                TypeDependsIndex::unite(&typeBits, _dependsIndex.moduleDepends(module)->statuses);
             }
         };
         for (const Device* dep : conn->tmSources()) {
             appendSourceMods(dep);
         }
+        TypeDependsCollector::Depends types;
+        _dependsIndex.toDepends(typeBits, &types);
 
         //header
         if (dev == project->master()) {
@@ -313,40 +438,188 @@ bool Generator::generateDeviceFiles(const Project* project)
         appendBuiltinHeaders();
         _output.appendEol();
 
-        appendBundledSources(dev, ".h");
+        appendBundledSources(dev, ".h", &_output);
 
         SrcBuilder path(joinPath(_savePath, "Photon"));
         path.appendWithFirstUpper(dev->name());
         path.append(".h");
-        TRY(saveOutput(path.c_str(), _output.view(), _diag.get()));
+        TRY(saveCurrentOutput(path.c_str()));
         _output.clear();
 
         //src
-        _output.append("#include \"Photon");
-        _output.appendWithFirstUpper(dev->name());
-        _output.append(".h\"\n\n");
-        includeGen.genOnboardIncludePaths(&types, ".gen.c");
-        _output.appendEol();
+        SrcBuilder typeSources;
+        IncludeGen sourceIncludeGen(&typeSources);
+        sourceIncludeGen.genOnboardIncludePaths(&types, ".gen.c");
 
+        SrcBuilder compSources;
         for (const Ast* module : dev->modules()) {
             if (module->component().isSome()) {
-                _output.appendOnboardComponentInclude(module->moduleInfo()->moduleName(), ".c");
+                compSources.appendOnboardComponentInclude(module->moduleInfo()->moduleName(), ".c");
             }
         }
+
+        SrcBuilder bundledSources;
+        appendBundledSources(dev, ".c", &bundledSources);
+
+        if (_config.onboardShardCount > 1) {
+            TRY(generateDeviceShards(dev, typeSources.view(), compSources.view(), bundledSources.view()));
+            continue;
+        }
+
+        _output.append("#include \"Photon");
+        _output.appendWithFirstUpper(dev->name());
+        _output.append(".h\"\n\n");
+        _output.append(typeSources.view());
+        _output.appendEol();
+        _output.append(compSources.view());
         _output.appendEol();
 
         appendBuiltinSources();
         _output.appendEol();
 
-        appendBundledSources(dev, ".c");
+        _output.append(bundledSources.view());
 
         path.back() = 'c';
-        TRY(saveOutput(path.c_str(), _output.view(), _diag.get()));
+        TRY(saveCurrentOutput(path.c_str()));
         _output.clear();
     }
     return true;
 }
 
+struct DeviceSourceUnit {
+    std::string include;
+    std::size_t index;
+    std::size_t size;
+};
+
+static void collectDeviceSourceUnits(bmcl::StringView includes, const std::string& savePath, std::vector<DeviceSourceUnit>* dest)
+{
+    std::istringstream stream(includes.toStdString());
+    std::string line;
+    while (std::getline(stream, line)) {
+        std::size_t begin = line.find('"');
+        std::size_t end = line.rfind('"');
+        if (begin == std::string::npos || end <= begin) {
+            continue;
+        }
+        std::string path = line.substr(begin + 1, end - begin - 1);
+        if (!isAbsPath(path)) {
+            path = joinPath(savePath, path);
+        }
+        // generated sources are already on disk at this point, their size is a good enough estimate of compile time
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        std::size_t size = 0;
+        if (file) {
+            size = std::size_t(file.tellg());
+        }
+        DeviceSourceUnit unit;
+        unit.include = std::move(line);
+        unit.index = dest->size();
+        unit.size = size;
+        dest->push_back(std::move(unit));
+    }
+}
+
+bool Generator::generateDeviceShards(const Device* dev, bmcl::StringView typeSources,
+                                     bmcl::StringView compSources, bmcl::StringView bundledSources)
+{
+    std::vector<DeviceSourceUnit> units;
+    collectDeviceSourceUnits(typeSources, _savePath, &units);
+    collectDeviceSourceUnits(compSources, _savePath, &units);
+    collectDeviceSourceUnits(bundledSources, _savePath, &units);
+
+    // builtin sources share static functions with each other and always go to the first shard
+    _output.clear();
+    appendBuiltinSources();
+    std::string builtinSources = _output.view().toStdString();
+    _output.clear();
+    std::vector<DeviceSourceUnit> builtinUnits;
+    collectDeviceSourceUnits(builtinSources, _savePath, &builtinUnits);
+
+    std::size_t shardCount = _config.onboardShardCount;
+    std::vector<std::size_t> shardSizes(shardCount, 0);
+    for (const DeviceSourceUnit& unit : builtinUnits) {
+        shardSizes[0] += unit.size;
+    }
+
+    std::vector<const DeviceSourceUnit*> sorted;
+    sorted.reserve(units.size());
+    for (const DeviceSourceUnit& unit : units) {
+        sorted.push_back(&unit);
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), [](const DeviceSourceUnit* left, const DeviceSourceUnit* right) {
+        return left->size > right->size;
+    });
+
+    std::vector<std::vector<const DeviceSourceUnit*>> shards(shardCount);
+    for (const DeviceSourceUnit* unit : sorted) {
+        auto it = std::min_element(shardSizes.begin(), shardSizes.end());
+        std::size_t i = it - shardSizes.begin();
+        *it += unit->size;
+        shards[i].push_back(unit);
+    }
+
+    SrcBuilder path(joinPath(_savePath, "Photon"));
+    path.appendWithFirstUpper(dev->name());
+    path.append('_');
+    std::size_t pathSize = path.size();
+    for (std::size_t i = 0; i < shardCount; i++) {
+        std::vector<const DeviceSourceUnit*>& shard = shards[i];
+        std::sort(shard.begin(), shard.end(), [](const DeviceSourceUnit* left, const DeviceSourceUnit* right) {
+            return left->index < right->index;
+        });
+
+        _output.append("#include \"Photon");
+        _output.appendWithFirstUpper(dev->name());
+        _output.append(".h\"\n\n");
+        for (const DeviceSourceUnit* unit : shard) {
+            _output.append(unit->include);
+            _output.appendEol();
+        }
+        if (i == 0) {
+            _output.appendEol();
+            _output.append(builtinSources);
+        }
+
+        path.appendNumericValue(i);
+        path.append(".c");
+        TRY(saveCurrentOutput(path.c_str()));
+        path.resize(pathSize);
+        _output.clear();
+    }
+    return true;
+}
+
+bool Generator::generateDeviceDispatch(const Project* project, bmcl::StringView suffix, bmcl::StringView ext)
+{
+    for (const Device* dev : project->devices()) {
+        _output.append("#ifdef PHOTON_DEVICE_");
+        _output.appendUpper(dev->name());
+        _output.appendEol();
+        _output.append("#include \"Photon");
+        _output.appendWithFirstUpper(dev->name());
+        _output.append(suffix);
+        _output.append(ext);
+        _output.append("\"\n");
+        _output.appendEndif();
+    }
+    // lets builds that do not know device names (host bench) select the master device
+    _output.append("#ifdef PHOTON_DEVICE_DEFAULT_MASTER\n");
+    _output.append("#include \"Photon");
+    _output.appendWithFirstUpper(project->master()->name());
+    _output.append(suffix);
+    _output.append(ext);
+    _output.append("\"\n");
+    _output.appendEndif();
+
+    std::string photoncPath = joinPath(_savePath, "Photon");
+    photoncPath.append(suffix.begin(), suffix.end());
+    photoncPath.append(ext.begin(), ext.end());
+    TRY(saveCurrentOutput(photoncPath));
+    _output.clear();
+    return true;
+}
+
 bool Generator::generateConfig(const Project* project)
 {
     _onboardPath.append(pathSeparator());
@@ -359,34 +632,333 @@ bool Generator::generateConfig(const Project* project)
     return true;
 }
 
-bool Generator::generateProject(const Project* project, const GeneratorConfig& cfg)
+bool Generator::generateSegWriter()
 {
-    _config = cfg;
+    SegWriterGen gen(&_output);
+    gen.generateHeader();
+    TRY(dump("SegWriter", ".h", &_onboardPath));
 
-    TRY(makeDirectory(_savePath, _diag.get()));
+    gen.generateSource();
+    TRY(dump("SegWriter", ".c", &_onboardPath));
+    return true;
+}
+
+bool Generator::generateEventQueue(const Project* project)
+{
+    EventQueueGen gen(&_output);
+    gen.setSegmentedWriter(_config.useSegmentedWriter);
+    gen.generateHeader(project);
+    TRY(dump("EventQueue", ".h", &_onboardPath));
+
+    gen.generateSource();
+    TRY(dump("EventQueue", ".c", &_onboardPath));
+    return true;
+}
+
+bool Generator::generateParamTable(const Project* project)
+{
+    ParamTableGen gen(&_output);
+    gen.setSeqlockVars(_config.useSeqlockVars);
+    gen.setAutosaveJournal(_config.useAutosaveJournal);
+    gen.generateHeader(project);
+    TRY(dump("ParamTable", ".h", &_onboardPath));
+
+    gen.generateSource(project);
+    TRY(dump("ParamTable", ".c", &_onboardPath));
+
+    if (_device.isNone()) {
+        gen.generateGcHeader(project);
+        TRY(dump("ParamTable", ".hpp", &_gcPath));
+    }
+    return true;
+}
+
+bool Generator::generateMsgStats(const Project* project)
+{
+    MsgStatsGen gen(&_output);
+    gen.setLevel(_config.instrumentationLevel);
+    // queued events are recorded by every producer
+    gen.setAtomicCounters(_config.useEventQueue);
+    gen.setSegmentedWriter(_config.useSegmentedWriter);
+    gen.generateHeader(project);
+    TRY(dump("MsgStats", ".h", &_onboardPath));
+
+    gen.generateSource(project);
+    TRY(dump("MsgStats", ".c", &_onboardPath));
+
+    if (_device.isNone()) {
+        gen.generateGcHeader(project);
+        TRY(dump("MsgStats", ".hpp", &_gcPath));
+    }
+    return true;
+}
+
+bool Generator::generateBinLog(const Project* project)
+{
+    BinLogGen gen(&_output);
+    gen.generateHeader();
+    TRY(dump("BinLog", ".h", &_onboardPath));
+
+    gen.generateSource();
+    TRY(dump("BinLog", ".c", &_onboardPath));
+    return true;
+}
+
+bool Generator::hasModule(const Ast* ast) const
+{
+    if (_device.isNone()) {
+        return true;
+    }
+    return _deviceModules.find(ast) != _deviceModules.end();
+}
+
+bool Generator::saveCurrentOutput(const std::string& path)
+{
+    bmcl::StringView output = _output.view();
+    if (_config.useBinaryLog) {
+        _binLogOutput.clear();
+        _binLogRewriter.rewrite(output, &_binLogOutput);
+        output = _binLogOutput.view();
+    }
+    if (_device.isNone()) {
+        return saveOutput(path, output, _diag.get());
+    }
+    _resolvedOutput.clear();
+    _guardResolver.resolve(output, &_resolvedOutput);
+    return saveOutput(path, _resolvedOutput.view(), _diag.get());
+}
+
+static bmcl::Option<bmcl::StringView> typeModuleName(const Type* type)
+{
+    switch (type->typeKind()) {
+    case TypeKind::Enum:
+        return type->asEnum()->moduleName();
+    case TypeKind::Struct:
+        return type->asStruct()->moduleName();
+    case TypeKind::Variant:
+        return type->asVariant()->moduleName();
+    case TypeKind::Alias:
+        return type->asAlias()->moduleName();
+    case TypeKind::Imported:
+        return type->asImported()->link()->moduleName();
+    case TypeKind::GenericInstantiation:
+        return type->asGenericInstantiation()->moduleName();
+    default:
+        return bmcl::None;
+    }
+}
 
+void Generator::specializeFor(const Project* project, const DeviceConnection* conn)
+{
+    _device = conn;
+    _deviceModules.clear();
+    _guardResolver.clear();
+
+    SrcBuilder macro;
+    auto declare = [&](bmcl::StringView prefix, bmcl::StringView name, bool isDefined) {
+        macro.append(prefix);
+        macro.appendUpper(name);
+        _guardResolver.declare(macro.view(), isDefined);
+        macro.clear();
+    };
+
+    // same macros as in Photon<Device>.h, all other devices and modules are known to be undefined
+    for (const Device* dev : project->devices()) {
+        declare("PHOTON_DEVICE_", dev->name(), false);
+        declare("PHOTON_HAS_DEVICE_TARGET_", dev->name(), false);
+        declare("PHOTON_HAS_DEVICE_SOURCE_", dev->name(), false);
+    }
+    for (const Ast* module : project->package()->modules()) {
+        declare("PHOTON_HAS_MODULE_", module->moduleInfo()->moduleName(), false);
+        declare("PHOTON_HAS_CMD_TARGET_", module->moduleInfo()->moduleName(), false);
+        declare("PHOTON_HAS_TM_SOURCE_", module->moduleInfo()->moduleName(), false);
+    }
+
+    declare("PHOTON_DEVICE_", conn->device()->name(), true);
+    for (const Ast* module : conn->device()->modules()) {
+        declare("PHOTON_HAS_MODULE_", module->moduleInfo()->moduleName(), true);
+        _deviceModules.emplace(module);
+    }
+    for (const Device* dep : conn->cmdTargets()) {
+        declare("PHOTON_HAS_DEVICE_TARGET_", dep->name(), true);
+        for (const Ast* module : dep->modules()) {
+            declare("PHOTON_HAS_CMD_TARGET_", module->moduleInfo()->moduleName(), true);
+            _deviceModules.emplace(module);
+        }
+    }
+    for (const Device* dep : conn->tmSources()) {
+        declare("PHOTON_HAS_DEVICE_SOURCE_", dep->name(), true);
+        for (const Ast* module : dep->modules()) {
+            declare("PHOTON_HAS_TM_SOURCE_", module->moduleInfo()->moduleName(), true);
+            _deviceModules.emplace(module);
+        }
+    }
+
+    // modules that provide types used by reachable modules
+    std::vector<Rc<const Ast>> queue(_deviceModules.begin(), _deviceModules.end());
+    while (!queue.empty()) {
+        Rc<const Ast> module = queue.back();
+        queue.pop_back();
+
+        const TypeDependsIndex::ModuleDepends* deps = _dependsIndex.moduleDepends(module.get()).unwrap();
+        TypeDependsIndex::Bits typeBits = deps->types;
+        TypeDependsIndex::unite(&typeBits, deps->vars);
+        TypeDependsIndex::unite(&typeBits, deps->cmds);
+        TypeDependsIndex::unite(&typeBits, deps->statuses);
+        TypeDependsIndex::unite(&typeBits, deps->events);
+        TypeDependsCollector::Depends types;
+        _dependsIndex.toDepends(typeBits, &types);
+        for (const Rc<const Type>& type : types) {
+            bmcl::Option<bmcl::StringView> name = typeModuleName(type.get());
+            if (name.isNone()) {
+                continue;
+            }
+            bmcl::OptionPtr<const Ast> dep = project->package()->moduleWithName(name.unwrap());
+            if (dep.isSome() && _deviceModules.emplace(dep.unwrap()).second) {
+                queue.emplace_back(dep.unwrap());
+            }
+        }
+    }
+}
+
+bool Generator::generateOnboard(const Project* project)
+{
+    TraceScope trace("generator", "generateOnboard");
+    const Package* package = project->package();
+
+    _onboardHgen.reset(new OnboardTypeHeaderGen(&_output));
+    _onboardHgen->setSeqlockVars(_config.useSeqlockVars);
+    _onboardHgen->setAutosaveJournal(_config.useAutosaveJournal);
+    _onboardHgen->setSegmentedWriter(_config.useSegmentedWriter);
+    _onboardHgen->setConfiguration(project->configuration());
+    _onboardSgen.reset(new OnboardTypeSourceGen(&_output));
+    _onboardSgen->setSegmentedWriter(_config.useSegmentedWriter);
+    for (const Ast* it : package->modules()) {
+        if (!hasModule(it)) {
+            continue;
+        }
+        if (!generateTypesAndComponents(it)) {
+            return false;
+        }
+    }
+
+    {
+        TraceScope trace("generator", "generateGenerics");
+        TRY(generateGenerics(package));
+    }
+    TRY(generateConfig(project));
+    {
+        TraceScope trace("generator", "generateDynArrays");
+        TRY(generateDynArrays(package));
+    }
+    {
+        TraceScope trace("generator", "generateTmPrivate");
+        TRY(generateTmPrivate(package));
+    }
+    {
+        TraceScope trace("generator", "generateStatusMessages");
+        TRY(generateStatusMessages(project));
+    }
+    {
+        TraceScope trace("generator", "generateCommands");
+        TRY(generateCommands(project));
+    }
+    if (_config.useSegmentedWriter) {
+        TRY(generateSegWriter());
+    }
+    if (_config.useEventQueue) {
+        TraceScope trace("generator", "generateEventQueue");
+        TRY(generateEventQueue(project));
+    }
+    if (_config.useParamTable) {
+        TraceScope trace("generator", "generateParamTable");
+        TRY(generateParamTable(project));
+    }
+    if (_config.instrumentationLevel > 0) {
+        TraceScope trace("generator", "generateMsgStats");
+        TRY(generateMsgStats(project));
+    }
+    if (_config.useBinaryLog) {
+        TRY(generateBinLog(project));
+    }
+    {
+        TraceScope trace("generator", "generateDeviceFiles");
+        TRY(generateDeviceFiles(project));
+    }
+    return true;
+}
+
+bool Generator::generateDispatchFiles(const Project* project)
+{
     std::string dummyPath = joinPath(_savePath, "Photon.dummy.h"); //FIXME: joinPath
     TRY(saveOutput(dummyPath, bmcl::StringView::empty(), _diag.get()));
 
-    bmcl::StringView exts[2] = {".c", ".h"};
-    for (bmcl::StringView ext : exts) {
-        for (const Device* dev : project->devices()) {
-            _output.append("#ifdef PHOTON_DEVICE_");
-            _output.appendUpper(dev->name());
-            _output.appendEol();
-            _output.append("#include \"Photon");
-            _output.appendWithFirstUpper(dev->name());
-            _output.append(ext);
-            _output.append("\"\n");
-            _output.appendEndif();
+    if (_config.onboardShardCount > 1) {
+        SrcBuilder suffix;
+        for (std::size_t i = 0; i < _config.onboardShardCount; i++) {
+            suffix.append('_');
+            suffix.appendNumericValue(i);
+            TRY(generateDeviceDispatch(project, suffix.view(), ".c"));
+            suffix.clear();
         }
+    } else {
+        TRY(generateDeviceDispatch(project, bmcl::StringView::empty(), ".c"));
+    }
+    TRY(generateDeviceDispatch(project, bmcl::StringView::empty(), ".h"));
+    return true;
+}
 
-        std::string photoncPath = joinPath(_savePath, "Photon");;
-        photoncPath.append(ext.begin(), ext.end());
-        TRY(saveOutput(photoncPath, _output.view(), _diag.get()));
-        _output.clear();
+bool Generator::generateSpecializedDevice(const Project* project, const DeviceConnection* conn, bmcl::StringView packageSource,
+                                          const bmcl::Buffer& package, const bmcl::Buffer& packageObject)
+{
+    TraceScope trace("generator", "generateSpecializedDevice", conn->device()->name());
+    std::string savePath = _savePath;
+    _savePath = joinPath(joinPath(savePath, "devices"), conn->device()->name());
+    TRY(makeDirectoryRecursive(_savePath, _diag.get()));
+    specializeFor(project, conn);
+
+    TRY(generateDispatchFiles(project));
+
+    _photongenPath = joinPath(_savePath, "photongen");
+    TRY(makeDirectory(_photongenPath, _diag.get()));
+
+    _onboardPath.assign(joinPath(_photongenPath, "onboard"));
+    TRY(makeDirectory(_onboardPath.c_str(), _diag.get()));
+    _onboardPath.append(pathSeparator());
+
+    TRY(generateOnboard(project));
+
+    _output.append(packageSource);
+    std::string packagePath = joinPath(_onboardPath.toStdString(), "Package.inc.c");
+    TRY(saveCurrentOutput(packagePath));
+    _output.clear();
+
+    packagePath = joinPath(_onboardPath.toStdString(), "Package.bin");
+    TRY(saveOutput(packagePath, package, _diag.get()));
+    if (_config.packageEmbedMode == PackageEmbedMode::Elf) {
+        packagePath = joinPath(_onboardPath.toStdString(), "Package.o");
+        TRY(saveOutput(packagePath, packageObject, _diag.get()));
     }
 
+    _device = bmcl::None;
+    _deviceModules.clear();
+    _guardResolver.clear();
+    _savePath = savePath;
+    return true;
+}
+
+bool Generator::generateProject(const Project* project, const GeneratorConfig& cfg)
+{
+    _config = cfg;
+    _binLogRewriter.clear();
+    _typeNames.clear();
+    _typeNames.addPackageTypes(project->package());
+    TypeNameCacheScope typeNamesScope(&_typeNames);
+    _dependsIndex.build(project->package());
+
+    TRY(makeDirectory(_savePath, _diag.get()));
+    TRY(generateDispatchFiles(project));
+
     _photongenPath = joinPath(_savePath, "photongen");
     TRY(makeDirectory(_photongenPath, _diag.get()));
 
@@ -398,60 +970,114 @@ bool Generator::generateProject(const Project* project, const GeneratorConfig& c
     TRY(makeDirectory(_gcPath.c_str(), _diag.get()));
     _gcPath.append(pathSeparator());
 
+    if (_config.packageEmbedMode == PackageEmbedMode::Elf && ElfObjectGen::findTarget(_config.packageObjectTarget).isNone()) {
+        _diag->buildSystemErrorReport("unsupported package object target", _config.packageObjectTarget);
+        return false;
+    }
+
+    std::string packageBlobPath = joinPath(absolutePath(_onboardPath.c_str()), "Package.bin");
     SrcBuilder packageSourceCode;
     bmcl::Buffer serializedProject;
+    std::size_t uncompressedProjectSize = 0;
+    bmcl::Buffer packageObject;
     packageSourceCode.reserve(1024 * 1024);
     _output.reserve(1024 * 1024);
-    auto future = std::async(std::launch::async, &Generator::generateSerializedPackage, project, &serializedProject, &packageSourceCode);
+    auto future = std::async(std::launch::async, &Generator::generateSerializedPackage, project, &_config, &packageBlobPath,
+                             &serializedProject, &uncompressedProjectSize, &packageSourceCode, &packageObject);
 
     const Package* package = project->package();
 
-    _onboardHgen.reset(new OnboardTypeHeaderGen(&_output));
-    _onboardSgen.reset(new OnboardTypeSourceGen(&_output));
-    for (const Ast* it : package->modules()) {
-        if (!generateTypesAndComponents(it)) {
-            return false;
+    TRY(generateOnboard(project));
+
+    {
+        TraceScope trace("generator", "generateGroundControl");
+        GcInterfaceGen igen(&_output);
+        igen.setMsgStats(_config.instrumentationLevel > 0);
+        igen.setDependsIndex(&_dependsIndex);
+        igen.setConfiguration(project->configuration());
+        igen.generateHeader(package);
+        std::string interfacePath = joinPath(_savePath, "Photon.hpp");
+        TRY(saveOutput(interfacePath, _output.view(), _diag.get()));
+        _output.clear();
+
+        igen.generateSource(package);
+        interfacePath = joinPath(_savePath, "Photon.cpp");
+        TRY(saveOutput(interfacePath, _output.view(), _diag.get()));
+        _output.clear();
+
+        igen.generateValidatorHeader(package);
+        interfacePath = joinPath(_gcPath.view(), "Validator.hpp");
+        TRY(saveOutput(interfacePath, _output.view(), _diag.get()));
+        _output.clear();
+
+        igen.generateTmRouterHeader(package);
+        interfacePath = joinPath(_gcPath.view(), "TmRouter.hpp");
+        TRY(saveOutput(interfacePath, _output.view(), _diag.get()));
+        _output.clear();
+
+        std::size_t gcPathSize = _gcPath.size();
+        _gcPath.append("_components_");
+        TRY(makeDirectory(_gcPath.c_str(), _diag.get()));
+        _gcPath.append(pathSeparator());
+        for (const Component* comp : package->components()) {
+            igen.generateComponentHeader(comp);
+            TRY(dump(comp->name(), ".hpp", &_gcPath));
         }
+        _gcPath.resize(gcPathSize);
     }
 
-    TRY(generateGenerics(package));
-    TRY(generateConfig(project));
-    TRY(generateDynArrays(package));
-    TRY(generateTmPrivate(package));
-    TRY(generateStatusMessages(project));
-    TRY(generateCommands(package));
-    TRY(generateDeviceFiles(project));
-
-    GcInterfaceGen igen(&_output);
-    igen.generateHeader(package);
-    std::string interfacePath = joinPath(_savePath, "Photon.hpp");
-    TRY(saveOutput(interfacePath, _output.view(), _diag.get()));
-    _output.clear();
-
-    igen.generateSource(package);
-    interfacePath = joinPath(_savePath, "Photon.cpp");
-    TRY(saveOutput(interfacePath, _output.view(), _diag.get()));
-    _output.clear();
+    {
+        TraceScope trace("generator", "waitSerializedPackage");
+        future.wait();
+    }
 
-    igen.generateValidatorHeader(package);
-    interfacePath = joinPath(_gcPath.view(), "Validator.hpp");
-    TRY(saveOutput(interfacePath, _output.view(), _diag.get()));
-    _output.clear();
+    MemoryStats memStats;
+    memStats.collect(package);
+    memStats.add("buffers", "output", 1, _output.peakSize());
+    memStats.add("buffers", "resolvedOutput", 1, _resolvedOutput.peakSize());
+    memStats.add("buffers", "binLogOutput", 1, _binLogOutput.peakSize());
+    memStats.add("buffers", "onboardPath", 1, _onboardPath.peakSize());
+    memStats.add("buffers", "gcPath", 1, _gcPath.peakSize());
+    memStats.add("buffers", "typeNames", _typeNames.stringCount(), _typeNames.stringBytes());
+    memStats.add("buffers", "dependsIndex", _dependsIndex.typeCount(), _dependsIndex.memoryUsage());
+    memStats.add("buffers", "packageSourceCode", 1, packageSourceCode.peakSize());
+    memStats.addOutputSize("package", "uncompressed", 1, uncompressedProjectSize);
+    memStats.addOutputSize("package", "compressed", 1, serializedProject.size());
 
     ReportGen rgen(&_output);
     rgen.generateReport(project);
+    rgen.generateMemoryReport(&memStats);
     std::string reportPath = joinPath(_photongenPath, "Report.txt");
     TRY(saveOutput(reportPath, _output.view(), _diag.get()));
     _output.clear();
+    TRY(memStats.saveJson(joinPath(_photongenPath, "Memory.json"), _diag.get()));
 
-
-    future.wait();
     std::string packageDetailPath = joinPath(std::string(_onboardPath.data(), _onboardPath.size()), "Package.inc.c");
     TRY(saveOutput(packageDetailPath, packageSourceCode.view(), _diag.get()));
 
-    std::string packageBlobPath = joinPath(std::string(_onboardPath.c_str()), "Package.bin");
     TRY(saveOutput(packageBlobPath, serializedProject, _diag.get()));
 
+    if (_config.packageEmbedMode == PackageEmbedMode::Elf) {
+        std::string packageObjectPath = joinPath(std::string(_onboardPath.c_str()), "Package.o");
+        TRY(saveOutput(packageObjectPath, packageObject, _diag.get()));
+    }
+
+    if (_config.specializeDevices) {
+        for (const DeviceConnection* conn : project->deviceConnections()) {
+            TRY(generateSpecializedDevice(project, conn, packageSourceCode.view(), serializedProject, packageObject));
+        }
+    }
+
+    // all onboard sources are written at this point, log site ids are final
+    if (_config.useBinaryLog) {
+        BinLogGen gen(&_output);
+        gen.generateGcHeader(&_binLogRewriter);
+        std::string binLogPath = joinPath(_gcPath.view(), "BinLog.hpp");
+        TRY(saveOutput(binLogPath, _output.view(), _diag.get()));
+        _output.clear();
+        TRY(_binLogRewriter.saveJson(joinPath(_photongenPath, "BinLog.json"), _diag.get()));
+    }
+
     _photongenPath.clear();
     _output.clear();
     _onboardHgen.reset();
@@ -468,6 +1094,9 @@ bool Generator::generateDynArrays(const Package* package)
     RcSecondUnorderedMap<std::string, const DynArrayType> dynArrays;
     DynArrayCollector coll;
     for (const Ast* ast : package->modules()) {
+        if (!hasModule(ast)) {
+            continue;
+        }
         for (const Type* type : ast->typesRange()) {
             coll.collectUniqueDynArrays(type, &dynArrays);
         }
@@ -493,6 +1122,12 @@ bool Generator::generateDynArrays(const Package* package)
 bool Generator::generateStatusMessages(const Project* project)
 {
     StatusEncoderGen gen(&_output);
+    gen.setSegmentedWriter(_config.useSegmentedWriter);
+    gen.setEventQueue(_config.useEventQueue);
+    gen.setSeqlockVars(_config.useSeqlockVars);
+    gen.setAutosaveJournal(_config.useAutosaveJournal);
+    gen.setMsgStats(_config.instrumentationLevel > 0);
+    gen.setDependsIndex(&_dependsIndex);
     gen.generateStatusEncoderSource(project);
     TRY(dump("StatusEncoder", ".c", &_onboardPath));
 
@@ -508,6 +1143,10 @@ bool Generator::generateStatusMessages(const Project* project)
     gen.generateAutosaveSource(project);
     TRY(dump("Autosave.inc", ".c", &_onboardPath));
 
+    if (_device.isSome()) {
+        return true;
+    }
+
     std::size_t pathSize = _gcPath.size();
     _gcPath.append("_statuses_");
     TRY(makeDirectory(_gcPath.c_str(), _diag.get()));
@@ -547,9 +1186,13 @@ bool Generator::generateStatusMessages(const Project* project)
     return true;
 }
 
-bool Generator::generateCommands(const Package* package)
+bool Generator::generateCommands(const Project* project)
 {
+    const Package* package = project->package();
     CmdDecoderGen decGen(&_output);
+    decGen.setConfiguration(project->configuration());
+    decGen.setSegmentedWriter(_config.useSegmentedWriter);
+    decGen.setMsgStats(_config.instrumentationLevel > 0);
     decGen.generateHeader(package->components());
     TRY(dump("CmdDecoder", ".h", &_onboardPath));
 
@@ -557,6 +1200,7 @@ bool Generator::generateCommands(const Package* package)
     TRY(dump("CmdDecoder", ".c", &_onboardPath));
 
     CmdEncoderGen encGen(&_output);
+    encGen.setSegmentedWriter(_config.useSegmentedWriter);
     encGen.generateSource(package->components());
     TRY(dump("CmdEncoder", ".c", &_onboardPath));
 
@@ -575,7 +1219,7 @@ bool Generator::dump(bmcl::StringView name, bmcl::StringView ext, StringBuilder*
 {
     currentPath->appendWithFirstUpper(name);
     currentPath->append(ext);
-    TRY(saveOutput(currentPath->c_str(), _output.view(), _diag.get()));
+    TRY(saveCurrentOutput(currentPath->c_str()));
     currentPath->removeFromBack(name.size() + ext.size());
     _output.clear();
     return true;
@@ -587,15 +1231,26 @@ bool Generator::generateGenerics(const Package* package)
     TRY(makeDirectory(_onboardPath.c_str(), _diag.get()));
     _onboardPath.append(pathSeparator());
 
-    _gcPath.append("_generic_");
-    TRY(makeDirectory(_gcPath.c_str(), _diag.get()));
-    _gcPath.append(pathSeparator());
+    bool hasGc = _device.isNone();
+    if (hasGc) {
+        _gcPath.append("_generic_");
+        TRY(makeDirectory(_gcPath.c_str(), _diag.get()));
+        _gcPath.append(pathSeparator());
+    }
 
     SrcBuilder typeNameBuilder;
     TypeNameGen typeNameGen(&typeNameBuilder);
     GcTypeGen gcTypeGen(&_output);
+    // package shares instantiations with equal arguments, generate each of them once
+    HashSet<const NamedType*> generated;
     for (const Ast* ast : package->modules()) {
+        if (!hasModule(ast)) {
+            continue;
+        }
         for (const GenericInstantiationType* type : ast->genericInstantiationsRange()) {
+            if (!generated.insert(type->instantiatedType()).second) {
+                continue;
+            }
             typeNameGen.genTypeName(type);
 
             _onboardHgen->genTypeHeader(ast, type, typeNameBuilder.view());
@@ -604,26 +1259,34 @@ bool Generator::generateGenerics(const Package* package)
             _onboardSgen->genTypeSource(type, typeNameBuilder.view());
             TRY(dump(typeNameBuilder.view(), GEN_PREFIX ".c", &_onboardPath));
 
-            gcTypeGen.generateHeader(type);
-            TRY(dump(typeNameBuilder.view(), ".hpp", &_gcPath));
+            if (hasGc) {
+                gcTypeGen.generateHeader(type);
+                TRY(dump(typeNameBuilder.view(), ".hpp", &_gcPath));
+            }
 
             typeNameBuilder.clear();
         }
     }
     _onboardPath.removeFromBack(10);
-    _gcPath.removeFromBack(10);
+    if (hasGc) {
+        _gcPath.removeFromBack(10);
+    }
     return true;
 }
 
 bool Generator::generateTypesAndComponents(const Ast* ast)
 {
+    TraceScope trace("generator", "generateTypesAndComponents", ast->moduleName());
     _onboardPath.append(ast->moduleName());
     TRY(makeDirectory(_onboardPath.c_str(), _diag.get()));
     _onboardPath.append(pathSeparator());
 
-    _gcPath.append(ast->moduleName());
-    TRY(makeDirectory(_gcPath.c_str(), _diag.get()));
-    _gcPath.append(pathSeparator());
+    bool hasGc = _device.isNone();
+    if (hasGc) {
+        _gcPath.append(ast->moduleName());
+        TRY(makeDirectory(_gcPath.c_str(), _diag.get()));
+        _gcPath.append(pathSeparator());
+    }
 
     SrcBuilder typeNameBuilder;
     TypeNameGen typeNameGen(&typeNameBuilder);
@@ -643,9 +1306,10 @@ bool Generator::generateTypesAndComponents(const Ast* ast)
 
             typeNameBuilder.clear();
         }
-        gcTypeGen.generateHeader(type);
-        TRY(dump(type->name(), ".hpp", &_gcPath));
-
+        if (hasGc) {
+            gcTypeGen.generateHeader(type);
+            TRY(dump(type->name(), ".hpp", &_gcPath));
+        }
     }
 
     if (ast->component().isSome()) {
@@ -661,6 +1325,18 @@ bool Generator::generateTypesAndComponents(const Ast* ast)
             _output.append(" _photon");
             _output.appendWithFirstUpper(comp->moduleName());
             _output.append(';');
+            if (_config.useSeqlockVars) {
+                _output.append("\natomic_uint _photon");
+                _output.appendWithFirstUpper(comp->moduleName());
+                _output.append("Seq;");
+            }
+            if (_config.useAutosaveJournal && !comp->savedVarsRange().isEmpty()) {
+                _output.append("\natomic_uchar _photon");
+                _output.appendWithFirstUpper(comp->moduleName());
+                _output.append("Dirty[(PHOTON_");
+                _output.appendUpper(comp->name());
+                _output.append("_SAVED_VAR_COUNT + 7) / 8];");
+            }
         }
         TRY(dumpIfNotEmpty(comp->moduleName(), ".Component.c", &_onboardPath));
 
@@ -685,7 +1361,9 @@ bool Generator::generateTypesAndComponents(const Ast* ast)
     }
 
     _onboardPath.removeFromBack(ast->moduleName().size() + 1);
-    _gcPath.removeFromBack(ast->moduleName().size() + 1);
+    if (hasGc) {
+        _gcPath.removeFromBack(ast->moduleName().size() + 1);
+    }
     return true;
 }
 }
@@ -10,12 +10,20 @@
 
 #include "decode/Config.h"
 #include "decode/core/Rc.h"
+#include "decode/core/HashSet.h"
 #include "decode/generator/SrcBuilder.h"
+#include "decode/generator/DeviceGuardResolver.h"
+#include "decode/generator/BinLogRewriter.h"
+#include "decode/generator/TypeNameCache.h"
+#include "decode/generator/TypeDependsIndex.h"
 #include "decode/parser/Containers.h"
 
 #include <bmcl/StringView.h>
+#include <bmcl/OptionPtr.h>
 
 #include <memory>
+#include <string>
+#include <cstddef>
 
 namespace decode {
 
@@ -23,21 +31,52 @@ class Ast;
 class Diagnostics;
 class Package;
 class Project;
+class Device;
+class DeviceConnection;
 class OnboardTypeHeaderGen;
 class OnboardTypeSourceGen;
 class NamedType;
 class DynArrayType;
 class TypeReprGen;
 
+enum class PackageEmbedMode {
+    Array,
+    Embed,
+    Incbin,
+    Elf,
+};
+
 struct GeneratorConfig {
     GeneratorConfig()
         : useAbsolutePathsForBundledSources(false)
+        , useSegmentedWriter(false)
+        , useEventQueue(false)
+        , useSeqlockVars(false)
+        , useAutosaveJournal(false)
+        , useParamTable(false)
+        , onboardShardCount(1)
+        , packageEmbedMode(PackageEmbedMode::Array)
+        , packageObjectTarget("arm")
+        , specializeDevices(false)
+        , instrumentationLevel(0)
+        , useBinaryLog(false)
       //  , generateOnboard(true)
       //  , generateGroundcontrol(true)
     {
     }
 
     bool useAbsolutePathsForBundledSources;
+    bool useSegmentedWriter;
+    bool useEventQueue;
+    bool useSeqlockVars;
+    bool useAutosaveJournal;
+    bool useParamTable;
+    std::size_t onboardShardCount;
+    PackageEmbedMode packageEmbedMode;
+    std::string packageObjectTarget;
+    bool specializeDevices;
+    unsigned instrumentationLevel;
+    bool useBinaryLog;
     //bool generateOnboard;
     //bool generateGroundcontrol;
 };
@@ -55,15 +94,32 @@ public:
     bool generateProject(const Project* project, const GeneratorConfig& cfg = GeneratorConfig());
 
 private:
+    bool generateOnboard(const Project* project);
+    bool generateDispatchFiles(const Project* project);
+    bool generateSpecializedDevice(const Project* project, const DeviceConnection* conn, bmcl::StringView packageSource,
+                                   const bmcl::Buffer& package, const bmcl::Buffer& packageObject);
+    void specializeFor(const Project* project, const DeviceConnection* conn);
+    bool hasModule(const Ast* ast) const;
+    bool saveCurrentOutput(const std::string& path);
     bool generateTypesAndComponents(const Ast* ast);
     bool generateDynArrays(const Package* package);
     bool generateStatusMessages(const Project* package);
-    bool generateCommands(const Package* package);
+    bool generateCommands(const Project* project);
     bool generateTmPrivate(const Package* package);
     bool generateGenerics(const Package* package);
-    static void generateSerializedPackage(const Project* project, bmcl::Buffer* serialized, SrcBuilder* sourceCode);
+    static void generateSerializedPackage(const Project* project, const GeneratorConfig* cfg, const std::string* blobPath,
+                                          bmcl::Buffer* serialized, std::size_t* uncompressedSize,
+                                          SrcBuilder* sourceCode, bmcl::Buffer* object);
     bool generateDeviceFiles(const Project* project);
+    bool generateDeviceShards(const Device* dev, bmcl::StringView typeSources,
+                              bmcl::StringView compSources, bmcl::StringView bundledSources);
+    bool generateDeviceDispatch(const Project* project, bmcl::StringView suffix, bmcl::StringView ext);
     bool generateConfig(const Project* project);
+    bool generateSegWriter();
+    bool generateEventQueue(const Project* project);
+    bool generateParamTable(const Project* project);
+    bool generateMsgStats(const Project* project);
+    bool generateBinLog(const Project* project);
 
     void appendModIfdef(bmcl::StringView name);
     void appendEndif();
@@ -84,5 +140,13 @@ private:
     std::unique_ptr<OnboardTypeHeaderGen> _onboardHgen;
     std::unique_ptr<OnboardTypeSourceGen> _onboardSgen;
     GeneratorConfig _config;
+    bmcl::OptionPtr<const DeviceConnection> _device;
+    HashSet<Rc<const Ast>> _deviceModules;
+    DeviceGuardResolver _guardResolver;
+    SrcBuilder _resolvedOutput;
+    BinLogRewriter _binLogRewriter;
+    SrcBuilder _binLogOutput;
+    TypeNameCache _typeNames;
+    TypeDependsIndex _dependsIndex;
 };
 }
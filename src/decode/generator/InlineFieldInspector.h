@@ -36,7 +36,11 @@ public:
                 if (size.isNone()) {
                     break;
                 }
-                totalSize.emplace(totalSize.unwrapOr(0) + size.unwrap());
+                std::size_t newSize = totalSize.unwrapOr(0) + size.unwrap();
+                if (!typeInspector->template canMergeSizeCheck<isOnboard, isSerializer>(newSize)) {
+                    break;
+                }
+                totalSize.emplace(newSize);
                 it++;
             }
             if (totalSize.isSome()) {
@@ -47,6 +51,7 @@ public:
                     base().endField(*jt);
                 }
                 totalSize.clear();
+                begin = it;
             } else {
                 base().beginField(*it);
                 typeInspector->template inspect<isOnboard, isSerializer>(it->type(), ctx, base().currentFieldName());
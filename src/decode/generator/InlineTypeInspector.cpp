@@ -9,9 +9,21 @@ namespace decode {
 
 InlineTypeInspector::InlineTypeInspector(SrcBuilder* output)
     : _output(output)
+    , _checkSizes(true)
+    , _isSegmentedWriter(false)
 {
 }
 
+void InlineTypeInspector::setSegmentedWriter(bool isSegmented)
+{
+    _isSegmentedWriter = isSegmented;
+}
+
+bool InlineTypeInspector::isSegmentedWriter() const
+{
+    return _isSegmentedWriter;
+}
+
 bool InlineTypeInspector::isSizeCheckEnabled() const
 {
     return _checkSizes;
@@ -115,11 +127,15 @@ void InlineTypeInspector::inspect(const Type* type, const InlineSerContext& ctx,
 }
 
 template <bool isOnboard, bool isSerializer>
-void InlineTypeInspector::appendSizeCheck(const InlineSerContext& ctx, bmcl::StringView name, SrcBuilder* dest)
+void InlineTypeInspector::appendSizeCheck(const InlineSerContext& ctx, bmcl::StringView name, SrcBuilder* dest) const
 {
     if (isOnboard) {
         if (isSerializer) {
-            dest->appendWritableSizeCheck(ctx, name);
+            if (_isSegmentedWriter) {
+                dest->appendSegmentedWritableSizeCheck(ctx, name);
+            } else {
+                dest->appendWritableSizeCheck(ctx, name);
+            }
         } else {
             dest->appendReadableSizeCheck(ctx, name);
         }
@@ -147,6 +163,14 @@ void InlineTypeInspector::appendSizeCheck(const InlineSerContext& ctx, bmcl::Str
     }
 }
 
+template <bool isOnboard, bool isSerializer>
+void InlineTypeInspector::appendVarSizeCheck(const InlineSerContext& ctx, SrcBuilder* dest) const
+{
+    if (isSegmentedSerializer<isOnboard, isSerializer>()) {
+        dest->appendSegmentedWritableSizeCheck(ctx, varSerializerMaxSize());
+    }
+}
+
 template <bool isSerializer>
 void InlineTypeInspector::inspectGcDynArray(const DynArrayType* type)
 {
@@ -194,10 +218,12 @@ void InlineTypeInspector::inspectArray(const ArrayType* type)
     _argName.push_back(']');
     bool oldCheckSizes = _checkSizes;
     if (_checkSizes) {
-        _checkSizes = false;
         auto size = type->elementType()->fixedSize();
-        if (size.isSome()) {
+        if (size.isSome() && canMergeSizeCheck<isOnboard, isSerializer>(size.unwrap() * type->elementCount())) {
+            _checkSizes = false;
             appendSizeCheck<isOnboard, isSerializer>(context(), std::to_string(size.unwrap() * type->elementCount()), _output);
+        } else if (!isSegmentedSerializer<isOnboard, isSerializer>()) {
+            _checkSizes = false;
         }
     }
     _output->appendLoopHeader(context(), type->elementCount());
@@ -444,7 +470,11 @@ void InlineTypeInspector::inspectOnboardNonInlineType(const Type* type)
                 output->append('&');
             }
             appendArgumentName();
-            output->append(", dest)");
+            if (_isSegmentedWriter) {
+                output->append(", seg)");
+            } else {
+                output->append(", dest)");
+            }
         } else {
             output->append("_Deserialize(&");
             appendArgumentName();
@@ -512,6 +542,9 @@ void InlineTypeInspector::genOnboardSizedSer(bmcl::StringView sizeCheck, bmcl::S
 template <bool isSerializer>
 void InlineTypeInspector::genOnboardVarSer(bmcl::StringView suffix)
 {
+    if (isSizeCheckEnabled()) {
+        appendVarSizeCheck<true, isSerializer>(context(), _output);
+    }
     _output->appendIndent(context());
     _output->appendWithTryMacro([&](SrcBuilder* output) {
         if (isSerializer) {
@@ -534,8 +567,12 @@ template void InlineTypeInspector::inspect<true, true>(const Type* type, const I
 template void InlineTypeInspector::inspect<true, false>(const Type* type, const InlineSerContext& ctx, bmcl::StringView argName, bool checkSizes);
 template void InlineTypeInspector::inspect<false, true>(const Type* type, const InlineSerContext& ctx, bmcl::StringView argName, bool checkSizes);
 template void InlineTypeInspector::inspect<false, false>(const Type* type, const InlineSerContext& ctx, bmcl::StringView argName, bool checkSizes);
-template void InlineTypeInspector::appendSizeCheck<true, true>(const InlineSerContext& ctx, bmcl::StringView name, SrcBuilder* dest);
-template void InlineTypeInspector::appendSizeCheck<true, false>(const InlineSerContext& ctx, bmcl::StringView name, SrcBuilder* dest);
-template void InlineTypeInspector::appendSizeCheck<false, true>(const InlineSerContext& ctx, bmcl::StringView name, SrcBuilder* dest);
-template void InlineTypeInspector::appendSizeCheck<false, false>(const InlineSerContext& ctx, bmcl::StringView name, SrcBuilder* dest);
+template void InlineTypeInspector::appendSizeCheck<true, true>(const InlineSerContext& ctx, bmcl::StringView name, SrcBuilder* dest) const;
+template void InlineTypeInspector::appendVarSizeCheck<true, true>(const InlineSerContext& ctx, SrcBuilder* dest) const;
+template void InlineTypeInspector::appendSizeCheck<true, false>(const InlineSerContext& ctx, bmcl::StringView name, SrcBuilder* dest) const;
+template void InlineTypeInspector::appendVarSizeCheck<true, false>(const InlineSerContext& ctx, SrcBuilder* dest) const;
+template void InlineTypeInspector::appendSizeCheck<false, true>(const InlineSerContext& ctx, bmcl::StringView name, SrcBuilder* dest) const;
+template void InlineTypeInspector::appendVarSizeCheck<false, true>(const InlineSerContext& ctx, SrcBuilder* dest) const;
+template void InlineTypeInspector::appendSizeCheck<false, false>(const InlineSerContext& ctx, bmcl::StringView name, SrcBuilder* dest) const;
+template void InlineTypeInspector::appendVarSizeCheck<false, false>(const InlineSerContext& ctx, SrcBuilder* dest) const;
 }
@@ -28,17 +28,38 @@ class BuiltinType;
 class DynArrayType;
 class TypeReprGen;
 
+// max size of a single spilled run in segmented writer mode
+constexpr std::size_t segWriterSpillSize()
+{
+    return 64;
+}
+
+// max encoded size of varuint/varint
+constexpr std::size_t varSerializerMaxSize()
+{
+    return 9;
+}
+
 class InlineTypeInspector {
 public:
     InlineTypeInspector(SrcBuilder* output);
 
+    void setSegmentedWriter(bool isSegmented);
+    bool isSegmentedWriter() const;
+
     void genOnboardSerializer(const Type* type, const InlineSerContext& ctx, bmcl::StringView argName, bool checkSizes = true);
     void genOnboardDeserializer(const Type* type, const InlineSerContext& ctx, bmcl::StringView argName, bool checkSizes = true);
 
     template <bool isOnboard, bool isSerializer>
     void inspect(const Type* type, const InlineSerContext& ctx, bmcl::StringView argName, bool checkSizes = true);
     template <bool isOnboard, bool isSerializer>
-    static void appendSizeCheck(const InlineSerContext& ctx, bmcl::StringView name, SrcBuilder* dest);
+    void appendSizeCheck(const InlineSerContext& ctx, bmcl::StringView name, SrcBuilder* dest) const;
+    template <bool isOnboard, bool isSerializer>
+    void appendVarSizeCheck(const InlineSerContext& ctx, SrcBuilder* dest) const;
+    template <bool isOnboard, bool isSerializer>
+    bool canMergeSizeCheck(std::size_t size) const;
+    template <bool isOnboard, bool isSerializer>
+    bool isSegmentedSerializer() const;
 
 private:
     const InlineSerContext& context() const;
@@ -83,14 +104,34 @@ private:
     std::stack<InlineSerContext, std::vector<InlineSerContext>> _ctxStack;
     std::string _argName;
     bool _checkSizes;
+    bool _isSegmentedWriter;
 };
 
+template <bool isOnboard, bool isSerializer>
+inline bool InlineTypeInspector::isSegmentedSerializer() const
+{
+    return isOnboard && isSerializer && _isSegmentedWriter;
+}
+
+template <bool isOnboard, bool isSerializer>
+inline bool InlineTypeInspector::canMergeSizeCheck(std::size_t size) const
+{
+    if (isSegmentedSerializer<isOnboard, isSerializer>()) {
+        return size <= segWriterSpillSize();
+    }
+    return true;
+}
+
 extern template void InlineTypeInspector::inspect<true, true>(const Type* type, const InlineSerContext& ctx, bmcl::StringView argName, bool checkSizes);
 extern template void InlineTypeInspector::inspect<true, false>(const Type* type, const InlineSerContext& ctx, bmcl::StringView argName, bool checkSizes);
 extern template void InlineTypeInspector::inspect<false, true>(const Type* type, const InlineSerContext& ctx, bmcl::StringView argName, bool checkSizes);
 extern template void InlineTypeInspector::inspect<false, false>(const Type* type, const InlineSerContext& ctx, bmcl::StringView argName, bool checkSizes);
-extern template void InlineTypeInspector::appendSizeCheck<true, true>(const InlineSerContext& ctx, bmcl::StringView name, SrcBuilder* dest);
-extern template void InlineTypeInspector::appendSizeCheck<true, false>(const InlineSerContext& ctx, bmcl::StringView name, SrcBuilder* dest);
-extern template void InlineTypeInspector::appendSizeCheck<false, true>(const InlineSerContext& ctx, bmcl::StringView name, SrcBuilder* dest);
-extern template void InlineTypeInspector::appendSizeCheck<false, false>(const InlineSerContext& ctx, bmcl::StringView name, SrcBuilder* dest);
+extern template void InlineTypeInspector::appendSizeCheck<true, true>(const InlineSerContext& ctx, bmcl::StringView name, SrcBuilder* dest) const;
+extern template void InlineTypeInspector::appendVarSizeCheck<true, true>(const InlineSerContext& ctx, SrcBuilder* dest) const;
+extern template void InlineTypeInspector::appendSizeCheck<true, false>(const InlineSerContext& ctx, bmcl::StringView name, SrcBuilder* dest) const;
+extern template void InlineTypeInspector::appendVarSizeCheck<true, false>(const InlineSerContext& ctx, SrcBuilder* dest) const;
+extern template void InlineTypeInspector::appendSizeCheck<false, true>(const InlineSerContext& ctx, bmcl::StringView name, SrcBuilder* dest) const;
+extern template void InlineTypeInspector::appendVarSizeCheck<false, true>(const InlineSerContext& ctx, SrcBuilder* dest) const;
+extern template void InlineTypeInspector::appendSizeCheck<false, false>(const InlineSerContext& ctx, bmcl::StringView name, SrcBuilder* dest) const;
+extern template void InlineTypeInspector::appendVarSizeCheck<false, false>(const InlineSerContext& ctx, SrcBuilder* dest) const;
 }
@@ -0,0 +1,303 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "decode/generator/MemoryStats.h"
+#include "decode/core/FileInfo.h"
+#include "decode/core/Utils.h"
+#include "decode/ast/Ast.h"
+#include "decode/ast/Component.h"
+#include "decode/ast/DocBlock.h"
+#include "decode/ast/Field.h"
+#include "decode/ast/Function.h"
+#include "decode/ast/ModuleInfo.h"
+#include "decode/ast/Type.h"
+#include "decode/parser/Package.h"
+
+#include <bmcl/StringView.h>
+
+#include <cstring>
+
+namespace decode {
+
+MemoryStats::MemoryStats()
+{
+}
+
+MemoryStats::~MemoryStats()
+{
+}
+
+const std::vector<MemoryStats::Entry>& MemoryStats::entries() const
+{
+    return _entries;
+}
+
+std::size_t MemoryStats::totalBytes() const
+{
+    std::size_t total = 0;
+    for (const Entry& entry : _entries) {
+        if (entry.isRetained) {
+            total += entry.bytes;
+        }
+    }
+    return total;
+}
+
+void MemoryStats::add(const char* group, bmcl::StringView name, std::size_t count, std::size_t bytes)
+{
+    addEntry(group, name, count, bytes, true);
+}
+
+void MemoryStats::addOutputSize(const char* group, bmcl::StringView name, std::size_t count, std::size_t bytes)
+{
+    addEntry(group, name, count, bytes, false);
+}
+
+void MemoryStats::addEntry(const char* group, bmcl::StringView name, std::size_t count, std::size_t bytes, bool isRetained)
+{
+    for (Entry& entry : _entries) {
+        if (std::strcmp(entry.group, group) == 0 && name == entry.name) {
+            entry.count += count;
+            entry.bytes += bytes;
+            return;
+        }
+    }
+    _entries.push_back(Entry{group, name.toStdString(), count, bytes, isRetained});
+}
+
+static std::size_t typeObjectSize(const Type* type)
+{
+    switch (type->typeKind()) {
+    case TypeKind::Builtin:
+        return sizeof(BuiltinType);
+    case TypeKind::Reference:
+        return sizeof(ReferenceType);
+    case TypeKind::Array:
+        return sizeof(ArrayType);
+    case TypeKind::DynArray:
+        return sizeof(DynArrayType);
+    case TypeKind::Function:
+        return sizeof(FunctionType) + type->asFunction()->argumentsRange().size() * sizeof(Rc<Field>);
+    case TypeKind::Enum:
+        return sizeof(EnumType) + type->asEnum()->constantsRange().size() * sizeof(Rc<EnumConstant>);
+    case TypeKind::Struct:
+        return sizeof(StructType) + type->asStruct()->fieldsRange().size() * sizeof(Rc<Field>);
+    case TypeKind::Variant:
+        return sizeof(VariantType) + type->asVariant()->fieldsRange().size() * sizeof(Rc<VariantField>);
+    case TypeKind::Imported:
+        return sizeof(ImportedType);
+    case TypeKind::Alias:
+        return sizeof(AliasType);
+    case TypeKind::Generic:
+        return sizeof(GenericType);
+    case TypeKind::GenericInstantiation:
+        return sizeof(GenericInstantiationType);
+    case TypeKind::GenericParameter:
+        return sizeof(GenericParameterType);
+    }
+    return sizeof(Type);
+}
+
+void MemoryStats::collectDocs(const DocBlockMixin* mixin)
+{
+    if (mixin->docs().isNone()) {
+        return;
+    }
+    const DocBlock* docs = mixin->docs().unwrap();
+    if (!_visited.insert(docs).second) {
+        return;
+    }
+    add("docs", "DocBlock", 1, sizeof(DocBlock) + docs->longDescription().size() * sizeof(bmcl::StringView));
+}
+
+void MemoryStats::collectField(const Field* field)
+{
+    if (!_visited.insert(field).second) {
+        return;
+    }
+    add("fields", "Field", 1, sizeof(Field));
+    collectDocs(field);
+}
+
+void MemoryStats::collectVariantField(const VariantField* field)
+{
+    if (!_visited.insert(field).second) {
+        return;
+    }
+    switch (field->variantFieldKind()) {
+    case VariantFieldKind::Constant:
+        add("fields", "ConstantVariantField", 1, sizeof(ConstantVariantField));
+        break;
+    case VariantFieldKind::Tuple:
+        add("fields", "TupleVariantField", 1,
+            sizeof(TupleVariantField) + field->asTupleField()->typesRange().size() * sizeof(Rc<Type>));
+        break;
+    case VariantFieldKind::Struct:
+        add("fields", "StructVariantField", 1,
+            sizeof(StructVariantField) + field->asStructField()->fieldsRange().size() * sizeof(Rc<Field>));
+        for (const Field* f : field->asStructField()->fieldsRange()) {
+            collectField(f);
+        }
+        break;
+    }
+    collectDocs(field);
+}
+
+void MemoryStats::collectType(const Type* type)
+{
+    if (!_visited.insert(type).second) {
+        return;
+    }
+    add("types", type->renderTypeKind(), 1, typeObjectSize(type));
+    collectDocs(type);
+
+    switch (type->typeKind()) {
+    case TypeKind::Function:
+        for (const Field* field : type->asFunction()->argumentsRange()) {
+            collectField(field);
+        }
+        break;
+    case TypeKind::Enum:
+        for (const EnumConstant* c : type->asEnum()->constantsRange()) {
+            add("fields", "EnumConstant", 1, sizeof(EnumConstant));
+            collectDocs(c);
+        }
+        break;
+    case TypeKind::Struct:
+        for (const Field* field : type->asStruct()->fieldsRange()) {
+            collectField(field);
+        }
+        break;
+    case TypeKind::Variant:
+        for (const VariantField* field : type->asVariant()->fieldsRange()) {
+            collectVariantField(field);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void MemoryStats::collectVarRegexp(const VarRegexp* regexp)
+{
+    if (!_visited.insert(regexp).second) {
+        return;
+    }
+    add("accessors", "VarRegexp", 1, sizeof(VarRegexp) + regexp->accessorsRange().size() * sizeof(Rc<Accessor>));
+    for (const Accessor* acc : regexp->accessorsRange()) {
+        switch (acc->accessorKind()) {
+        case AccessorKind::Field:
+            add("accessors", "FieldAccessor", 1, sizeof(FieldAccessor));
+            break;
+        case AccessorKind::Subscript:
+            add("accessors", "SubscriptAccessor", 1, sizeof(SubscriptAccessor));
+            break;
+        }
+    }
+}
+
+void MemoryStats::collectFile(const FileInfo* info)
+{
+    if (!_visited.insert(info).second) {
+        return;
+    }
+    add("files", "contents", 1, sizeof(FileInfo) + info->fileName().capacity() + info->contents().capacity());
+    add("files", "lineTable", info->lines().size(), info->lines().capacity() * sizeof(bmcl::StringView));
+}
+
+void MemoryStats::collect(const Package* package)
+{
+    for (const Ast* ast : package->modules()) {
+        collectFile(ast->moduleInfo()->fileInfo());
+        collectDocs(ast->moduleInfo());
+        for (const Type* type : ast->typesRange()) {
+            collectType(type);
+        }
+        if (ast->component().isNone()) {
+            continue;
+        }
+        const Component* comp = ast->component().unwrap();
+        for (const Field* field : comp->varsRange()) {
+            collectField(field);
+        }
+        for (const Command* cmd : comp->cmdsRange()) {
+            collectDocs(cmd);
+            collectType(cmd->type());
+        }
+        for (const StatusMsg* msg : comp->statusesRange()) {
+            for (const VarRegexp* part : msg->partsRange()) {
+                collectVarRegexp(part);
+            }
+        }
+        for (const EventMsg* msg : comp->eventsRange()) {
+            for (const Field* field : msg->partsRange()) {
+                collectField(field);
+            }
+        }
+        for (const VarRegexp* var : comp->savedVarsRange()) {
+            collectVarRegexp(var);
+        }
+    }
+    _visited.clear();
+}
+
+std::string MemoryStats::toJson() const
+{
+    std::string dest;
+    dest.reserve(_entries.size() * 64 + 32);
+    dest.push_back('{');
+    std::vector<const char*> groups;
+    for (const Entry& entry : _entries) {
+        bool isNew = true;
+        for (const char* group : groups) {
+            if (std::strcmp(group, entry.group) == 0) {
+                isNew = false;
+                break;
+            }
+        }
+        if (isNew) {
+            groups.push_back(entry.group);
+        }
+    }
+    for (std::size_t i = 0; i < groups.size(); i++) {
+        dest.append("\n  \"");
+        dest.append(groups[i]);
+        dest.append("\": {");
+        bool isFirst = true;
+        for (const Entry& entry : _entries) {
+            if (std::strcmp(groups[i], entry.group) != 0) {
+                continue;
+            }
+            if (!isFirst) {
+                dest.push_back(',');
+            }
+            isFirst = false;
+            dest.append("\n    \"");
+            dest.append(entry.name);
+            dest.append("\": {\"count\": ");
+            dest.append(std::to_string(entry.count));
+            dest.append(", \"bytes\": ");
+            dest.append(std::to_string(entry.bytes));
+            if (!entry.isRetained) {
+                dest.append(", \"retained\": false");
+            }
+            dest.push_back('}');
+        }
+        dest.append("\n  },");
+    }
+    dest.append("\n  \"totalBytes\": ");
+    dest.append(std::to_string(totalBytes()));
+    dest.append("\n}\n");
+    return dest;
+}
+
+bool MemoryStats::saveJson(const std::string& path, Diagnostics* diag) const
+{
+    return saveOutput(path, toJson(), diag);
+}
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "decode/Config.h"
+#include "decode/core/Rc.h"
+#include "decode/core/HashSet.h"
+
+#include <bmcl/Fwd.h>
+
+#include <string>
+#include <vector>
+
+namespace decode {
+
+class Diagnostics;
+class Package;
+class Type;
+class Field;
+class VariantField;
+class DocBlock;
+class DocBlockMixin;
+class VarRegexp;
+class FileInfo;
+
+// approximate retained memory grouped by object kind, bytes are shallow object sizes
+// plus owned string and line table storage
+class MemoryStats : public RefCountable {
+public:
+    using Pointer = Rc<MemoryStats>;
+    using ConstPointer = Rc<const MemoryStats>;
+
+    struct Entry {
+        const char* group;
+        std::string name;
+        std::size_t count;
+        std::size_t bytes;
+        bool isRetained;
+    };
+
+    MemoryStats();
+    ~MemoryStats();
+
+    void collect(const Package* package);
+    void add(const char* group, bmcl::StringView name, std::size_t count, std::size_t bytes);
+    // sizes of produced data (serialized package etc), reported but not counted in totalBytes()
+    void addOutputSize(const char* group, bmcl::StringView name, std::size_t count, std::size_t bytes);
+
+    const std::vector<Entry>& entries() const;
+    std::size_t totalBytes() const;
+
+    std::string toJson() const;
+    bool saveJson(const std::string& path, Diagnostics* diag) const;
+
+private:
+    void collectType(const Type* type);
+    void collectField(const Field* field);
+    void collectVariantField(const VariantField* field);
+    void collectVarRegexp(const VarRegexp* regexp);
+    void collectDocs(const DocBlockMixin* mixin);
+    void collectFile(const FileInfo* info);
+    void addEntry(const char* group, bmcl::StringView name, std::size_t count, std::size_t bytes, bool isRetained);
+
+    std::vector<Entry> _entries;
+    HashSet<const void*> _visited;
+};
+}
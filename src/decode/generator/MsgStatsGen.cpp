@@ -0,0 +1,473 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "decode/generator/MsgStatsGen.h"
+#include "decode/generator/SrcBuilder.h"
+#include "decode/parser/Project.h"
+#include "decode/parser/Package.h"
+#include "decode/ast/Component.h"
+#include "decode/ast/Function.h"
+
+#include <algorithm>
+
+namespace decode {
+
+MsgStatsGen::MsgStatsGen(SrcBuilder* output)
+    : _output(output)
+    , _level(1)
+    , _useAtomics(false)
+    , _isSegmented(false)
+{
+}
+
+MsgStatsGen::~MsgStatsGen()
+{
+}
+
+void MsgStatsGen::setLevel(unsigned level)
+{
+    _level = level;
+}
+
+void MsgStatsGen::setAtomicCounters(bool useAtomics)
+{
+    _useAtomics = useAtomics;
+}
+
+void MsgStatsGen::setSegmentedWriter(bool isSegmented)
+{
+    _isSegmented = isSegmented;
+}
+
+void MsgStatsGen::appendIndexName(const Component* comp, const char* kind, bmcl::StringView name, SrcBuilder* dest)
+{
+    dest->append("PHOTON_");
+    dest->appendUpper(comp->name());
+    dest->append('_');
+    dest->appendUpper(bmcl::StringView(kind));
+    dest->append('_');
+    dest->appendUpper(name);
+    dest->append("_STATS");
+}
+
+void MsgStatsGen::appendIndexName(const Component* comp, const StatusMsg* msg, SrcBuilder* dest)
+{
+    appendIndexName(comp, "status", msg->name(), dest);
+}
+
+void MsgStatsGen::appendIndexName(const Component* comp, const EventMsg* msg, SrcBuilder* dest)
+{
+    appendIndexName(comp, "event", msg->name(), dest);
+}
+
+void MsgStatsGen::appendIndexName(const Component* comp, const Command* cmd, SrcBuilder* dest)
+{
+    appendIndexName(comp, "cmd", cmd->name(), dest);
+}
+
+void MsgStatsGen::collectEntries(const Project* project)
+{
+    _entries.clear();
+    MsgStatsFormat::collectEntries(project->package(), &_entries);
+}
+
+void MsgStatsGen::generateHeader(const Project* project)
+{
+    collectEntries(project);
+
+    _output->startIncludeGuard("PRIVATE", "MSG_STATS");
+
+    _output->appendOnboardIncludePath("core/Error");
+    _output->appendOnboardIncludePath("core/Writer");
+    _output->appendEol();
+    if (_isSegmented) {
+        _output->append("#include \"photongen/onboard/SegWriter.h\"\n\n");
+    }
+    if (_useAtomics) {
+        // 64 bit atomics are implemented with libatomic calls on targets without 64 bit exclusive access
+        // (Cortex-M), which are usually not available, cycles are guarded by a critical section there
+        _output->append("#include <stdatomic.h>\n\n"
+                        "#if ATOMIC_LLONG_LOCK_FREE == 2\n"
+                        "# define PHOTON_MSG_STATS_ATOMIC_CYCLES 1\n"
+                        "#else\n"
+                        "# define PHOTON_MSG_STATS_ATOMIC_CYCLES 0\n"
+                        "#endif\n\n");
+    }
+
+    _output->appendNumericValueDefine(_level, "PHOTON_MSG_STATS_LEVEL");
+    _output->appendNumericValueDefine(_entries.size(), "PHOTON_MSG_STATS_COUNT");
+    _output->appendNumericValueDefine(MsgStatsFormat::errorSlots, "PHOTON_MSG_STATS_ERROR_SLOTS");
+    _output->appendNumericValueDefine(MsgStatsFormat::compNum, "PHOTON_MSG_STATS_COMP_NUM");
+    _output->appendNumericValueDefine(MsgStatsFormat::msgNum, "PHOTON_MSG_STATS_MSG_NUM");
+    _output->appendEol();
+    for (std::size_t i = 0; i < _entries.size(); i++) {
+        _output->append("#define ");
+        appendIndexName(_entries[i].comp, _entries[i].kind, _entries[i].name, _output);
+        _output->append(' ');
+        _output->appendNumericValue(i);
+        _output->appendEol();
+    }
+    _output->appendEol();
+
+    if (_level >= 2) {
+        _output->append("#define PHOTON_MSG_STATS_NOW() PhotonMsgStats_Cycles()\n\n");
+    } else {
+        _output->append("#define PHOTON_MSG_STATS_NOW() 0\n\n");
+    }
+
+    _output->startCppGuard();
+
+    if (_useAtomics) {
+        _output->append("/* each counter is updated atomically, messages may be recorded from several contexts.\n"
+                        " * Counters of one entry are not updated together, readers may see some of them updated before others */\n");
+    } else {
+        _output->append("/* counters are updated without locking, messages must be recorded from a single context.\n"
+                        " * Readers in other contexts may observe partially updated entries */\n");
+    }
+    auto appendCounter = [this](bmcl::StringView type, bmcl::StringView name) {
+        _output->append("    ");
+        if (_useAtomics) {
+            _output->append("_Atomic(");
+            _output->append(type);
+            _output->append(')');
+        } else {
+            _output->append(type);
+        }
+        _output->append(' ');
+        _output->append(name);
+        _output->append(";\n");
+    };
+    _output->append("typedef struct {\n");
+    appendCounter("uint32_t", "encodedCount");
+    appendCounter("uint32_t", "encodedBytes");
+    appendCounter("uint32_t", "decodedCount");
+    appendCounter("uint32_t", "decodedBytes");
+    appendCounter("uint32_t", "errors[PHOTON_MSG_STATS_ERROR_SLOTS]");
+    if (_useAtomics) {
+        _output->append("#if PHOTON_MSG_STATS_ATOMIC_CYCLES\n");
+        appendCounter("uint64_t", "cycles");
+        _output->append("#else\n"
+                        "    uint64_t cycles;\n"
+                        "#endif\n");
+    } else {
+        appendCounter("uint64_t", "cycles");
+    }
+    _output->append("} PhotonMsgStats;\n\n");
+
+    if (_level >= 2) {
+        _output->append("/* free running cycle counter, implemented by platform code */\n"
+                        "uint64_t PhotonMsgStats_Cycles(void);\n\n");
+    }
+    if (_useAtomics) {
+        _output->append("#if !PHOTON_MSG_STATS_ATOMIC_CYCLES\n"
+                        "/* critical section guarding cycles of all entries, implemented by platform code */\n"
+                        "void PhotonMsgStats_EnterCritical(void);\n"
+                        "void PhotonMsgStats_ExitCritical(void);\n"
+                        "#endif\n\n");
+    }
+
+    _output->append("void PhotonMsgStats_RecordEncode(size_t index, PhotonError rv, size_t size, uint64_t start);\n"
+                    "void PhotonMsgStats_RecordDecode(size_t index, PhotonError rv, size_t size, uint64_t start);\n"
+                    "const PhotonMsgStats* PhotonMsgStats_Get(size_t index);\n"
+                    "void PhotonMsgStats_Reset(void);\n"
+                    "PhotonError PhotonMsgStats_Serialize(");
+    if (_isSegmented) {
+        _output->append("PhotonSegWriter* seg");
+    } else {
+        _output->append("PhotonWriter* dest");
+    }
+    _output->append(");\n\n");
+
+    _output->endCppGuard();
+
+    _output->endIncludeGuard();
+}
+
+void MsgStatsGen::generateSource(const Project* project)
+{
+    collectEntries(project);
+
+    _output->append("#include \"photongen/onboard/MsgStats.h\"\n");
+    if (_isSegmented) {
+        _output->appendImplIncludePath("core/Try");
+    }
+    _output->appendImplIncludePath("core/Logging");
+    _output->appendEol();
+
+    _output->append("#define _PHOTON_FNAME \"photongen/onboard/MsgStats.c\"\n\n");
+
+    if (_useAtomics) {
+        // relaxed ordering is enough, counters are not used to synchronize anything else
+        _output->append("#define _PHOTON_MSG_STATS_ADD(counter, value) atomic_fetch_add_explicit(&(counter), (value), memory_order_relaxed)\n"
+                        "#define _PHOTON_MSG_STATS_LOAD(counter) atomic_load_explicit(&(counter), memory_order_relaxed)\n"
+                        "#define _PHOTON_MSG_STATS_STORE(counter, value) atomic_store_explicit(&(counter), (value), memory_order_relaxed)\n\n");
+        _output->append("#if PHOTON_MSG_STATS_ATOMIC_CYCLES\n"
+                        "# define _PHOTON_MSG_STATS_ADD_CYCLES(counter, value) _PHOTON_MSG_STATS_ADD(counter, value)\n"
+                        "# define _PHOTON_MSG_STATS_LOAD_CYCLES(counter) _PHOTON_MSG_STATS_LOAD(counter)\n"
+                        "# define _PHOTON_MSG_STATS_STORE_CYCLES(counter, value) _PHOTON_MSG_STATS_STORE(counter, value)\n"
+                        "#else\n"
+                        "static uint64_t loadCycles(const uint64_t* counter)\n"
+                        "{\n"
+                        "    uint64_t value;\n"
+                        "    PhotonMsgStats_EnterCritical();\n"
+                        "    value = *counter;\n"
+                        "    PhotonMsgStats_ExitCritical();\n"
+                        "    return value;\n"
+                        "}\n\n"
+                        "# define _PHOTON_MSG_STATS_ADD_CYCLES(counter, value) \\\n"
+                        "    do { PhotonMsgStats_EnterCritical(); (counter) += (value); PhotonMsgStats_ExitCritical(); } while (0)\n"
+                        "# define _PHOTON_MSG_STATS_LOAD_CYCLES(counter) loadCycles(&(counter))\n"
+                        "# define _PHOTON_MSG_STATS_STORE_CYCLES(counter, value) \\\n"
+                        "    do { PhotonMsgStats_EnterCritical(); (counter) = (value); PhotonMsgStats_ExitCritical(); } while (0)\n"
+                        "#endif\n\n");
+    } else {
+        _output->append("#define _PHOTON_MSG_STATS_ADD(counter, value) ((counter) += (value))\n"
+                        "#define _PHOTON_MSG_STATS_LOAD(counter) (counter)\n"
+                        "#define _PHOTON_MSG_STATS_STORE(counter, value) ((counter) = (value))\n"
+                        "#define _PHOTON_MSG_STATS_ADD_CYCLES(counter, value) _PHOTON_MSG_STATS_ADD(counter, value)\n"
+                        "#define _PHOTON_MSG_STATS_LOAD_CYCLES(counter) _PHOTON_MSG_STATS_LOAD(counter)\n"
+                        "#define _PHOTON_MSG_STATS_STORE_CYCLES(counter, value) _PHOTON_MSG_STATS_STORE(counter, value)\n\n");
+    }
+
+    // message header includes compNum and msgNum
+    _output->appendNumericValueDefine(MsgStatsFormat::entrySize, "_PHOTON_MSG_STATS_ENTRY_SIZE");
+    _output->appendNumericValueDefine(2 + MsgStatsFormat::headerSize, "_PHOTON_MSG_STATS_HEADER_SIZE");
+    _output->appendEol();
+
+    _output->append("static PhotonMsgStats _photonMsgStats[");
+    _output->appendNumericValue(std::max<std::size_t>(_entries.size(), 1));
+    _output->append("];\n"
+                    "static size_t _photonMsgStatsCursor = 0;\n\n");
+
+    _output->append("static void recordError(PhotonMsgStats* stats, PhotonError rv)\n"
+                    "{\n"
+                    "    size_t slot = (size_t)rv;\n"
+                    "    if (slot >= PHOTON_MSG_STATS_ERROR_SLOTS) {\n"
+                    "        slot = PHOTON_MSG_STATS_ERROR_SLOTS - 1;\n"
+                    "    }\n"
+                    "    _PHOTON_MSG_STATS_ADD(stats->errors[slot], 1);\n"
+                    "}\n\n");
+
+    auto appendRecord = [this](bmcl::StringView name, bmcl::StringView prefix) {
+        _output->append("void PhotonMsgStats_Record");
+        _output->append(name);
+        _output->append("(size_t index, PhotonError rv, size_t size, uint64_t start)\n"
+                        "{\n"
+                        "    PhotonMsgStats* stats = &_photonMsgStats[index];\n");
+        if (_level >= 2) {
+            _output->append("    _PHOTON_MSG_STATS_ADD_CYCLES(stats->cycles, PHOTON_MSG_STATS_NOW() - start);\n");
+        } else {
+            _output->append("    (void)start;\n");
+        }
+        _output->append("    if (rv != PhotonError_Ok) {\n"
+                        "        recordError(stats, rv);\n"
+                        "        return;\n"
+                        "    }\n"
+                        "    _PHOTON_MSG_STATS_ADD(stats->");
+        _output->append(prefix);
+        _output->append("Count, 1);\n    _PHOTON_MSG_STATS_ADD(stats->");
+        _output->append(prefix);
+        _output->append("Bytes, (uint32_t)size);\n}\n\n");
+    };
+    appendRecord("Encode", "encoded");
+    appendRecord("Decode", "decoded");
+
+    _output->append("const PhotonMsgStats* PhotonMsgStats_Get(size_t index)\n"
+                    "{\n"
+                    "    if (index >= PHOTON_MSG_STATS_COUNT) {\n"
+                    "        return 0;\n"
+                    "    }\n"
+                    "    return &_photonMsgStats[index];\n"
+                    "}\n\n");
+
+    _output->append("void PhotonMsgStats_Reset(void)\n"
+                    "{\n"
+                    "    size_t i;\n"
+                    "    size_t j;\n"
+                    "    for (i = 0; i < PHOTON_MSG_STATS_COUNT; i++) {\n"
+                    "        PhotonMsgStats* stats = &_photonMsgStats[i];\n"
+                    "        _PHOTON_MSG_STATS_STORE(stats->encodedCount, 0);\n"
+                    "        _PHOTON_MSG_STATS_STORE(stats->encodedBytes, 0);\n"
+                    "        _PHOTON_MSG_STATS_STORE(stats->decodedCount, 0);\n"
+                    "        _PHOTON_MSG_STATS_STORE(stats->decodedBytes, 0);\n"
+                    "        for (j = 0; j < PHOTON_MSG_STATS_ERROR_SLOTS; j++) {\n"
+                    "            _PHOTON_MSG_STATS_STORE(stats->errors[j], 0);\n"
+                    "        }\n"
+                    "        _PHOTON_MSG_STATS_STORE_CYCLES(stats->cycles, 0);\n"
+                    "    }\n"
+                    "    _photonMsgStatsCursor = 0;\n"
+                    "}\n\n");
+
+    _output->append("static void writeEntry(PhotonWriter* dest, const PhotonMsgStats* stats)\n"
+                    "{\n"
+                    "    size_t j;\n"
+                    "    PhotonWriter_WriteU32Le(dest, _PHOTON_MSG_STATS_LOAD(stats->encodedCount));\n"
+                    "    PhotonWriter_WriteU32Le(dest, _PHOTON_MSG_STATS_LOAD(stats->encodedBytes));\n"
+                    "    PhotonWriter_WriteU32Le(dest, _PHOTON_MSG_STATS_LOAD(stats->decodedCount));\n"
+                    "    PhotonWriter_WriteU32Le(dest, _PHOTON_MSG_STATS_LOAD(stats->decodedBytes));\n"
+                    "    for (j = 0; j < PHOTON_MSG_STATS_ERROR_SLOTS; j++) {\n"
+                    "        PhotonWriter_WriteU32Le(dest, _PHOTON_MSG_STATS_LOAD(stats->errors[j]));\n"
+                    "    }\n"
+                    "    PhotonWriter_WriteU64Le(dest, _PHOTON_MSG_STATS_LOAD_CYCLES(stats->cycles));\n"
+                    "}\n\n");
+
+    if (_isSegmented) {
+        // segments are requested from the caller as needed, all entries starting from the cursor are written
+        _output->append("PhotonError PhotonMsgStats_Serialize(PhotonSegWriter* seg)\n"
+                        "{\n"
+                        "    PhotonWriter* dest = PhotonSegWriter_Writer(seg);\n"
+                        "    size_t count = PHOTON_MSG_STATS_COUNT - _photonMsgStatsCursor;\n"
+                        "    size_t i;\n"
+                        "    if (PhotonWriter_WritableSize(dest) < _PHOTON_MSG_STATS_HEADER_SIZE) {\n"
+                        "        PHOTON_TRY(PhotonSegWriter_Spill(seg, _PHOTON_MSG_STATS_HEADER_SIZE));\n"
+                        "    }\n"
+                        "    PhotonWriter_WriteU8(dest, PHOTON_MSG_STATS_COMP_NUM);\n"
+                        "    PhotonWriter_WriteU8(dest, PHOTON_MSG_STATS_MSG_NUM);\n"
+                        "    PhotonWriter_WriteU16Le(dest, (uint16_t)_photonMsgStatsCursor);\n"
+                        "    PhotonWriter_WriteU16Le(dest, (uint16_t)count);\n"
+                        "    for (i = 0; i < count; i++) {\n"
+                        "        if (PhotonWriter_WritableSize(dest) < _PHOTON_MSG_STATS_ENTRY_SIZE) {\n"
+                        "            PHOTON_TRY(PhotonSegWriter_Spill(seg, _PHOTON_MSG_STATS_ENTRY_SIZE));\n"
+                        "        }\n"
+                        "        writeEntry(dest, &_photonMsgStats[_photonMsgStatsCursor + i]);\n"
+                        "    }\n"
+                        "    _photonMsgStatsCursor = 0;\n"
+                        "    return PhotonError_Ok;\n"
+                        "}\n\n");
+        _output->append("#undef _PHOTON_FNAME\n");
+        return;
+    }
+
+    // the table may not fit into a single frame, each call writes as many entries as fit
+    // starting from the last written one
+    _output->append("PhotonError PhotonMsgStats_Serialize(PhotonWriter* dest)\n"
+                    "{\n"
+                    "    size_t count;\n"
+                    "    size_t i;\n"
+                    "    if (PhotonWriter_WritableSize(dest) < _PHOTON_MSG_STATS_HEADER_SIZE + _PHOTON_MSG_STATS_ENTRY_SIZE) {\n"
+                    "        PHOTON_DEBUG(\"Not enough space to serialize msg stats\");\n"
+                    "        return PhotonError_NotEnoughSpace;\n"
+                    "    }\n"
+                    "    count = (PhotonWriter_WritableSize(dest) - _PHOTON_MSG_STATS_HEADER_SIZE) / _PHOTON_MSG_STATS_ENTRY_SIZE;\n"
+                    "    if (count > PHOTON_MSG_STATS_COUNT - _photonMsgStatsCursor) {\n"
+                    "        count = PHOTON_MSG_STATS_COUNT - _photonMsgStatsCursor;\n"
+                    "    }\n"
+                    "    PhotonWriter_WriteU8(dest, PHOTON_MSG_STATS_COMP_NUM);\n"
+                    "    PhotonWriter_WriteU8(dest, PHOTON_MSG_STATS_MSG_NUM);\n"
+                    "    PhotonWriter_WriteU16Le(dest, (uint16_t)_photonMsgStatsCursor);\n"
+                    "    PhotonWriter_WriteU16Le(dest, (uint16_t)count);\n"
+                    "    for (i = 0; i < count; i++) {\n"
+                    "        writeEntry(dest, &_photonMsgStats[_photonMsgStatsCursor + i]);\n"
+                    "    }\n"
+                    "    _photonMsgStatsCursor += count;\n"
+                    "    if (_photonMsgStatsCursor >= PHOTON_MSG_STATS_COUNT) {\n"
+                    "        _photonMsgStatsCursor = 0;\n"
+                    "    }\n"
+                    "    return PhotonError_Ok;\n"
+                    "}\n\n");
+
+    _output->append("#undef _PHOTON_FNAME\n");
+}
+
+void MsgStatsGen::generateGcHeader(const Project* project)
+{
+    collectEntries(project);
+
+    _output->appendPragmaOnce();
+    _output->appendEol();
+    _output->append("#include <bmcl/MemReader.h>\n\n"
+                    "#include <array>\n"
+                    "#include <cstdint>\n"
+                    "#include <cstddef>\n\n");
+
+    _output->append("namespace photongen {\n\n"
+                    "class MsgStats {\n"
+                    "public:\n"
+                    "    static constexpr std::size_t compNum = ");
+    _output->appendNumericValue(MsgStatsFormat::compNum);
+    _output->append(";\n    static constexpr std::size_t msgNum = ");
+    _output->appendNumericValue(MsgStatsFormat::msgNum);
+    _output->append(";\n    static constexpr std::size_t errorSlots = ");
+    _output->appendNumericValue(MsgStatsFormat::errorSlots);
+    _output->append(";\n    static constexpr std::size_t entryCount = ");
+    _output->appendNumericValue(_entries.size());
+    _output->append(";\n\n"
+                    "    struct Entry {\n"
+                    "        const char* component;\n"
+                    "        const char* kind;\n"
+                    "        const char* name;\n"
+                    "        std::uint32_t encodedCount;\n"
+                    "        std::uint32_t encodedBytes;\n"
+                    "        std::uint32_t decodedCount;\n"
+                    "        std::uint32_t decodedBytes;\n"
+                    "        std::array<std::uint32_t, errorSlots> errors;\n"
+                    "        std::uint64_t cycles;\n"
+                    "    };\n\n");
+
+    _output->append("    MsgStats()\n"
+                    "    {\n"
+                    "        static const char* const names[");
+    _output->appendNumericValue(std::max<std::size_t>(_entries.size(), 1));
+    _output->append("][3] = {\n");
+    if (_entries.empty()) {
+        _output->append("            {nullptr, nullptr, nullptr},\n");
+    }
+    for (const MsgStatsFormat::Entry& entry : _entries) {
+        _output->append("            {\"");
+        _output->append(entry.comp->name());
+        _output->append("\", \"");
+        _output->append(bmcl::StringView(entry.kind));
+        _output->append("\", \"");
+        _output->append(entry.name);
+        _output->append("\"},\n");
+    }
+    _output->append("        };\n"
+                    "        for (std::size_t i = 0; i < entryCount; i++) {\n"
+                    "            Entry& entry = _entries[i];\n"
+                    "            entry = Entry();\n"
+                    "            entry.component = names[i][0];\n"
+                    "            entry.kind = names[i][1];\n"
+                    "            entry.name = names[i][2];\n"
+                    "        }\n"
+                    "    }\n\n");
+
+    _output->append("    const std::array<Entry, entryCount>& entries() const\n"
+                    "    {\n"
+                    "        return _entries;\n"
+                    "    }\n\n");
+
+    _output->append("    bool deserialize(bmcl::MemReader* src)\n"
+                    "    {\n"
+                    "        if (src->sizeLeft() < 4) {\n"
+                    "            return false;\n"
+                    "        }\n"
+                    "        std::size_t first = src->readUint16Le();\n"
+                    "        std::size_t count = src->readUint16Le();\n"
+                    "        if (first + count > entryCount || src->sizeLeft() < count * (16 + 4 * errorSlots + 8)) {\n"
+                    "            return false;\n"
+                    "        }\n"
+                    "        for (std::size_t i = first; i < first + count; i++) {\n"
+                    "            Entry& entry = _entries[i];\n"
+                    "            entry.encodedCount = src->readUint32Le();\n"
+                    "            entry.encodedBytes = src->readUint32Le();\n"
+                    "            entry.decodedCount = src->readUint32Le();\n"
+                    "            entry.decodedBytes = src->readUint32Le();\n"
+                    "            for (std::uint32_t& error : entry.errors) {\n"
+                    "                error = src->readUint32Le();\n"
+                    "            }\n"
+                    "            entry.cycles = src->readUint64Le();\n"
+                    "        }\n"
+                    "        return true;\n"
+                    "    }\n\n");
+
+    _output->append("private:\n"
+                    "    std::array<Entry, entryCount> _entries;\n"
+                    "};\n"
+                    "}\n");
+}
+}
@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "decode/Config.h"
+#include "decode/runtime/MsgStatsFormat.h"
+
+#include <bmcl/StringView.h>
+
+#include <vector>
+
+namespace decode {
+
+class SrcBuilder;
+class Project;
+class Component;
+class StatusMsg;
+class EventMsg;
+class Command;
+
+// per message counters and cycle timing of generated onboard coders
+class MsgStatsGen {
+public:
+    MsgStatsGen(SrcBuilder* output);
+    ~MsgStatsGen();
+
+    // 1 - counters, 2 - counters and cycles
+    void setLevel(unsigned level);
+    // counters are updated with C11 atomics, required when messages are recorded from several contexts
+    void setAtomicCounters(bool useAtomics);
+    // stats message is written into the segment chain of the status table caller
+    void setSegmentedWriter(bool isSegmented);
+
+    void generateHeader(const Project* project);
+    void generateSource(const Project* project);
+    void generateGcHeader(const Project* project);
+
+    static void appendIndexName(const Component* comp, const StatusMsg* msg, SrcBuilder* dest);
+    static void appendIndexName(const Component* comp, const EventMsg* msg, SrcBuilder* dest);
+    static void appendIndexName(const Component* comp, const Command* cmd, SrcBuilder* dest);
+
+private:
+    static void appendIndexName(const Component* comp, const char* kind, bmcl::StringView name, SrcBuilder* dest);
+    void collectEntries(const Project* project);
+
+    SrcBuilder* _output;
+    std::vector<MsgStatsFormat::Entry> _entries;
+    unsigned _level;
+    bool _useAtomics;
+    bool _isSegmented;
+};
+}
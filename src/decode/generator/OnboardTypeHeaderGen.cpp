@@ -15,6 +15,7 @@
 #include "decode/ast/AstVisitor.h"
 #include "decode/generator/TypeNameGen.h"
 #include "decode/generator/IncludeGen.h"
+#include "decode/generator/Utils.h"
 
 #include <bmcl/Logging.h>
 
@@ -26,6 +27,10 @@ OnboardTypeHeaderGen::OnboardTypeHeaderGen(SrcBuilder* output)
     : _output(output)
     , _typeDefGen(output)
     , _prototypeGen(output)
+    , _cfg(nullptr)
+    , _useSeqlock(false)
+    , _useAutosaveJournal(false)
+    , _useSegmentedWriter(false)
 {
 }
 
@@ -33,6 +38,32 @@ OnboardTypeHeaderGen::~OnboardTypeHeaderGen()
 {
 }
 
+void OnboardTypeHeaderGen::setSeqlockVars(bool useSeqlock)
+{
+    _useSeqlock = useSeqlock;
+}
+
+void OnboardTypeHeaderGen::setAutosaveJournal(bool useJournal)
+{
+    _useAutosaveJournal = useJournal;
+}
+
+void OnboardTypeHeaderGen::setSegmentedWriter(bool isSegmented)
+{
+    _useSegmentedWriter = isSegmented;
+    _prototypeGen.setSegmentedWriter(isSegmented);
+}
+
+void OnboardTypeHeaderGen::setConfiguration(const Configuration* cfg)
+{
+    _cfg = cfg;
+}
+
+bool OnboardTypeHeaderGen::hasCmd(const Command* cmd) const
+{
+    return _cfg == nullptr || cmd->matchesConfiguration(_cfg);
+}
+
 void OnboardTypeHeaderGen::genTypeHeader(const Ast* ast, const TopLevelType* type, bmcl::StringView name)
 {
     switch (type->typeKind()) {
@@ -136,6 +167,11 @@ void OnboardTypeHeaderGen::genComponentHeader(const Ast* ast, const Component* c
     _typeDefGen.genComponentDef(comp);
 
     appendImplBlockIncludes(comp);
+    bool hasJournal = _useAutosaveJournal && !comp->savedVarsRange().isEmpty();
+    if (comp->hasVars() && (_useSeqlock || hasJournal)) {
+        _output->append("#include <stdatomic.h>\n");
+        _output->append("#include <string.h>\n\n");
+    }
     _output->startCppGuard();
 
     if (comp->hasVars()) {
@@ -144,6 +180,15 @@ void OnboardTypeHeaderGen::genComponentHeader(const Ast* ast, const Component* c
         _output->append(" _photon");
         _output->appendWithFirstUpper(comp->moduleName());
         _output->append(";\n\n");
+        if (_useSeqlock) {
+            appendSeqlockFuncs(comp);
+        }
+        if (hasJournal) {
+            appendSavedVarDirtyFuncs(comp);
+        }
+        if (_useSeqlock || hasJournal) {
+            appendVarSetters(comp);
+        }
     }
 
     _output->append("/**********************************IMPLEMENT***********************************/\n\n");
@@ -167,6 +212,148 @@ void OnboardTypeHeaderGen::genComponentHeader(const Ast* ast, const Component* c
     endIncludeGuard();
 }
 
+void OnboardTypeHeaderGen::appendSeqlockFuncs(const Component* comp)
+{
+    SrcBuilder seqName("_photon");
+    seqName.appendWithFirstUpper(comp->moduleName());
+    seqName.append("Seq");
+
+    _output->append("/*seqlock*/\nextern atomic_uint ");
+    _output->append(seqName.view());
+    _output->append(";\n\n");
+
+    _output->append("static inline void Photon");
+    _output->appendWithFirstUpper(comp->moduleName());
+    _output->append("_BeginWrite(void)\n{\n"
+                    "    unsigned seq = atomic_load_explicit(&");
+    _output->append(seqName.view());
+    _output->append(", memory_order_relaxed);\n"
+                    "    atomic_store_explicit(&");
+    _output->append(seqName.view());
+    _output->append(", seq + 1, memory_order_relaxed);\n"
+                    "    atomic_thread_fence(memory_order_release);\n}\n\n");
+
+    _output->append("static inline void Photon");
+    _output->appendWithFirstUpper(comp->moduleName());
+    _output->append("_EndWrite(void)\n{\n"
+                    "    unsigned seq = atomic_load_explicit(&");
+    _output->append(seqName.view());
+    _output->append(", memory_order_relaxed);\n"
+                    "    atomic_store_explicit(&");
+    _output->append(seqName.view());
+    _output->append(", seq + 1, memory_order_release);\n}\n\n");
+
+    _output->append("static inline unsigned Photon");
+    _output->appendWithFirstUpper(comp->moduleName());
+    _output->append("_BeginRead(void)\n{\n"
+                    "    return atomic_load_explicit(&");
+    _output->append(seqName.view());
+    _output->append(", memory_order_acquire);\n}\n\n");
+
+    _output->append("static inline int Photon");
+    _output->appendWithFirstUpper(comp->moduleName());
+    _output->append("_EndRead(unsigned seq)\n{\n"
+                    "    atomic_thread_fence(memory_order_acquire);\n"
+                    "    return (seq & 1) == 0 && atomic_load_explicit(&");
+    _output->append(seqName.view());
+    _output->append(", memory_order_relaxed) == seq;\n}\n\n");
+}
+
+void OnboardTypeHeaderGen::appendVarSetters(const Component* comp)
+{
+    TypeReprGen reprGen(_output);
+    StringBuilder argName;
+    argName.reserve(31);
+    _output->append("/*var setters*/\n");
+    for (const Field* field : comp->varsRange()) {
+        std::vector<std::size_t> savedIndices;
+        if (_useAutosaveJournal) {
+            std::size_t i = 0;
+            for (const VarRegexp* regexp : comp->savedVarsRange()) {
+                bmcl::OptionPtr<const Field> root = regexp->rootField();
+                if (root.isSome() && root.unwrap() == field) {
+                    savedIndices.push_back(i);
+                }
+                i++;
+            }
+        }
+        if (!_useSeqlock && savedIndices.empty()) {
+            continue;
+        }
+        Rc<const Type> type = wrapPassedTypeIntoPointerIfRequired(const_cast<Type*>(field->type())); //HACK
+        _output->append("static inline void Photon");
+        _output->appendWithFirstUpper(comp->moduleName());
+        _output->append("_SetVar_");
+        _output->appendWithFirstUpper(field->name());
+        _output->append("(");
+        reprGen.genOnboardTypeRepr(type.get(), field->name());
+        _output->append(")\n{\n");
+        if (_useSeqlock) {
+            _output->append("    Photon");
+            _output->appendWithFirstUpper(comp->moduleName());
+            _output->append("_BeginWrite();\n");
+        }
+        if (field->type()->resolveFinalType()->isArray()) {
+            _output->append("    memcpy(_photon");
+            _output->appendWithFirstUpper(comp->moduleName());
+            _output->append(".");
+            _output->append(field->name());
+            _output->append(", ");
+            _output->append(field->name());
+            _output->append(", sizeof(_photon");
+            _output->appendWithFirstUpper(comp->moduleName());
+            _output->append(".");
+            _output->append(field->name());
+            _output->append("));\n");
+        } else {
+            derefPassedVarNameIfRequired(field->type(), field->name(), &argName);
+            _output->append("    _photon");
+            _output->appendWithFirstUpper(comp->moduleName());
+            _output->append(".");
+            _output->append(field->name());
+            _output->append(" = ");
+            _output->append(argName.view());
+            _output->append(";\n");
+            argName.clear();
+        }
+        if (_useSeqlock) {
+            _output->append("    Photon");
+            _output->appendWithFirstUpper(comp->moduleName());
+            _output->append("_EndWrite();\n");
+        }
+        for (std::size_t i : savedIndices) {
+            _output->append("    Photon");
+            _output->appendWithFirstUpper(comp->moduleName());
+            _output->append("_MarkSavedVarDirty(");
+            _output->appendNumericValue(i);
+            _output->append(");\n");
+        }
+        _output->append("}\n\n");
+    }
+}
+
+void OnboardTypeHeaderGen::appendSavedVarDirtyFuncs(const Component* comp)
+{
+    SrcBuilder countName("PHOTON_");
+    countName.appendUpper(comp->name());
+    countName.append("_SAVED_VAR_COUNT");
+
+    _output->append("/*autosave*/\n");
+    _output->appendNumericValueDefine(comp->savedVarsRange().size(), countName.view());
+    _output->append("\nextern atomic_uchar _photon");
+    _output->appendWithFirstUpper(comp->moduleName());
+    _output->append("Dirty[(");
+    _output->append(countName.view());
+    _output->append(" + 7) / 8];\n\n");
+
+    _output->append("static inline void Photon");
+    _output->appendWithFirstUpper(comp->moduleName());
+    _output->append("_MarkSavedVarDirty(unsigned idx)\n{\n"
+                    "    atomic_fetch_or_explicit(&_photon");
+    _output->appendWithFirstUpper(comp->moduleName());
+    _output->append("Dirty[idx >> 3], (unsigned char)(1u << (idx & 7)), memory_order_relaxed);\n}\n\n");
+}
+
 void OnboardTypeHeaderGen::appendStatusStructs(const Component* comp)
 {
     TypeReprGen reprGen(_output);
@@ -275,20 +462,25 @@ void OnboardTypeHeaderGen::endIncludeGuard()
     _output->endIncludeGuard();
 }
 
-void OnboardTypeHeaderGen::appendImplBlockIncludes(const DynArrayType* dynArray)
+void OnboardTypeHeaderGen::appendSerializerIncludePaths()
 {
     _output->appendOnboardIncludePath("core/Reader");
     _output->appendOnboardIncludePath("core/Writer");
     _output->appendOnboardIncludePath("core/Error");
+    if (_useSegmentedWriter) {
+        _output->appendOnboardIncludePath("SegWriter");
+    }
     _output->appendEol();
 }
 
+void OnboardTypeHeaderGen::appendImplBlockIncludes(const DynArrayType* dynArray)
+{
+    appendSerializerIncludePaths();
+}
+
 void OnboardTypeHeaderGen::appendImplBlockIncludes(const Component* comp)
 {
-    _output->appendOnboardIncludePath("core/Reader");
-    _output->appendOnboardIncludePath("core/Writer");
-    _output->appendOnboardIncludePath("core/Error");
-    _output->appendEol();
+    appendSerializerIncludePaths();
 
     TypeDependsCollector::Depends dest;
     for (const Command* cmd : comp->cmdsRange()) {
@@ -311,10 +503,7 @@ void OnboardTypeHeaderGen::appendImplBlockIncludes(const Component* comp)
 
 void OnboardTypeHeaderGen::appendImplBlockIncludes(const TopLevelType* topLevelType, bmcl::StringView name)
 {
-    _output->appendOnboardIncludePath("core/Reader");
-    _output->appendOnboardIncludePath("core/Writer");
-    _output->appendOnboardIncludePath("core/Error");
-    _output->appendEol();
+    appendSerializerIncludePaths();
 
     bmcl::OptionPtr<const ImplBlock> impl = _ast->findImplBlock(topLevelType);
     TypeDependsCollector::Depends dest;
@@ -404,6 +593,9 @@ void OnboardTypeHeaderGen::appendCmdDecoderPrototypes(const Component* comp)
 {
     _output->append("/*cmd decoders*/\n");
     for (const Command* cmd : comp->cmdsRange()) {
+        if (!hasCmd(cmd)) {
+            continue;
+        }
         _prototypeGen.appendCmdDecoderFunctionPrototype(comp, cmd);
         _output->append(";\n");
     }
@@ -503,6 +695,9 @@ void OnboardTypeHeaderGen::appendCommandPrototypes(const Component* comp)
     _output->append("/*cmd handlers*/\n");
     TypeReprGen reprGen(_output);
     for (const Command* cmd : comp->cmdsRange()) {
+        if (!hasCmd(cmd)) {
+            continue;
+        }
         _prototypeGen.appendCmdHandlerFunctionProrotype(comp, cmd, &reprGen);
         _output->append(";\n");
     }
@@ -514,6 +709,9 @@ void OnboardTypeHeaderGen::appendCommandArgAllocators(const Component* comp)
     _output->append("/*cmd arg allocators*/\n");
     TypeReprGen reprGen(_output);
     for (const Command* cmd : comp->cmdsRange()) {
+        if (!hasCmd(cmd)) {
+            continue;
+        }
         for (const CmdArgument& arg : cmd->argumentsRange()) {
             if (arg.argPassKind() == CmdArgPassKind::AllocPtr) {
                 _prototypeGen.appendCmdArgAllocFunctionPrototype(comp, cmd, arg, &reprGen);
@@ -22,6 +22,8 @@ namespace decode {
 class Component;
 class FunctionType;
 class Function;
+class Command;
+class Configuration;
 
 class OnboardTypeHeaderGen {
 public:
@@ -35,7 +37,14 @@ public:
     void startIncludeGuard(bmcl::StringView modName, bmcl::StringView typeName);
     void endIncludeGuard();
 
+    void setSeqlockVars(bool useSeqlock);
+    void setAutosaveJournal(bool useJournal);
+    void setSegmentedWriter(bool isSegmented);
+    void setConfiguration(const Configuration* cfg);
+
 private:
+    bool hasCmd(const Command* cmd) const;
+
     void appendSerializerFuncPrototypes(const Type* type);
     void appendSerializerFuncPrototypes(const Component* comp);
 
@@ -52,6 +61,7 @@ private:
     void appendIncludesAndFwds(const Type* topLevelType);
     void appendIncludesAndFwds(const Component* comp);
     void appendCommonIncludePaths();
+    void appendSerializerIncludePaths();
 
     void appendStatusStructs(const Component* comp);
     void appendEventStructs(const Component* comp);
@@ -75,6 +85,9 @@ private:
     void appendEventSenderPrototypes(const Component* comp);
     void appendEventDecoderPrototypes(const Component* comp);
     void appendEventMinMaxSizeFuncs(const Component* comp);
+    void appendSeqlockFuncs(const Component* comp);
+    void appendVarSetters(const Component* comp);
+    void appendSavedVarDirtyFuncs(const Component* comp);
     void appendFunctionPrototypes(RcVec<Function>::ConstRange funcs, bmcl::StringView typeName);
 
     template <typename T>
@@ -86,5 +99,9 @@ private:
     TypeDefGen _typeDefGen;
     SrcBuilder _dynArrayName;
     FuncPrototypeGen _prototypeGen;
+    const Configuration* _cfg;
+    bool _useSeqlock;
+    bool _useAutosaveJournal;
+    bool _useSegmentedWriter;
 };
 }
@@ -28,6 +28,12 @@ OnboardTypeSourceGen::~OnboardTypeSourceGen()
 {
 }
 
+void OnboardTypeSourceGen::setSegmentedWriter(bool isSegmented)
+{
+    _inlineInspector.setSegmentedWriter(isSegmented);
+    _prototypeGen.setSegmentedWriter(isSegmented);
+}
+
 void OnboardTypeSourceGen::appendIncludes(bmcl::StringView modName)
 {
     StringBuilder path(modName.toStdString());
@@ -56,7 +62,9 @@ void OnboardTypeSourceGen::appendEnumSerializer(const EnumType* type)
                     "    default:\n"
                     "        PHOTON_CRITICAL(\"Failed to serialize enum\");\n"
                     "        return PhotonError_InvalidValue;\n"
-                    "    }\n    ");
+                    "    }\n");
+    _inlineInspector.appendVarSizeCheck<true, true>(InlineSerContext(), _output);
+    _output->appendIndent();
     _output->appendWithTryMacro([](SrcBuilder* output) {
         output->append("PhotonWriter_WriteVarint(dest, (int64_t)self)");
     }, "Failed to write enum");
@@ -110,6 +118,7 @@ void OnboardTypeSourceGen::appendStructDeserializer(const StructType* type)
 
 void OnboardTypeSourceGen::appendVariantSerializer(const VariantType* type)
 {
+    _inlineInspector.appendVarSizeCheck<true, true>(InlineSerContext(), _output);
     _output->appendIndent(1);
     _output->appendWithTryMacro([](SrcBuilder* output) {
         output->append("PhotonWriter_WriteVarint(dest, (int64_t)self->type)");
@@ -234,18 +243,20 @@ void OnboardTypeSourceGen::appendDynArraySerializer(const DynArrayType* type)
     _output->append("    if (self->size > ");
     _output->appendNumericValue(type->maxSize());
     _output->append(") {\n        PHOTON_CRITICAL(\"Failed to serialize dynarray\");\n"
-                    "        return PhotonError_InvalidValue;\n    }\n"
-                    "    ");
+                    "        return PhotonError_InvalidValue;\n    }\n");
+    _inlineInspector.appendVarSizeCheck<true, true>(ctx, _output);
+    _output->appendIndent(ctx);
     _output->appendWithTryMacro([](SrcBuilder* output) {
         output->append("PhotonWriter_WriteVaruint(dest, self->size)");
     }, "Failed to write dynarray size");
     auto size = typeFixedSize(type->elementType());
-    if (size.isSome()) {
+    bool checkElementSizes = size.isNone() || _inlineInspector.isSegmentedWriter();
+    if (!checkElementSizes) {
         _inlineInspector.appendSizeCheck<true, true>(ctx, "self->size * " + std::to_string(size.unwrap()), _output);
     }
     _output->appendLoopHeader(ctx, "self->size");
     InlineSerContext lctx = ctx.indent();
-    _inlineInspector.inspect<true, true>(type->elementType(), lctx, "self->data[a]", size.isNone());
+    _inlineInspector.inspect<true, true>(type->elementType(), lctx, "self->data[a]", checkElementSizes);
     _output->append("    }\n");
 }
 
@@ -282,6 +293,9 @@ void OnboardTypeSourceGen::genSource(const T* type, F&& serGen, F&& deserGen)
     _output->appendEol();
     _prototypeGen.appendTypeSerializerFunctionPrototype(_baseType);
     _output->append("\n{\n");
+    if (_inlineInspector.isSegmentedWriter()) {
+        _output->appendSegWriterDest();
+    }
     (this->*serGen)(type);
     _output->append("    return PhotonError_Ok;\n}\n");
     _output->appendEol();
@@ -309,6 +323,9 @@ bool OnboardTypeSourceGen::visitDynArrayType(const DynArrayType* type)
     _output->append(".gen.c\"\n\n");
     _prototypeGen.appendTypeSerializerFunctionPrototype(type);
     _output->append("\n{\n");
+    if (_inlineInspector.isSegmentedWriter()) {
+        _output->appendSegWriterDest();
+    }
     appendDynArraySerializer(type);
     _output->append("    return PhotonError_Ok;\n}\n");
     _output->appendEol();
@@ -33,6 +33,8 @@ public:
     OnboardTypeSourceGen(SrcBuilder* output);
     ~OnboardTypeSourceGen();
 
+    void setSegmentedWriter(bool isSegmented);
+
     void genTypeSource(const NamedType* type, bmcl::StringView name);
     void genTypeSource(const GenericInstantiationType* type, bmcl::StringView name);
     void genTypeSource(const DynArrayType* type);
@@ -0,0 +1,514 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "decode/generator/ParamTableGen.h"
+#include "decode/generator/SrcBuilder.h"
+#include "decode/generator/TypeReprGen.h"
+#include "decode/generator/InlineTypeInspector.h"
+#include "decode/core/RangeAttr.h"
+#include "decode/parser/Project.h"
+#include "decode/parser/Package.h"
+#include "decode/ast/Component.h"
+#include "decode/ast/Field.h"
+#include "decode/ast/Type.h"
+
+#include <bmcl/StringView.h>
+
+#include <algorithm>
+
+namespace decode {
+
+struct ParamTypeInfo {
+    BuiltinTypeKind kind;
+    const char* tag;
+    const char* repr;
+    const char* suffix;
+    const char* size;
+};
+
+static const ParamTypeInfo paramTypes[] = {
+    {BuiltinTypeKind::USize,   "USize",   "size_t",    "USizeLe", "sizeof(void*)"},
+    {BuiltinTypeKind::ISize,   "ISize",   "ptrdiff_t", "USizeLe", "sizeof(void*)"},
+    {BuiltinTypeKind::Varuint, "Varuint", "uint64_t",  "Varuint", nullptr},
+    {BuiltinTypeKind::Varint,  "Varint",  "int64_t",   "Varint",  nullptr},
+    {BuiltinTypeKind::U8,      "U8",      "uint8_t",   "U8",      "sizeof(uint8_t)"},
+    {BuiltinTypeKind::I8,      "I8",      "int8_t",    "U8",      "sizeof(uint8_t)"},
+    {BuiltinTypeKind::U16,     "U16",     "uint16_t",  "U16Le",   "sizeof(uint16_t)"},
+    {BuiltinTypeKind::I16,     "I16",     "int16_t",   "U16Le",   "sizeof(uint16_t)"},
+    {BuiltinTypeKind::U32,     "U32",     "uint32_t",  "U32Le",   "sizeof(uint32_t)"},
+    {BuiltinTypeKind::I32,     "I32",     "int32_t",   "U32Le",   "sizeof(uint32_t)"},
+    {BuiltinTypeKind::U64,     "U64",     "uint64_t",  "U64Le",   "sizeof(uint64_t)"},
+    {BuiltinTypeKind::I64,     "I64",     "int64_t",   "U64Le",   "sizeof(uint64_t)"},
+    {BuiltinTypeKind::F32,     "F32",     "float",     "F32Le",   "sizeof(float)"},
+    {BuiltinTypeKind::F64,     "F64",     "double",    "F64Le",   "sizeof(double)"},
+    {BuiltinTypeKind::Bool,    "Bool",    "bool",      "U8",      "sizeof(uint8_t)"},
+    {BuiltinTypeKind::Char,    "Char",    "char",      "Char",    "sizeof(char)"},
+};
+
+static const ParamTypeInfo* findParamType(BuiltinTypeKind kind)
+{
+    for (const ParamTypeInfo& info : paramTypes) {
+        if (info.kind == kind) {
+            return &info;
+        }
+    }
+    return nullptr;
+}
+
+static bool appendRangeValue(SrcBuilder* dest, const NumberVariant& value)
+{
+    switch (value.kind()) {
+    case NumberVariantKind::None:
+        dest->append("0");
+        return false;
+    case NumberVariantKind::Signed:
+        dest->appendNumericValue(double(value.as<std::intmax_t>()));
+        return true;
+    case NumberVariantKind::Unsigned:
+        dest->appendNumericValue(double(value.as<std::uintmax_t>()));
+        return true;
+    case NumberVariantKind::Double:
+        dest->appendNumericValue(value.as<double>());
+        return true;
+    }
+    return false;
+}
+
+ParamTableGen::ParamTableGen(SrcBuilder* output)
+    : _output(output)
+    , _useSeqlock(false)
+    , _useAutosaveJournal(false)
+{
+}
+
+ParamTableGen::~ParamTableGen()
+{
+}
+
+void ParamTableGen::setSeqlockVars(bool useSeqlock)
+{
+    _useSeqlock = useSeqlock;
+}
+
+void ParamTableGen::setAutosaveJournal(bool useJournal)
+{
+    _useAutosaveJournal = useJournal;
+}
+
+void ParamTableGen::collectParams(const Project* project)
+{
+    _params.clear();
+    for (const Component* comp : project->package()->components()) {
+        for (const Parameter* param : comp->paramsRange()) {
+            _params.push_back(Entry{comp, param});
+        }
+    }
+    std::sort(_params.begin(), _params.end(), [](const Entry& left, const Entry& right) {
+        return left.param->number() < right.param->number();
+    });
+}
+
+void ParamTableGen::appendParamPath(const Parameter* param)
+{
+    for (const FieldAccessor* acc : param->pathPartsRange()) {
+        _output->append('.');
+        _output->append(acc->field()->name());
+    }
+}
+
+void ParamTableGen::generateHeader(const Project* project)
+{
+    collectParams(project);
+
+    _output->startIncludeGuard("PRIVATE", "PARAM_TABLE");
+
+    _output->appendOnboardIncludePath("core/Error");
+    _output->appendOnboardIncludePath("core/Reader");
+    _output->appendOnboardIncludePath("core/Writer");
+    _output->appendEol();
+
+    _output->appendNumericValueDefine(_params.size(), "PHOTON_PARAM_COUNT");
+    _output->appendEol();
+    for (const Entry& entry : _params) {
+        _output->append("#define PHOTON_");
+        _output->appendUpper(entry.comp->name());
+        _output->append("_PARAM_");
+        _output->appendUpper(entry.param->name());
+        _output->append(' ');
+        _output->appendNumericValue(entry.param->number());
+        _output->appendEol();
+    }
+    _output->appendEol();
+
+    _output->append("#define PHOTON_PARAM_HAS_MIN 1\n"
+                    "#define PHOTON_PARAM_HAS_MAX 2\n"
+                    "#define PHOTON_PARAM_READ_ONLY 4\n\n");
+
+    _output->startCppGuard();
+
+    _output->append("typedef enum {\n");
+    for (const ParamTypeInfo& info : paramTypes) {
+        _output->append("    PhotonParamType_");
+        _output->append(bmcl::StringView(info.tag));
+        _output->append(",\n");
+    }
+    _output->append("} PhotonParamType;\n\n");
+
+    _output->append("typedef struct {\n"
+                    "    void* ptr;\n"
+                    "    double min;\n"
+                    "    double max;\n"
+                    "    uint8_t type;\n"
+                    "    uint8_t flags;\n"
+                    "} PhotonParamDesc;\n\n");
+
+    _output->append("const PhotonParamDesc* Photon_ParamDesc(uint64_t num);\n");
+    _output->append("PhotonError Photon_GetParams(PhotonReader* src, PhotonWriter* dest);\n");
+    _output->append("PhotonError Photon_SetParams(PhotonReader* src);\n\n");
+
+    _output->endCppGuard();
+
+    _output->endIncludeGuard();
+}
+
+void ParamTableGen::appendTableEntry(const Entry& entry)
+{
+    const Parameter* param = entry.param;
+    const ParamTypeInfo* info = findParamType(param->type()->builtinTypeKind());
+    assert(info);
+
+    _output->appendModIfdef(entry.comp->moduleName());
+    _output->append("    {&_photon");
+    _output->appendWithFirstUpper(entry.comp->moduleName());
+    appendParamPath(param);
+    _output->append(", ");
+
+    const FieldAccessor* last = *(param->pathPartsRange().end() - 1);
+    bmcl::OptionPtr<const RangeAttr> range = last->field()->rangeAttribute();
+    bool hasMin = false;
+    bool hasMax = false;
+    if (range.isSome()) {
+        hasMin = appendRangeValue(_output, range->minValue());
+        _output->append(", ");
+        hasMax = appendRangeValue(_output, range->maxValue());
+    } else {
+        _output->append("0, 0");
+    }
+
+    _output->append(", PhotonParamType_");
+    _output->append(bmcl::StringView(info->tag));
+    _output->append(", ");
+    unsigned flags = (hasMin ? 1 : 0) | (hasMax ? 2 : 0) | (param->isReadOnly() ? 4 : 0);
+    _output->appendNumericValue(flags);
+    _output->append("},\n#else\n    {0, 0, 0, 0, 0},\n");
+    _output->appendEndif();
+}
+
+void ParamTableGen::appendStoreParam()
+{
+    _output->append("static void storeParam(const PhotonParamDesc* desc, const void* value, size_t size)\n"
+                    "{\n"
+                    "    switch (desc - _photonParamTable) {\n");
+    for (std::size_t i = 0; i < _params.size(); i++) {
+        const Component* comp = _params[i].comp;
+        const Field* root = (*_params[i].param->pathPartsRange().begin())->field();
+        std::vector<std::size_t> savedIndices;
+        if (_useAutosaveJournal) {
+            std::size_t index = 0;
+            for (const VarRegexp* regexp : comp->savedVarsRange()) {
+                bmcl::OptionPtr<const Field> savedRoot = regexp->rootField();
+                if (savedRoot.isSome() && savedRoot.unwrap() == root) {
+                    savedIndices.push_back(index);
+                }
+                index++;
+            }
+        }
+        if (!_useSeqlock && savedIndices.empty()) {
+            continue;
+        }
+        _output->appendModIfdef(comp->moduleName());
+        _output->append("    case ");
+        _output->appendNumericValue(i);
+        _output->append(":\n");
+        if (_useSeqlock) {
+            _output->append("        Photon");
+            _output->appendWithFirstUpper(comp->moduleName());
+            _output->append("_BeginWrite();\n");
+        }
+        _output->append("        memcpy(desc->ptr, value, size);\n");
+        if (_useSeqlock) {
+            _output->append("        Photon");
+            _output->appendWithFirstUpper(comp->moduleName());
+            _output->append("_EndWrite();\n");
+        }
+        for (std::size_t index : savedIndices) {
+            _output->append("        Photon");
+            _output->appendWithFirstUpper(comp->moduleName());
+            _output->append("_MarkSavedVarDirty(");
+            _output->appendNumericValue(index);
+            _output->append(");\n");
+        }
+        _output->append("        return;\n");
+        _output->appendEndif();
+    }
+    _output->append("    }\n"
+                    "    memcpy(desc->ptr, value, size);\n"
+                    "}\n\n");
+}
+
+void ParamTableGen::generateSource(const Project* project)
+{
+    collectParams(project);
+
+    _output->append("#include \"photongen/onboard/ParamTable.h\"\n\n");
+    for (const Component* comp : project->package()->components()) {
+        if (!comp->hasParams()) {
+            continue;
+        }
+        _output->appendModIfdef(comp->moduleName());
+        _output->appendOnboardComponentInclude(comp->moduleName(), ".h");
+        _output->appendEndif();
+    }
+    _output->appendImplIncludePath("core/Try");
+    _output->appendImplIncludePath("core/Logging");
+    _output->appendEol();
+    bool hasStore = _useSeqlock || _useAutosaveJournal;
+    if (hasStore) {
+        _output->append("#include <string.h>\n\n");
+    }
+
+    _output->append("#define _PHOTON_FNAME \"photongen/onboard/ParamTable.c\"\n\n");
+
+    if (_params.empty()) {
+        _output->append("static const PhotonParamDesc _photonParamTable[1] = {{0, 0, 0, 0, 0}};\n\n");
+    } else {
+        _output->append("static const PhotonParamDesc _photonParamTable[PHOTON_PARAM_COUNT] = {\n");
+        for (const Entry& entry : _params) {
+            appendTableEntry(entry);
+        }
+        _output->append("};\n\n");
+    }
+
+    _output->append("const PhotonParamDesc* Photon_ParamDesc(uint64_t num)\n"
+                    "{\n"
+                    "    if (num >= PHOTON_PARAM_COUNT || !_photonParamTable[num].ptr) {\n"
+                    "        return 0;\n"
+                    "    }\n"
+                    "    return &_photonParamTable[num];\n"
+                    "}\n\n");
+
+    if (hasStore) {
+        appendStoreParam();
+    }
+
+    _output->append("static PhotonError checkParamRange(const PhotonParamDesc* desc, double value)\n"
+                    "{\n"
+                    "    if ((desc->flags & PHOTON_PARAM_HAS_MIN) && value < desc->min) {\n"
+                    "        PHOTON_DEBUG(\"Param value is less than min\");\n"
+                    "        return PhotonError_InvalidValue;\n"
+                    "    }\n"
+                    "    if ((desc->flags & PHOTON_PARAM_HAS_MAX) && value > desc->max) {\n"
+                    "        PHOTON_DEBUG(\"Param value is greater than max\");\n"
+                    "        return PhotonError_InvalidValue;\n"
+                    "    }\n"
+                    "    return PhotonError_Ok;\n"
+                    "}\n\n");
+
+    _output->append("static PhotonError writeParam(const PhotonParamDesc* desc, PhotonWriter* dest)\n"
+                    "{\n"
+                    "    switch (desc->type) {\n");
+    for (const ParamTypeInfo& info : paramTypes) {
+        _output->append("    case PhotonParamType_");
+        _output->append(bmcl::StringView(info.tag));
+        _output->append(":\n");
+        if (info.size) {
+            _output->append("        if (PhotonWriter_WritableSize(dest) < ");
+            _output->append(bmcl::StringView(info.size));
+            _output->append(") {\n"
+                            "            PHOTON_DEBUG(\"Not enough space to serialize param\");\n"
+                            "            return PhotonError_NotEnoughSpace;\n"
+                            "        }\n"
+                            "        PhotonWriter_Write");
+            _output->append(bmcl::StringView(info.suffix));
+            _output->append("(dest, *(const ");
+            _output->append(bmcl::StringView(info.repr));
+            _output->append("*)desc->ptr);\n"
+                            "        return PhotonError_Ok;\n");
+        } else {
+            _output->append("        return PhotonWriter_Write");
+            _output->append(bmcl::StringView(info.suffix));
+            _output->append("(dest, *(const ");
+            _output->append(bmcl::StringView(info.repr));
+            _output->append("*)desc->ptr);\n");
+        }
+    }
+    _output->append("    }\n"
+                    "    return PhotonError_InvalidValue;\n"
+                    "}\n\n");
+
+    _output->append("static PhotonError readParam(const PhotonParamDesc* desc, PhotonReader* src, int apply)\n"
+                    "{\n"
+                    "    switch (desc->type) {\n");
+    for (const ParamTypeInfo& info : paramTypes) {
+        _output->append("    case PhotonParamType_");
+        _output->append(bmcl::StringView(info.tag));
+        _output->append(": {\n        ");
+        _output->append(bmcl::StringView(info.repr));
+        _output->append(" value;\n");
+        if (info.size) {
+            _output->append("        if (PhotonReader_ReadableSize(src) < ");
+            _output->append(bmcl::StringView(info.size));
+            _output->append(") {\n"
+                            "            PHOTON_DEBUG(\"Not enough data to deserialize param\");\n"
+                            "            return PhotonError_NotEnoughData;\n"
+                            "        }\n"
+                            "        value = PhotonReader_Read");
+            _output->append(bmcl::StringView(info.suffix));
+            _output->append("(src);\n");
+        } else {
+            _output->append("        PHOTON_TRY(PhotonReader_Read");
+            _output->append(bmcl::StringView(info.suffix));
+            _output->append("(src, &value));\n");
+        }
+        _output->append("        PHOTON_TRY(checkParamRange(desc, (double)value));\n"
+                        "        if (apply) {\n");
+        if (hasStore) {
+            _output->append("            storeParam(desc, &value, sizeof(value));\n");
+        } else {
+            _output->append("            *(");
+            _output->append(bmcl::StringView(info.repr));
+            _output->append("*)desc->ptr = value;\n");
+        }
+        _output->append("        }\n"
+                        "        return PhotonError_Ok;\n"
+                        "    }\n");
+    }
+    _output->append("    }\n"
+                    "    return PhotonError_InvalidValue;\n"
+                    "}\n\n");
+
+    _output->append("PhotonError Photon_GetParams(PhotonReader* src, PhotonWriter* dest)\n"
+                    "{\n"
+                    "    uint64_t count;\n"
+                    "    uint64_t i;\n"
+                    "    PHOTON_TRY_MSG(PhotonReader_ReadVaruint(src, &count), \"Failed to read param count\");\n"
+                    "    PHOTON_TRY_MSG(PhotonWriter_WriteVaruint(dest, count), \"Failed to write param count\");\n"
+                    "    for (i = 0; i < count; i++) {\n"
+                    "        uint64_t num;\n"
+                    "        const PhotonParamDesc* desc;\n"
+                    "        PHOTON_TRY_MSG(PhotonReader_ReadVaruint(src, &num), \"Failed to read param id\");\n"
+                    "        desc = Photon_ParamDesc(num);\n"
+                    "        if (!desc) {\n"
+                    "            PHOTON_DEBUG(\"Invalid param id\");\n"
+                    "            return PhotonError_InvalidValue;\n"
+                    "        }\n"
+                    "        PHOTON_TRY_MSG(PhotonWriter_WriteVaruint(dest, num), \"Failed to write param id\");\n"
+                    "        PHOTON_TRY(writeParam(desc, dest));\n"
+                    "    }\n"
+                    "    return PhotonError_Ok;\n"
+                    "}\n\n");
+
+    _output->append("static PhotonError setParams(PhotonReader* src, int apply)\n"
+                    "{\n"
+                    "    uint64_t count;\n"
+                    "    uint64_t i;\n"
+                    "    PHOTON_TRY_MSG(PhotonReader_ReadVaruint(src, &count), \"Failed to read param count\");\n"
+                    "    for (i = 0; i < count; i++) {\n"
+                    "        uint64_t num;\n"
+                    "        const PhotonParamDesc* desc;\n"
+                    "        PHOTON_TRY_MSG(PhotonReader_ReadVaruint(src, &num), \"Failed to read param id\");\n"
+                    "        desc = Photon_ParamDesc(num);\n"
+                    "        if (!desc) {\n"
+                    "            PHOTON_DEBUG(\"Invalid param id\");\n"
+                    "            return PhotonError_InvalidValue;\n"
+                    "        }\n"
+                    "        if (desc->flags & PHOTON_PARAM_READ_ONLY) {\n"
+                    "            PHOTON_DEBUG(\"Param is read only\");\n"
+                    "            return PhotonError_InvalidValue;\n"
+                    "        }\n"
+                    "        PHOTON_TRY(readParam(desc, src, apply));\n"
+                    "    }\n"
+                    "    return PhotonError_Ok;\n"
+                    "}\n\n");
+
+    _output->append("PhotonError Photon_SetParams(PhotonReader* src)\n"
+                    "{\n"
+                    "    PhotonReader check = *src;\n"
+                    "    PHOTON_TRY(setParams(&check, 0));\n"
+                    "    return setParams(src, 1);\n"
+                    "}\n\n");
+
+    _output->append("#undef _PHOTON_FNAME\n");
+}
+
+void ParamTableGen::generateGcHeader(const Project* project)
+{
+    collectParams(project);
+
+    _output->appendPragmaOnce();
+    _output->appendEol();
+    _output->append("#include <photon/model/CoderState.h>\n\n"
+                    "#include <bmcl/Buffer.h>\n\n"
+                    "#include <cstdint>\n"
+                    "#include <cstddef>\n\n");
+
+    _output->append("namespace photongen {\nnamespace params {\n\n");
+    for (const Entry& entry : _params) {
+        _output->append("constexpr std::uint64_t ");
+        _output->append(entry.comp->name());
+        _output->append("_");
+        _output->append(entry.param->name());
+        _output->append(" = ");
+        _output->appendNumericValue(entry.param->number());
+        _output->append(";\n");
+    }
+    _output->append("\n}\n}\n\n");
+
+    _output->append("inline bool photongenSerializeGetParams(const std::uint64_t* ids, std::size_t count, "
+                    "bmcl::Buffer* dest, photon::CoderState* state)\n"
+                    "{\n"
+                    "    (void)state;\n"
+                    "    dest->writeVarUint(count);\n"
+                    "    for (std::size_t i = 0; i < count; i++) {\n"
+                    "        dest->writeVarUint(ids[i]);\n"
+                    "    }\n"
+                    "    return true;\n"
+                    "}\n\n");
+
+    _output->append("inline bool photongenSerializeSetParamsHeader(std::size_t count, "
+                    "bmcl::Buffer* dest, photon::CoderState* state)\n"
+                    "{\n"
+                    "    (void)state;\n"
+                    "    dest->writeVarUint(count);\n"
+                    "    return true;\n"
+                    "}\n\n");
+
+    TypeReprGen reprGen(_output);
+    InlineTypeInspector inspector(_output);
+    InlineSerContext ctx;
+    for (const Entry& entry : _params) {
+        if (entry.param->isReadOnly()) {
+            continue;
+        }
+        _output->append("inline bool photongenSerializeSetParam");
+        _output->appendWithFirstUpper(entry.comp->name());
+        _output->appendWithFirstUpper(entry.param->name());
+        _output->append("(");
+        reprGen.genGcTypeRepr(entry.param->type(), "value");
+        _output->append(", bmcl::Buffer* dest, photon::CoderState* state)\n{\n"
+                        "    (void)state;\n"
+                        "    dest->writeVarUint(photongen::params::");
+        _output->append(entry.comp->name());
+        _output->append("_");
+        _output->append(entry.param->name());
+        _output->append(");\n");
+        inspector.inspect<false, true>(entry.param->type(), ctx, "value");
+        _output->append("    return true;\n}\n\n");
+    }
+}
+}
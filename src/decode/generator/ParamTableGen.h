@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "decode/Config.h"
+
+#include <vector>
+
+namespace decode {
+
+class SrcBuilder;
+class Project;
+class Component;
+class Parameter;
+
+class ParamTableGen {
+public:
+    ParamTableGen(SrcBuilder* output);
+    ~ParamTableGen();
+
+    // writes go through the same seqlock and dirty bits as generated var setters
+    void setSeqlockVars(bool useSeqlock);
+    void setAutosaveJournal(bool useJournal);
+
+    void generateHeader(const Project* project);
+    void generateSource(const Project* project);
+    void generateGcHeader(const Project* project);
+
+private:
+    struct Entry {
+        const Component* comp;
+        const Parameter* param;
+    };
+
+    void collectParams(const Project* project);
+    void appendTableEntry(const Entry& entry);
+    void appendParamPath(const Parameter* param);
+    void appendStoreParam();
+
+    SrcBuilder* _output;
+    std::vector<Entry> _params;
+    bool _useSeqlock;
+    bool _useAutosaveJournal;
+};
+}
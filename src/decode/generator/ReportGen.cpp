@@ -1,5 +1,6 @@
 #include "decode/generator/ReportGen.h"
 #include "decode/generator/SrcBuilder.h"
+#include "decode/generator/MemoryStats.h"
 #include "decode/parser/Project.h"
 #include "decode/parser/Package.h"
 #include "decode/ast/Component.h"
@@ -83,4 +84,33 @@ void ReportGen::generateReport(const Project* project)
     _output->appendEol();
 }
 
+static void appendMemoryEntries(const MemoryStats* stats, bool isRetained, SrcBuilder* _output)
+{
+    for (const MemoryStats::Entry& entry : stats->entries()) {
+        if (entry.isRetained != isRetained) {
+            continue;
+        }
+        _output->append(" - ");
+        _output->append(bmcl::StringView(entry.group));
+        _output->append("::");
+        _output->append(entry.name);
+        _output->append(" [");
+        _output->appendNumericValue(entry.count);
+        _output->append(", ");
+        _output->appendNumericValue(entry.bytes);
+        _output->append("]\n");
+    }
+}
+
+void ReportGen::generateMemoryReport(const MemoryStats* stats)
+{
+    _output->append("\nmemory:\n");
+    appendMemoryEntries(stats, true, _output);
+    _output->append(" - total bytes ");
+    _output->appendNumericValue(stats->totalBytes());
+    _output->appendEol();
+    _output->append("\noutput sizes:\n");
+    appendMemoryEntries(stats, false, _output);
+}
+
 }
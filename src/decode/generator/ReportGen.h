@@ -6,6 +6,7 @@ namespace decode {
 
 class Project;
 class SrcBuilder;
+class MemoryStats;
 
 class ReportGen {
 public:
@@ -13,6 +14,7 @@ public:
     ~ReportGen();
 
     void generateReport(const Project* project);
+    void generateMemoryReport(const MemoryStats* stats);
 
 private:
     SrcBuilder* _output;
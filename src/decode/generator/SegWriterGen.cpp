@@ -0,0 +1,225 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "decode/generator/SegWriterGen.h"
+#include "decode/generator/SrcBuilder.h"
+#include "decode/generator/InlineTypeInspector.h"
+
+#include <bmcl/StringView.h>
+
+namespace decode {
+
+SegWriterGen::SegWriterGen(SrcBuilder* output)
+    : _output(output)
+{
+}
+
+SegWriterGen::~SegWriterGen()
+{
+}
+
+void SegWriterGen::generateHeader()
+{
+    _output->startIncludeGuard("PRIVATE", "SEG_WRITER");
+
+    _output->appendOnboardIncludePath("core/Error");
+    _output->appendOnboardIncludePath("core/Writer");
+    _output->appendEol();
+
+    _output->appendNumericValueDefine(segWriterSpillSize(), "PHOTON_SEG_WRITER_SPILL_SIZE");
+    _output->appendEol();
+
+    _output->startCppGuard();
+
+    _output->append("typedef PhotonError (*PhotonSegWriterNextFunc)(void* userData, PhotonWriter* segment);\n\n");
+
+    _output->append("typedef struct {\n"
+                    "    PhotonWriter writer;\n"
+                    "    PhotonWriter segment;\n"
+                    "    PhotonWriter* target;\n"
+                    "    size_t written;\n"
+                    "    size_t segmentSize;\n"
+                    "    PhotonSegWriterNextFunc next;\n"
+                    "    void* userData;\n"
+                    "    uint8_t isSpilling;\n"
+                    "    uint8_t spill[PHOTON_SEG_WRITER_SPILL_SIZE];\n"
+                    "} PhotonSegWriter;\n\n");
+
+    _output->append("void PhotonSegWriter_Init(PhotonSegWriter* self, PhotonSegWriterNextFunc next, void* userData);\n");
+    _output->append("void PhotonSegWriter_InitFlat(PhotonSegWriter* self, void* dest, size_t size);\n");
+    _output->append("void PhotonSegWriter_Wrap(PhotonSegWriter* self, PhotonWriter* target);\n");
+    _output->append("PhotonError PhotonSegWriter_Spill(PhotonSegWriter* self, size_t size);\n");
+    _output->append("PhotonError PhotonSegWriter_Write(PhotonSegWriter* self, const void* data, size_t size);\n");
+    _output->append("PhotonError PhotonSegWriter_Finish(PhotonSegWriter* self);\n");
+    _output->append("size_t PhotonSegWriter_WrittenSize(PhotonSegWriter* self);\n\n");
+
+    // status table functions, Photon_SerializeParams and Photon_ExecScript take the chain of the caller,
+    // events are written into the chain of the current telemetry frame
+    _output->append("/* implemented by the telemetry runtime */\n");
+    _output->appendModIfdef("tm");
+    _output->append("PhotonSegWriter* PhotonTm_BeginEventSegMsg(uint8_t compNum, uint8_t msgNum);\n"
+                    "void PhotonTm_EndEventSegMsg(void);\n");
+    _output->appendEndif();
+    _output->appendEol();
+
+    _output->append("static inline PhotonWriter* PhotonSegWriter_Writer(PhotonSegWriter* self)\n"
+                    "{\n"
+                    "    return &self->writer;\n"
+                    "}\n\n");
+
+    _output->endCppGuard();
+
+    _output->endIncludeGuard();
+}
+
+void SegWriterGen::generateSource()
+{
+    _output->append("#include \"photongen/onboard/SegWriter.h\"\n\n");
+    _output->appendImplIncludePath("core/Try");
+    _output->appendImplIncludePath("core/Logging");
+    _output->appendEol();
+
+    _output->append("#define _PHOTON_FNAME \"photongen/onboard/SegWriter.c\"\n\n");
+
+    _output->append("void PhotonSegWriter_Init(PhotonSegWriter* self, PhotonSegWriterNextFunc next, void* userData)\n"
+                    "{\n"
+                    "    PhotonWriter_Init(&self->writer, self->spill, 0);\n"
+                    "    self->target = 0;\n"
+                    "    self->written = 0;\n"
+                    "    self->segmentSize = 0;\n"
+                    "    self->next = next;\n"
+                    "    self->userData = userData;\n"
+                    "    self->isSpilling = 0;\n"
+                    "}\n\n");
+
+    _output->append("void PhotonSegWriter_InitFlat(PhotonSegWriter* self, void* dest, size_t size)\n"
+                    "{\n"
+                    "    PhotonWriter_Init(&self->writer, dest, size);\n"
+                    "    self->target = 0;\n"
+                    "    self->written = 0;\n"
+                    "    self->segmentSize = size;\n"
+                    "    self->next = 0;\n"
+                    "    self->userData = 0;\n"
+                    "    self->isSpilling = 0;\n"
+                    "}\n\n");
+
+    _output->append("void PhotonSegWriter_Wrap(PhotonSegWriter* self, PhotonWriter* target)\n"
+                    "{\n"
+                    "    self->writer = *target;\n"
+                    "    self->target = target;\n"
+                    "    self->written = 0;\n"
+                    "    self->segmentSize = PhotonWriter_WritableSize(target);\n"
+                    "    self->next = 0;\n"
+                    "    self->userData = 0;\n"
+                    "    self->isSpilling = 0;\n"
+                    "}\n\n");
+
+    _output->append("static PhotonError nextSegment(PhotonSegWriter* self)\n"
+                    "{\n"
+                    "    if (!self->next) {\n"
+                    "        PHOTON_DEBUG(\"Not enough space to serialize\");\n"
+                    "        return PhotonError_NotEnoughSpace;\n"
+                    "    }\n"
+                    "    self->written += self->segmentSize - PhotonWriter_WritableSize(&self->writer);\n"
+                    "    PHOTON_TRY(self->next(self->userData, &self->writer));\n"
+                    "    self->segmentSize = PhotonWriter_WritableSize(&self->writer);\n"
+                    "    if (PhotonWriter_WritableSize(&self->writer) == 0) {\n"
+                    "        PHOTON_DEBUG(\"Recieved empty segment\");\n"
+                    "        return PhotonError_NotEnoughSpace;\n"
+                    "    }\n"
+                    "    return PhotonError_Ok;\n"
+                    "}\n\n");
+
+    _output->append("static PhotonError flushSpill(PhotonSegWriter* self)\n"
+                    "{\n"
+                    "    const uint8_t* data = self->spill;\n"
+                    "    size_t size = sizeof(self->spill) - PhotonWriter_WritableSize(&self->writer);\n"
+                    "    self->writer = self->segment;\n"
+                    "    self->isSpilling = 0;\n"
+                    "    while (size != 0) {\n"
+                    "        size_t chunkSize = PhotonWriter_WritableSize(&self->writer);\n"
+                    "        if (chunkSize == 0) {\n"
+                    "            PHOTON_TRY(nextSegment(self));\n"
+                    "            continue;\n"
+                    "        }\n"
+                    "        if (chunkSize > size) {\n"
+                    "            chunkSize = size;\n"
+                    "        }\n"
+                    "        PhotonWriter_Write(&self->writer, data, chunkSize);\n"
+                    "        data += chunkSize;\n"
+                    "        size -= chunkSize;\n"
+                    "    }\n"
+                    "    return PhotonError_Ok;\n"
+                    "}\n\n");
+
+    _output->append("PhotonError PhotonSegWriter_Spill(PhotonSegWriter* self, size_t size)\n"
+                    "{\n"
+                    "    if (self->isSpilling) {\n"
+                    "        PHOTON_TRY(flushSpill(self));\n"
+                    "    }\n"
+                    "    if (PhotonWriter_WritableSize(&self->writer) == 0 && self->next) {\n"
+                    "        PHOTON_TRY(nextSegment(self));\n"
+                    "    }\n"
+                    "    if (PhotonWriter_WritableSize(&self->writer) >= size) {\n"
+                    "        return PhotonError_Ok;\n"
+                    "    }\n"
+                    "    if (!self->next || size > PHOTON_SEG_WRITER_SPILL_SIZE) {\n"
+                    "        PHOTON_DEBUG(\"Not enough space to serialize\");\n"
+                    "        return PhotonError_NotEnoughSpace;\n"
+                    "    }\n"
+                    "    self->segment = self->writer;\n"
+                    "    PhotonWriter_Init(&self->writer, self->spill, sizeof(self->spill));\n"
+                    "    self->isSpilling = 1;\n"
+                    "    return PhotonError_Ok;\n"
+                    "}\n\n");
+
+    _output->append("PhotonError PhotonSegWriter_Write(PhotonSegWriter* self, const void* data, size_t size)\n"
+                    "{\n"
+                    "    const uint8_t* src = (const uint8_t*)data;\n"
+                    "    if (self->isSpilling) {\n"
+                    "        PHOTON_TRY(flushSpill(self));\n"
+                    "    }\n"
+                    "    while (size != 0) {\n"
+                    "        size_t chunkSize = PhotonWriter_WritableSize(&self->writer);\n"
+                    "        if (chunkSize == 0) {\n"
+                    "            PHOTON_TRY(nextSegment(self));\n"
+                    "            continue;\n"
+                    "        }\n"
+                    "        if (chunkSize > size) {\n"
+                    "            chunkSize = size;\n"
+                    "        }\n"
+                    "        PhotonWriter_Write(&self->writer, src, chunkSize);\n"
+                    "        src += chunkSize;\n"
+                    "        size -= chunkSize;\n"
+                    "    }\n"
+                    "    return PhotonError_Ok;\n"
+                    "}\n\n");
+
+    _output->append("PhotonError PhotonSegWriter_Finish(PhotonSegWriter* self)\n"
+                    "{\n"
+                    "    if (self->isSpilling) {\n"
+                    "        PHOTON_TRY(flushSpill(self));\n"
+                    "    }\n"
+                    "    if (self->target) {\n"
+                    "        *self->target = self->writer;\n"
+                    "    }\n"
+                    "    return PhotonError_Ok;\n"
+                    "}\n\n");
+
+    _output->append("size_t PhotonSegWriter_WrittenSize(PhotonSegWriter* self)\n"
+                    "{\n"
+                    "    if (self->isSpilling) {\n"
+                    "        return self->written + self->segmentSize - PhotonWriter_WritableSize(&self->segment)\n"
+                    "               + sizeof(self->spill) - PhotonWriter_WritableSize(&self->writer);\n"
+                    "    }\n"
+                    "    return self->written + self->segmentSize - PhotonWriter_WritableSize(&self->writer);\n"
+                    "}\n\n");
+
+    _output->append("#undef _PHOTON_FNAME\n");
+}
+}
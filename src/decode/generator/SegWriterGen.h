@@ -0,0 +1,28 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "decode/Config.h"
+
+namespace decode {
+
+class SrcBuilder;
+
+class SegWriterGen {
+public:
+    SegWriterGen(SrcBuilder* output);
+    ~SegWriterGen();
+
+    void generateHeader();
+    void generateSource();
+
+private:
+    SrcBuilder* _output;
+};
+}
@@ -97,6 +97,20 @@ void SrcBuilder::appendWritableSizeCheck(const InlineSerContext& ctx, bmcl::Stri
     append("}\n");
 }
 
+void SrcBuilder::appendSegmentedWritableSizeCheck(const InlineSerContext& ctx, bmcl::StringView sizeCheck)
+{
+    appendIndent(ctx);
+    append("if (PhotonWriter_WritableSize(dest) < ");
+    append(sizeCheck);
+    append(") {\n");
+    appendIndent(ctx);
+    append("    PHOTON_TRY(PhotonSegWriter_Spill(seg, ");
+    append(sizeCheck);
+    append("));\n");
+    appendIndent(ctx);
+    append("}\n");
+}
+
 void SrcBuilder::appendReadableSizeCheck(const InlineSerContext& ctx, std::size_t size)
 {
     appendReadableSizeCheck(ctx, std::to_string(size));
@@ -107,6 +121,16 @@ void SrcBuilder::appendWritableSizeCheck(const InlineSerContext& ctx, std::size_
     appendWritableSizeCheck(ctx, std::to_string(size));
 }
 
+void SrcBuilder::appendSegmentedWritableSizeCheck(const InlineSerContext& ctx, std::size_t size)
+{
+    appendSegmentedWritableSizeCheck(ctx, std::to_string(size));
+}
+
+void SrcBuilder::appendSegWriterDest()
+{
+    append("    PhotonWriter* dest = PhotonSegWriter_Writer(seg);\n");
+}
+
 void SrcBuilder::appendLoopHeader(const InlineSerContext& ctx, bmcl::StringView loopSize)
 {
     appendIndent(ctx);
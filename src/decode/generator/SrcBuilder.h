@@ -36,6 +36,9 @@ public:
     void appendWritableSizeCheck(const InlineSerContext& ctx, std::size_t size);
     void appendReadableSizeCheck(const InlineSerContext& ctx, bmcl::StringView sizeCheck);
     void appendWritableSizeCheck(const InlineSerContext& ctx, bmcl::StringView sizeCheck);
+    void appendSegmentedWritableSizeCheck(const InlineSerContext& ctx, std::size_t size);
+    void appendSegmentedWritableSizeCheck(const InlineSerContext& ctx, bmcl::StringView sizeCheck);
+    void appendSegWriterDest();
     void appendLoopHeader(const InlineSerContext& ctx, std::size_t loopSize);
     void appendLoopHeader(const InlineSerContext& ctx, bmcl::StringView loopSize);
     void appendWithTryMacro(const SrcGen& func);
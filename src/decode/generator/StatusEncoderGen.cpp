@@ -14,13 +14,17 @@
 #include "decode/generator/TypeReprGen.h"
 #include "decode/generator/IncludeGen.h"
 #include "decode/generator/TypeDependsCollector.h"
+#include "decode/generator/TypeDependsIndex.h"
 #include "decode/generator/Utils.h"
 #include "decode/generator/FuncPrototypeGen.h"
+#include "decode/generator/MsgStatsGen.h"
 #include "decode/ast/Component.h"
 #include "decode/ast/ModuleInfo.h"
 #include "decode/parser/Containers.h"
 
 #include <string>
+#include <algorithm>
+#include <functional>
 #include <cassert>
 
 namespace decode {
@@ -29,6 +33,11 @@ StatusEncoderGen::StatusEncoderGen(SrcBuilder* output)
     : _output(output)
     , _inlineInspector(output)
     , _prototypeGen(output)
+    , _useEventQueue(false)
+    , _useSeqlock(false)
+    , _useAutosaveJournal(false)
+    , _useMsgStats(false)
+    , _dependsIndex(nullptr)
 {
 }
 
@@ -36,6 +45,45 @@ StatusEncoderGen::~StatusEncoderGen()
 {
 }
 
+bmcl::StringView StatusEncoderGen::writerArgName() const
+{
+    if (_inlineInspector.isSegmentedWriter()) {
+        return "seg";
+    }
+    return "dest";
+}
+
+void StatusEncoderGen::setSegmentedWriter(bool isSegmented)
+{
+    _inlineInspector.setSegmentedWriter(isSegmented);
+    _prototypeGen.setSegmentedWriter(isSegmented);
+}
+
+void StatusEncoderGen::setEventQueue(bool useEventQueue)
+{
+    _useEventQueue = useEventQueue;
+}
+
+void StatusEncoderGen::setSeqlockVars(bool useSeqlock)
+{
+    _useSeqlock = useSeqlock;
+}
+
+void StatusEncoderGen::setAutosaveJournal(bool useJournal)
+{
+    _useAutosaveJournal = useJournal;
+}
+
+void StatusEncoderGen::setMsgStats(bool useMsgStats)
+{
+    _useMsgStats = useMsgStats;
+}
+
+void StatusEncoderGen::setDependsIndex(const TypeDependsIndex* index)
+{
+    _dependsIndex = index;
+}
+
 static void appendTmDeserializerPrototype(SrcBuilder* dest)
 {
 
@@ -75,16 +123,37 @@ void StatusEncoderGen::generateAutosaveSource(const Project* project)
     _output->append("#include \"photongen/onboard/core/Reader.h\"\n");
     _output->append("#include \"photongen/onboard/core/Error.h\"\n");
     _output->append("#include \"photon/core/Logging.h\"\n\n");
+    if (_inlineInspector.isSegmentedWriter()) {
+        _output->append("#include \"photongen/onboard/SegWriter.h\"\n\n");
+    }
+    if (_useAutosaveJournal) {
+        _output->append("#include <stdatomic.h>\n#include <string.h>\n\n");
+    }
     _output->append("#define _PHOTON_FNAME \"Autosave.c\"\n\n");
 
     _output->appendNumericValueDefine(maxSize, "_PHOTON_AUTOSAVE_MAX_SIZE");
     _output->appendEol();
 
+    if (_useAutosaveJournal) {
+        appendAutosaveJournal(project);
+    }
+
     InlineSerContext ctx;
     SrcBuilder currentField("_photon");
 
-    _output->append("static PhotonError Photon_SerializeParams(PhotonWriter* dest)\n{\n");
-    _output->appendWritableSizeCheck(ctx, 8);
+    if (_useAutosaveJournal) {
+        _output->append("static PhotonError Photon_SerializeParamsSnapshot(");
+    } else {
+        _output->append("static PhotonError Photon_SerializeParams(");
+    }
+    _prototypeGen.appendWriterArg();
+    _output->append(")\n{\n");
+    if (_inlineInspector.isSegmentedWriter()) {
+        _output->appendSegWriterDest();
+        _output->appendSegmentedWritableSizeCheck(ctx, 8);
+    } else {
+        _output->appendWritableSizeCheck(ctx, 8);
+    }
     _output->append("    PhotonWriter_WriteU64Le(dest, _PHOTON_AUTOSAVE_MAX_SIZE);\n");
     for (const Component* comp : project->package()->components()) {
         _output->appendModIfdef(comp->moduleName());
@@ -97,7 +166,11 @@ void StatusEncoderGen::generateAutosaveSource(const Project* project)
     }
     _output->append("    return PhotonError_Ok;\n}\n\n");
 
-     _output->append("static PhotonError Photon_DeserializeParams(PhotonReader* src)\n{\n");
+    if (_useAutosaveJournal) {
+        _output->append("static PhotonError Photon_DeserializeParamsSnapshot(PhotonReader* src)\n{\n");
+    } else {
+        _output->append("static PhotonError Photon_DeserializeParams(PhotonReader* src)\n{\n");
+    }
     _output->appendReadableSizeCheck(ctx, 8);
     _output->append("    uint64_t maxVarSize = PhotonReader_ReadU64Le(src);\n"
                     "    if (maxVarSize != _PHOTON_AUTOSAVE_MAX_SIZE) {\n"
@@ -113,10 +186,308 @@ void StatusEncoderGen::generateAutosaveSource(const Project* project)
         _output->appendEndif();
     }
     _output->append("    return PhotonError_Ok;\n}\n\n");
+    if (_useAutosaveJournal) {
+        appendAutosaveJournalEntryPoints();
+    }
 
     _output->append("#undef _PHOTON_FNAME");
 }
 
+static void appendSavedVarFunctionName(SrcBuilder* dest, const Component* comp, bmcl::StringView prefix, std::size_t i)
+{
+    dest->append("Photon");
+    dest->appendWithFirstUpper(comp->moduleName());
+    dest->append(prefix);
+    dest->appendNumericValue(i);
+}
+
+static std::size_t varuintSize(std::size_t value)
+{
+    std::size_t size = 1;
+    for (value >>= 7; value != 0; value >>= 7) {
+        size++;
+    }
+    return size;
+}
+
+static void appendDirtyByte(SrcBuilder* dest, const Component* comp, std::size_t byte)
+{
+    dest->append("&_photon");
+    dest->appendWithFirstUpper(comp->moduleName());
+    dest->append("Dirty[");
+    dest->appendNumericValue(byte);
+    dest->append("]");
+}
+
+void StatusEncoderGen::appendAutosaveJournal(const Project* project)
+{
+    InlineSerContext ctx;
+    SrcBuilder currentField("_photon");
+
+    //stored image is a snapshot followed by journal records, each record starts with a marker byte
+    _output->append("#ifndef PHOTON_AUTOSAVE_JOURNAL_SIZE\n"
+                    "# define PHOTON_AUTOSAVE_JOURNAL_SIZE (3 * _PHOTON_AUTOSAVE_MAX_SIZE)\n"
+                    "#endif\n\n"
+                    "#define _PHOTON_AUTOSAVE_JOURNAL_RECORD 0x5a\n\n"
+                    "/* size of the stored image and of its journal part, zero image size means that there is no valid\n"
+                    " * stored image and the next save writes a snapshot. Storage must hold\n"
+                    " * _PHOTON_AUTOSAVE_MAX_SIZE + PHOTON_AUTOSAVE_JOURNAL_SIZE bytes */\n"
+                    "static size_t _photonAutosaveImageSize = 0;\n"
+                    "static size_t _photonAutosaveJournalSize = 0;\n\n");
+
+    for (const Component* comp : project->package()->components()) {
+        if (comp->savedVarsRange().isEmpty()) {
+            continue;
+        }
+        _output->appendModIfdef(comp->moduleName());
+        std::size_t i = 0;
+        for (const VarRegexp* regexp : comp->savedVarsRange()) {
+            _output->append("static PhotonError ");
+            appendSavedVarFunctionName(_output, comp, "_SerializeSavedVar", i);
+            _output->append("(");
+            _prototypeGen.appendWriterArg();
+            _output->append(")\n{\n");
+            //marker, component number and var id
+            std::size_t headerSize = 2 + varuintSize(i);
+            if (_inlineInspector.isSegmentedWriter()) {
+                _output->appendSegWriterDest();
+                _output->appendSegmentedWritableSizeCheck(ctx, headerSize);
+            } else {
+                _output->appendWritableSizeCheck(ctx, headerSize);
+            }
+            _output->append("    PhotonWriter_WriteU8(dest, _PHOTON_AUTOSAVE_JOURNAL_RECORD);\n"
+                            "    PhotonWriter_WriteU8(dest, ");
+            _output->appendNumericValue(comp->number());
+            _output->append(");\n    PHOTON_TRY_MSG(PhotonWriter_WriteVaruint(dest, ");
+            _output->appendNumericValue(i);
+            _output->append("), \"Failed to write saved var id\");\n");
+            currentField.appendWithFirstUpper(comp->moduleName());
+            appendInlineSerializer(regexp, &currentField, true);
+            currentField.resize(7);
+            _output->append("    return PhotonError_Ok;\n}\n\n");
+
+            _output->append("static PhotonError ");
+            appendSavedVarFunctionName(_output, comp, "_DeserializeSavedVar", i);
+            _output->append("(PhotonReader* src)\n{\n");
+            currentField.appendWithFirstUpper(comp->moduleName());
+            appendInlineSerializer(regexp, &currentField, false);
+            currentField.resize(7);
+            _output->append("    return PhotonError_Ok;\n}\n\n");
+            i++;
+        }
+        _output->appendEndif();
+        _output->appendEol();
+    }
+
+    std::size_t dirtySize = 0;
+    for (const Component* comp : project->package()->components()) {
+        dirtySize += (comp->savedVarsRange().size() + 7) / 8;
+    }
+    _output->appendNumericValueDefine(std::max<std::size_t>(dirtySize, 1), "_PHOTON_AUTOSAVE_DIRTY_SIZE");
+    _output->appendEol();
+
+    auto foreachDirtyByte = [&](std::function<void(const Component*, std::size_t, std::size_t)>&& f) {
+        std::size_t offset = 0;
+        for (const Component* comp : project->package()->components()) {
+            if (comp->savedVarsRange().isEmpty()) {
+                continue;
+            }
+            std::size_t bytes = (comp->savedVarsRange().size() + 7) / 8;
+            _output->appendModIfdef(comp->moduleName());
+            for (std::size_t byte = 0; byte < bytes; byte++) {
+                f(comp, byte, offset + byte);
+            }
+            _output->appendEndif();
+            offset += bytes;
+        }
+    };
+
+    _output->append("static void takeDirtyBits(unsigned char* dirty)\n{\n"
+                    "    memset(dirty, 0, _PHOTON_AUTOSAVE_DIRTY_SIZE);\n");
+    foreachDirtyByte([&](const Component* comp, std::size_t byte, std::size_t index) {
+        _output->append("    dirty[");
+        _output->appendNumericValue(index);
+        _output->append("] = atomic_exchange_explicit(");
+        appendDirtyByte(_output, comp, byte);
+        _output->append(", 0, memory_order_relaxed);\n");
+    });
+    _output->append("}\n\n");
+
+    _output->append("static void restoreDirtyBits(const unsigned char* dirty)\n{\n"
+                    "    (void)dirty;\n");
+    foreachDirtyByte([&](const Component* comp, std::size_t byte, std::size_t index) {
+        _output->append("    atomic_fetch_or_explicit(");
+        appendDirtyByte(_output, comp, byte);
+        _output->append(", dirty[");
+        _output->appendNumericValue(index);
+        _output->append("], memory_order_relaxed);\n");
+    });
+    _output->append("}\n\n");
+
+    //upper bound of the record sizes of taken entries, decides between appending and compaction
+    _output->append("static size_t journalMaxSize(const unsigned char* dirty)\n{\n"
+                    "    size_t size = 0;\n"
+                    "    (void)dirty;\n");
+    std::size_t offset = 0;
+    for (const Component* comp : project->package()->components()) {
+        if (comp->savedVarsRange().isEmpty()) {
+            continue;
+        }
+        std::size_t count = comp->savedVarsRange().size();
+        _output->appendModIfdef(comp->moduleName());
+        std::size_t i = 0;
+        for (const VarRegexp* regexp : comp->savedVarsRange()) {
+            _output->append("    if (dirty[");
+            _output->appendNumericValue(offset + i / 8);
+            _output->append("] & ");
+            _output->appendNumericValue(1u << (i & 7));
+            _output->append(") {\n        size += ");
+            _output->appendNumericValue(2 + varuintSize(i) + regexp->type()->encodedSizes().max);
+            _output->append(";\n    }\n");
+            i++;
+        }
+        _output->appendEndif();
+        offset += (count + 7) / 8;
+    }
+    _output->append("    return size;\n}\n\n");
+
+    //appends one record per taken entry, on failure the caller restores the dirty bits
+    _output->append("static PhotonError Photon_SerializeParamsJournal(");
+    _prototypeGen.appendWriterArg();
+    _output->append(", const unsigned char* dirty)\n{\n");
+    offset = 0;
+    for (const Component* comp : project->package()->components()) {
+        if (comp->savedVarsRange().isEmpty()) {
+            continue;
+        }
+        std::size_t count = comp->savedVarsRange().size();
+        _output->appendModIfdef(comp->moduleName());
+        for (std::size_t i = 0; i < count; i++) {
+            _output->append("    if (dirty[");
+            _output->appendNumericValue(offset + i / 8);
+            _output->append("] & ");
+            _output->appendNumericValue(1u << (i & 7));
+            _output->append(") {\n        PHOTON_TRY(");
+            appendSavedVarFunctionName(_output, comp, "_SerializeSavedVar", i);
+            _output->append("(");
+            _output->append(writerArgName());
+            _output->append("));\n    }\n");
+        }
+        _output->appendEndif();
+        offset += (count + 7) / 8;
+    }
+    _output->append("    (void)");
+    _output->append(writerArgName());
+    _output->append(";\n    (void)dirty;\n    return PhotonError_Ok;\n}\n\n");
+
+    //replay stops at the first byte that does not start a record, the rest of the stored image
+    //(erased storage or padding) is ignored
+    _output->append("static PhotonError Photon_DeserializeParamsJournal(PhotonReader* src, size_t* size)\n{\n"
+                    "    size_t start = PhotonReader_ReadableSize(src);\n"
+                    "    uint8_t compNum;\n"
+                    "    uint64_t varId;\n\n"
+                    "    *size = 0;\n"
+                    "    while (PhotonReader_ReadableSize(src) != 0) {\n"
+                    "        if (PhotonReader_ReadU8(src) != _PHOTON_AUTOSAVE_JOURNAL_RECORD) {\n"
+                    "            return PhotonError_Ok;\n"
+                    "        }\n"
+                    "        if (PhotonReader_ReadableSize(src) == 0) {\n"
+                    "            PHOTON_CRITICAL(\"Not enough data to deserialize autosave journal record\");\n"
+                    "            return PhotonError_NotEnoughData;\n"
+                    "        }\n"
+                    "        compNum = PhotonReader_ReadU8(src);\n"
+                    "        PHOTON_TRY_MSG(PhotonReader_ReadVaruint(src, &varId), \"Failed to read saved var id\");\n"
+                    "        switch (compNum) {\n");
+    for (const Component* comp : project->package()->components()) {
+        if (comp->savedVarsRange().isEmpty()) {
+            continue;
+        }
+        _output->appendModIfdef(comp->moduleName());
+        _output->append("        case ");
+        _output->appendNumericValue(comp->number());
+        _output->append(":\n            switch (varId) {\n");
+        for (std::size_t i = 0; i < comp->savedVarsRange().size(); i++) {
+            _output->append("            case ");
+            _output->appendNumericValue(i);
+            _output->append(":\n                PHOTON_TRY(");
+            appendSavedVarFunctionName(_output, comp, "_DeserializeSavedVar", i);
+            _output->append("(src));\n                *size = start - PhotonReader_ReadableSize(src);\n                continue;\n");
+        }
+        _output->append("            }\n            break;\n");
+        _output->appendEndif();
+    }
+    _output->append("        }\n"
+                    "        PHOTON_CRITICAL(\"Invalid autosave journal record (%u, %u)\", (unsigned)compNum, (unsigned)varId);\n"
+                    "        return PhotonError_InvalidValue;\n"
+                    "    }\n"
+                    "    return PhotonError_Ok;\n}\n\n");
+
+}
+
+void StatusEncoderGen::appendAutosaveJournalEntryPoints()
+{
+    bool isSegmented = _inlineInspector.isSegmentedWriter();
+    bmcl::StringView writer = writerArgName();
+
+    _output->append("static PhotonError Photon_DeserializeParams(PhotonReader* src)\n{\n"
+                    "    size_t snapshotSize = PhotonReader_ReadableSize(src);\n"
+                    "    size_t journalSize;\n"
+                    "    _photonAutosaveImageSize = 0;\n"
+                    "    _photonAutosaveJournalSize = 0;\n"
+                    "    PHOTON_TRY(Photon_DeserializeParamsSnapshot(src));\n"
+                    "    snapshotSize -= PhotonReader_ReadableSize(src);\n"
+                    "    PHOTON_TRY(Photon_DeserializeParamsJournal(src, &journalSize));\n"
+                    "    _photonAutosaveImageSize = snapshotSize + journalSize;\n"
+                    "    _photonAutosaveJournalSize = journalSize;\n"
+                    "    return PhotonError_Ok;\n}\n\n");
+
+    //the runtime stores written bytes at *offset of the stored image, offset 0 replaces the image
+    _output->append("static PhotonError Photon_SerializeParams(");
+    _prototypeGen.appendWriterArg();
+    _output->append(", size_t* offset)\n{\n"
+                    "    unsigned char dirty[_PHOTON_AUTOSAVE_DIRTY_SIZE];\n"
+                    "    size_t start = ");
+    if (isSegmented) {
+        _output->append("PhotonSegWriter_WrittenSize(seg)");
+    } else {
+        _output->append("PhotonWriter_WritableSize(dest)");
+    }
+    _output->append(";\n"
+                    "    size_t size;\n"
+                    "    PhotonError rv;\n"
+                    "    takeDirtyBits(dirty);\n"
+                    "    if (_photonAutosaveImageSize != 0\n"
+                    "        && _photonAutosaveJournalSize + journalMaxSize(dirty) <= PHOTON_AUTOSAVE_JOURNAL_SIZE) {\n"
+                    "        *offset = _photonAutosaveImageSize;\n"
+                    "        rv = Photon_SerializeParamsJournal(");
+    _output->append(writer);
+    _output->append(", dirty);\n"
+                    "    } else {\n"
+                    "        /* compaction, snapshot of all entries replaces the stored image and its journal */\n"
+                    "        *offset = 0;\n"
+                    "        rv = Photon_SerializeParamsSnapshot(");
+    _output->append(writer);
+    _output->append(");\n"
+                    "    }\n"
+                    "    if (rv != PhotonError_Ok) {\n"
+                    "        restoreDirtyBits(dirty);\n"
+                    "        return rv;\n"
+                    "    }\n");
+    if (isSegmented) {
+        _output->append("    size = PhotonSegWriter_WrittenSize(seg) - start;\n");
+    } else {
+        _output->append("    size = start - PhotonWriter_WritableSize(dest);\n");
+    }
+    _output->append("    if (*offset == 0) {\n"
+                    "        _photonAutosaveImageSize = size;\n"
+                    "        _photonAutosaveJournalSize = 0;\n"
+                    "    } else {\n"
+                    "        _photonAutosaveImageSize += size;\n"
+                    "        _photonAutosaveJournalSize += size;\n"
+                    "    }\n"
+                    "    return PhotonError_Ok;\n}\n\n");
+}
+
 void StatusEncoderGen::generateStatusEncoderSource(const Project* project)
 {
     TypeDependsCollector coll;
@@ -129,9 +500,20 @@ void StatusEncoderGen::generateStatusEncoderSource(const Project* project)
     for (const char* inc : {"core/Writer", "core/Error"}) {
         _output->appendOnboardIncludePath(inc);
     }
+    if (_useMsgStats) {
+        _output->append("#include \"photongen/onboard/MsgStats.h\"\n");
+    }
 
     for (const Component* comp : project->package()->components()) {
-        coll.collectStatuses(comp->statusesRange(), &includes);
+        bmcl::OptionPtr<const TypeDependsIndex::ModuleDepends> indexed;
+        if (_dependsIndex) {
+            indexed = _dependsIndex->componentDepends(comp);
+        }
+        if (indexed.isSome()) {
+            _dependsIndex->toDepends(indexed->statuses, &includes);
+        } else {
+            coll.collectStatuses(comp->statusesRange(), &includes);
+        }
 
         _output->appendModIfdef(comp->moduleName());
         includeGen.genOnboardIncludePaths(&includes);
@@ -141,17 +523,43 @@ void StatusEncoderGen::generateStatusEncoderSource(const Project* project)
         includes.clear();
     }
     _output->appendEol();
+    if (_useSeqlock) {
+        _output->append("#include <string.h>\n\n"
+                        "#ifndef PHOTON_SEQLOCK_MAX_RETRIES\n"
+                        "# define PHOTON_SEQLOCK_MAX_RETRIES 16\n"
+                        "#endif\n\n");
+    }
     _output->append("#define _PHOTON_FNAME \"photon/StatusEncoder.c\"\n\n");
 
     for (const ComponentAndMsg& msg : project->package()->statusMsgs()) {
         _output->appendModIfdef(msg.component->moduleName());
-        _prototypeGen.appendStatusEncoderFunctionPrototype(msg.component.get(), msg.msg.get());
+        if (_useMsgStats) {
+            _output->append("static PhotonError _");
+            _prototypeGen.appendStatusEncoderFunctionName(msg.component.get(), msg.msg.get());
+            _output->append("(");
+            _prototypeGen.appendWriterArg();
+            _output->append(")");
+        } else {
+            _prototypeGen.appendStatusEncoderFunctionPrototype(msg.component.get(), msg.msg.get());
+        }
         _output->append("\n{\n");
+        // written into the frame chain of the caller, which finishes it after all messages of a frame
+        if (_inlineInspector.isSegmentedWriter()) {
+            _output->appendSegWriterDest();
+        }
+        bool hasSnapshot = _useSeqlock && msg.component->hasVars();
+        if (hasSnapshot) {
+            appendVarsSnapshot(msg.component.get(), msg.msg.get());
+        }
         _output->append("    (void)dest;\n");
-        _output->append("    if (PhotonWriter_WritableSize(dest) < 2) {\n"
-                        "        PHOTON_DEBUG(\"Not enough space to serialize tm header\");\n"
-                        "        return PhotonError_NotEnoughSpace;\n"
-                        "    }\n");
+        if (_inlineInspector.isSegmentedWriter()) {
+            _output->appendSegmentedWritableSizeCheck(InlineSerContext(), 2);
+        } else {
+            _output->append("    if (PhotonWriter_WritableSize(dest) < 2) {\n"
+                            "        PHOTON_DEBUG(\"Not enough space to serialize tm header\");\n"
+                            "        return PhotonError_NotEnoughSpace;\n"
+                            "    }\n");
+        }
         _output->append("    PhotonWriter_WriteU8(dest, ");
         _output->appendNumericValue(msg.component->number());
         _output->append(");\n    PhotonWriter_WriteU8(dest, ");
@@ -159,17 +567,94 @@ void StatusEncoderGen::generateStatusEncoderSource(const Project* project)
         _output->append(");\n");
 
         for (const VarRegexp* part : msg.msg->partsRange()) {
+            if (hasSnapshot) {
+                SrcBuilder currentField("snapshot");
+                appendInlineSerializer(part, &currentField, true);
+                continue;
+            }
             SrcBuilder currentField("_photon");
             currentField.appendWithFirstUpper(msg.component->moduleName());
             appendInlineSerializer(part, &currentField, true);
         }
         _output->append("    return PhotonError_Ok;\n}\n");
+        if (_useMsgStats) {
+            appendStatsEncoderWrapper(msg.component.get(), msg.msg.get());
+        }
         _output->appendEndif();
         _output->appendEol();
     }
     _output->append("#undef _PHOTON_FNAME\n");
 }
 
+void StatusEncoderGen::appendStatsEncoderWrapper(const Component* comp, const StatusMsg* msg)
+{
+    _output->appendEol();
+    _prototypeGen.appendStatusEncoderFunctionPrototype(comp, msg);
+    bool isSegmented = _inlineInspector.isSegmentedWriter();
+    bmcl::StringView writtenSize = isSegmented ? "PhotonSegWriter_WrittenSize(seg)" : "PhotonWriter_WritableSize(dest)";
+    _output->append("\n{\n"
+                    "    size_t size = ");
+    _output->append(writtenSize);
+    _output->append(";\n"
+                    "    uint64_t start = PHOTON_MSG_STATS_NOW();\n"
+                    "    PhotonError rv = _");
+    _prototypeGen.appendStatusEncoderFunctionName(comp, msg);
+    _output->append("(");
+    _output->append(writerArgName());
+    _output->append(");\n"
+                    "    PhotonMsgStats_RecordEncode(");
+    MsgStatsGen::appendIndexName(comp, msg, _output);
+    if (isSegmented) {
+        _output->append(", rv, PhotonSegWriter_WrittenSize(seg) - size, start);\n");
+    } else {
+        _output->append(", rv, size - PhotonWriter_WritableSize(dest), start);\n");
+    }
+    _output->append("    return rv;\n"
+                    "}\n");
+}
+
+void StatusEncoderGen::appendVarsSnapshot(const Component* comp, const StatusMsg* msg)
+{
+    std::vector<const Field*> fields;
+    for (const VarRegexp* part : msg->partsRange()) {
+        bmcl::OptionPtr<const Field> field = part->rootField();
+        if (field.isNone()) {
+            continue;
+        }
+        if (std::find(fields.begin(), fields.end(), field.unwrap()) == fields.end()) {
+            fields.push_back(field.unwrap());
+        }
+    }
+
+    _output->append("    Photon");
+    _output->appendWithFirstUpper(comp->moduleName());
+    _output->append(" snapshot;\n"
+                    "    unsigned seq;\n"
+                    "    unsigned retries = 0;\n"
+                    "    do {\n"
+                    "        if (retries++ == PHOTON_SEQLOCK_MAX_RETRIES) {\n"
+                    "            PHOTON_DEBUG(\"Failed to snapshot component vars\");\n"
+                    "            return PhotonError_InvalidValue;\n"
+                    "        }\n"
+                    "        seq = Photon");
+    _output->appendWithFirstUpper(comp->moduleName());
+    _output->append("_BeginRead();\n");
+    for (const Field* field : fields) {
+        _output->append("        memcpy(&snapshot.");
+        _output->append(field->name());
+        _output->append(", &_photon");
+        _output->appendWithFirstUpper(comp->moduleName());
+        _output->append(".");
+        _output->append(field->name());
+        _output->append(", sizeof(snapshot.");
+        _output->append(field->name());
+        _output->append("));\n");
+    }
+    _output->append("    } while (!Photon");
+    _output->appendWithFirstUpper(comp->moduleName());
+    _output->append("_EndRead(seq));\n");
+}
+
 static void appendInfix(SrcBuilder* dest, const StatusMsg*)
 {
     dest->append("_StatusMsg_");
@@ -203,16 +688,31 @@ void StatusEncoderGen::appendMsgSwitch(const Component* comp, const T* msg)
         appendInfix(_output, msg);
         _output->appendWithFirstUpper(msg->name());
 
-        _output->append(" msg;\n"
-                        "                PHOTON_TRY(");
-
-        appendPrototype(&_prototypeGen, comp, msg);
-
-        _output->append("(src, &msg));\n"
-                        "                handler(compId, msgId, &msg, userData);\n"
+        _output->append(" msg;\n");
+        if (_useMsgStats) {
+            _output->append("                size_t size = PhotonReader_ReadableSize(src);\n"
+                            "                uint64_t start = PHOTON_MSG_STATS_NOW();\n"
+                            "                PhotonError rv = ");
+            appendPrototype(&_prototypeGen, comp, msg);
+            _output->append("(src, &msg);\n"
+                            "                PhotonMsgStats_RecordDecode(");
+            MsgStatsGen::appendIndexName(comp, msg, _output);
+            _output->append(", rv, size - PhotonReader_ReadableSize(src), start);\n"
+                            "                PHOTON_TRY(rv);\n");
+        } else {
+            _output->append("                PHOTON_TRY(");
+            appendPrototype(&_prototypeGen, comp, msg);
+            _output->append("(src, &msg));\n");
+        }
+        _output->append("                handler(compId, msgId, &msg, userData);\n"
                         "                continue;\n"
                         "            }\n");
     } else {
+        if (_useMsgStats) {
+            _output->append("                PhotonMsgStats_RecordDecode(");
+            MsgStatsGen::appendIndexName(comp, msg, _output);
+            _output->append(", PhotonError_Ok, 0, PHOTON_MSG_STATS_NOW());\n");
+        }
         _output->append("                handler(compId, msgId, 0, userData);\n"
                         "                continue;\n"
                         "            }\n");
@@ -221,7 +721,11 @@ void StatusEncoderGen::appendMsgSwitch(const Component* comp, const T* msg)
 
 void StatusEncoderGen::generateStatusDecoderSource(const Project* project)
 {
-    _output->append("#include \"photongen/onboard/StatusDecoder.h\"\n\n");
+    _output->append("#include \"photongen/onboard/StatusDecoder.h\"\n");
+    if (_useMsgStats) {
+        _output->append("#include \"photongen/onboard/MsgStats.h\"\n");
+    }
+    _output->appendEol();
     _output->appendImplIncludePath("core/Try");
     _output->appendImplIncludePath("core/Logging");
     _output->appendEol();
@@ -329,6 +833,25 @@ void StatusEncoderGen::generateStatusDecoderSource(const Project* project)
 
     }
 
+    if (_useMsgStats) {
+        //stats of other devices are only forwarded to ground control
+        _output->append("        case PHOTON_MSG_STATS_COMP_NUM: {\n"
+                        "            size_t count;\n"
+                        "            if (PhotonReader_ReadableSize(src) < 4) {\n"
+                        "                PHOTON_CRITICAL(\"Not enough data to deserialize msg stats header\");\n"
+                        "                return PhotonError_NotEnoughData;\n"
+                        "            }\n"
+                        "            PhotonReader_ReadU16Le(src);\n"
+                        "            count = PhotonReader_ReadU16Le(src);\n"
+                        "            if (PhotonReader_ReadableSize(src) < count * (4 * 4 + 4 * PHOTON_MSG_STATS_ERROR_SLOTS + 8)) {\n"
+                        "                PHOTON_CRITICAL(\"Not enough data to deserialize msg stats\");\n"
+                        "                return PhotonError_NotEnoughData;\n"
+                        "            }\n"
+                        "            PhotonReader_Skip(src, count * (4 * 4 + 4 * PHOTON_MSG_STATS_ERROR_SLOTS + 8));\n"
+                        "            handler(compId, msgId, 0, userData);\n"
+                        "            continue;\n"
+                        "        }\n");
+    }
     _output->append("        default:\n"
                     "            PHOTON_CRITICAL(\"Recieved invalid component id (%u)\", (unsigned)compId);\n"
                     "            return PhotonError_InvalidComponentId;\n"
@@ -362,6 +885,9 @@ void StatusEncoderGen::appendInlineSerializer(const VarRegexp* part, SrcBuilder*
             auto sacc = static_cast<const SubscriptAccessor*>(acc);
             const Type* type = sacc->type();
             if (type->isDynArray()) {
+                if (isSerializer) {
+                    _inlineInspector.appendVarSizeCheck<true, true>(ctx, _output);
+                }
                 _output->appendIndent(ctx);
                 if (isSerializer) {
                     _output->append("PHOTON_TRY_MSG(PhotonWriter_WriteVaruint(dest, ");
@@ -445,6 +971,93 @@ void StatusEncoderGen::appendInlineSerializer(const VarRegexp* part, SrcBuilder*
     }
 }
 
+void StatusEncoderGen::appendEventSerializer(const EventMsg* msg)
+{
+    InlineSerContext ctx;
+    StringBuilder nameBuilder;
+    nameBuilder.reserve(15);
+    for (const Field* field : msg->partsRange()) {
+        derefPassedVarNameIfRequired(field->type(), field->name(), &nameBuilder);
+        _inlineInspector.inspect<true, true>(field->type(), ctx, nameBuilder.view());
+        nameBuilder.clear();
+    }
+}
+
+void StatusEncoderGen::appendQueuedEventEncoder(const Component* comp, const EventMsg* msg, TypeReprGen* reprGen)
+{
+    _output->append("static ");
+    _prototypeGen.appendEventSerializerFunctionPrototype(comp, msg, reprGen);
+    _output->append("\n{\n");
+    if (_inlineInspector.isSegmentedWriter()) {
+        _output->appendSegWriterDest();
+    }
+    _output->append("    PhotonWriter_WriteU8(dest, ");
+    _output->appendNumericValue(comp->number());
+    _output->append(");\n    PhotonWriter_WriteU8(dest, ");
+    _output->appendNumericValue(msg->number());
+    _output->append(");\n");
+
+    appendEventSerializer(msg);
+
+    _output->append("    return PhotonError_Ok;\n}\n\n");
+
+    _prototypeGen.appendEventEncoderFunctionPrototype(comp, msg, reprGen);
+    bool isSegmented = _inlineInspector.isSegmentedWriter();
+    bmcl::StringView writer = isSegmented ? "PhotonSegWriter_Writer(&seg)" : "&dest";
+    _output->append("\n{\n");
+    if (isSegmented) {
+        _output->append("    PhotonSegWriter seg;\n");
+    } else {
+        _output->append("    PhotonWriter dest;\n");
+    }
+    _output->append("    PhotonError rv;\n");
+    if (_useMsgStats) {
+        _output->append("    uint64_t start;\n");
+    }
+    _output->append("    PhotonEventQueueSlot* slot = PhotonEventQueue_Reserve();\n"
+                    "    if (!slot) {\n"
+                    "        PHOTON_DEBUG(\"Event queue is full\");\n"
+                    "        return PhotonError_NotEnoughSpace;\n"
+                    "    }\n");
+    //slot is sized for the largest event, a flat writer never spills
+    if (isSegmented) {
+        _output->append("    PhotonSegWriter_InitFlat(&seg, slot->data, sizeof(slot->data));\n");
+    } else {
+        _output->append("    PhotonWriter_Init(&dest, slot->data, sizeof(slot->data));\n");
+    }
+    if (_useMsgStats) {
+        _output->append("    start = PHOTON_MSG_STATS_NOW();\n");
+    }
+    _output->append("    rv = ");
+    _prototypeGen.appendEventSerializerFunctionName(comp, msg);
+    _output->append("(");
+    for (const Field* field : msg->partsRange()) {
+        _output->append(field->name());
+        _output->append(", ");
+    }
+    if (isSegmented) {
+        _output->append("&seg);\n");
+    } else {
+        _output->append("&dest);\n");
+    }
+    if (_useMsgStats) {
+        _output->append("    PhotonMsgStats_RecordEncode(");
+        MsgStatsGen::appendIndexName(comp, msg, _output);
+        _output->append(", rv, sizeof(slot->data) - PhotonWriter_WritableSize(");
+        _output->append(writer);
+        _output->append("), start);\n");
+    }
+    _output->append("    if (rv != PhotonError_Ok) {\n"
+                    "        PhotonEventQueue_Commit(slot, 0);\n"
+                    "        return rv;\n"
+                    "    }\n"
+                    "    PhotonEventQueue_Commit(slot, sizeof(slot->data) - PhotonWriter_WritableSize(");
+    _output->append(writer);
+    _output->append("));\n"
+                    "    return PhotonError_Ok;\n"
+                    "}\n");
+}
+
 void StatusEncoderGen::generateEventEncoderSource(const Project* project)
 {
     for (const Ast* ast : project->package()->modules()) {
@@ -456,6 +1069,13 @@ void StatusEncoderGen::generateEventEncoderSource(const Project* project)
         _output->append(".Component.h\"\n");
         _output->appendEndif();
     }
+    if (_useEventQueue && _useMsgStats) {
+        _output->append("#include \"photongen/onboard/MsgStats.h\"\n");
+    }
+    if (_useEventQueue) {
+        _output->append("#include \"photongen/onboard/EventQueue.h\"\n");
+        _output->appendImplIncludePath("core/Logging");
+    }
     _output->appendEol();
     _output->append("#define _PHOTON_FNAME \"photon/EventEncoder.c\"\n\n");
 
@@ -467,27 +1087,41 @@ void StatusEncoderGen::generateEventEncoderSource(const Project* project)
         }
         _output->appendModIfdef(comp->moduleName());
         for (const EventMsg* msg : comp->eventsRange()) {
+            if (_useEventQueue) {
+                appendQueuedEventEncoder(comp, msg, &reprGen);
+                continue;
+            }
             _prototypeGen.appendEventEncoderFunctionPrototype(comp, msg, &reprGen);
-            if (msg->partsRange().size() == 0) {
-                _output->append("\n{\n    PhotonTm_BeginEventMsg(");
+            bool isSegmented = _inlineInspector.isSegmentedWriter();
+            bool hasParts = msg->partsRange().size() != 0;
+            _output->append("\n{\n    ");
+            if (isSegmented) {
+                // event is written into the frame chain of the telemetry runtime
+                if (hasParts) {
+                    _output->append("PhotonSegWriter* seg = ");
+                }
+                _output->append("PhotonTm_BeginEventSegMsg(");
             } else {
-                _output->append("\n{\n    PhotonWriter* dest = PhotonTm_BeginEventMsg(");
+                if (hasParts) {
+                    _output->append("PhotonWriter* dest = ");
+                }
+                _output->append("PhotonTm_BeginEventMsg(");
             }
             _output->appendNumericValue(comp->number());
             _output->append(", ");
             _output->appendNumericValue(msg->number());
             _output->append(");\n");
 
-            InlineSerContext ctx;
-            StringBuilder nameBuilder;
-            nameBuilder.reserve(15);
-            for (const Field* field : msg->partsRange()) {
-                derefPassedVarNameIfRequired(field->type(), field->name(), &nameBuilder);
-                _inlineInspector.inspect<true, true>(field->type(), ctx, nameBuilder.view());
-                nameBuilder.clear();
+            if (isSegmented && hasParts) {
+                _output->appendSegWriterDest();
             }
+            appendEventSerializer(msg);
 
-            _output->append("    PhotonTm_EndEventMsg();\n    return PhotonError_Ok;\n");
+            if (isSegmented) {
+                _output->append("    PhotonTm_EndEventSegMsg();\n    return PhotonError_Ok;\n");
+            } else {
+                _output->append("    PhotonTm_EndEventMsg();\n    return PhotonError_Ok;\n");
+            }
             _output->append("}\n");
         }
         _output->appendEndif();
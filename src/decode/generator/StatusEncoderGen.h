@@ -23,12 +23,23 @@ class SrcBuilder;
 class Project;
 class VarRegexp;
 class Type;
+class Component;
+class EventMsg;
+class StatusMsg;
+class TypeDependsIndex;
 
 class StatusEncoderGen {
 public:
     StatusEncoderGen(SrcBuilder* output);
     ~StatusEncoderGen();
 
+    void setSegmentedWriter(bool isSegmented);
+    void setEventQueue(bool useEventQueue);
+    void setSeqlockVars(bool useSeqlock);
+    void setAutosaveJournal(bool useJournal);
+    void setMsgStats(bool useMsgStats);
+    void setDependsIndex(const TypeDependsIndex* index);
+
     void generateStatusDecoderHeader(const Project* project);
     void generateStatusDecoderSource(const Project* project);
 
@@ -39,12 +50,24 @@ public:
     void generateAutosaveSource(const Project* project);
 
 private:
+    bmcl::StringView writerArgName() const;
     void appendInlineSerializer(const VarRegexp * part, SrcBuilder* currentField, bool isSerializer);
     template <typename T>
     void appendMsgSwitch(const Component* comp, const T* msg);
+    void appendAutosaveJournal(const Project* project);
+    void appendAutosaveJournalEntryPoints();
+    void appendVarsSnapshot(const Component* comp, const StatusMsg* msg);
+    void appendStatsEncoderWrapper(const Component* comp, const StatusMsg* msg);
+    void appendEventSerializer(const EventMsg* msg);
+    void appendQueuedEventEncoder(const Component* comp, const EventMsg* msg, TypeReprGen* reprGen);
 
     SrcBuilder* _output;
     InlineTypeInspector _inlineInspector;
     FuncPrototypeGen _prototypeGen;
+    bool _useEventQueue;
+    bool _useSeqlock;
+    bool _useAutosaveJournal;
+    bool _useMsgStats;
+    const TypeDependsIndex* _dependsIndex;
 };
 }
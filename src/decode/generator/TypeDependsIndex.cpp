@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "decode/generator/TypeDependsIndex.h"
+#include "decode/core/Tracer.h"
+#include "decode/ast/Ast.h"
+#include "decode/ast/Component.h"
+#include "decode/ast/Type.h"
+#include "decode/parser/Package.h"
+
+namespace decode {
+
+TypeDependsIndex::TypeDependsIndex()
+{
+}
+
+TypeDependsIndex::~TypeDependsIndex()
+{
+}
+
+void TypeDependsIndex::build(const Package* package)
+{
+    TraceScope trace("generator", "TypeDependsIndex::build");
+    clear();
+    TypeDependsCollector coll;
+    TypeDependsCollector::Depends depends;
+    for (const Ast* ast : package->modules()) {
+        ModuleDepends& dest = _modules[ast];
+        coll.collect(ast, &depends);
+        toBits(depends, &dest.types);
+        depends.clear();
+        if (ast->component().isNone()) {
+            continue;
+        }
+        const Component* comp = ast->component().unwrap();
+        _componentModules.emplace(comp, ast);
+
+        coll.collect(comp, &depends);
+        toBits(depends, &dest.vars);
+        depends.clear();
+        coll.collectCmds(comp->cmdsRange(), &depends);
+        toBits(depends, &dest.cmds);
+        depends.clear();
+        coll.collectStatuses(comp->statusesRange(), &depends);
+        toBits(depends, &dest.statuses);
+        depends.clear();
+        coll.collectEvents(comp->eventsRange(), &depends);
+        toBits(depends, &dest.events);
+        depends.clear();
+    }
+}
+
+void TypeDependsIndex::clear()
+{
+    _indices.clear();
+    _types.clear();
+    _modules.clear();
+    _componentModules.clear();
+}
+
+void TypeDependsIndex::toBits(const TypeDependsCollector::Depends& src, Bits* dest)
+{
+    for (const Rc<const Type>& type : src) {
+        auto it = _indices.emplace(type, _types.size());
+        if (it.second) {
+            _types.push_back(type);
+        }
+        std::size_t index = it.first->second;
+        if (dest->size() <= index / 64) {
+            dest->resize(index / 64 + 1, 0);
+        }
+        (*dest)[index / 64] |= std::uint64_t(1) << (index % 64);
+    }
+}
+
+void TypeDependsIndex::unite(Bits* dest, const Bits& src)
+{
+    if (dest->size() < src.size()) {
+        dest->resize(src.size(), 0);
+    }
+    for (std::size_t i = 0; i < src.size(); i++) {
+        (*dest)[i] |= src[i];
+    }
+}
+
+void TypeDependsIndex::toDepends(const Bits& bits, TypeDependsCollector::Depends* dest) const
+{
+    for (std::size_t i = 0; i < bits.size(); i++) {
+        std::uint64_t word = bits[i];
+        for (std::size_t j = 0; word != 0; j++, word >>= 1) {
+            if (word & 1) {
+                dest->emplace(_types[i * 64 + j]);
+            }
+        }
+    }
+}
+
+bmcl::OptionPtr<const TypeDependsIndex::ModuleDepends> TypeDependsIndex::moduleDepends(const Ast* ast) const
+{
+    auto it = _modules.find(ast);
+    if (it == _modules.end()) {
+        return bmcl::None;
+    }
+    return &it->second;
+}
+
+bmcl::OptionPtr<const TypeDependsIndex::ModuleDepends> TypeDependsIndex::componentDepends(const Component* comp) const
+{
+    auto it = _componentModules.find(comp);
+    if (it == _componentModules.end()) {
+        return bmcl::None;
+    }
+    return moduleDepends(it->second.get());
+}
+
+std::size_t TypeDependsIndex::typeCount() const
+{
+    return _types.size();
+}
+
+std::size_t TypeDependsIndex::memoryUsage() const
+{
+    std::size_t size = _types.capacity() * sizeof(Rc<const Type>);
+    for (const auto& it : _modules) {
+        const ModuleDepends& deps = it.second;
+        for (const Bits* bits : {&deps.types, &deps.vars, &deps.cmds, &deps.statuses, &deps.events}) {
+            size += bits->capacity() * sizeof(std::uint64_t);
+        }
+    }
+    return size;
+}
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "decode/Config.h"
+#include "decode/core/Rc.h"
+#include "decode/core/HashMap.h"
+#include "decode/generator/TypeDependsCollector.h"
+
+#include <bmcl/OptionPtr.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace decode {
+
+class Ast;
+class Component;
+class Package;
+
+// type dependencies of every module and its component collected once per package,
+// sets are stored as bitsets over an index of all collected types and combined by union
+class TypeDependsIndex {
+public:
+    using Bits = std::vector<std::uint64_t>;
+
+    struct ModuleDepends {
+        Bits types;
+        Bits vars;
+        Bits cmds;
+        Bits statuses;
+        Bits events;
+    };
+
+    TypeDependsIndex();
+    ~TypeDependsIndex();
+
+    void build(const Package* package);
+    void clear();
+
+    bmcl::OptionPtr<const ModuleDepends> moduleDepends(const Ast* ast) const;
+    bmcl::OptionPtr<const ModuleDepends> componentDepends(const Component* comp) const;
+
+    void toDepends(const Bits& bits, TypeDependsCollector::Depends* dest) const;
+
+    std::size_t typeCount() const;
+    std::size_t memoryUsage() const;
+
+    static void unite(Bits* dest, const Bits& src);
+
+private:
+    void toBits(const TypeDependsCollector::Depends& src, Bits* dest);
+
+    HashMap<Rc<const Type>, std::size_t> _indices;
+    std::vector<Rc<const Type>> _types;
+    HashMap<Rc<const Ast>, ModuleDepends> _modules;
+    HashMap<Rc<const Component>, Rc<const Ast>> _componentModules;
+};
+}
@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "decode/generator/TypeNameCache.h"
+#include "decode/ast/Type.h"
+#include "decode/ast/Ast.h"
+#include "decode/ast/AllBuiltinTypes.h"
+#include "decode/parser/Package.h"
+
+#include <cassert>
+
+namespace decode {
+
+std::atomic<TypeNameCache*> TypeNameCache::_current(nullptr);
+
+TypeNameCache::TypeNameCache()
+    : _stringBytes(0)
+{
+}
+
+TypeNameCache::~TypeNameCache()
+{
+}
+
+void TypeNameCache::setCurrent(TypeNameCache* cache)
+{
+    _current.store(cache, std::memory_order_relaxed);
+}
+
+void TypeNameCache::addPackageTypes(const Package* package)
+{
+    for (const Ast* ast : package->modules()) {
+        for (const Type* type : ast->typesRange()) {
+            addCacheableType(type);
+        }
+        const AllBuiltinTypes* builtins = ast->builtinTypes();
+        for (const Type* type : {builtins->usizeType(), builtins->isizeType(), builtins->varintType(),
+                                 builtins->varuintType(), builtins->u8Type(), builtins->u16Type(),
+                                 builtins->u32Type(), builtins->u64Type(), builtins->i8Type(),
+                                 builtins->i16Type(), builtins->i32Type(), builtins->i64Type(),
+                                 builtins->f32Type(), builtins->f64Type(), builtins->boolType(),
+                                 builtins->voidType(), builtins->charType()}) {
+            addCacheableType(type);
+        }
+    }
+}
+
+void TypeNameCache::addCacheableType(const Type* type)
+{
+    _cacheable.emplace(type);
+}
+
+bool TypeNameCache::isCacheable(const Type* type) const
+{
+    return _cacheable.find(type) != _cacheable.end();
+}
+
+bmcl::StringView TypeNameCache::intern(bmcl::StringView str)
+{
+    auto it = _strings.emplace(str.toStdString());
+    if (it.second) {
+        _stringBytes += str.size();
+    }
+    return bmcl::StringView(*it.first);
+}
+
+bmcl::Option<bmcl::StringView> TypeNameCache::findTypeName(const Type* type) const
+{
+    auto it = _names.find(type);
+    if (it == _names.end()) {
+        return bmcl::None;
+    }
+    return it->second;
+}
+
+bmcl::StringView TypeNameCache::addTypeName(const Type* type, bmcl::StringView name)
+{
+    assert(isCacheable(type));
+    bmcl::StringView interned = intern(name);
+    _names.emplace(type, interned);
+    return interned;
+}
+
+bmcl::OptionPtr<const TypeNameCache::Repr> TypeNameCache::findTypeRepr(const Type* type, bool isOnboard) const
+{
+    const ReprMap& reprs = isOnboard ? _onboardReprs : _gcReprs;
+    auto it = reprs.find(type);
+    if (it == reprs.end()) {
+        return bmcl::None;
+    }
+    return &it->second;
+}
+
+const TypeNameCache::Repr& TypeNameCache::addTypeRepr(const Type* type, bool isOnboard, bmcl::StringView prefix, bmcl::StringView suffix)
+{
+    assert(isCacheable(type));
+    ReprMap& reprs = isOnboard ? _onboardReprs : _gcReprs;
+    Repr repr{intern(prefix), intern(suffix)};
+    return reprs.emplace(type, repr).first->second;
+}
+
+void TypeNameCache::clear()
+{
+    _cacheable.clear();
+    _names.clear();
+    _onboardReprs.clear();
+    _gcReprs.clear();
+    _strings.clear();
+    _stringBytes = 0;
+}
+
+std::size_t TypeNameCache::stringCount() const
+{
+    return _strings.size();
+}
+
+std::size_t TypeNameCache::stringBytes() const
+{
+    return _stringBytes;
+}
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "decode/Config.h"
+#include "decode/core/Rc.h"
+#include "decode/core/HashMap.h"
+#include "decode/core/HashSet.h"
+
+#include <bmcl/StringView.h>
+#include <bmcl/Option.h>
+#include <bmcl/OptionPtr.h>
+
+#include <atomic>
+#include <string>
+
+namespace decode {
+
+class Package;
+class Type;
+
+// type names and type representations computed once per type of a package,
+// TypeNameGen and TypeReprGen append stored strings while a cache is current
+//
+// only types added with addPackageTypes or addCacheableType are cached, generators build temporary
+// types and mutate them between uses (pointee of a reused reference), those are always generated
+class TypeNameCache {
+public:
+    // representation with a field name is prefix + ' ' + name + suffix, without it prefix + suffix
+    struct Repr {
+        bmcl::StringView prefix;
+        bmcl::StringView suffix;
+    };
+
+    TypeNameCache();
+    ~TypeNameCache();
+
+    // null when caching is disabled, used only from generator thread
+    static TypeNameCache* current()
+    {
+        return _current.load(std::memory_order_relaxed);
+    }
+
+    static void setCurrent(TypeNameCache* cache);
+
+    void addPackageTypes(const Package* package);
+    void addCacheableType(const Type* type);
+    bool isCacheable(const Type* type) const;
+
+    bmcl::Option<bmcl::StringView> findTypeName(const Type* type) const;
+    bmcl::StringView addTypeName(const Type* type, bmcl::StringView name);
+
+    bmcl::OptionPtr<const Repr> findTypeRepr(const Type* type, bool isOnboard) const;
+    const Repr& addTypeRepr(const Type* type, bool isOnboard, bmcl::StringView prefix, bmcl::StringView suffix);
+
+    void clear();
+
+    std::size_t stringCount() const;
+    std::size_t stringBytes() const;
+
+private:
+    using ReprMap = HashMap<Rc<const Type>, Repr>;
+
+    bmcl::StringView intern(bmcl::StringView str);
+
+    static std::atomic<TypeNameCache*> _current;
+
+    HashSet<Rc<const Type>> _cacheable;
+    HashMap<Rc<const Type>, bmcl::StringView> _names;
+    ReprMap _onboardReprs;
+    ReprMap _gcReprs;
+    HashSet<std::string> _strings;
+    std::size_t _stringBytes;
+};
+
+class TypeNameCacheScope {
+public:
+    TypeNameCacheScope(TypeNameCache* cache)
+        : _previous(TypeNameCache::current())
+    {
+        TypeNameCache::setCurrent(cache);
+    }
+
+    ~TypeNameCacheScope()
+    {
+        TypeNameCache::setCurrent(_previous);
+    }
+
+    TypeNameCacheScope(const TypeNameCacheScope&) = delete;
+    TypeNameCacheScope& operator=(const TypeNameCacheScope&) = delete;
+
+private:
+    TypeNameCache* _previous;
+};
+}
@@ -7,6 +7,7 @@
  */
 
 #include "decode/generator/TypeNameGen.h"
+#include "decode/generator/TypeNameCache.h"
 #include "decode/core/StringBuilder.h"
 #include "decode/ast/Decl.h"
 
@@ -110,6 +111,19 @@ bool TypeNameGen::appendTypeName(const NamedType* type)
 
 void TypeNameGen::genTypeName(const Type* type)
 {
-    traverseType(type);
+    TypeNameCache* cache = TypeNameCache::current();
+    if (!cache || !cache->isCacheable(type)) {
+        traverseType(type);
+        return;
+    }
+    bmcl::Option<bmcl::StringView> name = cache->findTypeName(type);
+    if (name.isSome()) {
+        _output->append(name.unwrap());
+        return;
+    }
+    SrcBuilder temp;
+    TypeNameGen gen(&temp);
+    gen.traverseType(type);
+    _output->append(cache->addTypeName(type, temp.view()));
 }
 }
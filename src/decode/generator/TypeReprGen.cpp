@@ -9,10 +9,14 @@
 #include "decode/generator/TypeReprGen.h"
 #include "decode/core/Foreach.h"
 #include "decode/generator/TypeNameGen.h"
+#include "decode/generator/TypeNameCache.h"
 #include "decode/ast/Type.h"
 
 #include <bmcl/Logging.h>
 
+#include <algorithm>
+#include <cassert>
+
 namespace decode {
 
 TypeReprGen::TypeReprGen(SrcBuilder* dest)
@@ -343,12 +347,41 @@ void TypeReprGen::genGcTypeRepr(const Type* type, bmcl::StringView fieldName)
 template <bool isOnboard>
 void TypeReprGen::genTypeRepr(const Type* type)
 {
-    _currentOffset = _output->size();
-    writeType<isOnboard>(type);
+    genTypeRepr<isOnboard>(type, bmcl::StringView::empty());
 }
 
 template <bool isOnboard>
 void TypeReprGen::genTypeRepr(const Type* type, bmcl::StringView fieldName)
+{
+    TypeNameCache* cache = TypeNameCache::current();
+    if (!cache || !cache->isCacheable(type)) {
+        writeTypeRepr<isOnboard>(type, fieldName);
+        return;
+    }
+    const TypeNameCache::Repr* repr;
+    bmcl::OptionPtr<const TypeNameCache::Repr> found = cache->findTypeRepr(type, isOnboard);
+    if (found.isSome()) {
+        repr = found.unwrap();
+    } else {
+        // field name is written between declarator parts, split around a marker that never occurs in types
+        SrcBuilder temp;
+        TypeReprGen gen(&temp);
+        gen.writeTypeRepr<isOnboard>(type, "@");
+        bmcl::StringView view = temp.view();
+        std::size_t marker = std::find(view.begin(), view.end(), '@') - view.begin();
+        assert(marker > 0 && view[marker - 1] == ' ');
+        repr = &cache->addTypeRepr(type, isOnboard, view.sliceTo(marker - 1), view.sliceFrom(marker + 1));
+    }
+    _output->append(repr->prefix);
+    if (!fieldName.isEmpty()) {
+        _output->append(' ');
+        _output->append(fieldName);
+    }
+    _output->append(repr->suffix);
+}
+
+template <bool isOnboard>
+void TypeReprGen::writeTypeRepr(const Type* type, bmcl::StringView fieldName)
 {
     _currentOffset = _output->size();
     if (!fieldName.isEmpty()) {
@@ -43,6 +43,8 @@ private:
     template <bool isOnboard>
     void genTypeRepr(const Type* type, bmcl::StringView fieldName);
     template <bool isOnboard>
+    void writeTypeRepr(const Type* type, bmcl::StringView fieldName);
+    template <bool isOnboard>
     void writeBuiltin(const BuiltinType* type);
     template <bool isOnboard>
     void writeArray(const ArrayType* type);
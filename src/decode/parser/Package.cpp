@@ -9,6 +9,7 @@
 #include "decode/parser/Package.h"
 
 #include "decode/core/Configuration.h"
+#include "decode/core/Tracer.h"
 #include "decode/core/Diagnostics.h"
 #include "decode/core/Try.h"
 #include "decode/core/Utils.h"
@@ -20,6 +21,7 @@
 #include "decode/ast/Decl.h"
 #include "decode/ast/Type.h"
 #include "decode/ast/Field.h"
+#include "decode/ast/TypeInterner.h"
 #include "decode/parser/Parser.h"
 
 #include <bmcl/Buffer.h>
@@ -52,6 +54,7 @@ Package::~Package()
 
 PackageResult Package::readFromFiles(Configuration* cfg, Diagnostics* diag, bmcl::ArrayView<std::string> files)
 {
+    TraceScope trace("package", "Package::readFromFiles");
     Rc<Package> package = new Package(cfg, diag);
     Parser p(diag);
 
@@ -129,6 +132,7 @@ bool Package::addFile(const char* path, Parser* p)
 {
     ProgressPrinter printer(_cfg->verboseOutput());
     printer.printActionProgress("Parsing", "file `" + std::string(path) + "`");
+    TraceScope trace("parser", "Parser::parseFile", path);
     ParseResult ast = p->parseFile(path);
     if (ast.isErr()) {
         return false;
@@ -139,6 +143,131 @@ bool Package::addFile(const char* path, Parser* p)
     return true;
 }
 
+static void appendGenericInstanceKey(const Type* type, std::string* dest);
+
+static void appendNamedTypeKey(const NamedType* type, std::string* dest)
+{
+    dest->append(type->moduleName().begin(), type->moduleName().end());
+    dest->append("::");
+    dest->append(type->name().begin(), type->name().end());
+}
+
+static void appendSubstitutedTypesKey(bmcl::ArrayView<Rc<Type>> types, std::string* dest)
+{
+    dest->push_back('<');
+    for (const Rc<Type>& t : types) {
+        appendGenericInstanceKey(t.get(), dest);
+        dest->push_back(',');
+    }
+    dest->push_back('>');
+}
+
+// builds a string that is equal for structurally equal substituted types no matter where they were written
+static void appendGenericInstanceKey(const Type* type, std::string* dest)
+{
+    switch (type->typeKind()) {
+    case TypeKind::Builtin:
+        dest->append(BuiltinType::renderedTypeName(type->asBuiltin()->builtinTypeKind()).toStdString());
+        return;
+    case TypeKind::Reference: {
+        const ReferenceType* ref = type->asReference();
+        dest->push_back(ref->referenceKind() == ReferenceKind::Pointer ? '*' : '&');
+        if (ref->isMutable()) {
+            dest->append("mut ");
+        }
+        appendGenericInstanceKey(ref->pointee(), dest);
+        return;
+    }
+    case TypeKind::Array:
+        dest->push_back('[');
+        appendGenericInstanceKey(type->asArray()->elementType(), dest);
+        dest->push_back(';');
+        dest->append(std::to_string(type->asArray()->elementCount()));
+        dest->push_back(']');
+        return;
+    case TypeKind::DynArray:
+        dest->append("&[");
+        appendGenericInstanceKey(type->asDynArray()->elementType(), dest);
+        dest->push_back(';');
+        dest->append(std::to_string(type->asDynArray()->maxSize()));
+        dest->push_back(']');
+        return;
+    case TypeKind::Function: {
+        const FunctionType* func = type->asFunction();
+        dest->append("fn(");
+        if (func->selfArgument().isSome()) {
+            dest->append(std::to_string((int)func->selfArgument().unwrap()));
+            dest->append("self,");
+        }
+        for (const Field* arg : func->argumentsRange()) {
+            appendGenericInstanceKey(arg->type(), dest);
+            dest->push_back(',');
+        }
+        dest->push_back(')');
+        if (func->hasReturnValue()) {
+            dest->append("->");
+            appendGenericInstanceKey(func->returnValue().unwrap(), dest);
+        }
+        return;
+    }
+    case TypeKind::Imported: {
+        const ImportedType* imported = type->asImported();
+        if (imported->link()) {
+            appendGenericInstanceKey(imported->link(), dest);
+        } else {
+            appendNamedTypeKey(imported, dest);
+        }
+        return;
+    }
+    case TypeKind::GenericInstantiation: {
+        const GenericInstantiationType* inst = type->asGenericInstantiation();
+        const NamedType* generic = inst->genericType();
+        if (!generic) {
+            generic = inst->instantiatedType();
+            if (generic->isImported() && generic->asImported()->link()) {
+                generic = generic->asImported()->link();
+            }
+        }
+        appendNamedTypeKey(generic, dest);
+        dest->push_back('<');
+        for (const Type* t : inst->substitutedTypesRange()) {
+            appendGenericInstanceKey(t, dest);
+            dest->push_back(',');
+        }
+        dest->push_back('>');
+        return;
+    }
+    case TypeKind::GenericParameter:
+        dest->push_back('$');
+        dest->append(type->asGenericParemeter()->name().toStdString());
+        return;
+    case TypeKind::Struct:
+    case TypeKind::Variant:
+    case TypeKind::Enum:
+    case TypeKind::Alias:
+    case TypeKind::Generic:
+        appendNamedTypeKey(static_cast<const NamedType*>(type), dest);
+        return;
+    }
+}
+
+bmcl::Result<Rc<NamedType>, std::string> Package::instantiateGeneric(GenericType* generic, bmcl::ArrayView<Rc<Type>> types)
+{
+    std::string key;
+    appendNamedTypeKey(generic, &key);
+    appendSubstitutedTypesKey(types, &key);
+
+    auto it = _genericInstances.find(key);
+    if (it != _genericInstances.end()) {
+        return it->second;
+    }
+    auto rv = generic->instantiate(types);
+    if (rv.isOk()) {
+        _genericInstances.emplace(std::move(key), rv.unwrap());
+    }
+    return rv;
+}
+
 bool Package::resolveGenerics(Ast* ast)
 {
     bool isOk = true;
@@ -148,7 +277,7 @@ bool Package::resolveGenerics(Ast* ast)
             t = t->asImported()->link();
         }
         if (t->isGeneric()) {
-            auto rv = t->asGeneric()->instantiate(type->substitutedTypes());
+            auto rv = instantiateGeneric(t->asGeneric(), type->substitutedTypes());
             if (rv.isErr()) {
                 BMCL_CRITICAL() << "failed to instantiate type " + type->genericName().toStdString() + ": " + rv.unwrapErr();
                 isOk = false;
@@ -251,6 +380,7 @@ bool Package::resolveParameters(Ast* ast, uint64_t* paramNum)
             BMCL_CRITICAL() << "variable can only be of builtin type";
             return false;
         }
+        param->setType(const_cast<Type*>(lastType->resolveFinalType())->asBuiltin()); //HACK
     }
     return true;
 }
@@ -366,7 +496,7 @@ bool Package::resolveVarRegexp(Ast* ast, Component* comp, VarRegexp* re)
         } else {
             assert(false);
         }
-        ast->addType(contType.get());
+        contType = ast->typeInterner()->intern(contType.get(), ast);
     } else {
         contType = lastField->type();
     }
@@ -386,9 +516,11 @@ bool Package::mapComponent(Ast* ast)
 
 bool Package::resolveAll()
 {
+    TraceScope trace("package", "Package::resolveAll");
     bool isOk = true;
     uint64_t paramNum = 0;
     for (Ast* modifiedAst : modules()) {
+        TraceScope moduleTrace("package", "resolveModule", modifiedAst->moduleName());
         //BMCL_DEBUG() << "resolving " << modifiedAst->moduleInfo()->moduleName().toStdString();
         TRY(mapComponent(modifiedAst));
         isOk &= resolveImports(modifiedAst);
@@ -10,11 +10,14 @@
 
 #include "decode/Config.h"
 #include "decode/core/Rc.h"
+#include "decode/core/HashMap.h"
 #include "decode/parser/Containers.h"
 
 #include <bmcl/Fwd.h>
 #include <bmcl/Buffer.h>
 
+#include <string>
+
 namespace decode {
 
 class Ast;
@@ -24,6 +27,9 @@ class Package;
 class Component;
 class VarRegexp;
 class Configuration;
+class NamedType;
+class GenericType;
+class Type;
 struct ComponentAndMsg;
 
 using PackageResult = bmcl::Result<Rc<Package>, void>;
@@ -71,6 +77,7 @@ private:
     bool resolveAll();
     bool resolveImports(Ast* ast);
     bool resolveGenerics(Ast* ast);
+    bmcl::Result<Rc<NamedType>, std::string> instantiateGeneric(GenericType* generic, bmcl::ArrayView<Rc<Type>> types);
     bool resolveStatuses(Ast* ast);
     bool resolveParameters(Ast* ast, uint64_t* paramNum);
 
@@ -83,6 +90,7 @@ private:
     AstMap _modNameToAstMap;
     ComponentMap _components;
     CompAndMsgVec _statusMsgs;
+    HashMap<std::string, Rc<NamedType>> _genericInstances;
 };
 
 }
@@ -14,7 +14,9 @@
 #include "decode/core/HashMap.h"
 #include "decode/core/RangeAttr.h"
 #include "decode/core/CmdCallAttr.h"
+#include "decode/core/Tracer.h"
 #include "decode/ast/AllBuiltinTypes.h"
+#include "decode/ast/TypeInterner.h"
 #include "decode/ast/Decl.h"
 #include "decode/ast/DocBlock.h"
 #include "decode/ast/Ast.h"
@@ -54,6 +56,7 @@ namespace decode {
 Parser::Parser(Diagnostics* diag)
     : _diag(diag)
     , _builtinTypes(new AllBuiltinTypes)
+    , _typeInterner(new TypeInterner)
     , _currentTmMsgNum(0)
 {
     ADD_BUILTIN_MAP(usize, "usize");
@@ -212,12 +215,15 @@ void Parser::reportUnexpectedTokenError(TokenKind expected)
 
 ParseResult Parser::parseFile(const char* fname)
 {
-    bmcl::Result<std::string, int> rv = bmcl::readFileIntoString(fname);
-    if (rv.isErr()) {
-        return ParseResult();
+    Rc<FileInfo> finfo;
+    {
+        TraceScope trace("parser", "readFile", fname);
+        bmcl::Result<std::string, int> rv = bmcl::readFileIntoString(fname);
+        if (rv.isErr()) {
+            return ParseResult();
+        }
+        finfo = new FileInfo(std::string(fname), rv.take());
     }
-
-    Rc<FileInfo> finfo = new FileInfo(std::string(fname), rv.take());
     return parseFile(finfo.get());
 }
 
@@ -409,6 +415,7 @@ void Parser::clearUnusedDocCommentsAndAttributes()
 {
     _lastRangeAttr.reset();
     _lastCmdCallAttr.reset();
+    _lastCfgOption.reset();
     _docComments.clear();
 }
 
@@ -569,8 +576,8 @@ bool Parser::parseAttribute()
         TRY(expectCurrentToken(TokenKind::LParen));
         consumeAndSkipBlanks();
 
-        Rc<CfgOption> opt = parseCfgOption();
-        if (opt.isNull()) {
+        _lastCfgOption = parseCfgOption();
+        if (_lastCfgOption.isNull()) {
             return false;
         }
 
@@ -953,8 +960,7 @@ Rc<Type> Parser::parseReferenceType()
     }
 
     Rc<ReferenceType> type = new ReferenceType(ReferenceKind::Reference, isMutable, pointee.get());
-    _ast->addType(type.get());
-    return type;
+    return _typeInterner->intern(type.get(), _ast.get());
 }
 
 Rc<Type> Parser::parsePointerType()
@@ -984,8 +990,7 @@ Rc<Type> Parser::parsePointerType()
 
     if (!pointee.isNull()) {
         Rc<ReferenceType> type = new ReferenceType(ReferenceKind::Pointer, isMutable, pointee.get());
-        _ast->addType(type.get());
-        return type;
+        return _typeInterner->intern(type.get(), _ast.get());
     }
 
     return nullptr;
@@ -1052,8 +1057,7 @@ Rc<Type> Parser::parseFunctionPointer()
     }
     //TODO: skip past eol
 
-    _ast->addType(fn.get());
-    return fn;
+    return _typeInterner->intern(fn.get(), _ast.get());
 }
 
 Rc<Type> Parser::parseDynArrayType()
@@ -1079,8 +1083,7 @@ Rc<Type> Parser::parseDynArrayType()
     consume();
 
     Rc<DynArrayType> type = new DynArrayType(maxSize, innerType.get());
-    _ast->addType(type.get());
-    return type;
+    return _typeInterner->intern(type.get(), _ast.get());
 }
 
 Rc<Type> Parser::parseArrayType()
@@ -1106,8 +1109,7 @@ Rc<Type> Parser::parseArrayType()
     consume();
 
     Rc<ArrayType> type = new ArrayType(elementCount, innerType.get());
-    _ast->addType(type.get());
-    return type;
+    return _typeInterner->intern(type.get(), _ast.get());
 }
 
 bool Parser::parseUnsignedInteger(std::uintmax_t* dest)
@@ -1451,6 +1453,9 @@ bool Parser::parseCommands(Component* parent)
                 arg.setArgPassKind(kind);
             }
         }
+        if (!_lastCfgOption.isNull()) {
+            fn->setCfgOption(_lastCfgOption.get());
+        }
         fn->setDocs(docs.get());
         fn->setNumber(comp->cmdsRange().size());
         comp->addCommand(fn.get());
@@ -1858,7 +1863,7 @@ bool Parser::parseOneFile(FileInfo* finfo)
 
     _lastLineStart = _fileInfo->contents().c_str();
     _lexer = new Lexer(bmcl::StringView(_fileInfo->contents()));
-    _ast = new Ast(_builtinTypes.get());
+    _ast = new Ast(_builtinTypes.get(), _typeInterner.get());
 
     _lexer->consumeNextToken(&_currentToken);
     TRY(skipCommentsAndSpace());
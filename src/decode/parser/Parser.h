@@ -53,6 +53,7 @@ class Type;
 class TypeDecl;
 class VariantType;
 class AllBuiltinTypes;
+class TypeInterner;
 class CmdCallAttr;
 class Parameter;
 class VarRegexp;
@@ -192,6 +193,7 @@ private:
     Rc<ModuleInfo> _moduleInfo;
 
     Rc<AllBuiltinTypes> _builtinTypes;
+    Rc<TypeInterner> _typeInterner;
 
     const char* _lastLineStart;
     std::size_t _currentTmMsgNum;
@@ -200,6 +202,7 @@ private:
     RcVec<GenericParameterType> _currentGenericParameters;
     Rc<RangeAttr> _lastRangeAttr;
     Rc<CmdCallAttr> _lastCmdCallAttr;
+    Rc<CfgOption> _lastCfgOption;
     HashMap<bmcl::StringView, Rc<BuiltinType>> _btMap;
 };
 }
@@ -20,6 +20,7 @@
 #include "decode/core/Zpaq.h"
 #include "decode/core/Utils.h"
 #include "decode/core/ProgressPrinter.h"
+#include "decode/core/Tracer.h"
 #include "decode/core/HashMap.h"
 
 #include <bmcl/Result.h>
@@ -143,6 +144,7 @@ static void addParseError(bmcl::StringView path, bmcl::StringView cause, Diagnos
 
 static TableResult readToml(const std::string& path, Diagnostics* diag)
 {
+    TraceScope trace("project", "readToml", path);
     auto file = bmcl::readFileIntoString(path.c_str());
     if (file.isErr()) {
         diag->buildSystemFileErrorReport("failed to read file", file.unwrapErr(), path);
@@ -162,6 +164,7 @@ static TableResult readToml(const std::string& path, Diagnostics* diag)
 
 ProjectResult Project::fromFile(Configuration* cfg, Diagnostics* diag, const char* path)
 {
+    TraceScope trace("project", "Project::fromFile", path);
     std::string projectFilePath(path);
     normalizePath(&projectFilePath);
     Rc<Project> proj = new Project(cfg, diag);
@@ -356,7 +359,9 @@ ProjectResult Project::fromFile(Configuration* cfg, Diagnostics* diag, const cha
         dev->_package = proj->_package;
         dev->_id = it.second.id;
         dev->_name = std::move(it.second.name);
-        dev->_modules = commonModules;
+        for (const Rc<Ast>& mod : commonModules) {
+            dev->addModule(mod.get());
+        }
 
         for (const std::string& modName : it.second.modules) {
             bmcl::OptionPtr<Ast> mod = proj->_package->moduleWithName(modName);
@@ -364,7 +369,7 @@ ProjectResult Project::fromFile(Configuration* cfg, Diagnostics* diag, const cha
                 addParseError(path, "module '" + it.second.name + "' does not exist", diag);
                 return ProjectResult();
             }
-            dev->_modules.emplace_back(mod.unwrap());
+            dev->addModule(mod.unwrap());
         }
 
         it.second.device = dev;
@@ -406,6 +411,7 @@ ProjectResult Project::fromFile(Configuration* cfg, Diagnostics* diag, const cha
 
 bool Project::generate(const char* destDir, const GeneratorConfig& cfg)
 {
+    TraceScope trace("generator", "Project::generate");
     ProgressPrinter printer(_cfg->verboseOutput());
     printer.printActionProgress("Generating", "sources");
 
@@ -435,6 +441,11 @@ const Package* Project::package() const
     return _package.get();
 }
 
+const Configuration* Project::configuration() const
+{
+    return _cfg.get();
+}
+
 typedef std::array<std::uint8_t, 4> MagicType;
 const MagicType magic = {{0x7a, 0x70, 0x61, 0x71}};
 
@@ -583,7 +594,7 @@ ProjectResult Project::decodeFromMemory(Diagnostics* diag, const void* src, std:
                 addReadErr("Invalid module name reference");
                 return ProjectResult();
             }
-            dev->_modules.emplace_back(mod.unwrap());
+            dev->addModule(mod.unwrap());
         }
         devices.push_back(std::move(dev));
     }
@@ -670,7 +681,7 @@ ProjectResult Project::decodeFromMemory(Diagnostics* diag, const void* src, std:
     return proj;
 }
 
-bmcl::Buffer Project::encode() const
+bmcl::Buffer Project::encode(std::size_t* uncompressedSize) const
 {
     bmcl::Buffer dest;
     dest.write(magic.data(), magic.size());
@@ -741,6 +752,9 @@ bmcl::Buffer Project::encode() const
     }
 
     //BMCL_DEBUG() << "uncompressed project size: " << dest.size();
+    if (uncompressedSize) {
+        *uncompressedSize = dest.size();
+    }
 
     ZpaqResult compressed = zpaqCompress(dest.data(), dest.size(), _cfg->compressionLevel());
     assert(compressed.isOk());
@@ -840,6 +854,17 @@ RcVec<Ast>::ConstRange Device::modules() const
     return _modules;
 }
 
+bmcl::OptionPtr<const Ast> Device::moduleWithName(bmcl::StringView name) const
+{
+    return _moduleNameToAst.findValueWithKey(name);
+}
+
+void Device::addModule(Ast* module)
+{
+    _modules.emplace_back(module);
+    _moduleNameToAst.emplace(std::piecewise_construct, std::forward_as_tuple(module->moduleName()), std::forward_as_tuple(module));
+}
+
 DeviceConnection::DeviceConnection(const Device* dev)
     : _device(dev)
 {
@@ -43,13 +43,17 @@ public:
     uint64_t id() const;
     const std::string& name() const;
     RcVec<Ast>::ConstRange modules() const;
+    bmcl::OptionPtr<const Ast> moduleWithName(bmcl::StringView name) const;
 
 private:
     friend class Project;
     Device();
     ~Device();
 
+    void addModule(Ast* module);
+
     RcVec<Ast> _modules;
+    RcSecondUnorderedMap<bmcl::StringView, Ast> _moduleNameToAst;
     std::string _name;
     uint64_t _id;
     Rc<Package> _package;
@@ -98,13 +102,14 @@ public:
     const std::string& name() const;
     std::uint64_t mccId() const;
     const Package* package() const;
+    const Configuration* configuration() const;
     const Device* master() const;
     DeviceVec::ConstIterator devicesBegin() const;
     DeviceVec::ConstIterator devicesEnd() const;
     DeviceVec::ConstRange devices() const;
     RcVec<DeviceConnection>::ConstRange deviceConnections() const;
 
-    bmcl::Buffer encode() const;
+    bmcl::Buffer encode(std::size_t* uncompressedSize = nullptr) const;
     void encode(bmcl::Buffer* dest) const;
     bmcl::Option<const SourcesToCopy&> sourcesForModule(const Ast* module) const;
     bmcl::OptionPtr<const Device> deviceWithName(bmcl::StringView name) const;
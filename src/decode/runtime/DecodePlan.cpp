@@ -0,0 +1,574 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "decode/runtime/DecodePlan.h"
+#include "decode/ast/Type.h"
+#include "decode/ast/Field.h"
+#include "decode/ast/Component.h"
+#include "decode/ast/Function.h"
+#include "decode/parser/Package.h"
+
+#include <bmcl/MemReader.h>
+#include <bmcl/Option.h>
+
+#include <algorithm>
+#include <cassert>
+
+namespace decode {
+
+class DecodePlanBuilder {
+public:
+    DecodePlanBuilder(DecodePlan* plan)
+        : _plan(plan)
+    {
+    }
+
+    void beginStruct(std::size_t fieldCount)
+    {
+        appendOp(DecodeOpKind::BeginStruct, fieldCount);
+    }
+
+    void appendType(const Type* type, bool checkSize)
+    {
+        if (checkSize) {
+            bmcl::Option<std::size_t> size = fixedSize(type);
+            if (size.isSome()) {
+                if (size.unwrap() != 0) {
+                    appendOp(DecodeOpKind::Ensure, size.unwrap());
+                }
+                checkSize = false;
+            }
+        }
+        switch (type->typeKind()) {
+        case TypeKind::Builtin:
+            appendBuiltin(type->asBuiltin(), checkSize);
+            return;
+        case TypeKind::Reference:
+            if (checkSize) {
+                appendOp(DecodeOpKind::Ensure, 8);
+            }
+            appendOp(DecodeOpKind::U64);
+            return;
+        case TypeKind::Array: {
+            const ArrayType* array = type->asArray();
+            std::size_t begin = appendOp(DecodeOpKind::BeginArray, array->elementCount());
+            appendType(array->elementType(), checkSize);
+            endLoop(begin);
+            return;
+        }
+        case TypeKind::DynArray: {
+            const DynArrayType* array = type->asDynArray();
+            std::size_t begin = appendOp(DecodeOpKind::BeginDynArray, array->maxSize());
+            appendType(array->elementType(), true);
+            endLoop(begin);
+            return;
+        }
+        case TypeKind::Function:
+            assert(false);
+            return;
+        case TypeKind::Enum:
+            appendEnum(type->asEnum());
+            return;
+        case TypeKind::Struct: {
+            const StructType* s = type->asStruct();
+            beginStruct(s->fieldsRange().size());
+            for (const Field* field : s->fieldsRange()) {
+                appendType(field->type(), checkSize);
+            }
+            return;
+        }
+        case TypeKind::Variant:
+            appendVariant(type->asVariant());
+            return;
+        case TypeKind::Imported:
+            appendType(type->asImported()->link(), checkSize);
+            return;
+        case TypeKind::Alias:
+            appendType(type->asAlias()->alias(), checkSize);
+            return;
+        case TypeKind::Generic:
+            assert(false);
+            return;
+        case TypeKind::GenericInstantiation:
+            appendType(type->asGenericInstantiation()->instantiatedType(), checkSize);
+            return;
+        case TypeKind::GenericParameter:
+            assert(false);
+            return;
+        }
+    }
+
+private:
+    static bmcl::Option<std::size_t> builtinSize(BuiltinTypeKind kind)
+    {
+        switch (kind) {
+        case BuiltinTypeKind::USize:
+        case BuiltinTypeKind::ISize:
+        case BuiltinTypeKind::U64:
+        case BuiltinTypeKind::I64:
+        case BuiltinTypeKind::F64:
+            return std::size_t(8);
+        case BuiltinTypeKind::U32:
+        case BuiltinTypeKind::I32:
+        case BuiltinTypeKind::F32:
+            return std::size_t(4);
+        case BuiltinTypeKind::U16:
+        case BuiltinTypeKind::I16:
+            return std::size_t(2);
+        case BuiltinTypeKind::U8:
+        case BuiltinTypeKind::I8:
+        case BuiltinTypeKind::Bool:
+        case BuiltinTypeKind::Char:
+            return std::size_t(1);
+        case BuiltinTypeKind::Varint:
+        case BuiltinTypeKind::Varuint:
+        case BuiltinTypeKind::Void:
+            return bmcl::None;
+        }
+        return bmcl::None;
+    }
+
+    static bmcl::Option<std::size_t> fixedSize(const Type* type)
+    {
+        switch (type->typeKind()) {
+        case TypeKind::Builtin:
+            return builtinSize(type->asBuiltin()->builtinTypeKind());
+        case TypeKind::Reference:
+            return std::size_t(8);
+        case TypeKind::Array: {
+            bmcl::Option<std::size_t> size = fixedSize(type->asArray()->elementType());
+            if (size.isNone()) {
+                return bmcl::None;
+            }
+            return size.unwrap() * type->asArray()->elementCount();
+        }
+        case TypeKind::Struct: {
+            std::size_t total = 0;
+            for (const Field* field : type->asStruct()->fieldsRange()) {
+                bmcl::Option<std::size_t> size = fixedSize(field->type());
+                if (size.isNone()) {
+                    return bmcl::None;
+                }
+                total += size.unwrap();
+            }
+            return total;
+        }
+        case TypeKind::Imported:
+            return fixedSize(type->asImported()->link());
+        case TypeKind::Alias:
+            return fixedSize(type->asAlias()->alias());
+        case TypeKind::GenericInstantiation:
+            return fixedSize(type->asGenericInstantiation()->instantiatedType());
+        default:
+            return bmcl::None;
+        }
+    }
+
+    std::size_t appendOp(DecodeOpKind kind, uint64_t arg = 0)
+    {
+        _plan->_ops.push_back(DecodeOp{kind, 0, arg});
+        return _plan->_ops.size() - 1;
+    }
+
+    void endLoop(std::size_t begin)
+    {
+        std::size_t end = appendOp(DecodeOpKind::EndLoop);
+        _plan->_ops[end].jump = begin + 1;
+        _plan->_ops[begin].jump = end + 1;
+    }
+
+    void appendBuiltin(const BuiltinType* type, bool checkSize)
+    {
+        BuiltinTypeKind kind = type->builtinTypeKind();
+        if (checkSize) {
+            bmcl::Option<std::size_t> size = builtinSize(kind);
+            if (size.isSome()) {
+                appendOp(DecodeOpKind::Ensure, size.unwrap());
+            }
+        }
+        switch (kind) {
+        case BuiltinTypeKind::USize:
+        case BuiltinTypeKind::U64:
+            appendOp(DecodeOpKind::U64);
+            return;
+        case BuiltinTypeKind::ISize:
+        case BuiltinTypeKind::I64:
+            appendOp(DecodeOpKind::I64);
+            return;
+        case BuiltinTypeKind::Varint:
+            appendOp(DecodeOpKind::Varint);
+            return;
+        case BuiltinTypeKind::Varuint:
+            appendOp(DecodeOpKind::Varuint);
+            return;
+        case BuiltinTypeKind::U8:
+            appendOp(DecodeOpKind::U8);
+            return;
+        case BuiltinTypeKind::I8:
+            appendOp(DecodeOpKind::I8);
+            return;
+        case BuiltinTypeKind::U16:
+            appendOp(DecodeOpKind::U16);
+            return;
+        case BuiltinTypeKind::I16:
+            appendOp(DecodeOpKind::I16);
+            return;
+        case BuiltinTypeKind::U32:
+            appendOp(DecodeOpKind::U32);
+            return;
+        case BuiltinTypeKind::I32:
+            appendOp(DecodeOpKind::I32);
+            return;
+        case BuiltinTypeKind::F32:
+            appendOp(DecodeOpKind::F32);
+            return;
+        case BuiltinTypeKind::F64:
+            appendOp(DecodeOpKind::F64);
+            return;
+        case BuiltinTypeKind::Bool:
+            appendOp(DecodeOpKind::Bool);
+            return;
+        case BuiltinTypeKind::Char:
+            appendOp(DecodeOpKind::Char);
+            return;
+        case BuiltinTypeKind::Void:
+            assert(false);
+            return;
+        }
+    }
+
+    void appendEnum(const EnumType* type)
+    {
+        DecodePlan::EnumTable table;
+        for (const EnumConstant* c : type->constantsRange()) {
+            table.push_back(c->value());
+        }
+        std::sort(table.begin(), table.end());
+        _plan->_enums.push_back(std::move(table));
+        appendOp(DecodeOpKind::Enum, _plan->_enums.size() - 1);
+    }
+
+    void appendVariant(const VariantType* type)
+    {
+        std::size_t tableIndex = _plan->_variants.size();
+        _plan->_variants.emplace_back();
+        appendOp(DecodeOpKind::Variant, tableIndex);
+
+        DecodePlan::VariantTable table;
+        std::vector<std::size_t> jumps;
+        for (const VariantField* field : type->fieldsRange()) {
+            table.emplace_back(field->id(), _plan->_ops.size());
+            switch (field->variantFieldKind()) {
+            case VariantFieldKind::Constant:
+                beginStruct(0);
+                break;
+            case VariantFieldKind::Tuple: {
+                const TupleVariantField* f = field->asTupleField();
+                beginStruct(f->typesRange().size());
+                for (const Type* t : f->typesRange()) {
+                    appendType(t, true);
+                }
+                break;
+            }
+            case VariantFieldKind::Struct: {
+                const StructVariantField* f = field->asStructField();
+                beginStruct(f->fieldsRange().size());
+                for (const Field* t : f->fieldsRange()) {
+                    appendType(t->type(), true);
+                }
+                break;
+            }
+            }
+            jumps.push_back(appendOp(DecodeOpKind::Jump));
+        }
+        for (std::size_t jump : jumps) {
+            _plan->_ops[jump].jump = _plan->_ops.size();
+        }
+        std::sort(table.begin(), table.end());
+        _plan->_variants[tableIndex] = std::move(table);
+    }
+
+    DecodePlan* _plan;
+};
+
+DecodePlan::DecodePlan()
+{
+}
+
+DecodePlan::~DecodePlan()
+{
+}
+
+Rc<DecodePlan> DecodePlan::fromType(const Type* type)
+{
+    Rc<DecodePlan> plan = new DecodePlan;
+    DecodePlanBuilder builder(plan.get());
+    builder.appendType(type, true);
+    return plan;
+}
+
+Rc<DecodePlan> DecodePlan::fromStatusMsg(const StatusMsg* msg)
+{
+    Rc<DecodePlan> plan = new DecodePlan;
+    DecodePlanBuilder builder(plan.get());
+    builder.beginStruct(msg->partsRange().size());
+    for (const VarRegexp* part : msg->partsRange()) {
+        builder.appendType(part->type(), true);
+    }
+    return plan;
+}
+
+Rc<DecodePlan> DecodePlan::fromEventMsg(const EventMsg* msg)
+{
+    Rc<DecodePlan> plan = new DecodePlan;
+    DecodePlanBuilder builder(plan.get());
+    builder.beginStruct(msg->partsRange().size());
+    for (const Field* part : msg->partsRange()) {
+        builder.appendType(part->type(), true);
+    }
+    return plan;
+}
+
+Rc<DecodePlan> DecodePlan::fromCommand(const Command* cmd)
+{
+    Rc<DecodePlan> plan = new DecodePlan;
+    DecodePlanBuilder builder(plan.get());
+    builder.beginStruct(cmd->type()->argumentsRange().size());
+    for (const Field* arg : cmd->type()->argumentsRange()) {
+        builder.appendType(arg->type(), true);
+    }
+    return plan;
+}
+
+const std::vector<DecodeOp>& DecodePlan::ops() const
+{
+    return _ops;
+}
+
+template <typename T>
+static inline void pushValue(std::vector<ValueNode>* dest, ValueKind kind, T value)
+{
+    dest->emplace_back();
+    ValueNode& node = dest->back();
+    node.kind = kind;
+    node.count = 0;
+    switch (kind) {
+    case ValueKind::Signed:
+    case ValueKind::Enum:
+        node.i = value;
+        break;
+    case ValueKind::Double:
+        node.d = value;
+        break;
+    default:
+        node.u = value;
+    }
+}
+
+static inline void pushContainer(std::vector<ValueNode>* dest, ValueKind kind, uint64_t count, uint64_t value = 0)
+{
+    dest->emplace_back();
+    ValueNode& node = dest->back();
+    node.kind = kind;
+    node.count = count;
+    node.u = value;
+}
+
+bool DecodePlan::decode(bmcl::MemReader* src, std::vector<ValueNode>* dest) const
+{
+    struct LoopFrame {
+        std::size_t start;
+        uint64_t remaining;
+    };
+    std::vector<LoopFrame> frames;
+    frames.reserve(16);
+
+    std::size_t pc = 0;
+    std::size_t end = _ops.size();
+    while (pc < end) {
+        const DecodeOp& op = _ops[pc];
+        switch (op.kind) {
+        case DecodeOpKind::Ensure:
+            if (src->sizeLeft() < op.arg) {
+                return false;
+            }
+            break;
+        case DecodeOpKind::U8:
+            pushValue(dest, ValueKind::Unsigned, src->readUint8());
+            break;
+        case DecodeOpKind::I8:
+            pushValue(dest, ValueKind::Signed, int8_t(src->readUint8()));
+            break;
+        case DecodeOpKind::U16:
+            pushValue(dest, ValueKind::Unsigned, src->readUint16Le());
+            break;
+        case DecodeOpKind::I16:
+            pushValue(dest, ValueKind::Signed, int16_t(src->readUint16Le()));
+            break;
+        case DecodeOpKind::U32:
+            pushValue(dest, ValueKind::Unsigned, src->readUint32Le());
+            break;
+        case DecodeOpKind::I32:
+            pushValue(dest, ValueKind::Signed, int32_t(src->readUint32Le()));
+            break;
+        case DecodeOpKind::U64:
+            pushValue(dest, ValueKind::Unsigned, src->readUint64Le());
+            break;
+        case DecodeOpKind::I64:
+            pushValue(dest, ValueKind::Signed, int64_t(src->readUint64Le()));
+            break;
+        case DecodeOpKind::F32:
+            pushValue(dest, ValueKind::Double, src->readFloat32Le());
+            break;
+        case DecodeOpKind::F64:
+            pushValue(dest, ValueKind::Double, src->readFloat64Le());
+            break;
+        case DecodeOpKind::Bool:
+            pushValue(dest, ValueKind::Bool, src->readUint8());
+            break;
+        case DecodeOpKind::Char:
+            pushValue(dest, ValueKind::Char, src->readUint8());
+            break;
+        case DecodeOpKind::Varuint: {
+            uint64_t value;
+            if (!src->readVarUint(&value)) {
+                return false;
+            }
+            pushValue(dest, ValueKind::Unsigned, value);
+            break;
+        }
+        case DecodeOpKind::Varint: {
+            int64_t value;
+            if (!src->readVarInt(&value)) {
+                return false;
+            }
+            pushValue(dest, ValueKind::Signed, value);
+            break;
+        }
+        case DecodeOpKind::Enum: {
+            int64_t value;
+            if (!src->readVarInt(&value)) {
+                return false;
+            }
+            const EnumTable& table = _enums[op.arg];
+            if (!std::binary_search(table.begin(), table.end(), value)) {
+                return false;
+            }
+            pushValue(dest, ValueKind::Enum, value);
+            break;
+        }
+        case DecodeOpKind::BeginStruct:
+            pushContainer(dest, ValueKind::Struct, op.arg);
+            break;
+        case DecodeOpKind::BeginArray:
+            pushContainer(dest, ValueKind::Array, op.arg);
+            if (op.arg == 0) {
+                pc = op.jump;
+                continue;
+            }
+            frames.push_back(LoopFrame{pc + 1, op.arg});
+            break;
+        case DecodeOpKind::BeginDynArray: {
+            uint64_t size;
+            if (!src->readVarUint(&size)) {
+                return false;
+            }
+            if (size > op.arg) {
+                return false;
+            }
+            pushContainer(dest, ValueKind::Array, size);
+            if (size == 0) {
+                pc = op.jump;
+                continue;
+            }
+            frames.push_back(LoopFrame{pc + 1, size});
+            break;
+        }
+        case DecodeOpKind::EndLoop: {
+            LoopFrame& frame = frames.back();
+            frame.remaining--;
+            if (frame.remaining != 0) {
+                pc = frame.start;
+                continue;
+            }
+            frames.pop_back();
+            break;
+        }
+        case DecodeOpKind::Variant: {
+            int64_t id;
+            if (!src->readVarInt(&id)) {
+                return false;
+            }
+            const VariantTable& table = _variants[op.arg];
+            auto it = std::lower_bound(table.begin(), table.end(), id, [](const std::pair<int64_t, uint32_t>& left, int64_t value) {
+                return left.first < value;
+            });
+            if (it == table.end() || it->first != id) {
+                return false;
+            }
+            pushContainer(dest, ValueKind::Variant, 1, id);
+            pc = it->second;
+            continue;
+        }
+        case DecodeOpKind::Jump:
+            pc = op.jump;
+            continue;
+        }
+        pc++;
+    }
+    return true;
+}
+
+PackageDecoder::PackageDecoder(const Package* package)
+{
+    for (const Component* comp : package->components()) {
+        for (const StatusMsg* msg : comp->statusesRange()) {
+            _statuses.emplace(key(comp->number(), msg->number()), DecodePlan::fromStatusMsg(msg));
+        }
+        for (const EventMsg* msg : comp->eventsRange()) {
+            _events.emplace(key(comp->number(), msg->number()), DecodePlan::fromEventMsg(msg));
+        }
+        for (const Command* cmd : comp->cmdsRange()) {
+            _cmds.emplace(key(comp->number(), cmd->number()), DecodePlan::fromCommand(cmd));
+        }
+    }
+}
+
+PackageDecoder::~PackageDecoder()
+{
+}
+
+uint64_t PackageDecoder::key(uint64_t compNum, uint64_t msgNum)
+{
+    return (compNum << 32) | (msgNum & 0xffffffff);
+}
+
+bmcl::OptionPtr<const DecodePlan> PackageDecoder::findPlan(const PlanMap& map, uint64_t compNum, uint64_t msgNum)
+{
+    auto it = map.find(key(compNum, msgNum));
+    if (it == map.end()) {
+        return bmcl::None;
+    }
+    return it->second.get();
+}
+
+bmcl::OptionPtr<const DecodePlan> PackageDecoder::statusPlan(uint64_t compNum, uint64_t msgNum) const
+{
+    return findPlan(_statuses, compNum, msgNum);
+}
+
+bmcl::OptionPtr<const DecodePlan> PackageDecoder::eventPlan(uint64_t compNum, uint64_t msgNum) const
+{
+    return findPlan(_events, compNum, msgNum);
+}
+
+bmcl::OptionPtr<const DecodePlan> PackageDecoder::cmdPlan(uint64_t compNum, uint64_t cmdNum) const
+{
+    return findPlan(_cmds, compNum, cmdNum);
+}
+}
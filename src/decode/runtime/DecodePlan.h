@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "decode/Config.h"
+#include "decode/core/Rc.h"
+#include "decode/core/HashMap.h"
+
+#include <bmcl/Fwd.h>
+#include <bmcl/OptionPtr.h>
+
+#include <cstdint>
+#include <vector>
+#include <utility>
+
+namespace decode {
+
+class Type;
+class Package;
+class Command;
+class StatusMsg;
+class EventMsg;
+class DecodePlanBuilder;
+
+enum class ValueKind : uint8_t {
+    Unsigned,
+    Signed,
+    Double,
+    Bool,
+    Char,
+    Enum,
+    Array,
+    Struct,
+    Variant,
+};
+
+//values are stored in pre-order, containers are followed by count child values
+struct ValueNode {
+    ValueKind kind;
+    uint32_t count;
+    union {
+        uint64_t u;
+        int64_t i;
+        double d;
+    };
+};
+
+enum class DecodeOpKind : uint8_t {
+    Ensure,
+    U8,
+    I8,
+    U16,
+    I16,
+    U32,
+    I32,
+    U64,
+    I64,
+    F32,
+    F64,
+    Bool,
+    Char,
+    Varuint,
+    Varint,
+    Enum,
+    BeginStruct,
+    BeginArray,
+    BeginDynArray,
+    EndLoop,
+    Variant,
+    Jump,
+};
+
+struct DecodeOp {
+    DecodeOpKind kind;
+    uint32_t jump;
+    uint64_t arg;
+};
+
+class DecodePlan : public RefCountable {
+public:
+    using Pointer = Rc<DecodePlan>;
+    using ConstPointer = Rc<const DecodePlan>;
+
+    static Rc<DecodePlan> fromType(const Type* type);
+    static Rc<DecodePlan> fromStatusMsg(const StatusMsg* msg);
+    static Rc<DecodePlan> fromEventMsg(const EventMsg* msg);
+    static Rc<DecodePlan> fromCommand(const Command* cmd);
+
+    ~DecodePlan();
+
+    bool decode(bmcl::MemReader* src, std::vector<ValueNode>* dest) const;
+
+    const std::vector<DecodeOp>& ops() const;
+
+private:
+    friend class DecodePlanBuilder;
+
+    using VariantTable = std::vector<std::pair<int64_t, uint32_t>>;
+    using EnumTable = std::vector<int64_t>;
+
+    DecodePlan();
+
+    std::vector<DecodeOp> _ops;
+    std::vector<VariantTable> _variants;
+    std::vector<EnumTable> _enums;
+};
+
+class PackageDecoder : public RefCountable {
+public:
+    using Pointer = Rc<PackageDecoder>;
+    using ConstPointer = Rc<const PackageDecoder>;
+
+    PackageDecoder(const Package* package);
+    ~PackageDecoder();
+
+    bmcl::OptionPtr<const DecodePlan> statusPlan(uint64_t compNum, uint64_t msgNum) const;
+    bmcl::OptionPtr<const DecodePlan> eventPlan(uint64_t compNum, uint64_t msgNum) const;
+    bmcl::OptionPtr<const DecodePlan> cmdPlan(uint64_t compNum, uint64_t cmdNum) const;
+
+private:
+    using PlanMap = HashMap<uint64_t, Rc<DecodePlan>>;
+
+    static uint64_t key(uint64_t compNum, uint64_t msgNum);
+    static bmcl::OptionPtr<const DecodePlan> findPlan(const PlanMap& map, uint64_t compNum, uint64_t msgNum);
+
+    PlanMap _statuses;
+    PlanMap _events;
+    PlanMap _cmds;
+};
+}
@@ -0,0 +1,286 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "decode/runtime/LogDecoder.h"
+#include "decode/ast/Component.h"
+#include "decode/parser/Package.h"
+#include "decode/runtime/MsgStatsFormat.h"
+
+#include <bmcl/MemReader.h>
+#include <bmcl/Result.h>
+#include <bmcl/FileUtils.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+# define DECODE_HAS_MMAP
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <fcntl.h>
+# include <unistd.h>
+#endif
+
+#include <cerrno>
+#include <cstring>
+
+namespace decode {
+
+MappedFile::MappedFile()
+    : _data(nullptr)
+    , _size(0)
+{
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef DECODE_HAS_MMAP
+    if (_fallback.empty() && _size != 0) {
+        munmap(const_cast<uint8_t*>(_data), _size);
+    }
+#endif
+}
+
+MappedFileResult MappedFile::open(const char* path)
+{
+    Rc<MappedFile> file = new MappedFile;
+#ifdef DECODE_HAS_MMAP
+    int fd = ::open(path, O_RDONLY);
+    if (fd == -1) {
+        return std::string(std::strerror(errno));
+    }
+    struct stat info;
+    if (fstat(fd, &info) == -1) {
+        int err = errno;
+        close(fd);
+        return std::string(std::strerror(err));
+    }
+    if (info.st_size == 0) {
+        close(fd);
+        return file;
+    }
+    void* data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    int err = errno;
+    close(fd);
+    if (data == MAP_FAILED) {
+        return std::string(std::strerror(err));
+    }
+    madvise(data, info.st_size, MADV_SEQUENTIAL);
+    file->_data = (const uint8_t*)data;
+    file->_size = info.st_size;
+#else
+    bmcl::Result<std::string, int> rv = bmcl::readFileIntoString(path);
+    if (rv.isErr()) {
+        return std::string(std::strerror(rv.unwrapErr()));
+    }
+    file->_fallback = rv.take();
+    file->_data = (const uint8_t*)file->_fallback.data();
+    file->_size = file->_fallback.size();
+#endif
+    return file;
+}
+
+bmcl::Bytes MappedFile::data() const
+{
+    return bmcl::Bytes(_data, _size);
+}
+
+static uint64_t msgKey(uint64_t compNum, uint64_t msgNum)
+{
+    return (compNum << 32) | (msgNum & 0xffffffff);
+}
+
+LogDecoder::LogDecoder(const Package* package)
+    : _decoder(new PackageDecoder(package))
+{
+    for (const Component* comp : package->components()) {
+        for (const StatusMsg* msg : comp->statusesRange()) {
+            _statusNames.emplace(msgKey(comp->number(), msg->number()), comp->name().toStdString() + "." + msg->name().toStdString());
+        }
+        for (const EventMsg* msg : comp->eventsRange()) {
+            _eventNames.emplace(msgKey(comp->number(), msg->number()), comp->name().toStdString() + "." + msg->name().toStdString());
+        }
+    }
+    MsgStatsFormat::collectEntryNames(package, &_msgStatsNames);
+}
+
+LogDecoder::~LogDecoder()
+{
+}
+
+bool LogDecoder::splitFrames(bmcl::Bytes log, std::vector<LogFrame>* dest, std::size_t* errorOffset)
+{
+    bmcl::MemReader reader(log);
+    while (reader.sizeLeft() != 0) {
+        std::size_t offset = reader.current() - log.data();
+        uint64_t size;
+        if (!reader.readVarUint(&size) || size > reader.sizeLeft()) {
+            *errorOffset = offset;
+            return false;
+        }
+        dest->push_back(LogFrame{std::size_t(reader.current() - log.data()), std::size_t(size)});
+        reader.skip(size);
+    }
+    return true;
+}
+
+static std::size_t appendValue(const std::vector<ValueNode>& nodes, std::size_t i, StringBuilder* dest)
+{
+    const ValueNode& node = nodes[i];
+    i++;
+    switch (node.kind) {
+    case ValueKind::Unsigned:
+        dest->appendNumericValue((unsigned long long)node.u);
+        return i;
+    case ValueKind::Signed:
+    case ValueKind::Enum:
+        dest->appendNumericValue((long long)node.i);
+        return i;
+    case ValueKind::Double:
+        dest->appendNumericValue(node.d);
+        return i;
+    case ValueKind::Bool:
+        dest->appendBoolValue(node.u != 0);
+        return i;
+    case ValueKind::Char:
+        if (node.u >= 0x20 && node.u < 0x7f) {
+            dest->append('\'');
+            dest->append(char(node.u));
+            dest->append('\'');
+        } else {
+            dest->appendNumericValue((unsigned long long)node.u);
+        }
+        return i;
+    case ValueKind::Array:
+        dest->append('[');
+        break;
+    case ValueKind::Struct:
+        dest->append('{');
+        break;
+    case ValueKind::Variant:
+        dest->appendNumericValue((long long)node.i);
+        break;
+    }
+    for (uint32_t n = 0; n < node.count; n++) {
+        if (n != 0) {
+            dest->append(", ");
+        }
+        i = appendValue(nodes, i, dest);
+    }
+    if (node.kind == ValueKind::Array) {
+        dest->append(']');
+    } else if (node.kind == ValueKind::Struct) {
+        dest->append('}');
+    }
+    return i;
+}
+
+// builtin status message emitted by onboard code generated with instrumentation enabled, see MsgStatsFormat
+bool LogDecoder::decodeMsgStats(bmcl::MemReader* src, LogChunkResult* dest) const
+{
+    const std::size_t entrySize = MsgStatsFormat::entrySize;
+    if (src->sizeLeft() < MsgStatsFormat::headerSize) {
+        return false;
+    }
+    std::size_t first = src->readUint16Le();
+    std::size_t count = src->readUint16Le();
+    if (first + count > _msgStatsNames.size() || src->sizeLeft() < count * entrySize) {
+        return false;
+    }
+    dest->output.append(" MsgStats {");
+    for (std::size_t i = first; i < first + count; i++) {
+        if (i != first) {
+            dest->output.append(", ");
+        }
+        dest->output.append(_msgStatsNames[i]);
+        dest->output.append(": {");
+        for (std::size_t j = 0; j < 4; j++) {
+            dest->output.appendNumericValue((unsigned long long)src->readUint32Le());
+            dest->output.append(", ");
+        }
+        dest->output.append('[');
+        for (std::size_t j = 0; j < MsgStatsFormat::errorSlots; j++) {
+            if (j != 0) {
+                dest->output.append(", ");
+            }
+            dest->output.appendNumericValue((unsigned long long)src->readUint32Le());
+        }
+        dest->output.append("], ");
+        dest->output.appendNumericValue((unsigned long long)src->readUint64Le());
+        dest->output.append('}');
+    }
+    dest->output.append('}');
+    dest->messages++;
+    return true;
+}
+
+bool LogDecoder::decodeFrame(bmcl::Bytes payload, std::vector<ValueNode>* nodes, LogChunkResult* dest) const
+{
+    bmcl::MemReader reader(payload);
+    while (reader.sizeLeft() != 0) {
+        if (reader.sizeLeft() < 2) {
+            dest->output.append(" error: not enough data to decode message header\n");
+            return false;
+        }
+        uint8_t compNum = reader.readUint8();
+        uint8_t msgNum = reader.readUint8();
+        uint64_t key = msgKey(compNum, msgNum);
+
+        bmcl::OptionPtr<const DecodePlan> plan = _decoder->statusPlan(compNum, msgNum);
+        const std::string* name;
+        if (plan.isSome()) {
+            name = &_statusNames.find(key)->second;
+        } else {
+            plan = _decoder->eventPlan(compNum, msgNum);
+            if (plan.isNone() && compNum == MsgStatsFormat::compNum && msgNum == MsgStatsFormat::msgNum) {
+                if (!decodeMsgStats(&reader, dest)) {
+                    dest->output.append(" error: failed to decode MsgStats\n");
+                    return false;
+                }
+                continue;
+            }
+            if (plan.isNone()) {
+                dest->output.append(" error: unknown message ");
+                dest->output.appendNumericValue(compNum);
+                dest->output.append(':');
+                dest->output.appendNumericValue(msgNum);
+                dest->output.appendEol();
+                return false;
+            }
+            name = &_eventNames.find(key)->second;
+        }
+
+        nodes->clear();
+        if (!plan->decode(&reader, nodes)) {
+            dest->output.append(" error: failed to decode ");
+            dest->output.append(*name);
+            dest->output.appendEol();
+            return false;
+        }
+        dest->output.append(' ');
+        dest->output.append(*name);
+        dest->output.append(' ');
+        appendValue(*nodes, 0, &dest->output);
+        dest->messages++;
+    }
+    dest->output.appendEol();
+    return true;
+}
+
+void LogDecoder::decodeFrames(bmcl::Bytes log, bmcl::ArrayView<LogFrame> frames, std::size_t firstFrameIndex, LogChunkResult* dest) const
+{
+    std::vector<ValueNode> nodes;
+    nodes.reserve(256);
+    std::size_t index = firstFrameIndex;
+    for (const LogFrame& frame : frames) {
+        dest->output.appendNumericValue((unsigned long long)index);
+        dest->output.append(':');
+        if (!decodeFrame(bmcl::Bytes(log.data() + frame.offset, frame.size), &nodes, dest)) {
+            dest->errors++;
+        }
+        index++;
+    }
+}
+}
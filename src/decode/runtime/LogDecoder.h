@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "decode/Config.h"
+#include "decode/core/Rc.h"
+#include "decode/core/HashMap.h"
+#include "decode/core/StringBuilder.h"
+#include "decode/runtime/DecodePlan.h"
+
+#include <bmcl/Fwd.h>
+#include <bmcl/ArrayView.h>
+#include <bmcl/Bytes.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace decode {
+
+class Package;
+class MappedFile;
+
+using MappedFileResult = bmcl::Result<Rc<MappedFile>, std::string>;
+
+class MappedFile : public RefCountable {
+public:
+    using Pointer = Rc<MappedFile>;
+    using ConstPointer = Rc<const MappedFile>;
+
+    static MappedFileResult open(const char* path);
+    ~MappedFile();
+
+    bmcl::Bytes data() const;
+
+private:
+    MappedFile();
+
+    const uint8_t* _data;
+    std::size_t _size;
+    std::string _fallback;
+};
+
+// recorded log is a sequence of frames: varuint payload size followed by payload,
+// payload is a sequence of (u8 component number, u8 message number, message)
+struct LogFrame {
+    std::size_t offset;
+    std::size_t size;
+};
+
+struct LogChunkResult {
+    LogChunkResult()
+        : messages(0)
+        , errors(0)
+    {
+    }
+
+    StringBuilder output;
+    std::size_t messages;
+    std::size_t errors;
+};
+
+class LogDecoder : public RefCountable {
+public:
+    using Pointer = Rc<LogDecoder>;
+    using ConstPointer = Rc<const LogDecoder>;
+
+    LogDecoder(const Package* package);
+    ~LogDecoder();
+
+    static bool splitFrames(bmcl::Bytes log, std::vector<LogFrame>* dest, std::size_t* errorOffset);
+
+    void decodeFrames(bmcl::Bytes log, bmcl::ArrayView<LogFrame> frames, std::size_t firstFrameIndex, LogChunkResult* dest) const;
+
+private:
+    bool decodeFrame(bmcl::Bytes payload, std::vector<ValueNode>* nodes, LogChunkResult* dest) const;
+    bool decodeMsgStats(bmcl::MemReader* src, LogChunkResult* dest) const;
+
+    Rc<PackageDecoder> _decoder;
+    HashMap<uint64_t, std::string> _statusNames;
+    HashMap<uint64_t, std::string> _eventNames;
+    std::vector<std::string> _msgStatsNames;
+};
+}
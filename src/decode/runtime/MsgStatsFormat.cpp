@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "decode/runtime/MsgStatsFormat.h"
+#include "decode/parser/Package.h"
+#include "decode/ast/Component.h"
+#include "decode/ast/Function.h"
+
+namespace decode {
+
+constexpr unsigned MsgStatsFormat::compNum;
+constexpr unsigned MsgStatsFormat::msgNum;
+constexpr unsigned MsgStatsFormat::errorSlots;
+constexpr std::size_t MsgStatsFormat::headerSize;
+constexpr std::size_t MsgStatsFormat::entrySize;
+
+void MsgStatsFormat::collectEntries(const Package* package, std::vector<Entry>* dest)
+{
+    for (const Component* comp : package->components()) {
+        for (const StatusMsg* msg : comp->statusesRange()) {
+            dest->push_back(Entry{comp, "status", msg->name()});
+        }
+        for (const EventMsg* msg : comp->eventsRange()) {
+            dest->push_back(Entry{comp, "event", msg->name()});
+        }
+        for (const Command* cmd : comp->cmdsRange()) {
+            dest->push_back(Entry{comp, "cmd", cmd->name()});
+        }
+    }
+}
+
+void MsgStatsFormat::collectEntryNames(const Package* package, std::vector<std::string>* dest)
+{
+    std::vector<Entry> entries;
+    collectEntries(package, &entries);
+    for (const Entry& entry : entries) {
+        dest->push_back(entry.comp->name().toStdString() + "." + entry.kind + "." + entry.name.toStdString());
+    }
+}
+}
@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "decode/Config.h"
+
+#include <bmcl/StringView.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace decode {
+
+class Package;
+class Component;
+
+// wire format of the builtin message stats status message, written by code generated with MsgStatsGen:
+// (u16 first entry, u16 entry count) followed by entries in table order, each entry is
+// (u32 encoded count, u32 encoded bytes, u32 decoded count, u32 decoded bytes, u32 errors[errorSlots], u64 cycles)
+class MsgStatsFormat {
+public:
+    // compNum and msgNum of the message, outside of component id range used by projects
+    static constexpr unsigned compNum = 255;
+    static constexpr unsigned msgNum = 0;
+    static constexpr unsigned errorSlots = 8;
+    static constexpr std::size_t headerSize = 4;
+    static constexpr std::size_t entrySize = 4 * 4 + 4 * errorSlots + 8;
+
+    struct Entry {
+        const Component* comp;
+        const char* kind;
+        bmcl::StringView name;
+    };
+
+    // statuses, events and commands of each component
+    static void collectEntries(const Package* package, std::vector<Entry>* dest);
+    // entry names in table order, formatted as "component.kind.name"
+    static void collectEntryNames(const Package* package, std::vector<std::string>* dest);
+};
+}
@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "decode/runtime/SchemaValidator.h"
+#include "decode/ast/Utils.h"
+#include "decode/ast/AllBuiltinTypes.h"
+
+namespace decode {
+
+using TypeTable = std::vector<Rc<const Type>>;
+
+static Type* typeAt(const TypeTable& types, uint32_t index)
+{
+    if (index >= types.size()) {
+        return nullptr;
+    }
+    return const_cast<Type*>(types[index].get());
+}
+
+static const Type* builtinType(const Ast* coreAst, uint8_t kind)
+{
+    if (!coreAst) {
+        return nullptr;
+    }
+    const AllBuiltinTypes* builtins = coreAst->builtinTypes();
+    switch ((BuiltinTypeKind)kind) {
+    case BuiltinTypeKind::USize:
+        return builtins->usizeType();
+    case BuiltinTypeKind::ISize:
+        return builtins->isizeType();
+    case BuiltinTypeKind::Varint:
+        return builtins->varintType();
+    case BuiltinTypeKind::Varuint:
+        return builtins->varuintType();
+    case BuiltinTypeKind::U8:
+        return builtins->u8Type();
+    case BuiltinTypeKind::I8:
+        return builtins->i8Type();
+    case BuiltinTypeKind::U16:
+        return builtins->u16Type();
+    case BuiltinTypeKind::I16:
+        return builtins->i16Type();
+    case BuiltinTypeKind::U32:
+        return builtins->u32Type();
+    case BuiltinTypeKind::I32:
+        return builtins->i32Type();
+    case BuiltinTypeKind::U64:
+        return builtins->u64Type();
+    case BuiltinTypeKind::I64:
+        return builtins->i64Type();
+    case BuiltinTypeKind::F32:
+        return builtins->f32Type();
+    case BuiltinTypeKind::F64:
+        return builtins->f64Type();
+    case BuiltinTypeKind::Bool:
+        return builtins->boolType();
+    case BuiltinTypeKind::Void:
+        return builtins->voidType();
+    case BuiltinTypeKind::Char:
+        return builtins->charType();
+    }
+    return nullptr;
+}
+
+static Rc<const Type> resolveType(const Schema& schema, const SchemaType& type, const TypeTable& types,
+                                  const std::vector<const Ast*>& modules, const Ast* coreAst)
+{
+    const Ast* module = nullptr;
+    if (type.module < modules.size()) {
+        module = modules[type.module];
+    }
+    switch (type.kind) {
+    case SchemaTypeKind::Builtin:
+        return builtinType(coreAst, type.flags);
+    case SchemaTypeKind::Reference:
+        return tryMakeReference((ReferenceKind)(type.flags >> 1), type.flags & 1, typeAt(types, type.inner));
+    case SchemaTypeKind::Array:
+        return tryMakeArray(type.size, typeAt(types, type.inner));
+    case SchemaTypeKind::DynArray:
+        return tryMakeDynArray(type.size, typeAt(types, type.inner));
+    case SchemaTypeKind::Function: {
+        bmcl::OptionPtr<Type> rv;
+        if (type.inner != schemaNoType) {
+            rv = typeAt(types, type.inner);
+            if (rv.isNone()) {
+                return nullptr;
+            }
+        }
+        bmcl::Option<SelfArgument> self;
+        if (type.flags != 0) {
+            self = SelfArgument(type.flags - 1);
+        }
+        std::vector<Type*> args;
+        args.reserve(type.count);
+        for (uint32_t i = 0; i < type.count; i++) {
+            args.push_back(typeAt(types, schema.typeRefs[type.first + i]));
+        }
+        return tryMakeFunction(rv, self, args);
+    }
+    case SchemaTypeKind::Enum:
+        return findType<EnumType>(module, type.name);
+    case SchemaTypeKind::Struct: {
+        Rc<const StructType> s = findType<StructType>(module, type.name);
+        expectFieldNum(&s, type.count);
+        for (uint32_t i = 0; i < type.count; i++) {
+            const SchemaField& field = schema.fields[type.first + i];
+            expectField(&s, i, field.name, typeAt(types, field.type));
+        }
+        return s;
+    }
+    case SchemaTypeKind::Variant:
+        return findType<VariantType>(module, type.name);
+    case SchemaTypeKind::Generic:
+        return findType<GenericType>(module, type.name);
+    case SchemaTypeKind::GenericInstantiation: {
+        Type* generic = typeAt(types, type.inner);
+        if (!generic || !generic->isGeneric()) {
+            return nullptr;
+        }
+        Rc<const GenericType> g = generic->asGeneric();
+        std::vector<Rc<Type>> params;
+        params.reserve(type.count);
+        for (uint32_t i = 0; i < type.count; i++) {
+            Type* param = typeAt(types, schema.typeRefs[type.first + i]);
+            if (!param) {
+                return nullptr;
+            }
+            params.emplace_back(param);
+        }
+        return instantiateGeneric(&g, params);
+    }
+    }
+    return nullptr;
+}
+
+void validateSchema(const Schema& schema, const Device* device, SchemaValidationResult* dest)
+{
+    std::vector<const Ast*> modules;
+    modules.reserve(schema.modules.size());
+    const Ast* coreAst = nullptr;
+    for (const char* name : schema.modules) {
+        const Ast* module = findModule(device, name);
+        if (bmcl::StringView(name) == "core") {
+            coreAst = module;
+        }
+        modules.push_back(module);
+    }
+
+    dest->components.clear();
+    dest->components.reserve(modules.size());
+    for (const Ast* module : modules) {
+        const Component* comp = getComponent(module);
+        if (comp) {
+            dest->components.emplace_back(comp->number());
+        } else {
+            dest->components.emplace_back(bmcl::None);
+        }
+    }
+
+    TypeTable types;
+    types.reserve(schema.types.size());
+    for (const SchemaType& type : schema.types) {
+        types.push_back(resolveType(schema, type, types, modules, coreAst));
+    }
+
+    dest->cmds.clear();
+    dest->cmds.reserve(schema.cmds.size());
+    for (const SchemaCmd& desc : schema.cmds) {
+        const Component* comp = nullptr;
+        if (desc.module < modules.size()) {
+            comp = getComponent(modules[desc.module]);
+        }
+        Rc<const Command> cmd = findCmd(comp, desc.name, desc.argCount);
+        for (uint32_t i = 0; i < desc.argCount; i++) {
+            expectCmdArg(&cmd, i, typeAt(types, schema.typeRefs[desc.firstArg + i]));
+        }
+        if (desc.returnType != schemaNoType) {
+            expectCmdRv(&cmd, typeAt(types, desc.returnType));
+        } else {
+            expectCmdNoRv(&cmd);
+        }
+        if (cmd.isNull()) {
+            dest->cmds.emplace_back(bmcl::None);
+        } else {
+            dest->cmds.emplace_back(cmd->number());
+        }
+    }
+
+    dest->msgs.clear();
+    dest->msgs.reserve(schema.msgs.size());
+    for (const SchemaMsg& desc : schema.msgs) {
+        const Component* comp = nullptr;
+        if (desc.module < modules.size()) {
+            comp = getComponent(modules[desc.module]);
+        }
+        bmcl::Option<uint64_t> number;
+        if (desc.isEvent) {
+            const EventMsg* msg = findEventMsg(comp, desc.name);
+            if (msg) {
+                number = msg->number();
+            }
+        } else {
+            const StatusMsg* msg = findStatusMsg(comp, desc.name);
+            if (msg) {
+                number = msg->number();
+            }
+        }
+        dest->msgs.push_back(number);
+    }
+}
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "decode/Config.h"
+
+#include <bmcl/ArrayView.h>
+#include <bmcl/Option.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace decode {
+
+class Device;
+
+enum class SchemaTypeKind : uint8_t {
+    Builtin,
+    Reference,
+    Array,
+    DynArray,
+    Function,
+    Enum,
+    Struct,
+    Variant,
+    Generic,
+    GenericInstantiation,
+};
+
+constexpr uint32_t schemaNoType = 0xffffffff;
+
+// flags:
+//   Builtin - BuiltinTypeKind
+//   Reference - ReferenceKind << 1 | isMutable
+//   Function - 0 if no self argument, SelfArgument + 1 otherwise
+// inner:
+//   pointee, element, return value or generic type index
+// first, count:
+//   struct fields in Schema::fields, function arguments or substituted types in Schema::typeRefs
+struct SchemaType {
+    SchemaTypeKind kind;
+    uint8_t flags;
+    uint16_t module;
+    const char* name;
+    uint64_t size;
+    uint32_t inner;
+    uint32_t first;
+    uint32_t count;
+};
+
+struct SchemaField {
+    const char* name;
+    uint32_t type;
+};
+
+struct SchemaCmd {
+    uint16_t module;
+    const char* name;
+    uint32_t firstArg;
+    uint32_t argCount;
+    uint32_t returnType;
+};
+
+struct SchemaMsg {
+    uint16_t module;
+    const char* name;
+    bool isEvent;
+};
+
+// types are ordered so that every type only references types with lower indices
+struct Schema {
+    bmcl::ArrayView<const char*> modules;
+    bmcl::ArrayView<SchemaType> types;
+    bmcl::ArrayView<SchemaField> fields;
+    bmcl::ArrayView<uint32_t> typeRefs;
+    bmcl::ArrayView<SchemaCmd> cmds;
+    bmcl::ArrayView<SchemaMsg> msgs;
+};
+
+struct SchemaValidationResult {
+    std::vector<bmcl::Option<uint64_t>> components;
+    std::vector<bmcl::Option<uint64_t>> cmds;
+    std::vector<bmcl::Option<uint64_t>> msgs;
+};
+
+void validateSchema(const Schema& schema, const Device* device, SchemaValidationResult* dest);
+}
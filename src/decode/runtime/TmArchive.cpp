@@ -0,0 +1,720 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "decode/runtime/TmArchive.h"
+#include "decode/ast/Component.h"
+#include "decode/ast/Type.h"
+#include "decode/core/StringBuilder.h"
+#include "decode/parser/Package.h"
+#include "decode/runtime/MsgStatsFormat.h"
+
+#include <bmcl/MemReader.h>
+#include <bmcl/Result.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace decode {
+
+static constexpr std::array<uint8_t, 4> archiveMagic = {{'D', 'T', 'M', 'A'}};
+static constexpr std::size_t trailerSize = 8 + 4;
+
+static uint64_t tableKey(uint64_t compNum, uint64_t msgNum)
+{
+    return (compNum << 32) | (msgNum & 0xffffffff);
+}
+
+static uint64_t doubleBits(double value)
+{
+    uint64_t bits;
+    std::memcpy(&bits, &value, 8);
+    return bits;
+}
+
+static double bitsDouble(uint64_t bits)
+{
+    double value;
+    std::memcpy(&value, &bits, 8);
+    return value;
+}
+
+static unsigned enumBitWidth(std::size_t constantNum)
+{
+    unsigned width = 1;
+    while (width < 64 && (uint64_t(1) << width) < constantNum) {
+        width++;
+    }
+    return width;
+}
+
+static TmColumnKind columnKind(const Type* type, std::vector<int64_t>* enumValues)
+{
+    type = type->resolveFinalType();
+    if (type->isEnum()) {
+        for (const EnumConstant* c : type->asEnum()->constantsRange()) {
+            enumValues->push_back(c->value());
+        }
+        std::sort(enumValues->begin(), enumValues->end());
+        return TmColumnKind::Enum;
+    }
+    if (!type->isBuiltin()) {
+        return TmColumnKind::Blob;
+    }
+    switch (type->asBuiltin()->builtinTypeKind()) {
+    case BuiltinTypeKind::USize:
+    case BuiltinTypeKind::U8:
+    case BuiltinTypeKind::U16:
+    case BuiltinTypeKind::U32:
+    case BuiltinTypeKind::U64:
+    case BuiltinTypeKind::Varuint:
+    case BuiltinTypeKind::Char:
+        return TmColumnKind::Unsigned;
+    case BuiltinTypeKind::ISize:
+    case BuiltinTypeKind::I8:
+    case BuiltinTypeKind::I16:
+    case BuiltinTypeKind::I32:
+    case BuiltinTypeKind::I64:
+    case BuiltinTypeKind::Varint:
+        return TmColumnKind::Signed;
+    case BuiltinTypeKind::F32:
+    case BuiltinTypeKind::F64:
+        return TmColumnKind::Double;
+    case BuiltinTypeKind::Bool:
+        return TmColumnKind::Bool;
+    case BuiltinTypeKind::Void:
+        break;
+    }
+    return TmColumnKind::Blob;
+}
+
+template <typename T>
+static void updateStats(T value, bool isFirst, TmColumnChunk* chunk)
+{
+    T min;
+    T max;
+    std::memcpy(&min, &chunk->min, sizeof(T));
+    std::memcpy(&max, &chunk->max, sizeof(T));
+    if (isFirst || value < min) {
+        min = value;
+    }
+    if (isFirst || value > max) {
+        max = value;
+    }
+    std::memcpy(&chunk->min, &min, sizeof(T));
+    std::memcpy(&chunk->max, &max, sizeof(T));
+}
+
+static void encodeDeltas(const std::vector<uint64_t>& values, bmcl::Buffer* dest)
+{
+    uint64_t prev = 0;
+    for (uint64_t value : values) {
+        dest->writeVarInt(int64_t(value - prev));
+        prev = value;
+    }
+}
+
+static void encodeBits(const std::vector<uint64_t>& values, unsigned width, bmcl::Buffer* dest)
+{
+    uint64_t acc = 0;
+    unsigned accBits = 0;
+    for (uint64_t value : values) {
+        for (unsigned i = 0; i < width; i++) {
+            acc |= ((value >> i) & 1) << accBits;
+            accBits++;
+            if (accBits == 8) {
+                dest->writeUint8(acc);
+                acc = 0;
+                accBits = 0;
+            }
+        }
+    }
+    if (accBits != 0) {
+        dest->writeUint8(acc);
+    }
+}
+
+TmArchiveWriter::TmArchiveWriter(const Package* package, std::size_t blockRows)
+    : _decoder(new PackageDecoder(package))
+    , _blockRows(std::max<std::size_t>(1, blockRows))
+    , _offset(0)
+    , _file(nullptr)
+{
+    StringBuilder name;
+    for (const Component* comp : package->components()) {
+        for (const StatusMsg* msg : comp->statusesRange()) {
+            Table table;
+            table.compNum = comp->number();
+            table.msgNum = msg->number();
+            for (const VarRegexp* part : msg->partsRange()) {
+                Column column;
+                name.clear();
+                part->buildFieldName(&name);
+                // subscripts are not part of field names, keep column names unique
+                std::size_t n = 1;
+                std::size_t nameSize = name.size();
+                auto isDuplicate = [&]() {
+                    return std::any_of(table.columns.begin(), table.columns.end(), [&](const Column& c) {
+                        return c.info.name == name.view();
+                    });
+                };
+                while (isDuplicate()) {
+                    name.resize(nameSize);
+                    name.append('_');
+                    name.appendNumericValue(n);
+                    n++;
+                }
+                column.info.name = name.view().toStdString();
+                column.info.kind = columnKind(part->type(), &column.info.enumValues);
+                column.plan = DecodePlan::fromType(part->type());
+                table.columns.push_back(std::move(column));
+            }
+            _tableIndex.emplace(tableKey(table.compNum, table.msgNum), _tables.size());
+            _tables.push_back(std::move(table));
+        }
+    }
+}
+
+TmArchiveWriter::~TmArchiveWriter()
+{
+    if (_file) {
+        std::fclose(_file);
+    }
+}
+
+bool TmArchiveWriter::write(const void* data, std::size_t size)
+{
+    if (std::fwrite(data, 1, size, _file) != size) {
+        return false;
+    }
+    _offset += size;
+    return true;
+}
+
+bool TmArchiveWriter::open(const char* path)
+{
+    _file = std::fopen(path, "wb");
+    if (!_file) {
+        return false;
+    }
+    _offset = 0;
+    _blocks.clear();
+    return write(archiveMagic.data(), archiveMagic.size());
+}
+
+bool TmArchiveWriter::appendStatus(uint64_t time, uint64_t compNum, uint64_t msgNum, bmcl::MemReader* src)
+{
+    auto it = _tableIndex.find(tableKey(compNum, msgNum));
+    if (it == _tableIndex.end()) {
+        return false;
+    }
+    Table& table = _tables[it->second];
+    std::size_t rows = table.times.size();
+    std::size_t columnIndex = 0;
+    for (Column& column : table.columns) {
+        const uint8_t* start = src->current();
+        _nodes.clear();
+        if (!column.plan->decode(src, &_nodes)) {
+            for (std::size_t i = 0; i < columnIndex; i++) {
+                Column& c = table.columns[i];
+                if (c.info.kind == TmColumnKind::Blob) {
+                    bmcl::MemReader reader(c.blobs.data(), c.blobs.size());
+                    for (std::size_t j = 0; j < rows; j++) {
+                        uint64_t size;
+                        reader.readVarUint(&size);
+                        reader.skip(size);
+                    }
+                    c.blobs.resize(reader.current() - c.blobs.data());
+                }
+                c.values.resize(rows);
+            }
+            return false;
+        }
+        const ValueNode& node = _nodes[0];
+        switch (column.info.kind) {
+        case TmColumnKind::Signed:
+        case TmColumnKind::Unsigned:
+        case TmColumnKind::Bool:
+            column.values.push_back(node.u);
+            break;
+        case TmColumnKind::Double:
+            column.values.push_back(doubleBits(node.d));
+            break;
+        case TmColumnKind::Enum: {
+            const std::vector<int64_t>& values = column.info.enumValues;
+            column.values.push_back(std::lower_bound(values.begin(), values.end(), node.i) - values.begin());
+            break;
+        }
+        case TmColumnKind::Blob:
+            column.values.push_back(0);
+            column.blobs.writeVarUint(src->current() - start);
+            column.blobs.write(start, src->current() - start);
+            break;
+        }
+        columnIndex++;
+    }
+    table.times.push_back(time);
+    if (table.times.size() >= _blockRows) {
+        return flushTable(it->second);
+    }
+    return true;
+}
+
+bool TmArchiveWriter::appendFrame(uint64_t time, bmcl::Bytes payload)
+{
+    bmcl::MemReader src(payload);
+    while (src.sizeLeft() != 0) {
+        if (src.sizeLeft() < 2) {
+            return false;
+        }
+        uint8_t compNum = src.readUint8();
+        uint8_t msgNum = src.readUint8();
+        if (_tableIndex.find(tableKey(compNum, msgNum)) != _tableIndex.end()) {
+            if (!appendStatus(time, compNum, msgNum, &src)) {
+                return false;
+            }
+            continue;
+        }
+        bmcl::OptionPtr<const DecodePlan> plan = _decoder->eventPlan(compNum, msgNum);
+        if (plan.isSome()) {
+            _nodes.clear();
+            if (!plan->decode(&src, &_nodes)) {
+                return false;
+            }
+            continue;
+        }
+        if (compNum == MsgStatsFormat::compNum && msgNum == MsgStatsFormat::msgNum) {
+            const std::size_t entrySize = MsgStatsFormat::entrySize;
+            if (src.sizeLeft() < MsgStatsFormat::headerSize) {
+                return false;
+            }
+            src.skip(2);
+            std::size_t count = src.readUint16Le();
+            if (src.sizeLeft() < count * entrySize) {
+                return false;
+            }
+            src.skip(count * entrySize);
+            continue;
+        }
+        return false;
+    }
+    return true;
+}
+
+bool TmArchiveWriter::writeChunk(const bmcl::Buffer& chunk, TmColumnChunk* dest)
+{
+    dest->offset = _offset;
+    dest->size = chunk.size();
+    return write(chunk.data(), chunk.size());
+}
+
+bool TmArchiveWriter::flushTable(std::size_t index)
+{
+    Table& table = _tables[index];
+    if (table.times.empty()) {
+        return true;
+    }
+    TmBlockInfo block;
+    block.table = index;
+    block.rows = table.times.size();
+
+    bmcl::Buffer chunk;
+    encodeDeltas(table.times, &chunk);
+    block.time = TmColumnChunk{0, 0, 0, 0};
+    for (std::size_t i = 0; i < table.times.size(); i++) {
+        updateStats<uint64_t>(table.times[i], i == 0, &block.time);
+    }
+    if (!writeChunk(chunk, &block.time)) {
+        return false;
+    }
+
+    for (Column& column : table.columns) {
+        TmColumnChunk info{0, 0, 0, 0};
+        chunk.clear();
+        const std::vector<uint64_t>& values = column.values;
+        switch (column.info.kind) {
+        case TmColumnKind::Signed:
+            encodeDeltas(values, &chunk);
+            for (std::size_t i = 0; i < values.size(); i++) {
+                updateStats<int64_t>(values[i], i == 0, &info);
+            }
+            break;
+        case TmColumnKind::Unsigned:
+            encodeDeltas(values, &chunk);
+            for (std::size_t i = 0; i < values.size(); i++) {
+                updateStats<uint64_t>(values[i], i == 0, &info);
+            }
+            break;
+        case TmColumnKind::Double:
+            for (std::size_t i = 0; i < values.size(); i++) {
+                chunk.writeUint64Le(values[i]);
+                updateStats<double>(bitsDouble(values[i]), i == 0, &info);
+            }
+            break;
+        case TmColumnKind::Bool:
+            encodeBits(values, 1, &chunk);
+            for (std::size_t i = 0; i < values.size(); i++) {
+                updateStats<uint64_t>(values[i], i == 0, &info);
+            }
+            break;
+        case TmColumnKind::Enum:
+            encodeBits(values, enumBitWidth(column.info.enumValues.size()), &chunk);
+            for (std::size_t i = 0; i < values.size(); i++) {
+                updateStats<int64_t>(column.info.enumValues[values[i]], i == 0, &info);
+            }
+            break;
+        case TmColumnKind::Blob:
+            chunk.write(column.blobs.data(), column.blobs.size());
+            column.blobs.clear();
+            break;
+        }
+        if (!writeChunk(chunk, &info)) {
+            return false;
+        }
+        block.columns.push_back(info);
+        column.values.clear();
+    }
+    table.times.clear();
+    _blocks.push_back(std::move(block));
+    return true;
+}
+
+static void writeChunkInfo(const TmColumnChunk& chunk, bmcl::Buffer* dest)
+{
+    dest->writeVarUint(chunk.offset);
+    dest->writeVarUint(chunk.size);
+    dest->writeUint64Le(chunk.min);
+    dest->writeUint64Le(chunk.max);
+}
+
+bool TmArchiveWriter::finish()
+{
+    for (std::size_t i = 0; i < _tables.size(); i++) {
+        if (!flushTable(i)) {
+            return false;
+        }
+    }
+
+    uint64_t footerOffset = _offset;
+    bmcl::Buffer footer;
+    footer.writeVarUint(_tables.size());
+    for (const Table& table : _tables) {
+        footer.writeVarUint(table.compNum);
+        footer.writeVarUint(table.msgNum);
+        footer.writeVarUint(table.columns.size());
+        for (const Column& column : table.columns) {
+            footer.writeVarUint(column.info.name.size());
+            footer.write(column.info.name.data(), column.info.name.size());
+            footer.writeUint8((uint8_t)column.info.kind);
+            if (column.info.kind == TmColumnKind::Enum) {
+                footer.writeVarUint(column.info.enumValues.size());
+                for (int64_t value : column.info.enumValues) {
+                    footer.writeVarInt(value);
+                }
+            }
+        }
+    }
+    footer.writeVarUint(_blocks.size());
+    for (const TmBlockInfo& block : _blocks) {
+        footer.writeVarUint(block.table);
+        footer.writeVarUint(block.rows);
+        writeChunkInfo(block.time, &footer);
+        for (const TmColumnChunk& chunk : block.columns) {
+            writeChunkInfo(chunk, &footer);
+        }
+    }
+    footer.writeUint64Le(footerOffset);
+    footer.write(archiveMagic.data(), archiveMagic.size());
+
+    bool isOk = write(footer.data(), footer.size());
+    isOk = (std::fclose(_file) == 0) && isOk;
+    _file = nullptr;
+    return isOk;
+}
+
+TmArchiveReader::TmArchiveReader(MappedFile* file)
+    : _file(file)
+{
+}
+
+TmArchiveReader::~TmArchiveReader()
+{
+}
+
+TmArchiveReaderResult TmArchiveReader::open(const char* path)
+{
+    MappedFileResult file = MappedFile::open(path);
+    if (file.isErr()) {
+        return file.unwrapErr();
+    }
+    Rc<TmArchiveReader> reader = new TmArchiveReader(file.unwrap().get());
+    if (!reader->readFooter()) {
+        return std::string("invalid archive footer");
+    }
+    return reader;
+}
+
+// every row takes at least this much of a chunk, rejects footers with row counts not backed by data
+static bool chunkHoldsRows(const TmColumnInfo& info, const TmColumnChunk& chunk, uint64_t rows)
+{
+    switch (info.kind) {
+    case TmColumnKind::Signed:
+    case TmColumnKind::Unsigned:
+    case TmColumnKind::Blob:
+        return rows <= chunk.size;
+    case TmColumnKind::Double:
+        return rows <= chunk.size / 8;
+    case TmColumnKind::Bool:
+        return rows / 8 <= chunk.size;
+    case TmColumnKind::Enum:
+        return rows / 8 <= chunk.size / enumBitWidth(info.enumValues.size());
+    }
+    return false;
+}
+
+static bool readChunkInfo(bmcl::MemReader* src, TmColumnChunk* dest, std::size_t fileSize)
+{
+    if (!src->readVarUint(&dest->offset) || !src->readVarUint(&dest->size)) {
+        return false;
+    }
+    if (src->sizeLeft() < 16) {
+        return false;
+    }
+    dest->min = src->readUint64Le();
+    dest->max = src->readUint64Le();
+    return dest->offset <= fileSize && dest->size <= (fileSize - dest->offset);
+}
+
+bool TmArchiveReader::readFooter()
+{
+    bmcl::Bytes data = _file->data();
+    if (data.size() < archiveMagic.size() + trailerSize) {
+        return false;
+    }
+    if (std::memcmp(data.data(), archiveMagic.data(), archiveMagic.size()) != 0) {
+        return false;
+    }
+    bmcl::MemReader trailer(data.data() + data.size() - trailerSize, trailerSize);
+    uint64_t footerOffset = trailer.readUint64Le();
+    if (std::memcmp(trailer.current(), archiveMagic.data(), archiveMagic.size()) != 0) {
+        return false;
+    }
+    if (footerOffset > data.size() - trailerSize) {
+        return false;
+    }
+
+    bmcl::MemReader src(data.data() + footerOffset, data.size() - trailerSize - footerOffset);
+    uint64_t tableNum;
+    if (!src.readVarUint(&tableNum)) {
+        return false;
+    }
+    for (uint64_t i = 0; i < tableNum; i++) {
+        TmTableInfo table;
+        uint64_t columnNum;
+        if (!src.readVarUint(&table.compNum) || !src.readVarUint(&table.msgNum) || !src.readVarUint(&columnNum)) {
+            return false;
+        }
+        for (uint64_t j = 0; j < columnNum; j++) {
+            TmColumnInfo column;
+            uint64_t nameSize;
+            if (!src.readVarUint(&nameSize) || src.sizeLeft() < nameSize + 1) {
+                return false;
+            }
+            column.name.assign((const char*)src.current(), nameSize);
+            src.skip(nameSize);
+            uint8_t kind = src.readUint8();
+            if (kind > (uint8_t)TmColumnKind::Blob) {
+                return false;
+            }
+            column.kind = (TmColumnKind)kind;
+            if (column.kind == TmColumnKind::Enum) {
+                uint64_t valueNum;
+                if (!src.readVarUint(&valueNum) || valueNum > src.sizeLeft()) {
+                    return false;
+                }
+                for (uint64_t k = 0; k < valueNum; k++) {
+                    int64_t value;
+                    if (!src.readVarInt(&value)) {
+                        return false;
+                    }
+                    column.enumValues.push_back(value);
+                }
+            }
+            table.columns.push_back(std::move(column));
+        }
+        _tables.push_back(std::move(table));
+    }
+
+    uint64_t blockNum;
+    if (!src.readVarUint(&blockNum)) {
+        return false;
+    }
+    for (uint64_t i = 0; i < blockNum; i++) {
+        TmBlockInfo block;
+        uint64_t table;
+        uint64_t rows;
+        if (!src.readVarUint(&table) || !src.readVarUint(&rows) || table >= _tables.size()) {
+            return false;
+        }
+        block.table = table;
+        block.rows = rows;
+        // time deltas take at least a byte per row
+        if (!readChunkInfo(&src, &block.time, footerOffset) || rows > block.time.size) {
+            return false;
+        }
+        const std::vector<TmColumnInfo>& columns = _tables[table].columns;
+        block.columns.resize(columns.size());
+        for (std::size_t j = 0; j < columns.size(); j++) {
+            if (!readChunkInfo(&src, &block.columns[j], footerOffset) || !chunkHoldsRows(columns[j], block.columns[j], rows)) {
+                return false;
+            }
+        }
+        _blocks.push_back(std::move(block));
+    }
+    return true;
+}
+
+const std::vector<TmTableInfo>& TmArchiveReader::tables() const
+{
+    return _tables;
+}
+
+const std::vector<TmBlockInfo>& TmArchiveReader::blocks() const
+{
+    return _blocks;
+}
+
+bmcl::Option<std::size_t> TmArchiveReader::findTable(uint64_t compNum, uint64_t msgNum) const
+{
+    for (std::size_t i = 0; i < _tables.size(); i++) {
+        if (_tables[i].compNum == compNum && _tables[i].msgNum == msgNum) {
+            return i;
+        }
+    }
+    return bmcl::None;
+}
+
+bmcl::Option<std::size_t> TmArchiveReader::findColumn(std::size_t table, bmcl::StringView name) const
+{
+    const std::vector<TmColumnInfo>& columns = _tables[table].columns;
+    for (std::size_t i = 0; i < columns.size(); i++) {
+        if (name == columns[i].name) {
+            return i;
+        }
+    }
+    return bmcl::None;
+}
+
+static bool decodeDeltas(bmcl::MemReader* src, std::size_t rows, std::vector<TmSample>* dest)
+{
+    uint64_t prev = 0;
+    for (std::size_t i = 0; i < rows; i++) {
+        int64_t delta;
+        if (!src->readVarInt(&delta)) {
+            return false;
+        }
+        prev += uint64_t(delta);
+        (*dest)[i].u = prev;
+    }
+    return true;
+}
+
+static bool decodeBits(bmcl::MemReader* src, std::size_t rows, unsigned width, std::vector<TmSample>* dest)
+{
+    if (rows / 8 > src->sizeLeft() / width || (rows * width + 7) / 8 > src->sizeLeft()) {
+        return false;
+    }
+    const uint8_t* data = src->current();
+    std::size_t bit = 0;
+    for (std::size_t i = 0; i < rows; i++) {
+        uint64_t value = 0;
+        for (unsigned j = 0; j < width; j++) {
+            value |= uint64_t((data[bit / 8] >> (bit % 8)) & 1) << j;
+            bit++;
+        }
+        (*dest)[i].u = value;
+    }
+    return true;
+}
+
+bool TmArchiveReader::decodeColumn(const TmColumnInfo& info, const TmColumnChunk& chunk, std::size_t rows, std::vector<TmSample>* dest) const
+{
+    bmcl::Bytes data = _file->data();
+    if (chunk.offset > data.size() || chunk.size > data.size() - chunk.offset || rows > chunk.size * 8) {
+        return false;
+    }
+    bmcl::MemReader src(data.data() + chunk.offset, chunk.size);
+    dest->resize(rows);
+    switch (info.kind) {
+    case TmColumnKind::Signed:
+    case TmColumnKind::Unsigned:
+        return decodeDeltas(&src, rows, dest);
+    case TmColumnKind::Double:
+        if (src.sizeLeft() / 8 < rows) {
+            return false;
+        }
+        for (std::size_t i = 0; i < rows; i++) {
+            (*dest)[i].d = src.readFloat64Le();
+        }
+        return true;
+    case TmColumnKind::Bool:
+        return decodeBits(&src, rows, 1, dest);
+    case TmColumnKind::Enum:
+        if (!decodeBits(&src, rows, enumBitWidth(info.enumValues.size()), dest)) {
+            return false;
+        }
+        for (std::size_t i = 0; i < rows; i++) {
+            if ((*dest)[i].u >= info.enumValues.size()) {
+                return false;
+            }
+            (*dest)[i].i = info.enumValues[(*dest)[i].u];
+        }
+        return true;
+    case TmColumnKind::Blob:
+        for (std::size_t i = 0; i < rows; i++) {
+            uint64_t size;
+            if (!src.readVarUint(&size) || src.sizeLeft() < size) {
+                return false;
+            }
+            (*dest)[i].blob = bmcl::Bytes(src.current(), size);
+            src.skip(size);
+        }
+        return true;
+    }
+    return false;
+}
+
+bool TmArchiveReader::scanColumn(std::size_t table, std::size_t column, uint64_t from, uint64_t to, std::vector<TmSample>* dest) const
+{
+    const TmColumnInfo& info = _tables[table].columns[column];
+    TmColumnInfo timeInfo;
+    timeInfo.kind = TmColumnKind::Unsigned;
+    std::vector<TmSample> times;
+    std::vector<TmSample> values;
+    for (const TmBlockInfo& block : _blocks) {
+        if (block.table != table || block.time.max < from || block.time.min > to) {
+            continue;
+        }
+        if (!decodeColumn(timeInfo, block.time, block.rows, &times)) {
+            return false;
+        }
+        if (!decodeColumn(info, block.columns[column], block.rows, &values)) {
+            return false;
+        }
+        for (std::size_t i = 0; i < block.rows; i++) {
+            uint64_t time = times[i].u;
+            if (time < from || time > to) {
+                continue;
+            }
+            values[i].time = time;
+            dest->push_back(values[i]);
+        }
+    }
+    return true;
+}
+}
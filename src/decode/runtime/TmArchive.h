@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "decode/Config.h"
+#include "decode/core/Rc.h"
+#include "decode/core/HashMap.h"
+#include "decode/runtime/DecodePlan.h"
+#include "decode/runtime/LogDecoder.h"
+
+#include <bmcl/Fwd.h>
+#include <bmcl/Buffer.h>
+#include <bmcl/Bytes.h>
+#include <bmcl/Option.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace decode {
+
+class Package;
+class TmArchiveReader;
+
+using TmArchiveReaderResult = bmcl::Result<Rc<TmArchiveReader>, std::string>;
+
+enum class TmColumnKind : uint8_t {
+    Signed,   // zigzag varint deltas
+    Unsigned, // zigzag varint deltas, wrapping
+    Double,   // raw f64
+    Bool,     // bit-packed
+    Enum,     // bit-packed constant index
+    Blob,     // varuint size + encoded value
+};
+
+struct TmColumnInfo {
+    std::string name;
+    TmColumnKind kind;
+    std::vector<int64_t> enumValues;
+};
+
+struct TmColumnChunk {
+    uint64_t offset;
+    uint64_t size;
+    uint64_t min;
+    uint64_t max;
+};
+
+struct TmBlockInfo {
+    std::size_t table;
+    std::size_t rows;
+    TmColumnChunk time;
+    std::vector<TmColumnChunk> columns;
+};
+
+struct TmTableInfo {
+    uint64_t compNum;
+    uint64_t msgNum;
+    std::vector<TmColumnInfo> columns;
+};
+
+struct TmSample {
+    uint64_t time;
+    union {
+        int64_t i;
+        uint64_t u;
+        double d;
+    };
+    bmcl::Bytes blob;
+};
+
+// archive layout:
+//   magic, blocks, footer (tables, block index), u64le footer offset, magic
+// each block holds rows of a single status message, columns of a block are stored
+// contiguously so that scanning a field reads only its own chunk and the time chunk
+class TmArchiveWriter : public RefCountable {
+public:
+    using Pointer = Rc<TmArchiveWriter>;
+    using ConstPointer = Rc<const TmArchiveWriter>;
+
+    TmArchiveWriter(const Package* package, std::size_t blockRows = 4096);
+    ~TmArchiveWriter();
+
+    bool open(const char* path);
+    bool appendStatus(uint64_t time, uint64_t compNum, uint64_t msgNum, bmcl::MemReader* src);
+    // appends all statuses of a recorded log frame payload, events are skipped
+    bool appendFrame(uint64_t time, bmcl::Bytes payload);
+    bool finish();
+
+private:
+    struct Column {
+        TmColumnInfo info;
+        Rc<DecodePlan> plan;
+        std::vector<uint64_t> values;
+        bmcl::Buffer blobs;
+    };
+
+    struct Table {
+        uint64_t compNum;
+        uint64_t msgNum;
+        std::vector<Column> columns;
+        std::vector<uint64_t> times;
+    };
+
+    bool write(const void* data, std::size_t size);
+    bool flushTable(std::size_t index);
+    bool writeChunk(const bmcl::Buffer& chunk, TmColumnChunk* dest);
+
+    Rc<PackageDecoder> _decoder;
+    std::vector<Table> _tables;
+    HashMap<uint64_t, std::size_t> _tableIndex;
+    std::vector<TmBlockInfo> _blocks;
+    std::vector<ValueNode> _nodes;
+    std::size_t _blockRows;
+    uint64_t _offset;
+    std::FILE* _file;
+};
+
+class TmArchiveReader : public RefCountable {
+public:
+    using Pointer = Rc<TmArchiveReader>;
+    using ConstPointer = Rc<const TmArchiveReader>;
+
+    static TmArchiveReaderResult open(const char* path);
+    ~TmArchiveReader();
+
+    const std::vector<TmTableInfo>& tables() const;
+    const std::vector<TmBlockInfo>& blocks() const;
+
+    bmcl::Option<std::size_t> findTable(uint64_t compNum, uint64_t msgNum) const;
+    bmcl::Option<std::size_t> findColumn(std::size_t table, bmcl::StringView name) const;
+
+    bool scanColumn(std::size_t table, std::size_t column, uint64_t from, uint64_t to, std::vector<TmSample>* dest) const;
+
+private:
+    TmArchiveReader(MappedFile* file);
+
+    bool readFooter();
+    bool decodeColumn(const TmColumnInfo& info, const TmColumnChunk& chunk, std::size_t rows, std::vector<TmSample>* dest) const;
+
+    Rc<MappedFile> _file;
+    std::vector<TmTableInfo> _tables;
+    std::vector<TmBlockInfo> _blocks;
+};
+}
@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "decode/generator/BinLogRewriter.h"
+#include "decode/generator/SrcBuilder.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+using namespace decode;
+
+static std::string rewrite(BinLogRewriter* rewriter, bmcl::StringView src)
+{
+    SrcBuilder dest;
+    rewriter->rewrite(src, &dest);
+    return dest.view().toStdString();
+}
+
+TEST(BinLogRewriter, logCalls)
+{
+    BinLogRewriter rewriter;
+    std::string out = rewrite(&rewriter,
+        "#include \"a.h\"\n"
+        "#define _PHOTON_FNAME \"a.c\"\n"
+        "void f(unsigned x)\n"
+        "{\n"
+        "    PHOTON_DEBUG(\"value %u\", x);\n"
+        "    PHOTON_CRITICAL(\"failed\");\n"
+        "}\n");
+    EXPECT_EQ("#include \"a.h\"\n"
+              "#include \"photongen/onboard/BinLog.h\"\n"
+              "#define _PHOTON_FNAME \"a.c\"\n"
+              "void f(unsigned x)\n"
+              "{\n"
+              "    PHOTON_BINLOG_DEBUG(0, 1, (uint32_t)(x));\n"
+              "    PHOTON_BINLOG_CRITICAL(1, 0);\n"
+              "}\n", out);
+
+    ASSERT_EQ(2u, rewriter.sites().size());
+    EXPECT_STREQ("debug", rewriter.sites()[0].level);
+    EXPECT_EQ("value %u", rewriter.sites()[0].format);
+    EXPECT_STREQ("critical", rewriter.sites()[1].level);
+}
+
+TEST(BinLogRewriter, sharedIds)
+{
+    BinLogRewriter rewriter;
+    rewrite(&rewriter, "PHOTON_INFO(\"msg\");\nPHOTON_INFO(\"msg\");\nPHOTON_WARNING(\"msg\");\n");
+    std::string out = rewrite(&rewriter, "PHOTON_INFO(\"msg\");\n");
+    EXPECT_EQ("#include \"photongen/onboard/BinLog.h\"\nPHOTON_BINLOG_INFO(0, 0);\n", out);
+
+    ASSERT_EQ(2u, rewriter.sites().size());
+    EXPECT_EQ(3u, rewriter.sites()[0].count);
+    EXPECT_EQ(1u, rewriter.sites()[1].count);
+
+    rewriter.clear();
+    EXPECT_TRUE(rewriter.sites().empty());
+}
+
+TEST(BinLogRewriter, tryMsg)
+{
+    BinLogRewriter rewriter;
+    std::string out = rewrite(&rewriter, "PHOTON_TRY_MSG(g(a, \")\"), \"g failed\");");
+    EXPECT_EQ("#include \"photongen/onboard/BinLog.h\"\nPHOTON_BINLOG_TRY(g(a, \")\"), 0);", out);
+    ASSERT_EQ(1u, rewriter.sites().size());
+    EXPECT_STREQ("debug", rewriter.sites()[0].level);
+    EXPECT_EQ("g failed", rewriter.sites()[0].format);
+}
+
+TEST(BinLogRewriter, unsupportedCalls)
+{
+    BinLogRewriter rewriter;
+    const char* src =
+        "PHOTON_DEBUG(fmt, 1);\n"
+        "PHOTON_DEBUG(\"a\" \"b\");\n"
+        "PHOTON_DEBUG(\"%u %u %u %u %u\", 1, 2, 3, 4, 5);\n"
+        "MY_PHOTON_DEBUG(\"text\");\n"
+        "PHOTON_TRACE(\"text\");\n"
+        "PHOTON_DEBUG(\"unterminated\"\n";
+    EXPECT_EQ(src, rewrite(&rewriter, src));
+    EXPECT_TRUE(rewriter.sites().empty());
+}
+
+TEST(BinLogRewriter, maxArgs)
+{
+    BinLogRewriter rewriter;
+    std::string out = rewrite(&rewriter, "PHOTON_WARNING(\"%u %u %u %u\", a[0], f(b, c), d, e);");
+    EXPECT_EQ("#include \"photongen/onboard/BinLog.h\"\n"
+              "PHOTON_BINLOG_WARNING(0, 4, (uint32_t)(a[0]), (uint32_t)(f(b, c)), (uint32_t)(d), (uint32_t)(e));", out);
+}
+
+TEST(BinLogRewriter, jsonEscapes)
+{
+    BinLogRewriter rewriter;
+    rewrite(&rewriter, "PHOTON_INFO(\"tab\\there \\x41\\101\\0 \\'q\\' \\\"d\\\" \\\\ 100%%\");");
+    ASSERT_EQ(1u, rewriter.sites().size());
+    // the site keeps the C literal for the groundcontrol header
+    EXPECT_EQ("tab\\there \\x41\\101\\0 \\'q\\' \\\"d\\\" \\\\ 100%%", rewriter.sites()[0].format);
+    EXPECT_EQ("{\n"
+              "  \"sites\": [\n"
+              "    {\"id\": 0, \"level\": \"info\", \"count\": 1, \"format\": \"tab\\there AA\\u0000 'q' \\\"d\\\" \\\\ 100%%\"}\n"
+              "  ]\n"
+              "}\n", rewriter.toJson());
+}
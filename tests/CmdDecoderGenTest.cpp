@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "TestPackage.h"
+
+#include "decode/generator/CmdDecoderGen.h"
+#include "decode/generator/SrcBuilder.h"
+
+#include <gtest/gtest.h>
+
+using namespace decode;
+
+static const char* cfgModule =
+    "module foo\n"
+    "\n"
+    "component {\n"
+    "    commands {\n"
+    "        fn always()\n"
+    "        #[cfg(heater)]\n"
+    "        fn heat()\n"
+    "        #[cfg(not(heater))]\n"
+    "        fn cool()\n"
+    "        #[cfg(any(heater, fan))]\n"
+    "        fn blow()\n"
+    "    }\n"
+    "}\n";
+
+static std::string generateDecoder(const Package* package, const Configuration* cfg)
+{
+    SrcBuilder output;
+    CmdDecoderGen gen(&output);
+    gen.setConfiguration(cfg);
+    gen.generateSource(package->components());
+    return output.view().toStdString();
+}
+
+static bool hasCase(const std::string& src, bmcl::StringView cmdName)
+{
+    return src.find("PhotonFoo_DeserializeAndExecCmd_" + cmdName.toStdString() + "(src, dest);") != std::string::npos;
+}
+
+TEST(CmdDecoderGen, cfgDisabled)
+{
+    Rc<Package> package = parseTestPackage({cfgModule});
+    ASSERT_TRUE(package.get() != nullptr);
+
+    Rc<Configuration> cfg = new Configuration;
+    std::string src = generateDecoder(package.get(), cfg.get());
+    EXPECT_TRUE(hasCase(src, "Always"));
+    EXPECT_FALSE(hasCase(src, "Heat"));
+    EXPECT_TRUE(hasCase(src, "Cool"));
+    EXPECT_FALSE(hasCase(src, "Blow"));
+    EXPECT_EQ(std::string::npos, src.find("case 1:"));
+    EXPECT_NE(std::string::npos, src.find("case 2:"));
+}
+
+TEST(CmdDecoderGen, cfgEnabled)
+{
+    Rc<Package> package = parseTestPackage({cfgModule});
+    ASSERT_TRUE(package.get() != nullptr);
+
+    Rc<Configuration> cfg = new Configuration;
+    cfg->setCfgOption("heater");
+    std::string src = generateDecoder(package.get(), cfg.get());
+    EXPECT_TRUE(hasCase(src, "Always"));
+    EXPECT_TRUE(hasCase(src, "Heat"));
+    EXPECT_FALSE(hasCase(src, "Cool"));
+    EXPECT_TRUE(hasCase(src, "Blow"));
+    EXPECT_NE(std::string::npos, src.find("case 1:"));
+    EXPECT_NE(std::string::npos, src.find("case 3:"));
+}
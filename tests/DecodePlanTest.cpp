@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "decode/runtime/DecodePlan.h"
+#include "decode/ast/Type.h"
+#include "decode/ast/Field.h"
+
+#include <bmcl/Buffer.h>
+#include <bmcl/MemReader.h>
+
+#include <gtest/gtest.h>
+
+using namespace decode;
+
+static bool decodeBuffer(const Type* type, const bmcl::Buffer& buf, std::vector<ValueNode>* nodes)
+{
+    Rc<DecodePlan> plan = DecodePlan::fromType(type);
+    bmcl::MemReader reader(buf.data(), buf.size());
+    if (!plan->decode(&reader, nodes)) {
+        return false;
+    }
+    return reader.sizeLeft() == 0;
+}
+
+TEST(DecodePlan, builtins)
+{
+    Rc<StructType> type = new StructType("s", nullptr);
+    type->addField(new Field("a", new BuiltinType(BuiltinTypeKind::U8)));
+    type->addField(new Field("b", new BuiltinType(BuiltinTypeKind::I16)));
+    type->addField(new Field("c", new BuiltinType(BuiltinTypeKind::U32)));
+    type->addField(new Field("d", new BuiltinType(BuiltinTypeKind::F64)));
+    type->addField(new Field("e", new BuiltinType(BuiltinTypeKind::Varint)));
+    type->addField(new Field("f", new BuiltinType(BuiltinTypeKind::Varuint)));
+    type->addField(new Field("g", new BuiltinType(BuiltinTypeKind::Bool)));
+
+    bmcl::Buffer buf;
+    buf.writeUint8(200);
+    buf.writeUint16Le(uint16_t(-1234));
+    buf.writeUint32Le(0xdeadbeef);
+    buf.writeFloat64Le(2.5);
+    buf.writeVarInt(-100000);
+    buf.writeVarUint(300);
+    buf.writeUint8(1);
+
+    std::vector<ValueNode> nodes;
+    ASSERT_TRUE(decodeBuffer(type.get(), buf, &nodes));
+    ASSERT_EQ(8u, nodes.size());
+    EXPECT_EQ(ValueKind::Struct, nodes[0].kind);
+    EXPECT_EQ(7u, nodes[0].count);
+    EXPECT_EQ(ValueKind::Unsigned, nodes[1].kind);
+    EXPECT_EQ(200u, nodes[1].u);
+    EXPECT_EQ(ValueKind::Signed, nodes[2].kind);
+    EXPECT_EQ(-1234, nodes[2].i);
+    EXPECT_EQ(0xdeadbeefu, nodes[3].u);
+    EXPECT_EQ(ValueKind::Double, nodes[4].kind);
+    EXPECT_EQ(2.5, nodes[4].d);
+    EXPECT_EQ(-100000, nodes[5].i);
+    EXPECT_EQ(300u, nodes[6].u);
+    EXPECT_EQ(ValueKind::Bool, nodes[7].kind);
+    EXPECT_EQ(1u, nodes[7].u);
+}
+
+TEST(DecodePlan, truncatedInput)
+{
+    Rc<StructType> type = new StructType("s", nullptr);
+    type->addField(new Field("a", new BuiltinType(BuiltinTypeKind::U32)));
+    type->addField(new Field("b", new BuiltinType(BuiltinTypeKind::U32)));
+
+    bmcl::Buffer buf;
+    buf.writeUint32Le(1);
+    buf.writeUint16Le(2);
+
+    std::vector<ValueNode> nodes;
+    EXPECT_FALSE(decodeBuffer(type.get(), buf, &nodes));
+}
+
+TEST(DecodePlan, arrays)
+{
+    Rc<ArrayType> type = new ArrayType(3, new DynArrayType(4, new BuiltinType(BuiltinTypeKind::U16)));
+
+    bmcl::Buffer buf;
+    buf.writeVarUint(2);
+    buf.writeUint16Le(1);
+    buf.writeUint16Le(2);
+    buf.writeVarUint(0);
+    buf.writeVarUint(1);
+    buf.writeUint16Le(3);
+
+    std::vector<ValueNode> nodes;
+    ASSERT_TRUE(decodeBuffer(type.get(), buf, &nodes));
+    ASSERT_EQ(7u, nodes.size());
+    EXPECT_EQ(ValueKind::Array, nodes[0].kind);
+    EXPECT_EQ(3u, nodes[0].count);
+    EXPECT_EQ(2u, nodes[1].count);
+    EXPECT_EQ(1u, nodes[2].u);
+    EXPECT_EQ(2u, nodes[3].u);
+    EXPECT_EQ(0u, nodes[4].count);
+    EXPECT_EQ(1u, nodes[5].count);
+    EXPECT_EQ(3u, nodes[6].u);
+}
+
+TEST(DecodePlan, dynArrayOverflow)
+{
+    Rc<DynArrayType> type = new DynArrayType(2, new BuiltinType(BuiltinTypeKind::U8));
+
+    bmcl::Buffer buf;
+    buf.writeVarUint(3);
+    buf.writeUint8(1);
+    buf.writeUint8(2);
+    buf.writeUint8(3);
+
+    std::vector<ValueNode> nodes;
+    EXPECT_FALSE(decodeBuffer(type.get(), buf, &nodes));
+}
+
+TEST(DecodePlan, deeplyNestedArrays)
+{
+    Rc<Type> type = new BuiltinType(BuiltinTypeKind::U8);
+    for (std::size_t i = 0; i < 100; i++) {
+        type = new ArrayType(1, type.get());
+    }
+
+    bmcl::Buffer buf;
+    buf.writeUint8(42);
+
+    std::vector<ValueNode> nodes;
+    ASSERT_TRUE(decodeBuffer(type.get(), buf, &nodes));
+    ASSERT_EQ(101u, nodes.size());
+    EXPECT_EQ(42u, nodes.back().u);
+}
+
+TEST(DecodePlan, enums)
+{
+    Rc<EnumType> type = new EnumType("e", nullptr);
+    type->addConstant(new EnumConstant("A", -5, true));
+    type->addConstant(new EnumConstant("B", 7, true));
+
+    bmcl::Buffer valid;
+    valid.writeVarInt(7);
+    std::vector<ValueNode> nodes;
+    ASSERT_TRUE(decodeBuffer(type.get(), valid, &nodes));
+    ASSERT_EQ(1u, nodes.size());
+    EXPECT_EQ(ValueKind::Enum, nodes[0].kind);
+    EXPECT_EQ(7, nodes[0].i);
+
+    bmcl::Buffer invalid;
+    invalid.writeVarInt(6);
+    nodes.clear();
+    EXPECT_FALSE(decodeBuffer(type.get(), invalid, &nodes));
+}
+
+TEST(DecodePlan, variants)
+{
+    Rc<VariantType> type = new VariantType("v", nullptr);
+    type->addField(new ConstantVariantField(0, "None"));
+    Rc<TupleVariantField> tuple = new TupleVariantField(1, "Some");
+    tuple->addType(new BuiltinType(BuiltinTypeKind::U32));
+    type->addField(tuple.get());
+
+    Rc<ArrayType> array = new ArrayType(2, type.get());
+
+    bmcl::Buffer buf;
+    buf.writeVarInt(1);
+    buf.writeUint32Le(77);
+    buf.writeVarInt(0);
+
+    std::vector<ValueNode> nodes;
+    ASSERT_TRUE(decodeBuffer(array.get(), buf, &nodes));
+    ASSERT_EQ(6u, nodes.size());
+    EXPECT_EQ(ValueKind::Array, nodes[0].kind);
+    EXPECT_EQ(ValueKind::Variant, nodes[1].kind);
+    EXPECT_EQ(1u, nodes[1].u);
+    EXPECT_EQ(ValueKind::Struct, nodes[2].kind);
+    EXPECT_EQ(1u, nodes[2].count);
+    EXPECT_EQ(77u, nodes[3].u);
+    EXPECT_EQ(ValueKind::Variant, nodes[4].kind);
+    EXPECT_EQ(0u, nodes[4].u);
+    EXPECT_EQ(0u, nodes[5].count);
+
+    bmcl::Buffer unknown;
+    unknown.writeVarInt(2);
+    nodes.clear();
+    EXPECT_FALSE(decodeBuffer(type.get(), unknown, &nodes));
+}
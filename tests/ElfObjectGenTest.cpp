@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "decode/generator/ElfObjectGen.h"
+
+#include <bmcl/Buffer.h>
+#include <bmcl/OptionPtr.h>
+#include <bmcl/StringView.h>
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <string>
+
+using namespace decode;
+
+struct ElfSection {
+    std::string name;
+    uint32_t type;
+    uint64_t offset;
+    uint64_t size;
+    uint32_t link;
+    uint64_t entrySize;
+};
+
+struct ElfSymbol {
+    std::string name;
+    uint8_t info;
+    uint16_t section;
+    uint64_t value;
+    uint64_t size;
+};
+
+// minimal little-endian ELF reader, only what ElfObjectGen emits
+class ElfReader {
+public:
+    ElfReader(const bmcl::Buffer& data)
+        : _data(data)
+    {
+        _is64Bit = _data.data()[4] == 2;
+    }
+
+    template <typename T>
+    T read(std::size_t offset) const
+    {
+        T value;
+        std::memcpy(&value, _data.data() + offset, sizeof(T));
+        return value;
+    }
+
+    uint64_t readWord(std::size_t offset) const
+    {
+        return _is64Bit ? read<uint64_t>(offset) : read<uint32_t>(offset);
+    }
+
+    std::string readString(std::size_t offset) const
+    {
+        return std::string((const char*)_data.data() + offset);
+    }
+
+    bool is64Bit() const
+    {
+        return _is64Bit;
+    }
+
+    uint16_t machine() const
+    {
+        return read<uint16_t>(18);
+    }
+
+    uint32_t flags() const
+    {
+        return read<uint32_t>(_is64Bit ? 48 : 36);
+    }
+
+    std::vector<ElfSection> sections() const
+    {
+        uint64_t offset = readWord(_is64Bit ? 40 : 32);
+        std::size_t headerSize = read<uint16_t>(_is64Bit ? 58 : 46);
+        std::size_t count = read<uint16_t>(_is64Bit ? 60 : 48);
+        std::size_t shstrIndex = read<uint16_t>(_is64Bit ? 62 : 50);
+        std::size_t word = _is64Bit ? 8 : 4;
+        std::vector<ElfSection> sections;
+        for (std::size_t i = 0; i < count; i++) {
+            std::size_t h = offset + i * headerSize;
+            ElfSection section;
+            section.name = std::to_string(read<uint32_t>(h));
+            section.type = read<uint32_t>(h + 4);
+            section.offset = readWord(h + 8 + 2 * word);
+            section.size = readWord(h + 8 + 3 * word);
+            section.link = read<uint32_t>(h + 8 + 4 * word);
+            section.entrySize = readWord(h + 16 + 5 * word);
+            sections.push_back(section);
+        }
+        uint64_t shstrOffset = sections[shstrIndex].offset;
+        for (ElfSection& section : sections) {
+            section.name = readString(shstrOffset + std::stoul(section.name));
+        }
+        return sections;
+    }
+
+    std::vector<ElfSymbol> symbols() const
+    {
+        std::vector<ElfSection> s = sections();
+        std::vector<ElfSymbol> symbols;
+        for (const ElfSection& section : s) {
+            if (section.type != 2) {
+                continue;
+            }
+            uint64_t strOffset = s[section.link].offset;
+            for (uint64_t i = 1; i < section.size / section.entrySize; i++) {
+                std::size_t e = section.offset + i * section.entrySize;
+                ElfSymbol symbol;
+                symbol.name = readString(strOffset + read<uint32_t>(e));
+                if (_is64Bit) {
+                    symbol.info = read<uint8_t>(e + 4);
+                    symbol.section = read<uint16_t>(e + 6);
+                    symbol.value = read<uint64_t>(e + 8);
+                    symbol.size = read<uint64_t>(e + 16);
+                } else {
+                    symbol.value = read<uint32_t>(e + 4);
+                    symbol.size = read<uint32_t>(e + 8);
+                    symbol.info = read<uint8_t>(e + 12);
+                    symbol.section = read<uint16_t>(e + 14);
+                }
+                symbols.push_back(symbol);
+            }
+        }
+        return symbols;
+    }
+
+private:
+    const bmcl::Buffer& _data;
+    bool _is64Bit;
+};
+
+static void checkObject(bmcl::StringView targetName, bool is64Bit, uint16_t machine)
+{
+    bmcl::OptionPtr<const ElfTarget> target = ElfObjectGen::findTarget(targetName);
+    ASSERT_TRUE(target.isSome());
+
+    const uint8_t package[] = {1, 2, 3, 4, 5};
+    const uint8_t hash[] = {0xaa, 0xbb, 0xcc};
+    ElfObjectGen gen;
+    gen.addSymbol("_package", bmcl::Bytes(package, sizeof(package)));
+    gen.addSymbol("_packageHash", bmcl::Bytes(hash, sizeof(hash)));
+    bmcl::Buffer object;
+    gen.generate(target.unwrap(), &object);
+
+    ASSERT_GT(object.size(), 16u);
+    EXPECT_EQ(0, std::memcmp(object.data(), "\x7f" "ELF", 4));
+    ElfReader reader(object);
+    EXPECT_EQ(is64Bit, reader.is64Bit());
+    EXPECT_EQ(1u, reader.read<uint16_t>(16));
+    EXPECT_EQ(machine, reader.machine());
+    EXPECT_EQ(target->flags, reader.flags());
+
+    std::vector<ElfSection> sections = reader.sections();
+    ASSERT_EQ(6u, sections.size());
+    EXPECT_EQ(".rodata", sections[1].name);
+    EXPECT_EQ(".note.GNU-stack", sections[2].name);
+    EXPECT_EQ(".symtab", sections[3].name);
+    EXPECT_EQ(".strtab", sections[4].name);
+    EXPECT_EQ(".shstrtab", sections[5].name);
+    for (const ElfSection& section : sections) {
+        EXPECT_LE(section.offset + section.size, object.size());
+    }
+
+    std::vector<ElfSymbol> symbols = reader.symbols();
+    ASSERT_EQ(2u, symbols.size());
+    EXPECT_EQ("_package", symbols[0].name);
+    EXPECT_EQ("_packageHash", symbols[1].name);
+    for (const ElfSymbol& symbol : symbols) {
+        EXPECT_EQ(0x11, symbol.info);
+        EXPECT_EQ(1u, symbol.section);
+        EXPECT_EQ(0u, symbol.value % 8);
+    }
+    EXPECT_EQ(sizeof(package), symbols[0].size);
+    EXPECT_EQ(sizeof(hash), symbols[1].size);
+    const uint8_t* rodata = object.data() + sections[1].offset;
+    EXPECT_EQ(0, std::memcmp(rodata + symbols[0].value, package, sizeof(package)));
+    EXPECT_EQ(0, std::memcmp(rodata + symbols[1].value, hash, sizeof(hash)));
+}
+
+TEST(ElfObjectGen, x86_64)
+{
+    checkObject("x86_64", true, 62);
+}
+
+TEST(ElfObjectGen, aarch64)
+{
+    checkObject("aarch64", true, 183);
+}
+
+TEST(ElfObjectGen, arm)
+{
+    checkObject("arm", false, 40);
+}
+
+TEST(ElfObjectGen, riscv32)
+{
+    checkObject("riscv32", false, 243);
+}
+
+TEST(ElfObjectGen, unknownTarget)
+{
+    EXPECT_TRUE(ElfObjectGen::findTarget("mips").isNone());
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "TestPackage.h"
+
+#include "decode/generator/GcInterfaceGen.h"
+#include "decode/generator/SrcBuilder.h"
+#include "decode/core/Configuration.h"
+
+#include <gtest/gtest.h>
+
+using namespace decode;
+
+static const char* cfgModule =
+    "module foo\n"
+    "\n"
+    "component {\n"
+    "    commands {\n"
+    "        fn always()\n"
+    "        #[cfg(heater)]\n"
+    "        fn heat()\n"
+    "        #[cfg(not(heater))]\n"
+    "        fn cool()\n"
+    "    }\n"
+    "}\n";
+
+static std::string generateValidator(const Package* package, const Configuration* cfg)
+{
+    SrcBuilder output;
+    GcInterfaceGen gen(&output);
+    gen.setConfiguration(cfg);
+    gen.generateValidatorHeader(package);
+    gen.generateSource(package);
+    return output.view().toStdString();
+}
+
+static bool hasEncoder(const std::string& src, bmcl::StringView cmdName)
+{
+    return src.find("bool encodeCmdFoo" + cmdName.toStdString() + "(") != std::string::npos;
+}
+
+static bool hasSchemaCmd(const std::string& src, bmcl::StringView cmdName)
+{
+    return src.find(", \"" + cmdName.toStdString() + "\", ") != std::string::npos;
+}
+
+TEST(GcInterfaceGen, cfgDisabled)
+{
+    Rc<Package> package = parseTestPackage({cfgModule});
+    ASSERT_TRUE(package.get() != nullptr);
+
+    Rc<Configuration> cfg = new Configuration;
+    std::string src = generateValidator(package.get(), cfg.get());
+    EXPECT_TRUE(hasEncoder(src, "Always"));
+    EXPECT_FALSE(hasEncoder(src, "Heat"));
+    EXPECT_TRUE(hasEncoder(src, "Cool"));
+    EXPECT_TRUE(hasSchemaCmd(src, "always"));
+    EXPECT_FALSE(hasSchemaCmd(src, "heat"));
+    EXPECT_TRUE(hasSchemaCmd(src, "cool"));
+}
+
+TEST(GcInterfaceGen, cfgEnabled)
+{
+    Rc<Package> package = parseTestPackage({cfgModule});
+    ASSERT_TRUE(package.get() != nullptr);
+
+    Rc<Configuration> cfg = new Configuration;
+    cfg->setCfgOption("heater");
+    std::string src = generateValidator(package.get(), cfg.get());
+    EXPECT_TRUE(hasEncoder(src, "Always"));
+    EXPECT_TRUE(hasEncoder(src, "Heat"));
+    EXPECT_FALSE(hasEncoder(src, "Cool"));
+    EXPECT_FALSE(hasSchemaCmd(src, "cool"));
+}
@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "TestPackage.h"
+
+#include "decode/runtime/LogDecoder.h"
+#include "decode/runtime/MsgStatsFormat.h"
+
+#include <bmcl/Buffer.h>
+
+#include <gtest/gtest.h>
+
+using namespace decode;
+
+static const char* logModule =
+    "module foo\n"
+    "\n"
+    "component {\n"
+    "    variables {\n"
+    "        a: u32,\n"
+    "        b: u8,\n"
+    "    }\n"
+    "\n"
+    "    commands {\n"
+    "        fn set(v: u8)\n"
+    "    }\n"
+    "\n"
+    "    statuses {\n"
+    "        [state, 0, true]: {a, b},\n"
+    "    }\n"
+    "\n"
+    "    events {\n"
+    "        [alarm, true]: {code: u16},\n"
+    "    }\n"
+    "}\n";
+
+static void appendFrame(const bmcl::Buffer& payload, bmcl::Buffer* log)
+{
+    log->writeVarUint(payload.size());
+    log->write(payload.data(), payload.size());
+}
+
+static void decodeLog(const LogDecoder* decoder, const bmcl::Buffer& log, LogChunkResult* result)
+{
+    std::vector<LogFrame> frames;
+    std::size_t errorOffset;
+    EXPECT_TRUE(LogDecoder::splitFrames(log, &frames, &errorOffset));
+    decoder->decodeFrames(log, frames, 0, result);
+}
+
+TEST(LogDecoder, splitFrames)
+{
+    bmcl::Buffer log;
+    bmcl::Buffer payload;
+    payload.writeUint8(1);
+    payload.writeUint8(2);
+    appendFrame(payload, &log);
+    appendFrame(bmcl::Buffer(), &log);
+    appendFrame(payload, &log);
+
+    std::vector<LogFrame> frames;
+    std::size_t errorOffset = 0;
+    ASSERT_TRUE(LogDecoder::splitFrames(log, &frames, &errorOffset));
+    ASSERT_EQ(3u, frames.size());
+    EXPECT_EQ(1u, frames[0].offset);
+    EXPECT_EQ(2u, frames[0].size);
+    EXPECT_EQ(0u, frames[1].size);
+    EXPECT_EQ(5u, frames[2].offset);
+}
+
+TEST(LogDecoder, splitTruncatedFrame)
+{
+    bmcl::Buffer log;
+    bmcl::Buffer payload;
+    payload.writeUint32Le(0);
+    appendFrame(payload, &log);
+    log.writeVarUint(10);
+    log.writeUint8(0);
+
+    std::vector<LogFrame> frames;
+    std::size_t errorOffset = 0;
+    EXPECT_FALSE(LogDecoder::splitFrames(log, &frames, &errorOffset));
+    EXPECT_EQ(1u, frames.size());
+    EXPECT_EQ(5u, errorOffset);
+}
+
+TEST(LogDecoder, statusesAndEvents)
+{
+    Rc<Package> package = parseTestPackage({logModule});
+    ASSERT_TRUE(package.get() != nullptr);
+    Rc<LogDecoder> decoder = new LogDecoder(package.get());
+
+    bmcl::Buffer payload;
+    payload.writeUint8(0);
+    payload.writeUint8(0);
+    payload.writeUint32Le(5);
+    payload.writeUint8(6);
+    payload.writeUint8(0);
+    payload.writeUint8(0);
+    payload.writeUint16Le(7);
+    bmcl::Buffer log;
+    appendFrame(payload, &log);
+
+    LogChunkResult result;
+    decodeLog(decoder.get(), log, &result);
+    EXPECT_EQ(2u, result.messages);
+    EXPECT_EQ(0u, result.errors);
+    EXPECT_EQ("0: foo.state {5, 6} foo.alarm {7}\n", result.output.toStdString());
+}
+
+TEST(LogDecoder, unknownMessage)
+{
+    Rc<Package> package = parseTestPackage({logModule});
+    ASSERT_TRUE(package.get() != nullptr);
+    Rc<LogDecoder> decoder = new LogDecoder(package.get());
+
+    bmcl::Buffer payload;
+    payload.writeUint8(3);
+    payload.writeUint8(1);
+    bmcl::Buffer log;
+    appendFrame(payload, &log);
+
+    LogChunkResult result;
+    decodeLog(decoder.get(), log, &result);
+    EXPECT_EQ(0u, result.messages);
+    EXPECT_EQ(1u, result.errors);
+    EXPECT_EQ("0: error: unknown message 3:1\n", result.output.toStdString());
+}
+
+TEST(LogDecoder, msgStats)
+{
+    Rc<Package> package = parseTestPackage({logModule});
+    ASSERT_TRUE(package.get() != nullptr);
+    Rc<LogDecoder> decoder = new LogDecoder(package.get());
+
+    bmcl::Buffer payload;
+    payload.writeUint8(MsgStatsFormat::compNum);
+    payload.writeUint8(MsgStatsFormat::msgNum);
+    payload.writeUint16Le(1);
+    payload.writeUint16Le(2);
+    for (uint32_t i = 0; i < 2; i++) {
+        payload.writeUint32Le(1 + i);
+        payload.writeUint32Le(10);
+        payload.writeUint32Le(0);
+        payload.writeUint32Le(0);
+        for (std::size_t j = 0; j < MsgStatsFormat::errorSlots; j++) {
+            payload.writeUint32Le(j == 1);
+        }
+        payload.writeUint64Le(100);
+    }
+    bmcl::Buffer log;
+    appendFrame(payload, &log);
+
+    LogChunkResult result;
+    decodeLog(decoder.get(), log, &result);
+    EXPECT_EQ(1u, result.messages);
+    EXPECT_EQ(0u, result.errors);
+    EXPECT_EQ("0: MsgStats {foo.event.alarm: {1, 10, 0, 0, [0, 1, 0, 0, 0, 0, 0, 0], 100}, "
+              "foo.cmd.set: {2, 10, 0, 0, [0, 1, 0, 0, 0, 0, 0, 0], 100}}\n",
+              result.output.toStdString());
+}
+
+TEST(LogDecoder, msgStatsOutOfRange)
+{
+    Rc<Package> package = parseTestPackage({logModule});
+    ASSERT_TRUE(package.get() != nullptr);
+    Rc<LogDecoder> decoder = new LogDecoder(package.get());
+
+    bmcl::Buffer payload;
+    payload.writeUint8(MsgStatsFormat::compNum);
+    payload.writeUint8(MsgStatsFormat::msgNum);
+    payload.writeUint16Le(2);
+    payload.writeUint16Le(2);
+    bmcl::Buffer log;
+    appendFrame(payload, &log);
+
+    LogChunkResult result;
+    decodeLog(decoder.get(), log, &result);
+    EXPECT_EQ(1u, result.errors);
+    EXPECT_EQ("0: error: failed to decode MsgStats\n", result.output.toStdString());
+}
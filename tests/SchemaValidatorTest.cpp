@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "TestPackage.h"
+
+#include "decode/runtime/SchemaValidator.h"
+#include "decode/ast/Type.h"
+
+#include <gtest/gtest.h>
+
+using namespace decode;
+
+static const char* coreModule =
+    "module core\n";
+
+static const char* appModule =
+    "module app\n"
+    "\n"
+    "struct Point {\n"
+    "    x: u16,\n"
+    "    y: i32,\n"
+    "}\n"
+    "\n"
+    "component {\n"
+    "    variables {\n"
+    "        p: Point,\n"
+    "    }\n"
+    "\n"
+    "    commands {\n"
+    "        fn move(a: u8, p: Point)\n"
+    "        fn ping()\n"
+    "    }\n"
+    "\n"
+    "    statuses {\n"
+    "        [pos, 0, true]: {p},\n"
+    "    }\n"
+    "\n"
+    "    events {\n"
+    "        [hit, true]: {code: u16},\n"
+    "    }\n"
+    "}\n";
+
+static SchemaType builtin(BuiltinTypeKind kind)
+{
+    return SchemaType{SchemaTypeKind::Builtin, uint8_t(kind), 0, nullptr, 0, schemaNoType, 0, 0};
+}
+
+class SchemaValidatorTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        _project = parseTestProject("SchemaValidatorTest", {{"core", coreModule}, {"app", appModule}});
+        ASSERT_TRUE(_project.get() != nullptr);
+    }
+
+    Rc<Project> _project;
+};
+
+static const char* modules[] = {"core", "app", "missing"};
+static const SchemaField fields[] = {{"x", 1}, {"y", 2}};
+
+TEST_F(SchemaValidatorTest, commands)
+{
+    const SchemaType types[] = {
+        builtin(BuiltinTypeKind::U8),
+        builtin(BuiltinTypeKind::U16),
+        builtin(BuiltinTypeKind::I32),
+        SchemaType{SchemaTypeKind::Struct, 0, 1, "Point", 0, schemaNoType, 0, 2},
+        SchemaType{SchemaTypeKind::Struct, 0, 1, "Point", 0, schemaNoType, 0, 1},
+    };
+    const uint32_t typeRefs[] = {0, 3, 1, 3, 0, 4};
+    const SchemaCmd cmds[] = {
+        {1, "move", 0, 2, schemaNoType},
+        {1, "ping", 0, 0, schemaNoType},
+        {1, "move", 2, 2, schemaNoType},
+        {1, "move", 4, 2, schemaNoType},
+        {1, "jump", 0, 0, schemaNoType},
+        {2, "ping", 0, 0, schemaNoType},
+        {1, "ping", 0, 0, 0},
+    };
+
+    Schema schema{modules, types, fields, typeRefs, cmds, bmcl::ArrayView<SchemaMsg>()};
+    SchemaValidationResult result;
+    validateSchema(schema, _project->master(), &result);
+
+    ASSERT_EQ(3u, result.components.size());
+    EXPECT_TRUE(result.components[0].isNone());
+    EXPECT_TRUE(result.components[1].isSome());
+    EXPECT_TRUE(result.components[2].isNone());
+
+    ASSERT_EQ(7u, result.cmds.size());
+    ASSERT_TRUE(result.cmds[0].isSome());
+    EXPECT_EQ(0u, result.cmds[0].unwrap());
+    ASSERT_TRUE(result.cmds[1].isSome());
+    EXPECT_EQ(1u, result.cmds[1].unwrap());
+    EXPECT_TRUE(result.cmds[2].isNone());
+    EXPECT_TRUE(result.cmds[3].isNone());
+    EXPECT_TRUE(result.cmds[4].isNone());
+    EXPECT_TRUE(result.cmds[5].isNone());
+    EXPECT_TRUE(result.cmds[6].isNone());
+}
+
+TEST_F(SchemaValidatorTest, messages)
+{
+    const SchemaMsg msgs[] = {
+        {1, "pos", false},
+        {1, "hit", true},
+        {1, "pos", true},
+        {1, "hit", false},
+        {2, "pos", false},
+    };
+
+    Schema schema{modules, bmcl::ArrayView<SchemaType>(), bmcl::ArrayView<SchemaField>(),
+                  bmcl::ArrayView<uint32_t>(), bmcl::ArrayView<SchemaCmd>(), msgs};
+    SchemaValidationResult result;
+    validateSchema(schema, _project->master(), &result);
+
+    ASSERT_EQ(5u, result.msgs.size());
+    ASSERT_TRUE(result.msgs[0].isSome());
+    EXPECT_EQ(0u, result.msgs[0].unwrap());
+    ASSERT_TRUE(result.msgs[1].isSome());
+    EXPECT_EQ(0u, result.msgs[1].unwrap());
+    EXPECT_TRUE(result.msgs[2].isNone());
+    EXPECT_TRUE(result.msgs[3].isNone());
+    EXPECT_TRUE(result.msgs[4].isNone());
+}
+
+TEST_F(SchemaValidatorTest, missingCoreModule)
+{
+    static const char* appOnly[] = {"app"};
+    const SchemaType types[] = {
+        builtin(BuiltinTypeKind::U8),
+    };
+    const uint32_t typeRefs[] = {0, 0};
+    const SchemaCmd cmds[] = {
+        {0, "ping", 0, 0, schemaNoType},
+        {0, "move", 0, 2, schemaNoType},
+    };
+
+    Schema schema{appOnly, types, bmcl::ArrayView<SchemaField>(), typeRefs, cmds, bmcl::ArrayView<SchemaMsg>()};
+    SchemaValidationResult result;
+    validateSchema(schema, _project->master(), &result);
+
+    ASSERT_EQ(2u, result.cmds.size());
+    EXPECT_TRUE(result.cmds[0].isSome());
+    EXPECT_TRUE(result.cmds[1].isNone());
+}
+
+TEST(SchemaValidator, noDevice)
+{
+    const SchemaCmd cmds[] = {
+        {0, "ping", 0, 0, schemaNoType},
+    };
+    Schema schema{modules, bmcl::ArrayView<SchemaType>(), bmcl::ArrayView<SchemaField>(),
+                  bmcl::ArrayView<uint32_t>(), cmds, bmcl::ArrayView<SchemaMsg>()};
+    SchemaValidationResult result;
+    validateSchema(schema, nullptr, &result);
+
+    ASSERT_EQ(3u, result.components.size());
+    EXPECT_TRUE(result.components[1].isNone());
+    ASSERT_EQ(1u, result.cmds.size());
+    EXPECT_TRUE(result.cmds[0].isNone());
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "decode/core/Configuration.h"
+#include "decode/core/Diagnostics.h"
+#include "decode/core/PathUtils.h"
+#include "decode/core/Utils.h"
+#include "decode/parser/Package.h"
+#include "decode/parser/Project.h"
+
+#include <bmcl/Buffer.h>
+#include <bmcl/Result.h>
+#include <bmcl/StringView.h>
+
+#include <initializer_list>
+#include <iostream>
+#include <string>
+#include <utility>
+
+// parses in-memory module sources, one module per string, returns null on error
+inline decode::Rc<decode::Package> parseTestPackage(std::initializer_list<bmcl::StringView> modules,
+                                                    decode::Configuration* cfg = nullptr)
+{
+    bmcl::Buffer buf;
+    std::size_t i = 0;
+    for (bmcl::StringView contents : modules) {
+        decode::serializeString("mod" + std::to_string(i) + ".decode", &buf);
+        decode::serializeString(contents, &buf);
+        i++;
+    }
+    decode::Rc<decode::Configuration> defaultCfg = new decode::Configuration;
+    decode::Rc<decode::Diagnostics> diag = new decode::Diagnostics;
+    decode::PackageResult package = decode::Package::decodeFromMemory(cfg ? cfg : defaultCfg.get(), diag.get(), buf.data(), buf.size());
+    if (package.isErr()) {
+        diag->printReports(&std::cerr);
+        return nullptr;
+    }
+    return package.unwrap();
+}
+
+// writes project.toml with a single "master" device using all modules, module name maps to its source
+inline decode::Rc<decode::Project> parseTestProject(const std::string& dir,
+                                                    std::initializer_list<std::pair<const char*, const char*>> modules)
+{
+    decode::Rc<decode::Configuration> cfg = new decode::Configuration;
+    decode::Rc<decode::Diagnostics> diag = new decode::Diagnostics;
+    if (!decode::makeDirectoryRecursive(dir, diag.get())) {
+        return nullptr;
+    }
+    std::string moduleList;
+    std::size_t id = 0;
+    for (const std::pair<const char*, const char*>& module : modules) {
+        std::string name = module.first;
+        std::string modDir = decode::joinPath(dir, name);
+        std::string modFile = "id = " + std::to_string(id) + "\nname = \"" + name + "\"\ndest = \"" + name
+                              + "\"\ndecode = \"" + name + ".decode\"\n";
+        if (!decode::makeDirectoryRecursive(modDir, diag.get())
+            || !decode::saveOutput(decode::joinPath(modDir, "mod.toml"), modFile, diag.get())
+            || !decode::saveOutput(decode::joinPath(modDir, name + ".decode"), bmcl::StringView(module.second), diag.get())) {
+            return nullptr;
+        }
+        if (id != 0) {
+            moduleList += ", ";
+        }
+        moduleList += "\"" + name + "\"";
+        id++;
+    }
+    std::string projectFile = "[project]\nname = \"test\"\nmaster = \"master\"\nmcc_id = 0\nmodule_dirs = [" + moduleList
+                              + "]\n\n[[devices]]\nname = \"master\"\nid = 1\nmodules = [" + moduleList + "]\n";
+    std::string projectPath = decode::joinPath(dir, "project.toml");
+    if (!decode::saveOutput(projectPath, projectFile, diag.get())) {
+        return nullptr;
+    }
+    decode::ProjectResult project = decode::Project::fromFile(cfg.get(), diag.get(), projectPath.c_str());
+    if (project.isErr()) {
+        diag->printReports(&std::cerr);
+        return nullptr;
+    }
+    return project.unwrap();
+}
@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "TestPackage.h"
+
+#include "decode/runtime/TmArchive.h"
+
+#include <bmcl/Buffer.h>
+#include <bmcl/MemReader.h>
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <iterator>
+
+using namespace decode;
+
+static const char* archiveModule =
+    "module arch\n"
+    "\n"
+    "enum Mode {\n"
+    "    Off = 0,\n"
+    "    On = 5,\n"
+    "}\n"
+    "\n"
+    "struct Pair {\n"
+    "    x: u8,\n"
+    "    y: u8,\n"
+    "}\n"
+    "\n"
+    "component {\n"
+    "    variables {\n"
+    "        counter: u32,\n"
+    "        offset: i16,\n"
+    "        temp: f64,\n"
+    "        flag: bool,\n"
+    "        mode: Mode,\n"
+    "        pair: Pair,\n"
+    "    }\n"
+    "\n"
+    "    statuses {\n"
+    "        [all, 0, true]: {counter, offset, temp, flag, mode, pair},\n"
+    "    }\n"
+    "\n"
+    "    events {\n"
+    "        [ev, true]: {code: u16},\n"
+    "    }\n"
+    "}\n";
+
+static const char* archivePath = "TmArchiveTest.dtma";
+
+static void appendRow(uint32_t i, bmcl::Buffer* dest)
+{
+    dest->writeUint32Le(1000 + i * 3);
+    dest->writeUint16Le(uint16_t(int16_t(-int(i))));
+    dest->writeFloat64Le(i * 0.5);
+    dest->writeUint8(i % 2);
+    dest->writeVarInt((i % 3) == 0 ? 5 : 0);
+    dest->writeUint8(i);
+    dest->writeUint8(i * 2);
+}
+
+static void writeArchive(const Package* package, std::size_t rows)
+{
+    Rc<TmArchiveWriter> writer = new TmArchiveWriter(package, 4);
+    ASSERT_TRUE(writer->open(archivePath));
+    for (uint32_t i = 0; i < rows; i++) {
+        bmcl::Buffer row;
+        appendRow(i, &row);
+        bmcl::MemReader src(row.data(), row.size());
+        ASSERT_TRUE(writer->appendStatus(i * 10, 0, 0, &src));
+        EXPECT_EQ(0u, src.sizeLeft());
+    }
+    ASSERT_TRUE(writer->finish());
+}
+
+static std::vector<TmSample> scan(const TmArchiveReader* reader, bmcl::StringView name, uint64_t from, uint64_t to)
+{
+    std::vector<TmSample> samples;
+    bmcl::Option<std::size_t> table = reader->findTable(0, 0);
+    EXPECT_TRUE(table.isSome());
+    bmcl::Option<std::size_t> column = reader->findColumn(table.unwrap(), name);
+    EXPECT_TRUE(column.isSome());
+    EXPECT_TRUE(reader->scanColumn(table.unwrap(), column.unwrap(), from, to, &samples));
+    return samples;
+}
+
+TEST(TmArchive, roundTrip)
+{
+    Rc<Package> package = parseTestPackage({archiveModule});
+    ASSERT_TRUE(package.get() != nullptr);
+    writeArchive(package.get(), 10);
+
+    TmArchiveReaderResult reader = TmArchiveReader::open(archivePath);
+    ASSERT_TRUE(reader.isOk());
+    const TmArchiveReader* r = reader.unwrap().get();
+    ASSERT_EQ(1u, r->tables().size());
+    EXPECT_EQ(3u, r->blocks().size());
+
+    std::vector<TmSample> counter = scan(r, "counter", 0, 1000);
+    ASSERT_EQ(10u, counter.size());
+    std::vector<TmSample> offset = scan(r, "offset", 0, 1000);
+    std::vector<TmSample> temp = scan(r, "temp", 0, 1000);
+    std::vector<TmSample> flag = scan(r, "flag", 0, 1000);
+    std::vector<TmSample> mode = scan(r, "mode", 0, 1000);
+    std::vector<TmSample> pair = scan(r, "pair", 0, 1000);
+    ASSERT_EQ(10u, pair.size());
+    for (uint32_t i = 0; i < 10; i++) {
+        EXPECT_EQ(i * 10, counter[i].time);
+        EXPECT_EQ(1000 + i * 3, counter[i].u);
+        EXPECT_EQ(-int64_t(i), offset[i].i);
+        EXPECT_EQ(i * 0.5, temp[i].d);
+        EXPECT_EQ(i % 2, flag[i].u);
+        EXPECT_EQ((i % 3) == 0 ? 5 : 0, mode[i].i);
+        ASSERT_EQ(2u, pair[i].blob.size());
+        EXPECT_EQ(i, pair[i].blob[0]);
+        EXPECT_EQ(i * 2, pair[i].blob[1]);
+    }
+}
+
+TEST(TmArchive, timeRange)
+{
+    Rc<Package> package = parseTestPackage({archiveModule});
+    ASSERT_TRUE(package.get() != nullptr);
+    writeArchive(package.get(), 10);
+
+    TmArchiveReaderResult reader = TmArchiveReader::open(archivePath);
+    ASSERT_TRUE(reader.isOk());
+    std::vector<TmSample> samples = scan(reader.unwrap().get(), "counter", 25, 55);
+    ASSERT_EQ(3u, samples.size());
+    EXPECT_EQ(30u, samples[0].time);
+    EXPECT_EQ(50u, samples[2].time);
+    EXPECT_EQ(1015u, samples[2].u);
+}
+
+TEST(TmArchive, appendFrame)
+{
+    Rc<Package> package = parseTestPackage({archiveModule});
+    ASSERT_TRUE(package.get() != nullptr);
+
+    Rc<TmArchiveWriter> writer = new TmArchiveWriter(package.get());
+    ASSERT_TRUE(writer->open(archivePath));
+    bmcl::Buffer payload;
+    payload.writeUint8(0);
+    payload.writeUint8(0);
+    appendRow(7, &payload);
+    payload.writeUint8(0);
+    payload.writeUint8(0);
+    appendRow(8, &payload);
+    EXPECT_TRUE(writer->appendFrame(3, payload));
+
+    bmcl::Buffer unknown;
+    unknown.writeUint8(4);
+    unknown.writeUint8(4);
+    EXPECT_FALSE(writer->appendFrame(4, unknown));
+    ASSERT_TRUE(writer->finish());
+
+    TmArchiveReaderResult reader = TmArchiveReader::open(archivePath);
+    ASSERT_TRUE(reader.isOk());
+    std::vector<TmSample> samples = scan(reader.unwrap().get(), "counter", 0, 10);
+    ASSERT_EQ(2u, samples.size());
+    EXPECT_EQ(3u, samples[0].time);
+    EXPECT_EQ(1021u, samples[0].u);
+    EXPECT_EQ(3u, samples[1].time);
+    EXPECT_EQ(1024u, samples[1].u);
+}
+
+TEST(TmArchive, corruptedFooter)
+{
+    Rc<Package> package = parseTestPackage({archiveModule});
+    ASSERT_TRUE(package.get() != nullptr);
+    writeArchive(package.get(), 10);
+
+    std::vector<char> original;
+    {
+        std::ifstream in(archivePath, std::ios::binary);
+        original.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    ASSERT_GT(original.size(), 12u);
+
+    // every mutated footer must be either rejected or scanned without reading out of bounds
+    for (std::size_t i = 4; i < original.size(); i++) {
+        std::vector<char> data = original;
+        data[i] = char(0xff);
+        {
+            std::ofstream out(archivePath, std::ios::binary | std::ios::trunc);
+            out.write(data.data(), data.size());
+        }
+        TmArchiveReaderResult reader = TmArchiveReader::open(archivePath);
+        if (reader.isErr()) {
+            continue;
+        }
+        const TmArchiveReader* r = reader.unwrap().get();
+        for (std::size_t t = 0; t < r->tables().size(); t++) {
+            for (std::size_t c = 0; c < r->tables()[t].columns.size(); c++) {
+                std::vector<TmSample> samples;
+                r->scanColumn(t, c, 0, uint64_t(-1), &samples);
+            }
+        }
+    }
+}
@@ -0,0 +1,237 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "TestPackage.h"
+
+#include "decode/generator/TypeDependsIndex.h"
+#include "decode/generator/TypeDependsCollector.h"
+#include "decode/ast/Ast.h"
+#include "decode/ast/Component.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+using namespace decode;
+
+static const char* coreModule =
+    "module core\n"
+    "\n"
+    "enum Mode {\n"
+    "    Off = 0,\n"
+    "    On = 1,\n"
+    "}\n"
+    "\n"
+    "struct Point {\n"
+    "    x: u16,\n"
+    "    y: i32,\n"
+    "}\n";
+
+static const char* appModule =
+    "module app\n"
+    "\n"
+    "import core::{Point, Mode}\n"
+    "\n"
+    "struct Route {\n"
+    "    points: &[Point; 4],\n"
+    "    mode: Mode,\n"
+    "}\n"
+    "\n"
+    "component {\n"
+    "    variables {\n"
+    "        route: Route,\n"
+    "        counter: u32,\n"
+    "    }\n"
+    "\n"
+    "    commands {\n"
+    "        fn move(p: Point, speed: f32)\n"
+    "        fn setMode(m: Mode)\n"
+    "    }\n"
+    "\n"
+    "    statuses {\n"
+    "        [state, 0, true]: {route, counter},\n"
+    "    }\n"
+    "\n"
+    "    events {\n"
+    "        [arrived, true]: {p: Point, code: u16},\n"
+    "    }\n"
+    "}\n";
+
+static const char* navModule =
+    "module nav\n"
+    "\n"
+    "import core::Point\n"
+    "\n"
+    "component {\n"
+    "    variables {\n"
+    "        target: Point,\n"
+    "    }\n"
+    "\n"
+    "    commands {\n"
+    "        fn goTo(p: Point, alt: [i16; 3])\n"
+    "    }\n"
+    "}\n";
+
+static const Ast* findModule(const Package* package, bmcl::StringView name)
+{
+    for (const Ast* ast : package->modules()) {
+        if (ast->moduleName() == name) {
+            return ast;
+        }
+    }
+    return nullptr;
+}
+
+static void expectSameDepends(const TypeDependsIndex& index, const TypeDependsIndex::Bits& bits,
+                              const TypeDependsCollector::Depends& expected)
+{
+    TypeDependsCollector::Depends depends;
+    index.toDepends(bits, &depends);
+    EXPECT_EQ(expected.size(), depends.size());
+    for (const Rc<const Type>& type : expected) {
+        EXPECT_EQ(1u, depends.count(type));
+    }
+}
+
+// every set stored in the index must match what TypeDependsCollector returns for the same module
+static void expectSameAsCollector(const Package* package)
+{
+    TypeDependsIndex index;
+    index.build(package);
+
+    TypeDependsCollector coll;
+    for (const Ast* ast : package->modules()) {
+        bmcl::OptionPtr<const TypeDependsIndex::ModuleDepends> deps = index.moduleDepends(ast);
+        ASSERT_TRUE(deps.isSome());
+
+        TypeDependsCollector::Depends expected;
+        coll.collect(ast, &expected);
+        expectSameDepends(index, deps->types, expected);
+
+        if (ast->component().isNone()) {
+            EXPECT_TRUE(deps->vars.empty());
+            EXPECT_TRUE(deps->cmds.empty());
+            continue;
+        }
+        const Component* comp = ast->component().unwrap();
+        EXPECT_EQ(deps.unwrap(), index.componentDepends(comp).unwrap());
+
+        expected.clear();
+        coll.collect(comp, &expected);
+        expectSameDepends(index, deps->vars, expected);
+
+        expected.clear();
+        coll.collectCmds(comp->cmdsRange(), &expected);
+        expectSameDepends(index, deps->cmds, expected);
+
+        expected.clear();
+        coll.collectStatuses(comp->statusesRange(), &expected);
+        expectSameDepends(index, deps->statuses, expected);
+
+        expected.clear();
+        coll.collectEvents(comp->eventsRange(), &expected);
+        expectSameDepends(index, deps->events, expected);
+    }
+}
+
+TEST(TypeDependsIndex, sameAsCollector)
+{
+    Rc<Package> package = parseTestPackage({coreModule, appModule, navModule});
+    ASSERT_TRUE(package.get() != nullptr);
+    expectSameAsCollector(package.get());
+}
+
+TEST(TypeDependsIndex, sameAsCollectorManyTypes)
+{
+    // more than 64 types to spread sets over several words
+    std::string module = "module many\n\n";
+    std::string fields;
+    for (std::size_t i = 0; i < 100; i++) {
+        std::string name = "S" + std::to_string(i);
+        module += "struct " + name + " {\n    a: u8,\n}\n\n";
+        fields += "        v" + std::to_string(i) + ": " + name + ",\n";
+    }
+    module += "component {\n    variables {\n" + fields + "    }\n\n"
+              "    commands {\n        fn last(a: S99, b: S63, c: S64)\n    }\n}\n";
+
+    Rc<Package> package = parseTestPackage({coreModule, bmcl::StringView(module)});
+    ASSERT_TRUE(package.get() != nullptr);
+    expectSameAsCollector(package.get());
+
+    TypeDependsIndex index;
+    index.build(package.get());
+    EXPECT_GE(index.typeCount(), 100u);
+    const TypeDependsIndex::ModuleDepends* deps = index.moduleDepends(findModule(package.get(), "many")).unwrap();
+    EXPECT_GE(deps->vars.size(), 2u);
+}
+
+TEST(TypeDependsIndex, sharedTypesIndexedOnce)
+{
+    Rc<Package> package = parseTestPackage({coreModule, appModule, navModule});
+    ASSERT_TRUE(package.get() != nullptr);
+
+    TypeDependsIndex index;
+    index.build(package.get());
+
+    TypeDependsCollector coll;
+    TypeDependsCollector::Depends all;
+    for (const Ast* ast : package->modules()) {
+        coll.collect(ast, &all);
+        if (ast->component().isNone()) {
+            continue;
+        }
+        const Component* comp = ast->component().unwrap();
+        coll.collect(comp, &all);
+        coll.collectCmds(comp->cmdsRange(), &all);
+        coll.collectStatuses(comp->statusesRange(), &all);
+        coll.collectEvents(comp->eventsRange(), &all);
+    }
+    EXPECT_EQ(all.size(), index.typeCount());
+}
+
+TEST(TypeDependsIndex, unite)
+{
+    Rc<Package> package = parseTestPackage({coreModule, appModule, navModule});
+    ASSERT_TRUE(package.get() != nullptr);
+    const Ast* app = findModule(package.get(), "app");
+    const Ast* nav = findModule(package.get(), "nav");
+    ASSERT_TRUE(app != nullptr);
+    ASSERT_TRUE(nav != nullptr);
+
+    TypeDependsIndex index;
+    index.build(package.get());
+
+    TypeDependsIndex::Bits bits;
+    TypeDependsIndex::unite(&bits, index.moduleDepends(app)->cmds);
+    TypeDependsIndex::unite(&bits, index.moduleDepends(nav)->cmds);
+    TypeDependsIndex::unite(&bits, TypeDependsIndex::Bits());
+
+    TypeDependsCollector coll;
+    TypeDependsCollector::Depends expected;
+    coll.collectCmds(app->component()->cmdsRange(), &expected);
+    coll.collectCmds(nav->component()->cmdsRange(), &expected);
+    expectSameDepends(index, bits, expected);
+}
+
+TEST(TypeDependsIndex, unknownModule)
+{
+    Rc<Package> package = parseTestPackage({coreModule, navModule});
+    ASSERT_TRUE(package.get() != nullptr);
+    Rc<Package> other = parseTestPackage({coreModule});
+    ASSERT_TRUE(other.get() != nullptr);
+
+    TypeDependsIndex index;
+    index.build(package.get());
+    EXPECT_TRUE(index.moduleDepends(findModule(other.get(), "core")).isNone());
+    EXPECT_TRUE(index.moduleDepends(findModule(package.get(), "nav")).isSome());
+    EXPECT_TRUE(index.componentDepends(findModule(package.get(), "nav")->component().unwrap()).isSome());
+
+    index.clear();
+    EXPECT_EQ(0u, index.typeCount());
+    EXPECT_TRUE(index.moduleDepends(findModule(package.get(), "nav")).isNone());
+}
@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "decode/ast/TypeInterner.h"
+#include "decode/ast/AllBuiltinTypes.h"
+#include "decode/ast/Ast.h"
+#include "decode/ast/Type.h"
+#include "decode/ast/Field.h"
+
+#include <gtest/gtest.h>
+
+using namespace decode;
+
+class TypeInternerTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        _builtins = new AllBuiltinTypes;
+        _interner = new TypeInterner;
+        _a = new Ast(_builtins.get(), _interner.get());
+        _b = new Ast(_builtins.get(), _interner.get());
+    }
+
+    Type* u8()
+    {
+        return _builtins->u8Type();
+    }
+
+    Type* intern(Type* type, Ast* ast)
+    {
+        Rc<Type> holder = type;
+        return _interner->intern(type, ast);
+    }
+
+    Rc<AllBuiltinTypes> _builtins;
+    Rc<TypeInterner> _interner;
+    Rc<Ast> _a;
+    Rc<Ast> _b;
+};
+
+TEST_F(TypeInternerTest, equalTypes)
+{
+    Type* first = intern(new ArrayType(3, u8()), _a.get());
+    Type* second = intern(new ArrayType(3, u8()), _a.get());
+    EXPECT_EQ(first, second);
+    EXPECT_EQ(1u, _interner->size());
+    EXPECT_EQ(1u, _a->typesRange().size());
+}
+
+TEST_F(TypeInternerTest, differentTypes)
+{
+    Type* array = intern(new ArrayType(3, u8()), _a.get());
+    EXPECT_NE(array, intern(new ArrayType(4, u8()), _a.get()));
+    EXPECT_NE(array, intern(new DynArrayType(3, u8()), _a.get()));
+    EXPECT_NE(array, intern(new ArrayType(3, _builtins->u16Type()), _a.get()));
+
+    Type* ptr = intern(new ReferenceType(ReferenceKind::Pointer, false, u8()), _a.get());
+    EXPECT_NE(ptr, intern(new ReferenceType(ReferenceKind::Pointer, true, u8()), _a.get()));
+    EXPECT_NE(ptr, intern(new ReferenceType(ReferenceKind::Reference, false, u8()), _a.get()));
+    EXPECT_EQ(ptr, intern(new ReferenceType(ReferenceKind::Pointer, false, u8()), _a.get()));
+    EXPECT_EQ(7u, _interner->size());
+    EXPECT_EQ(7u, _a->typesRange().size());
+}
+
+TEST_F(TypeInternerTest, nestedTypes)
+{
+    Type* inner = intern(new ArrayType(2, u8()), _a.get());
+    Type* outer = intern(new DynArrayType(5, inner), _a.get());
+    Type* sameInner = intern(new ArrayType(2, u8()), _a.get());
+    EXPECT_EQ(inner, sameInner);
+    EXPECT_EQ(outer, intern(new DynArrayType(5, sameInner), _a.get()));
+    EXPECT_EQ(2u, _interner->size());
+}
+
+TEST_F(TypeInternerTest, functions)
+{
+    auto makeFunc = [this](bmcl::StringView argName) {
+        Rc<FunctionType> func = new FunctionType;
+        func->addArgument(new Field(argName, u8()));
+        func->setReturnValue(_builtins->u16Type());
+        return func;
+    };
+    Rc<FunctionType> first = makeFunc("");
+    Rc<FunctionType> second = makeFunc("");
+    EXPECT_EQ(first.get(), _interner->intern(first.get(), _a.get()));
+    EXPECT_EQ(first.get(), _interner->intern(second.get(), _a.get()));
+
+    // named arguments are part of the declaration, such functions are never shared
+    Rc<FunctionType> named = makeFunc("x");
+    EXPECT_EQ(named.get(), _interner->intern(named.get(), _a.get()));
+    Rc<FunctionType> sameNamed = makeFunc("x");
+    EXPECT_EQ(sameNamed.get(), _interner->intern(sameNamed.get(), _a.get()));
+    EXPECT_EQ(1u, _interner->size());
+    EXPECT_EQ(3u, _a->typesRange().size());
+}
+
+TEST_F(TypeInternerTest, addedOncePerModule)
+{
+    Type* type = intern(new ArrayType(3, u8()), _a.get());
+    EXPECT_EQ(type, intern(new ArrayType(3, u8()), _b.get()));
+    // a module can intern again after another one did, e.g. when var regexps are resolved
+    EXPECT_EQ(type, intern(new ArrayType(3, u8()), _a.get()));
+    EXPECT_EQ(type, intern(new ArrayType(3, u8()), _b.get()));
+
+    ASSERT_EQ(1u, _a->typesRange().size());
+    ASSERT_EQ(1u, _b->typesRange().size());
+    EXPECT_EQ(type, *_a->typesRange().begin());
+    EXPECT_EQ(type, *_b->typesRange().begin());
+}
@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "decode/generator/TypeNameCache.h"
+#include "decode/generator/TypeNameGen.h"
+#include "decode/generator/TypeReprGen.h"
+#include "decode/generator/SrcBuilder.h"
+#include "decode/ast/Type.h"
+#include "decode/ast/Field.h"
+#include "decode/ast/ModuleInfo.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+using namespace decode;
+
+TEST(TypeNameCache, names)
+{
+    Rc<Type> a = new BuiltinType(BuiltinTypeKind::U8);
+    Rc<Type> b = new BuiltinType(BuiltinTypeKind::U8);
+    TypeNameCache cache;
+    cache.addCacheableType(a.get());
+    cache.addCacheableType(b.get());
+    EXPECT_TRUE(cache.findTypeName(a.get()).isNone());
+
+    bmcl::StringView name = cache.addTypeName(a.get(), "U8");
+    EXPECT_EQ("U8", name);
+    ASSERT_TRUE(cache.findTypeName(a.get()).isSome());
+    EXPECT_EQ(name.data(), cache.findTypeName(a.get()).unwrap().data());
+    EXPECT_TRUE(cache.findTypeName(b.get()).isNone());
+
+    // equal strings are stored once
+    EXPECT_EQ(name.data(), cache.addTypeName(b.get(), "U8").data());
+    EXPECT_EQ(1u, cache.stringCount());
+    EXPECT_EQ(2u, cache.stringBytes());
+}
+
+TEST(TypeNameCache, reprs)
+{
+    Rc<Type> type = new ArrayType(4, new BuiltinType(BuiltinTypeKind::U16));
+    TypeNameCache cache;
+    cache.addCacheableType(type.get());
+    EXPECT_TRUE(cache.findTypeRepr(type.get(), true).isNone());
+
+    cache.addTypeRepr(type.get(), true, "uint16_t", "[4]");
+    EXPECT_TRUE(cache.findTypeRepr(type.get(), false).isNone());
+    cache.addTypeRepr(type.get(), false, "std::array<std::uint16_t, 4>", "");
+
+    bmcl::OptionPtr<const TypeNameCache::Repr> onboard = cache.findTypeRepr(type.get(), true);
+    ASSERT_TRUE(onboard.isSome());
+    EXPECT_EQ("uint16_t", onboard->prefix);
+    EXPECT_EQ("[4]", onboard->suffix);
+    bmcl::OptionPtr<const TypeNameCache::Repr> gc = cache.findTypeRepr(type.get(), false);
+    ASSERT_TRUE(gc.isSome());
+    EXPECT_EQ("", gc->suffix);
+    EXPECT_EQ(4u, cache.stringCount());
+}
+
+TEST(TypeNameCache, clear)
+{
+    Rc<Type> type = new BuiltinType(BuiltinTypeKind::I32);
+    TypeNameCache cache;
+    cache.addCacheableType(type.get());
+    cache.addTypeName(type.get(), "I32");
+    cache.addTypeRepr(type.get(), true, "int32_t", "");
+    cache.clear();
+    EXPECT_TRUE(cache.findTypeName(type.get()).isNone());
+    EXPECT_TRUE(cache.findTypeRepr(type.get(), true).isNone());
+    EXPECT_FALSE(cache.isCacheable(type.get()));
+    EXPECT_EQ(0u, cache.stringCount());
+    EXPECT_EQ(0u, cache.stringBytes());
+}
+
+TEST(TypeNameCache, scope)
+{
+    EXPECT_EQ(nullptr, TypeNameCache::current());
+    TypeNameCache outer;
+    TypeNameCache inner;
+    {
+        TypeNameCacheScope outerScope(&outer);
+        EXPECT_EQ(&outer, TypeNameCache::current());
+        {
+            TypeNameCacheScope innerScope(&inner);
+            EXPECT_EQ(&inner, TypeNameCache::current());
+        }
+        EXPECT_EQ(&outer, TypeNameCache::current());
+    }
+    EXPECT_EQ(nullptr, TypeNameCache::current());
+}
+
+static std::string generateNames(const RcVec<Type>& types)
+{
+    SrcBuilder dest;
+    for (const Type* type : types) {
+        TypeNameGen gen(&dest);
+        gen.genTypeName(type);
+        dest.appendEol();
+    }
+    return dest.view().toStdString();
+}
+
+static std::string generateReprs(const RcVec<Type>& types)
+{
+    SrcBuilder dest;
+    TypeReprGen gen(&dest);
+    for (const Type* type : types) {
+        gen.genOnboardTypeRepr(type);
+        dest.appendEol();
+        gen.genOnboardTypeRepr(type, "field");
+        dest.appendEol();
+        gen.genGcTypeRepr(type);
+        dest.appendEol();
+        gen.genGcTypeRepr(type, "field");
+        dest.appendEol();
+    }
+    return dest.view().toStdString();
+}
+
+// cached output must match output generated without a cache, including repeated lookups
+TEST(TypeNameCache, sameOutputAsUncached)
+{
+    Rc<BuiltinType> u8 = new BuiltinType(BuiltinTypeKind::U8);
+    Rc<BuiltinType> f64 = new BuiltinType(BuiltinTypeKind::F64);
+    Rc<FunctionType> func = new FunctionType;
+    func->addArgument(new Field("", u8.get()));
+    func->setReturnValue(f64.get());
+
+    RcVec<Type> types;
+    types.emplace_back(u8.get());
+    types.emplace_back(new ArrayType(3, u8.get()));
+    types.emplace_back(new ArrayType(2, new ArrayType(3, f64.get())));
+    types.emplace_back(new DynArrayType(10, u8.get()));
+    types.emplace_back(new ReferenceType(ReferenceKind::Pointer, false, u8.get()));
+    types.emplace_back(new ReferenceType(ReferenceKind::Pointer, true, new ArrayType(4, u8.get())));
+    types.emplace_back(new ReferenceType(ReferenceKind::Reference, false, f64.get()));
+    types.emplace_back(func.get());
+    types.emplace_back(new ArrayType(2, func.get()));
+
+    ASSERT_EQ(nullptr, TypeNameCache::current());
+    std::string names = generateNames(types);
+    std::string reprs = generateReprs(types);
+
+    TypeNameCache cache;
+    for (const Type* type : types) {
+        cache.addCacheableType(type);
+    }
+    cache.addCacheableType(u8.get());
+    cache.addCacheableType(f64.get());
+    TypeNameCacheScope scope(&cache);
+    EXPECT_EQ(names, generateNames(types));
+    EXPECT_EQ(reprs, generateReprs(types));
+    EXPECT_NE(0u, cache.stringCount());
+    EXPECT_EQ(names, generateNames(types));
+    EXPECT_EQ(reprs, generateReprs(types));
+}
+
+// generators reuse one reference type and change its pointee for every field
+TEST(TypeNameCache, mutatedTemporary)
+{
+    Rc<ModuleInfo> info = new ModuleInfo("test", nullptr);
+    Rc<StructType> first = new StructType("First", info.get());
+    first->addField(new Field("a", new BuiltinType(BuiltinTypeKind::U8)));
+    Rc<StructType> second = new StructType("Second", info.get());
+    second->addField(new Field("b", new BuiltinType(BuiltinTypeKind::U16)));
+
+    TypeNameCache cache;
+    cache.addCacheableType(first.get());
+    cache.addCacheableType(second.get());
+    TypeNameCacheScope scope(&cache);
+
+    Rc<ReferenceType> ref = new ReferenceType(ReferenceKind::Reference, false, first.get());
+    SrcBuilder dest;
+    TypeReprGen reprGen(&dest);
+    TypeNameGen nameGen(&dest);
+    for (int i = 0; i < 2; i++) {
+        ref->setPointee(first.get());
+        ref->setMutable(false);
+        reprGen.genGcTypeRepr(ref.get(), "a");
+        dest.appendEol();
+        nameGen.genTypeName(ref.get());
+        dest.appendEol();
+        ref->setPointee(second.get());
+        ref->setMutable(true);
+        reprGen.genGcTypeRepr(ref.get(), "b");
+        dest.appendEol();
+        nameGen.genTypeName(ref.get());
+        dest.appendEol();
+    }
+    std::string cached = dest.view().toStdString();
+    EXPECT_FALSE(cache.isCacheable(ref.get()));
+    EXPECT_TRUE(cache.findTypeRepr(ref.get(), false).isNone());
+    EXPECT_TRUE(cache.findTypeName(ref.get()).isNone());
+
+    TypeNameCacheScope noCache(nullptr);
+    SrcBuilder expected;
+    TypeReprGen expectedReprGen(&expected);
+    TypeNameGen expectedNameGen(&expected);
+    for (int i = 0; i < 2; i++) {
+        Rc<ReferenceType> a = new ReferenceType(ReferenceKind::Reference, false, first.get());
+        expectedReprGen.genGcTypeRepr(a.get(), "a");
+        expected.appendEol();
+        expectedNameGen.genTypeName(a.get());
+        expected.appendEol();
+        Rc<ReferenceType> b = new ReferenceType(ReferenceKind::Reference, true, second.get());
+        expectedReprGen.genGcTypeRepr(b.get(), "b");
+        expected.appendEol();
+        expectedNameGen.genTypeName(b.get());
+        expected.appendEol();
+    }
+    EXPECT_EQ(expected.view().toStdString(), cached);
+    EXPECT_NE(std::string::npos, cached.find("First"));
+    EXPECT_NE(std::string::npos, cached.find("Second"));
+}